@@ -33,6 +33,14 @@ __copy_from_user_inatomic_nocache(void *to, const void __user *from,
        return __copy_from_user_ll_nocache_nozero(to, from, n);
 }
 
+/* There is no uncached copy to user space on 32-bit, use the cached one. */
+static __always_inline unsigned long __must_check
+__copy_to_user_inatomic_nocache(void __user *to, const void *from,
+				unsigned long n)
+{
+	return __copy_user_ll((__force void *)to, from, n);
+}
+
 unsigned long __must_check clear_user(void __user *mem, unsigned long len);
 unsigned long __must_check __clear_user(void __user *mem, unsigned long len);
 
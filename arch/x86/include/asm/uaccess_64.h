@@ -162,6 +162,23 @@ __copy_from_user_inatomic_nocache(void *dst, const void __user *src,
 	return ret;
 }
 
+/*
+ * __copy_user_nocache() has exception handling on both sides, so it works
+ * just as well with a user destination.
+ */
+static inline int
+__copy_to_user_inatomic_nocache(void __user *dst, const void *src,
+				unsigned size)
+{
+	long ret;
+	kasan_check_read(src, size);
+	stac();
+	ret = __copy_user_nocache((__force void *)dst,
+				  (__force const void __user *)src, size);
+	clac();
+	return ret;
+}
+
 static inline int
 __copy_from_user_flushcache(void *dst, const void __user *src, unsigned size)
 {
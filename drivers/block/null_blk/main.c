@@ -9,6 +9,9 @@
 #include <linux/sched.h>
 #include <linux/fs.h>
 #include <linux/init.h>
+#include <linux/debugfs.h>
+#include <linux/random.h>
+#include <linux/seq_file.h>
 #include "null_blk.h"
 
 #undef pr_fmt
@@ -205,6 +208,14 @@ static unsigned long g_completion_nsec = 10000;
 module_param_named(completion_nsec, g_completion_nsec, ulong, 0444);
 MODULE_PARM_DESC(completion_nsec, "Time in ns to complete a request in hardware. Default: 10,000ns");
 
+static unsigned long g_completion_batch_nsec;
+module_param_named(completion_batch_nsec, g_completion_batch_nsec, ulong, 0444);
+MODULE_PARM_DESC(completion_batch_nsec, "Complete timer mode requests together at multiples of this many ns. Default: 0 (no batching)");
+
+static bool g_latency_hist;
+module_param_named(latency_hist, g_latency_hist, bool, 0444);
+MODULE_PARM_DESC(latency_hist, "Record a histogram of request completion latencies in debugfs. Default: false");
+
 static int g_hw_queue_depth = 64;
 module_param_named(hw_queue_depth, g_hw_queue_depth, int, 0444);
 MODULE_PARM_DESC(hw_queue_depth, "Queue depth for each hardware queue. Default: 64");
@@ -440,6 +451,8 @@ static int nullb_apply_poll_queues(struct nullb_device *dev,
 
 NULLB_DEVICE_ATTR(size, ulong, NULL);
 NULLB_DEVICE_ATTR(completion_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(completion_batch_nsec, ulong, NULL);
+NULLB_DEVICE_ATTR(latency_hist, bool, NULL);
 NULLB_DEVICE_ATTR(submit_queues, uint, nullb_apply_submit_queues);
 NULLB_DEVICE_ATTR(poll_queues, uint, nullb_apply_poll_queues);
 NULLB_DEVICE_ATTR(home_node, uint, NULL);
@@ -586,9 +599,122 @@ static ssize_t nullb_device_zone_offline_store(struct config_item *item,
 }
 CONFIGFS_ATTR_WO(nullb_device_, zone_offline);
 
+static ssize_t nullb_device_latency_dist_show(struct config_item *item,
+					      char *page)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	ssize_t len = 0;
+	unsigned int i;
+
+	for (i = 0; i < dev->lat_dist_nr; i++)
+		len += scnprintf(page + len, PAGE_SIZE - len, "%s%u.%02u:%lu",
+				 i ? " " : "", dev->lat_dist[i].pct / 100,
+				 dev->lat_dist[i].pct % 100,
+				 dev->lat_dist[i].nsec);
+	len += scnprintf(page + len, PAGE_SIZE - len, "\n");
+
+	return len;
+}
+
+/* Parse a percentile such as "99" or "99.99" into 0.01% units. */
+static int nullb_parse_pct(char *str, unsigned int *pct)
+{
+	unsigned int whole, frac = 0;
+	char *dot = strchr(str, '.');
+	int ret;
+
+	if (dot) {
+		*dot++ = '\0';
+		if (!*dot || strlen(dot) > 2)
+			return -EINVAL;
+		ret = kstrtouint(dot, 10, &frac);
+		if (ret)
+			return ret;
+		if (strlen(dot) == 1)
+			frac *= 10;
+	}
+
+	ret = kstrtouint(str, 10, &whole);
+	if (ret)
+		return ret;
+	if (whole > 100)
+		return -EINVAL;
+
+	*pct = whole * 100 + frac;
+	return *pct > 10000 ? -EINVAL : 0;
+}
+
+/*
+ * A completion latency distribution, given as space separated
+ * "percentile:nsec" points, e.g. "50:10000 99:80000 99.9:500000
+ * 100:2000000". Percentiles and latencies must be increasing and the last
+ * point must be the 100th percentile. Each timer mode request samples its
+ * completion time from the table, interpolating linearly between points.
+ * Writing an empty string goes back to using completion_nsec.
+ */
+static ssize_t nullb_device_latency_dist_store(struct config_item *item,
+					       const char *page, size_t count)
+{
+	struct nullb_device *dev = to_nullb_device(item);
+	struct nullb_lat_point dist[NULLB_LAT_DIST_MAX];
+	char *orig, *buf, *tok, *sep;
+	unsigned int nr = 0;
+	int ret = 0;
+
+	if (test_bit(NULLB_DEV_FL_CONFIGURED, &dev->flags))
+		return -EBUSY;
+
+	orig = kstrndup(page, count, GFP_KERNEL);
+	if (!orig)
+		return -ENOMEM;
+
+	buf = strstrip(orig);
+	while ((tok = strsep(&buf, " \t")) != NULL) {
+		if (!*tok)
+			continue;
+
+		sep = strchr(tok, ':');
+		if (!sep || nr == NULLB_LAT_DIST_MAX) {
+			ret = -EINVAL;
+			goto out;
+		}
+		*sep++ = '\0';
+
+		ret = nullb_parse_pct(tok, &dist[nr].pct);
+		if (ret)
+			goto out;
+		ret = kstrtoul(sep, 0, &dist[nr].nsec);
+		if (ret)
+			goto out;
+
+		if (nr && (dist[nr].pct <= dist[nr - 1].pct ||
+			   dist[nr].nsec < dist[nr - 1].nsec)) {
+			ret = -EINVAL;
+			goto out;
+		}
+		nr++;
+	}
+
+	if (nr && dist[nr - 1].pct != 10000) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	memcpy(dev->lat_dist, dist, nr * sizeof(dist[0]));
+	dev->lat_dist_nr = nr;
+	ret = count;
+out:
+	kfree(orig);
+	return ret;
+}
+CONFIGFS_ATTR(nullb_device_, latency_dist);
+
 static struct configfs_attribute *nullb_device_attrs[] = {
 	&nullb_device_attr_size,
 	&nullb_device_attr_completion_nsec,
+	&nullb_device_attr_completion_batch_nsec,
+	&nullb_device_attr_latency_dist,
+	&nullb_device_attr_latency_hist,
 	&nullb_device_attr_submit_queues,
 	&nullb_device_attr_poll_queues,
 	&nullb_device_attr_home_node,
@@ -700,8 +826,9 @@ static ssize_t memb_group_features_show(struct config_item *item, char *page)
 {
 	return snprintf(page, PAGE_SIZE,
 			"badblocks,blocking,blocksize,cache_size,fua,"
-			"completion_nsec,discard,home_node,hw_queue_depth,"
-			"irqmode,max_sectors,mbps,memory_backed,no_sched,"
+			"completion_batch_nsec,completion_nsec,discard,"
+			"home_node,hw_queue_depth,irqmode,latency_dist,"
+			"latency_hist,max_sectors,mbps,memory_backed,no_sched,"
 			"poll_queues,power,queue_mode,shared_tag_bitmap,"
 			"shared_tags,size,submit_queues,use_per_node_hctx,"
 			"virt_boundary,zoned,zone_capacity,zone_max_active,"
@@ -764,6 +891,8 @@ static struct nullb_device *null_alloc_dev(void)
 
 	dev->size = g_gb * 1024;
 	dev->completion_nsec = g_completion_nsec;
+	dev->completion_batch_nsec = g_completion_batch_nsec;
+	dev->latency_hist = g_latency_hist;
 	dev->submit_queues = g_submit_queues;
 	dev->prev_submit_queues = g_submit_queues;
 	dev->poll_queues = g_poll_queues;
@@ -807,25 +936,78 @@ static void null_free_dev(struct nullb_device *dev)
 	kfree(dev);
 }
 
+static void null_account_latency(struct nullb_cmd *cmd)
+{
+	struct nullb *nullb = cmd->nq->dev->nullb;
+	u64 delta;
+
+	if (!nullb->lat_hist)
+		return;
+
+	delta = ktime_get_ns() - cmd->start_ns;
+	this_cpu_inc(nullb->lat_hist->buckets[min_t(unsigned int,
+			ilog2(delta | 1), NULLB_LAT_HIST_BUCKETS - 1)]);
+}
+
 static enum hrtimer_restart null_cmd_timer_expired(struct hrtimer *timer)
 {
 	struct nullb_cmd *cmd = container_of(timer, struct nullb_cmd, timer);
 
+	null_account_latency(cmd);
 	blk_mq_end_request(blk_mq_rq_from_pdu(cmd), cmd->error);
 	return HRTIMER_NORESTART;
 }
 
+/* Pick a completion time from the device's latency distribution, if any. */
+static u64 null_sample_latency(struct nullb_device *dev)
+{
+	const struct nullb_lat_point *p = dev->lat_dist;
+	unsigned int nr = dev->lat_dist_nr, prev_pct = 0, r, i;
+	unsigned long prev_nsec = 0;
+
+	if (!nr)
+		return dev->completion_nsec;
+
+	r = get_random_u32_below(10000);
+	for (i = 0; i < nr - 1 && p[i].pct <= r; i++)
+		;
+	if (i) {
+		prev_pct = p[i - 1].pct;
+		prev_nsec = p[i - 1].nsec;
+	}
+
+	return prev_nsec + div_u64((u64)(p[i].nsec - prev_nsec) *
+				   (r - prev_pct), p[i].pct - prev_pct);
+}
+
 static void null_cmd_end_timer(struct nullb_cmd *cmd)
 {
-	ktime_t kt = cmd->nq->dev->completion_nsec;
+	struct nullb_device *dev = cmd->nq->dev;
+	u64 batch = dev->completion_batch_nsec;
+	u64 nsec = null_sample_latency(dev);
+
+	if (batch) {
+		/*
+		 * Round the completion up to the end of its batch window so
+		 * that all requests falling into a window complete from the
+		 * same timer interrupt, like a device coalescing completions.
+		 */
+		u64 expires = ktime_get_ns() + nsec;
+
+		expires = div64_u64(expires + batch - 1, batch) * batch;
+		hrtimer_start(&cmd->timer, ns_to_ktime(expires),
+			      HRTIMER_MODE_ABS);
+		return;
+	}
 
-	hrtimer_start(&cmd->timer, kt, HRTIMER_MODE_REL);
+	hrtimer_start(&cmd->timer, ns_to_ktime(nsec), HRTIMER_MODE_REL);
 }
 
 static void null_complete_rq(struct request *rq)
 {
 	struct nullb_cmd *cmd = blk_mq_rq_to_pdu(rq);
 
+	null_account_latency(cmd);
 	blk_mq_end_request(rq, cmd->error);
 }
 
@@ -1346,6 +1528,7 @@ static inline void nullb_complete_cmd(struct nullb_cmd *cmd)
 		blk_mq_complete_request(rq);
 		break;
 	case NULL_IRQ_NONE:
+		null_account_latency(cmd);
 		blk_mq_end_request(rq, cmd->error);
 		break;
 	case NULL_IRQ_TIMER:
@@ -1541,6 +1724,7 @@ static int null_poll(struct blk_mq_hw_ctx *hctx, struct io_comp_batch *iob)
 		cmd = blk_mq_rq_to_pdu(req);
 		cmd->error = null_process_cmd(cmd, req_op(req), blk_rq_pos(req),
 						blk_rq_sectors(req));
+		null_account_latency(cmd);
 		if (!blk_mq_add_to_batch(req, iob, cmd->error != BLK_STS_OK,
 					 blk_mq_end_request_batch))
 			blk_mq_end_request(req, cmd->error);
@@ -1601,6 +1785,8 @@ static blk_status_t null_queue_rq(struct blk_mq_hw_ctx *hctx,
 	}
 	cmd->error = BLK_STS_OK;
 	cmd->nq = nq;
+	if (nq->dev->nullb->lat_hist)
+		cmd->start_ns = ktime_get_ns();
 	cmd->fake_timeout = should_timeout_request(rq) ||
 		blk_should_fake_timeout(rq->q);
 
@@ -1689,6 +1875,84 @@ static const struct blk_mq_ops null_mq_ops = {
 	.init_hctx	= null_init_hctx,
 };
 
+static struct dentry *null_debugfs_root;
+
+static int null_latency_hist_show(struct seq_file *m, void *v)
+{
+	struct nullb *nullb = m->private;
+	unsigned int b;
+	int cpu;
+
+	for (b = 0; b < NULLB_LAT_HIST_BUCKETS; b++) {
+		u64 count = 0;
+
+		for_each_possible_cpu(cpu)
+			count += per_cpu_ptr(nullb->lat_hist, cpu)->buckets[b];
+		if (count)
+			seq_printf(m, "%llu-%llu %llu\n", b ? 1ULL << b : 0,
+				   (2ULL << b) - 1, count);
+	}
+
+	return 0;
+}
+
+static int null_latency_hist_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, null_latency_hist_show, inode->i_private);
+}
+
+/* Any write clears the histogram. */
+static ssize_t null_latency_hist_write(struct file *file,
+				       const char __user *buf, size_t count,
+				       loff_t *ppos)
+{
+	struct nullb *nullb = file_inode(file)->i_private;
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		memset(per_cpu_ptr(nullb->lat_hist, cpu), 0,
+		       sizeof(struct nullb_lat_hist));
+
+	return count;
+}
+
+static const struct file_operations null_latency_hist_fops = {
+	.owner		= THIS_MODULE,
+	.open		= null_latency_hist_open,
+	.read		= seq_read,
+	.write		= null_latency_hist_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+/*
+ * Measured completion latencies, from ->queue_rq() to the end of the
+ * request, as "min_ns-max_ns count" lines of log2 sized buckets.
+ */
+static int null_setup_latency_hist(struct nullb *nullb)
+{
+	if (!nullb->dev->latency_hist)
+		return 0;
+
+	nullb->lat_hist = alloc_percpu(struct nullb_lat_hist);
+	if (!nullb->lat_hist)
+		return -ENOMEM;
+
+	nullb->debugfs_dir = debugfs_create_dir(nullb->disk_name,
+						null_debugfs_root);
+	debugfs_create_file("latency_histogram", 0600, nullb->debugfs_dir,
+			    nullb, &null_latency_hist_fops);
+	return 0;
+}
+
+static void null_free_latency_hist(struct nullb *nullb)
+{
+	debugfs_remove_recursive(nullb->debugfs_dir);
+	nullb->debugfs_dir = NULL;
+	free_percpu(nullb->lat_hist);
+	nullb->lat_hist = NULL;
+}
+
 static void null_del_dev(struct nullb *nullb)
 {
 	struct nullb_device *dev;
@@ -1703,6 +1967,7 @@ static void null_del_dev(struct nullb *nullb)
 	list_del_init(&nullb->list);
 
 	del_gendisk(nullb->disk);
+	null_free_latency_hist(nullb);
 
 	if (test_bit(NULLB_DEV_FL_THROTTLED, &nullb->dev->flags)) {
 		hrtimer_cancel(&nullb->bw_timer);
@@ -1982,16 +2247,22 @@ static int null_add_dev(struct nullb_device *dev)
 			goto out_ida_free;
 	}
 
-	rv = add_disk(nullb->disk);
+	rv = null_setup_latency_hist(nullb);
 	if (rv)
 		goto out_ida_free;
 
+	rv = add_disk(nullb->disk);
+	if (rv)
+		goto out_free_hist;
+
 	list_add_tail(&nullb->list, &nullb_list);
 
 	pr_info("disk %s created\n", nullb->disk_name);
 
 	return 0;
 
+out_free_hist:
+	null_free_latency_hist(nullb);
 out_ida_free:
 	ida_free(&nullb_indexes, nullb->index);
 out_cleanup_disk:
@@ -2101,6 +2372,8 @@ static int __init null_init(void)
 
 	mutex_init(&lock);
 
+	null_debugfs_root = debugfs_create_dir("null_blk", NULL);
+
 	null_major = register_blkdev(0, "nullb");
 	if (null_major < 0) {
 		ret = null_major;
@@ -2123,6 +2396,7 @@ static int __init null_init(void)
 	}
 	unregister_blkdev(null_major, "nullb");
 err_conf:
+	debugfs_remove_recursive(null_debugfs_root);
 	configfs_unregister_subsystem(&nullb_subsys);
 	return ret;
 }
@@ -2142,6 +2416,8 @@ static void __exit null_exit(void)
 	}
 	mutex_unlock(&lock);
 
+	debugfs_remove_recursive(null_debugfs_root);
+
 	if (tag_set.ops)
 		blk_mq_free_tag_set(&tag_set);
 
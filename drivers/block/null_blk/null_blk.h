@@ -20,6 +20,7 @@ struct nullb_cmd {
 	bool fake_timeout;
 	struct nullb_queue *nq;
 	struct hrtimer timer;
+	u64 start_ns;
 };
 
 struct nullb_queue {
@@ -50,6 +51,20 @@ struct nullb_zone {
 	unsigned int capacity;
 };
 
+/* Maximum number of points in a completion latency distribution */
+#define NULLB_LAT_DIST_MAX	16
+/* Measured latencies are kept in log2(ns) buckets */
+#define NULLB_LAT_HIST_BUCKETS	32
+
+struct nullb_lat_point {
+	unsigned int pct;	/* cumulative percentile, in 0.01% units */
+	unsigned long nsec;	/* completion time at that percentile */
+};
+
+struct nullb_lat_hist {
+	u64 buckets[NULLB_LAT_HIST_BUCKETS];
+};
+
 struct nullb_device {
 	struct nullb *nullb;
 	struct config_group group;
@@ -76,6 +91,9 @@ struct nullb_device {
 
 	unsigned long size; /* device size in MB */
 	unsigned long completion_nsec; /* time in ns to complete a request */
+	unsigned long completion_batch_nsec; /* timer completion batch window */
+	struct nullb_lat_point lat_dist[NULLB_LAT_DIST_MAX]; /* latency table */
+	unsigned int lat_dist_nr; /* number of points in lat_dist */
 	unsigned long cache_size; /* disk cache size in MB */
 	unsigned long zone_size; /* zone size in MB if device is zoned */
 	unsigned long zone_capacity; /* zone capacity in MB if device is zoned */
@@ -107,6 +125,7 @@ struct nullb_device {
 	bool shared_tags; /* share tag set between devices for blk-mq */
 	bool shared_tag_bitmap; /* use hostwide shared tags */
 	bool fua; /* Support FUA */
+	bool latency_hist; /* record completion latencies in debugfs */
 };
 
 struct nullb {
@@ -124,6 +143,9 @@ struct nullb {
 
 	struct nullb_queue *queues;
 	char disk_name[DISK_NAME_LEN];
+
+	struct nullb_lat_hist __percpu *lat_hist;
+	struct dentry *debugfs_dir;
 };
 
 blk_status_t null_handle_discard(struct nullb_device *dev, sector_t sector,
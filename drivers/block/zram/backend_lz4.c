@@ -7,20 +7,38 @@
 
 struct lz4_ctx {
 	void *mem;
-
-	LZ4_streamDecode_t *dstrm;
-	LZ4_stream_t *cstrm;
 };
 
 static void lz4_release_params(struct zcomp_params *params)
 {
+	kvfree(params->drv_data);
+	params->drv_data = NULL;
 }
 
 static int lz4_setup_params(struct zcomp_params *params)
 {
+	LZ4_dict_t *dict;
+
 	if (params->level == ZCOMP_PARAM_NO_LEVEL)
 		params->level = LZ4_ACCELERATION_DEFAULT;
 
+	if (!params->dict_sz)
+		return 0;
+
+	/*
+	 * Hash the dictionary once here; every compression then starts from
+	 * a copy of it instead of calling LZ4_loadDict() per page.
+	 */
+	dict = kvmalloc(sizeof(*dict), GFP_KERNEL);
+	if (!dict)
+		return -ENOMEM;
+
+	params->drv_data = dict;
+	if (LZ4_initDict(dict, params->dict, params->dict_sz) == 0) {
+		lz4_release_params(params);
+		return -EINVAL;
+	}
+
 	return 0;
 }
 
@@ -32,8 +50,6 @@ static void lz4_destroy(struct zcomp_ctx *ctx)
 		return;
 
 	vfree(zctx->mem);
-	kfree(zctx->dstrm);
-	kfree(zctx->cstrm);
 	kfree(zctx);
 }
 
@@ -46,46 +62,30 @@ static int lz4_create(struct zcomp_params *params, struct zcomp_ctx *ctx)
 		return -ENOMEM;
 
 	ctx->context = zctx;
-	if (params->dict_sz == 0) {
-		zctx->mem = vmalloc(LZ4_MEM_COMPRESS);
-		if (!zctx->mem)
-			goto error;
-	} else {
-		zctx->dstrm = kzalloc(sizeof(*zctx->dstrm), GFP_KERNEL);
-		if (!zctx->dstrm)
-			goto error;
-
-		zctx->cstrm = kzalloc(sizeof(*zctx->cstrm), GFP_KERNEL);
-		if (!zctx->cstrm)
-			goto error;
+	zctx->mem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!zctx->mem) {
+		lz4_destroy(ctx);
+		return -ENOMEM;
 	}
 
 	return 0;
-
-error:
-	lz4_destroy(ctx);
-	return -ENOMEM;
 }
 
 static int lz4_compress(struct zcomp_params *params, struct zcomp_ctx *ctx,
 			struct zcomp_req *req)
 {
 	struct lz4_ctx *zctx = ctx->context;
+	LZ4_dict_t *dict = params->drv_data;
 	int ret;
 
-	if (!zctx->cstrm) {
+	if (!dict)
 		ret = LZ4_compress_fast(req->src, req->dst, req->src_len,
 					req->dst_len, params->level,
 					zctx->mem);
-	} else {
-		/* Cstrm needs to be reset */
-		ret = LZ4_loadDict(zctx->cstrm, params->dict, params->dict_sz);
-		if (ret != params->dict_sz)
-			return -EINVAL;
-		ret = LZ4_compress_fast_continue(zctx->cstrm, req->src,
-						 req->dst, req->src_len,
-						 req->dst_len, params->level);
-	}
+	else
+		ret = LZ4_compress_fast_dict(dict, req->src, req->dst,
+					     req->src_len, req->dst_len,
+					     params->level, zctx->mem);
 	if (!ret)
 		return -EINVAL;
 	req->dst_len = ret;
@@ -95,22 +95,15 @@ static int lz4_compress(struct zcomp_params *params, struct zcomp_ctx *ctx,
 static int lz4_decompress(struct zcomp_params *params, struct zcomp_ctx *ctx,
 			  struct zcomp_req *req)
 {
-	struct lz4_ctx *zctx = ctx->context;
+	LZ4_dict_t *dict = params->drv_data;
 	int ret;
 
-	if (!zctx->dstrm) {
+	if (!dict)
 		ret = LZ4_decompress_safe(req->src, req->dst, req->src_len,
 					  req->dst_len);
-	} else {
-		/* Dstrm needs to be reset */
-		ret = LZ4_setStreamDecode(zctx->dstrm, params->dict,
-					  params->dict_sz);
-		if (!ret)
-			return -EINVAL;
-		ret = LZ4_decompress_safe_continue(zctx->dstrm, req->src,
-						   req->dst, req->src_len,
-						   req->dst_len);
-	}
+	else
+		ret = LZ4_decompress_safe_dict(dict, req->src, req->dst,
+					       req->src_len, req->dst_len);
 	if (ret < 0)
 		return -EINVAL;
 	return 0;
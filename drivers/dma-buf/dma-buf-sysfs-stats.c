@@ -41,6 +41,13 @@
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/exporter_name``
  * * ``/sys/kernel/dmabuf/buffers/<inode_number>/size``
  *
+ * Allocation latency of DMA-BUF heaps, measured around the heap's allocate
+ * callback, is aggregated under ``/sys/kernel/dmabuf/alloc_stats``:
+ *
+ * * ``/sys/kernel/dmabuf/alloc_stats/count``
+ * * ``/sys/kernel/dmabuf/alloc_stats/total_ns``
+ * * ``/sys/kernel/dmabuf/alloc_stats/max_ns``
+ *
  * The information in the interface can also be used to derive per-exporter
  * statistics. The data from the interface can be gathered on error conditions
  * or other important events to provide a snapshot of DMA-BUF usage.
@@ -141,10 +148,62 @@ static const struct kset_uevent_ops dmabuf_sysfs_no_uevent_ops = {
 	.filter = dmabuf_sysfs_uevent_filter,
 };
 
+static atomic64_t dma_buf_alloc_count;
+static atomic64_t dma_buf_alloc_total_ns;
+static atomic64_t dma_buf_alloc_max_ns;
+
+void dma_buf_stats_record_alloc(u64 ns)
+{
+	s64 max = atomic64_read(&dma_buf_alloc_max_ns);
+
+	atomic64_inc(&dma_buf_alloc_count);
+	atomic64_add(ns, &dma_buf_alloc_total_ns);
+	while (ns > max &&
+	       !atomic64_try_cmpxchg(&dma_buf_alloc_max_ns, &max, ns))
+		;
+}
+
+static ssize_t count_show(struct kobject *kobj, struct kobj_attribute *attr,
+			  char *buf)
+{
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&dma_buf_alloc_count));
+}
+
+static ssize_t total_ns_show(struct kobject *kobj,
+			     struct kobj_attribute *attr, char *buf)
+{
+	return sysfs_emit(buf, "%lld\n",
+			  atomic64_read(&dma_buf_alloc_total_ns));
+}
+
+static ssize_t max_ns_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	return sysfs_emit(buf, "%lld\n", atomic64_read(&dma_buf_alloc_max_ns));
+}
+
+static struct kobj_attribute alloc_count_attribute = __ATTR_RO(count);
+static struct kobj_attribute alloc_total_ns_attribute = __ATTR_RO(total_ns);
+static struct kobj_attribute alloc_max_ns_attribute = __ATTR_RO(max_ns);
+
+static struct attribute *dma_buf_alloc_stats_attrs[] = {
+	&alloc_count_attribute.attr,
+	&alloc_total_ns_attribute.attr,
+	&alloc_max_ns_attribute.attr,
+	NULL,
+};
+
+static const struct attribute_group dma_buf_alloc_stats_group = {
+	.name = "alloc_stats",
+	.attrs = dma_buf_alloc_stats_attrs,
+};
+
 static struct kset *dma_buf_stats_kset;
 static struct kset *dma_buf_per_buffer_stats_kset;
 int dma_buf_init_sysfs_statistics(void)
 {
+	int ret;
+
 	dma_buf_stats_kset = kset_create_and_add("dmabuf",
 						 &dmabuf_sysfs_no_uevent_ops,
 						 kernel_kobj);
@@ -159,11 +218,21 @@ int dma_buf_init_sysfs_statistics(void)
 		return -ENOMEM;
 	}
 
+	ret = sysfs_create_group(&dma_buf_stats_kset->kobj,
+				 &dma_buf_alloc_stats_group);
+	if (ret) {
+		kset_unregister(dma_buf_per_buffer_stats_kset);
+		kset_unregister(dma_buf_stats_kset);
+		return ret;
+	}
+
 	return 0;
 }
 
 void dma_buf_uninit_sysfs_statistics(void)
 {
+	sysfs_remove_group(&dma_buf_stats_kset->kobj,
+			   &dma_buf_alloc_stats_group);
 	kset_unregister(dma_buf_per_buffer_stats_kset);
 	kset_unregister(dma_buf_stats_kset);
 }
@@ -14,10 +14,13 @@
 #include <linux/list.h>
 #include <linux/nospec.h>
 #include <linux/syscalls.h>
+#include <linux/timekeeping.h>
 #include <linux/uaccess.h>
 #include <linux/xarray.h>
 #include <uapi/linux/dma-heap.h>
 
+#include "dma-buf-sysfs-stats.h"
+
 #define DEVNAME "dma_heap"
 
 #define NUM_HEAP_MINORS 128
@@ -53,6 +56,7 @@ static int dma_heap_buffer_alloc(struct dma_heap *heap, size_t len,
 				 u64 heap_flags)
 {
 	struct dma_buf *dmabuf;
+	u64 start;
 	int fd;
 
 	/*
@@ -63,9 +67,11 @@ static int dma_heap_buffer_alloc(struct dma_heap *heap, size_t len,
 	if (!len)
 		return -EINVAL;
 
+	start = ktime_get_ns();
 	dmabuf = heap->ops->allocate(heap, len, fd_flags, heap_flags);
 	if (IS_ERR(dmabuf))
 		return PTR_ERR(dmabuf);
+	dma_buf_stats_record_alloc(ktime_get_ns() - start);
 
 	fd = dma_buf_fd(dmabuf, fd_flags);
 	if (fd < 0) {
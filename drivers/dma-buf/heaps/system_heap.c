@@ -17,9 +17,13 @@
 #include <linux/highmem.h>
 #include <linux/mm.h>
 #include <linux/module.h>
+#include <linux/nodemask.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 static struct dma_heap *sys_heap;
 
@@ -54,6 +58,269 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, HIGH_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * The high orders above are backed by a per-node pool of prezeroed pages.
+ * Freed buffers hand their high-order pages back to the pool as "dirty",
+ * and a background worker clears them and tops up the pool with fresh
+ * pages, so that the allocation path neither waits on the buddy allocator
+ * nor zeroes memory inline. The pool size is bounded by pool_size_mb and
+ * is given back under memory pressure through a shrinker.
+ */
+#define NUM_POOL_ORDERS	(NUM_ORDERS - 1)
+
+struct system_heap_pool {
+	spinlock_t lock;
+	unsigned long nr_pages;
+	struct list_head clean[NUM_POOL_ORDERS];
+	struct list_head dirty[NUM_POOL_ORDERS];
+};
+
+static struct system_heap_pool **pools;
+static atomic_long_t pool_pages;
+static struct shrinker *pool_shrinker;
+
+static unsigned int pool_size_mb;
+
+static void system_heap_pool_work_fn(struct work_struct *work);
+static DECLARE_WORK(pool_work, system_heap_pool_work_fn);
+
+static unsigned long pool_budget_pages(void)
+{
+	return (unsigned long)READ_ONCE(pool_size_mb) << (20 - PAGE_SHIFT);
+}
+
+static void pool_add(struct system_heap_pool *pool, struct list_head *list,
+		     struct page *page)
+{
+	spin_lock(&pool->lock);
+	list_add_tail(&page->lru, list);
+	pool->nr_pages += compound_nr(page);
+	spin_unlock(&pool->lock);
+}
+
+static struct page *pool_remove(struct system_heap_pool *pool,
+				struct list_head *list)
+{
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(list, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		pool->nr_pages -= compound_nr(page);
+	}
+	spin_unlock(&pool->lock);
+
+	return page;
+}
+
+static struct page *pool_get(int order_idx, int nid)
+{
+	struct page *page;
+
+	if (!pools || order_idx >= NUM_POOL_ORDERS)
+		return NULL;
+
+	page = pool_remove(pools[nid], &pools[nid]->clean[order_idx]);
+	if (!page)
+		return NULL;
+
+	/* Keep the pool topped up behind the allocation */
+	if (atomic_long_sub_return(compound_nr(page), &pool_pages) <
+	    pool_budget_pages() / 2)
+		queue_work(system_unbound_wq, &pool_work);
+
+	return page;
+}
+
+static bool pool_put(struct page *page)
+{
+	unsigned int order = compound_order(page);
+	int i;
+
+	if (!pools)
+		return false;
+
+	for (i = 0; i < NUM_POOL_ORDERS; i++)
+		if (orders[i] == order)
+			break;
+	if (i == NUM_POOL_ORDERS)
+		return false;
+
+	if (atomic_long_add_return(1 << order, &pool_pages) >
+	    pool_budget_pages()) {
+		atomic_long_sub(1 << order, &pool_pages);
+		return false;
+	}
+
+	pool_add(pools[page_to_nid(page)],
+		 &pools[page_to_nid(page)]->dirty[i], page);
+
+	return true;
+}
+
+static void clear_pool_page(struct page *page)
+{
+	unsigned int i;
+
+	for (i = 0; i < compound_nr(page); i++) {
+		clear_highpage(page + i);
+		cond_resched();
+	}
+}
+
+static void system_heap_pool_work_fn(struct work_struct *work)
+{
+	unsigned long budget = pool_budget_pages();
+	unsigned long node_target;
+	struct system_heap_pool *pool;
+	struct page *page;
+	int nid, i;
+
+	node_target = budget / 2 / max(1U, num_node_state(N_MEMORY));
+
+	for_each_node_state(nid, N_MEMORY) {
+		pool = pools[nid];
+
+		/* Clear pages handed back by released buffers */
+		for (i = 0; i < NUM_POOL_ORDERS; i++) {
+			while ((page = pool_remove(pool, &pool->dirty[i]))) {
+				clear_pool_page(page);
+				pool_add(pool, &pool->clean[i], page);
+			}
+		}
+
+		/* Top up with the largest order to half the node's share */
+		while (READ_ONCE(pool->nr_pages) < node_target &&
+		       atomic_long_read(&pool_pages) < budget) {
+			page = alloc_pages_node(nid, order_flags[0] |
+						__GFP_THISNODE, orders[0]);
+			if (!page)
+				break;
+
+			atomic_long_add(compound_nr(page), &pool_pages);
+			pool_add(pool, &pool->clean[0], page);
+			cond_resched();
+		}
+	}
+}
+
+/* Give up to @nr_to_free pages of the pool back to the page allocator */
+static unsigned long pool_trim(unsigned long nr_to_free)
+{
+	unsigned long freed = 0;
+	struct page *page;
+	int nid, i;
+
+	for_each_node_state(nid, N_MEMORY) {
+		struct system_heap_pool *pool = pools[nid];
+
+		/* Dirty pages go first, they still cost a clear to reuse */
+		for (i = 0; i < 2 * NUM_POOL_ORDERS; i++) {
+			struct list_head *list = i < NUM_POOL_ORDERS ?
+				&pool->dirty[i] :
+				&pool->clean[i - NUM_POOL_ORDERS];
+
+			while (freed < nr_to_free &&
+			       (page = pool_remove(pool, list))) {
+				atomic_long_sub(compound_nr(page), &pool_pages);
+				freed += compound_nr(page);
+				__free_pages(page, compound_order(page));
+			}
+		}
+	}
+
+	return freed;
+}
+
+static unsigned long system_heap_pool_count(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	unsigned long count = atomic_long_read(&pool_pages);
+
+	return count ? count : SHRINK_EMPTY;
+}
+
+static unsigned long system_heap_pool_scan(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	unsigned long freed = pool_trim(sc->nr_to_scan);
+
+	return freed ? freed : SHRINK_STOP;
+}
+
+/* Resizing takes effect at once: shrink down to, or fill up to, the limit */
+static int pool_size_mb_set(const char *val, const struct kernel_param *kp)
+{
+	long excess;
+	int ret;
+
+	ret = param_set_uint(val, kp);
+	if (ret || !pools)
+		return ret;
+
+	excess = atomic_long_read(&pool_pages) - pool_budget_pages();
+	if (excess > 0)
+		pool_trim(excess);
+	else
+		queue_work(system_unbound_wq, &pool_work);
+
+	return 0;
+}
+
+static const struct kernel_param_ops pool_size_mb_ops = {
+	.set	= pool_size_mb_set,
+	.get	= param_get_uint,
+};
+
+module_param_cb(pool_size_mb, &pool_size_mb_ops, &pool_size_mb, 0644);
+MODULE_PARM_DESC(pool_size_mb,
+		 "Upper bound in MiB of prezeroed high-order pages kept in the pool (default: 0, disabled)");
+
+static int system_heap_pool_init(void)
+{
+	int nid, i;
+
+	pools = kcalloc(nr_node_ids, sizeof(*pools), GFP_KERNEL);
+	if (!pools)
+		return -ENOMEM;
+
+	for_each_node(nid) {
+		struct system_heap_pool *pool;
+
+		pool = kzalloc_node(sizeof(*pool), GFP_KERNEL, nid);
+		if (!pool)
+			goto err;
+
+		spin_lock_init(&pool->lock);
+		for (i = 0; i < NUM_POOL_ORDERS; i++) {
+			INIT_LIST_HEAD(&pool->clean[i]);
+			INIT_LIST_HEAD(&pool->dirty[i]);
+		}
+		pools[nid] = pool;
+	}
+
+	pool_shrinker = shrinker_alloc(0, "dmabuf-system-heap");
+	if (!pool_shrinker)
+		goto err;
+
+	pool_shrinker->count_objects = system_heap_pool_count;
+	pool_shrinker->scan_objects = system_heap_pool_scan;
+	shrinker_register(pool_shrinker);
+
+	if (pool_budget_pages())
+		queue_work(system_unbound_wq, &pool_work);
+
+	return 0;
+
+err:
+	for_each_node(nid)
+		kfree(pools[nid]);
+	kfree(pools);
+	pools = NULL;
+	return -ENOMEM;
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -286,16 +553,24 @@ static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct sg_table *table;
 	struct scatterlist *sg;
+	bool pooled = false;
 	int i;
 
 	table = &buffer->sg_table;
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *page = sg_page(sg);
 
+		if (pool_put(page)) {
+			pooled = true;
+			continue;
+		}
 		__free_pages(page, compound_order(page));
 	}
 	sg_free_table(table);
 	kfree(buffer);
+
+	if (pooled)
+		queue_work(system_unbound_wq, &pool_work);
 }
 
 static const struct dma_buf_ops system_heap_buf_ops = {
@@ -323,6 +598,10 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
+		page = pool_get(i, numa_node_id());
+		if (page)
+			return page;
+
 		page = alloc_pages(order_flags[i], orders[i]);
 		if (!page)
 			continue;
@@ -429,6 +708,10 @@ static int system_heap_create(void)
 	exp_info.ops = &system_heap_ops;
 	exp_info.priv = NULL;
 
+	/* The heap is still usable without a pool */
+	if (system_heap_pool_init())
+		pr_warn("system heap: failed to set up page pool\n");
+
 	sys_heap = dma_heap_add(&exp_info);
 	if (IS_ERR(sys_heap))
 		return PTR_ERR(sys_heap);
@@ -1344,20 +1344,17 @@ static inline void decode_delta(struct delta_index_entry *delta_entry)
 	}
 }
 
-noinline int uds_next_delta_index_entry(struct delta_index_entry *delta_entry)
+/*
+ * Step a delta index entry to the next entry in its list, or mark it as being at the end of the
+ * list. The caller must already have checked that the entry is not at the end.
+ */
+static __always_inline int advance_delta_entry(struct delta_index_entry *delta_entry)
 {
 	int result;
-	const struct delta_list *delta_list;
 	u32 next_offset;
-	u16 size;
+	u16 size = delta_entry->delta_list->size;
 
-	result = assert_not_at_end(delta_entry);
-	if (result != UDS_SUCCESS)
-		return result;
-
-	delta_list = delta_entry->delta_list;
 	delta_entry->offset += delta_entry->entry_bits;
-	size = delta_list->size;
 	if (unlikely(delta_entry->offset >= size)) {
 		delta_entry->at_end = true;
 		delta_entry->delta = 0;
@@ -1385,6 +1382,17 @@ noinline int uds_next_delta_index_entry(struct delta_index_entry *delta_entry)
 	return UDS_SUCCESS;
 }
 
+noinline int uds_next_delta_index_entry(struct delta_index_entry *delta_entry)
+{
+	int result;
+
+	result = assert_not_at_end(delta_entry);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	return advance_delta_entry(delta_entry);
+}
+
 int uds_remember_delta_index_offset(const struct delta_index_entry *delta_entry)
 {
 	int result;
@@ -1436,6 +1444,28 @@ static void set_collision_name(const struct delta_index_entry *entry, const u8 *
 	}
 }
 
+/*
+ * Advance through a delta list to the first entry whose key is not less than the given key. This
+ * is equivalent to calling uds_next_delta_index_entry() until that condition holds, but keeps the
+ * decode loop tight since this is where every index lookup spends its time.
+ */
+static int search_delta_list(struct delta_index_entry *delta_entry, u32 key)
+{
+	int result;
+
+	result = assert_not_at_end(delta_entry);
+	if (result != UDS_SUCCESS)
+		return result;
+
+	do {
+		result = advance_delta_entry(delta_entry);
+		if (result != UDS_SUCCESS)
+			return result;
+	} while (!delta_entry->at_end && (key > delta_entry->key));
+
+	return UDS_SUCCESS;
+}
+
 int uds_get_delta_index_entry(const struct delta_index *delta_index, u32 list_number,
 			      u32 key, const u8 *name,
 			      struct delta_index_entry *delta_entry)
@@ -1447,11 +1477,9 @@ int uds_get_delta_index_entry(const struct delta_index *delta_index, u32 list_nu
 	if (result != UDS_SUCCESS)
 		return result;
 
-	do {
-		result = uds_next_delta_index_entry(delta_entry);
-		if (result != UDS_SUCCESS)
-			return result;
-	} while (!delta_entry->at_end && (key > delta_entry->key));
+	result = search_delta_list(delta_entry, key);
+	if (result != UDS_SUCCESS)
+		return result;
 
 	result = uds_remember_delta_index_offset(delta_entry);
 	if (result != UDS_SUCCESS)
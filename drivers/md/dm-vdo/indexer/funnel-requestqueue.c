@@ -239,12 +239,26 @@ static inline void wake_up_worker(struct uds_request_queue *queue)
 
 void uds_request_queue_enqueue(struct uds_request_queue *queue,
 			       struct uds_request *request)
+{
+	uds_request_queue_enqueue_batch(queue, &request, 1);
+}
+
+/*
+ * Enqueue several requests with a single check of whether the worker needs waking, rather than
+ * one per request.
+ */
+void uds_request_queue_enqueue_batch(struct uds_request_queue *queue,
+				     struct uds_request **requests, unsigned int count)
 {
 	struct funnel_queue *sub_queue;
-	bool unbatched = request->unbatched;
+	bool unbatched = false;
+	unsigned int i;
 
-	sub_queue = request->requeued ? queue->retry_queue : queue->main_queue;
-	vdo_funnel_queue_put(sub_queue, &request->queue_link);
+	for (i = 0; i < count; i++) {
+		unbatched |= requests[i]->unbatched;
+		sub_queue = requests[i]->requeued ? queue->retry_queue : queue->main_queue;
+		vdo_funnel_queue_put(sub_queue, &requests[i]->queue_link);
+	}
 
 	/*
 	 * We must wake the worker thread when it is dormant. A read fence isn't needed here since
@@ -254,6 +268,12 @@ void uds_request_queue_enqueue(struct uds_request_queue *queue,
 		wake_up_worker(queue);
 }
 
+/* Whether the queue has no request left; only meaningful on the worker thread. */
+bool uds_request_queue_is_idle(struct uds_request_queue *queue)
+{
+	return are_queues_idle(queue);
+}
+
 void uds_request_queue_finish(struct uds_request_queue *queue)
 {
 	if (queue == NULL)
@@ -26,6 +26,11 @@ int __must_check uds_make_request_queue(const char *queue_name,
 void uds_request_queue_enqueue(struct uds_request_queue *queue,
 			       struct uds_request *request);
 
+void uds_request_queue_enqueue_batch(struct uds_request_queue *queue,
+				     struct uds_request **requests, unsigned int count);
+
+bool uds_request_queue_is_idle(struct uds_request_queue *queue);
+
 void uds_request_queue_finish(struct uds_request_queue *queue);
 
 #endif /* UDS_REQUEST_QUEUE_H */
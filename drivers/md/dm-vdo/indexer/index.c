@@ -135,11 +135,6 @@ static u64 triage_index_request(struct uds_index *index, struct uds_request *req
 	if (!is_zone_chapter_sparse(zone, virtual_chapter))
 		return NO_CHAPTER;
 
-	/*
-	 * FIXME: Optimize for a common case by remembering the chapter from the most recent
-	 * barrier message and skipping this chapter if is it the same.
-	 */
-
 	return virtual_chapter;
 }
 
@@ -164,16 +159,67 @@ static int simulate_index_zone_barrier_message(struct index_zone *zone,
 	return uds_update_sparse_cache(zone, sparse_virtual_chapter);
 }
 
-/* This is the request processing function for the triage queue. */
+/* Requests are passed from the triage queue to a zone queue in batches of up to this many. */
+#define TRIAGE_BATCH_SIZE 32
+
+struct triage_batch {
+	unsigned int count;
+	struct uds_request *requests[TRIAGE_BATCH_SIZE];
+};
+
+static void dispatch_triage_batch(struct uds_index *index, unsigned int zone)
+{
+	struct triage_batch *batch = &index->triage_batches[zone];
+
+	if (batch->count == 0)
+		return;
+
+	uds_request_queue_enqueue_batch(index->zone_queues[zone], batch->requests,
+					batch->count);
+	batch->count = 0;
+}
+
+static void dispatch_triage_batches(struct uds_index *index)
+{
+	unsigned int zone;
+
+	for (zone = 0; zone < index->zone_count; zone++)
+		dispatch_triage_batch(index, zone);
+}
+
+/*
+ * This is the request processing function for the triage queue. Runs of requests for the same
+ * sparse chapter are common, so a barrier is only sent when the chapter differs from the one in
+ * the most recent barrier. Since only barriers change the sparse cache membership, and zone queues
+ * process the earlier barrier before any later request, repeating it would be a no-op. A barrier
+ * which fails to cache its chapter clears the remembered chapter, so the next request retries it.
+ *
+ * Triaged requests are collected per zone and handed over in batches, which are dispatched when
+ * full, before any barrier so that it stays ordered after them, and whenever the triage queue has
+ * run dry.
+ */
 static void triage_request(struct uds_request *request)
 {
 	struct uds_index *index = request->index;
 	u64 sparse_virtual_chapter = triage_index_request(index, request);
+	struct triage_batch *batch;
 
-	if (sparse_virtual_chapter != NO_CHAPTER)
+	if ((sparse_virtual_chapter != NO_CHAPTER) &&
+	    (sparse_virtual_chapter != READ_ONCE(index->last_barrier_chapter))) {
+		WRITE_ONCE(index->last_barrier_chapter, sparse_virtual_chapter);
+		dispatch_triage_batches(index);
 		enqueue_barrier_messages(index, sparse_virtual_chapter);
+	}
+
+	request->zone_number =
+		uds_get_volume_index_zone(index->volume_index, &request->record_name);
+	batch = &index->triage_batches[request->zone_number];
+	batch->requests[batch->count++] = request;
+	if (batch->count == TRIAGE_BATCH_SIZE)
+		dispatch_triage_batch(index, request->zone_number);
 
-	uds_enqueue_request(request, STAGE_INDEX);
+	if (uds_request_queue_is_idle(index->triage_queue))
+		dispatch_triage_batches(index);
 }
 
 static int finish_previous_chapter(struct uds_index *index, u64 current_chapter_number)
@@ -299,6 +345,19 @@ static int handle_chapter_closed(struct index_zone *zone, u64 virtual_chapter)
 	return UDS_SUCCESS;
 }
 
+static int handle_sparse_cache_barrier(struct index_zone *zone, u64 virtual_chapter)
+{
+	struct uds_index *index = zone->index;
+	int result;
+
+	result = uds_update_sparse_cache(zone, virtual_chapter);
+	/* The chapter was not cached, so a repeat of this barrier must not be skipped. */
+	if ((result != UDS_SUCCESS) || (virtual_chapter < index->oldest_virtual_chapter))
+		WRITE_ONCE(index->last_barrier_chapter, NO_CHAPTER);
+
+	return result;
+}
+
 static int dispatch_index_zone_control_request(struct uds_request *request)
 {
 	struct uds_zone_message *message = &request->zone_message;
@@ -306,7 +365,7 @@ static int dispatch_index_zone_control_request(struct uds_request *request)
 
 	switch (message->type) {
 	case UDS_MESSAGE_SPARSE_CACHE_BARRIER:
-		return uds_update_sparse_cache(zone, message->virtual_chapter);
+		return handle_sparse_cache_barrier(zone, message->virtual_chapter);
 
 	case UDS_MESSAGE_ANNOUNCE_CHAPTER_CLOSED:
 		return handle_chapter_closed(zone, message->virtual_chapter);
@@ -659,6 +718,11 @@ static int initialize_index_queues(struct uds_index *index,
 
 	/* The triage queue is only needed for sparse multi-zone indexes. */
 	if ((index->zone_count > 1) && uds_is_sparse_index_geometry(geometry)) {
+		result = vdo_allocate(index->zone_count, struct triage_batch,
+				      "triage batches", &index->triage_batches);
+		if (result != VDO_SUCCESS)
+			return result;
+
 		result = uds_make_request_queue("triageW", &triage_request,
 						&index->triage_queue);
 		if (result != UDS_SUCCESS)
@@ -1166,6 +1230,7 @@ int uds_make_index(struct uds_configuration *config, enum uds_open_index_type op
 		return result;
 
 	index->zone_count = config->zone_count;
+	index->last_barrier_chapter = NO_CHAPTER;
 
 	result = uds_make_index_layout(config, new, &index->layout);
 	if (result != UDS_SUCCESS) {
@@ -1291,6 +1356,7 @@ void uds_free_index(struct uds_index *index)
 
 	uds_free_volume(index->volume);
 	uds_free_index_layout(vdo_forget(index->layout));
+	vdo_free(index->triage_batches);
 	vdo_free(index);
 }
 
@@ -1335,6 +1401,8 @@ int uds_save_index(struct uds_index *index)
 
 int uds_replace_index_storage(struct uds_index *index, struct block_device *bdev)
 {
+	/* Replacing the storage empties the sparse cache. */
+	index->last_barrier_chapter = NO_CHAPTER;
 	return uds_replace_volume_storage(index->volume, index->layout, bdev);
 }
 
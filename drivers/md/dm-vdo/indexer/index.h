@@ -53,6 +53,10 @@ struct uds_index {
 
 	index_callback_fn callback;
 	struct uds_request_queue *triage_queue;
+	/* The chapter of the most recent barrier sent by the triage queue */
+	u64 last_barrier_chapter;
+	/* Triaged requests waiting to be handed to each zone queue */
+	struct triage_batch *triage_batches;
 	struct uds_request_queue *zone_queues[];
 };
 
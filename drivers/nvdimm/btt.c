@@ -149,22 +149,10 @@ static int btt_map_write(struct arena_info *arena, u32 lba, u32 mapping,
 	return __btt_map_write(arena, lba, mapping_le, rwb_flags);
 }
 
-static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
-			int *trim, int *error, unsigned long rwb_flags)
+static int btt_map_decode(u32 lba, __le32 in, u32 *mapping, int *trim,
+			int *error)
 {
-	int ret;
-	__le32 in;
 	u32 raw_mapping, postmap, ze, z_flag, e_flag;
-	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
-
-	if (unlikely(lba >= arena->external_nlba))
-		dev_err_ratelimited(to_dev(arena),
-			"%s: lba %#x out of range (max: %#x)\n",
-			__func__, lba, arena->external_nlba);
-
-	ret = arena_read_bytes(arena, ns_off, &in, MAP_ENT_SIZE, rwb_flags);
-	if (ret)
-		return ret;
 
 	raw_mapping = le32_to_cpu(in);
 
@@ -202,7 +190,47 @@ static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
 	if (error)
 		*error = e_flag;
 
-	return ret;
+	return 0;
+}
+
+static int btt_map_read(struct arena_info *arena, u32 lba, u32 *mapping,
+			int *trim, int *error, unsigned long rwb_flags)
+{
+	int ret;
+	__le32 in;
+	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
+
+	if (unlikely(lba >= arena->external_nlba))
+		dev_err_ratelimited(to_dev(arena),
+			"%s: lba %#x out of range (max: %#x)\n",
+			__func__, lba, arena->external_nlba);
+
+	ret = arena_read_bytes(arena, ns_off, &in, MAP_ENT_SIZE, rwb_flags);
+	if (ret)
+		return ret;
+
+	return btt_map_decode(lba, in, mapping, trim, error);
+}
+
+/*
+ * Fetch the raw map entries for @nr consecutive premap LBAs with a single
+ * media read. The caller decodes them with btt_map_decode() and is still
+ * responsible for re-validating each entry under the RTT protocol.
+ */
+static int btt_map_read_batch(struct arena_info *arena, u32 lba, u32 nr,
+			__le32 *in, unsigned long rwb_flags)
+{
+	u64 ns_off = arena->mapoff + (lba * MAP_ENT_SIZE);
+
+	if (unlikely(lba + nr > arena->external_nlba)) {
+		dev_err_ratelimited(to_dev(arena),
+			"%s: lba %#x + %u out of range (max: %#x)\n",
+			__func__, lba, nr, arena->external_nlba);
+		return -EIO;
+	}
+
+	return arena_read_bytes(arena, ns_off, in, nr * MAP_ENT_SIZE,
+			rwb_flags);
 }
 
 static int btt_log_group_read(struct arena_info *arena, u32 lane,
@@ -1188,28 +1216,67 @@ static int btt_rw_integrity(struct btt *btt, struct bio_integrity_payload *bip,
 }
 #endif
 
+/*
+ * Number of map entries fetched per media read on the read path. The batch
+ * spans bio segments, so it is sized for a multi-page bio rather than for a
+ * single bvec.
+ */
+#define BTT_MAP_BATCH 64
+
+/*
+ * Map entries read ahead for a bio. @left is the number of bytes of the bio
+ * not yet consumed, which bounds how far ahead the next batch may read.
+ */
+struct btt_map_batch {
+	struct arena_info *arena;
+	u32 lba;
+	u32 nr;
+	unsigned int left;
+	__le32 ent[BTT_MAP_BATCH];
+};
+
 static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 			struct page *page, unsigned int off, sector_t sector,
-			unsigned int len)
+			unsigned int len, struct btt_map_batch *batch)
 {
 	int ret = 0;
 	int t_flag, e_flag;
 	struct arena_info *arena = NULL;
-	u32 lane = 0, premap, postmap;
+	u32 lane, premap, postmap;
+
+	/*
+	 * The lane is held for the whole segment rather than re-acquired
+	 * per sector, it only pins the RTT slot we publish reads in.
+	 */
+	lane = nd_region_acquire_lane(btt->nd_region);
 
 	while (len) {
 		u32 cur_len;
 
-		lane = nd_region_acquire_lane(btt->nd_region);
-
 		ret = lba_to_arena(btt, sector, &premap, &arena);
 		if (ret)
 			goto out_lane;
 
 		cur_len = min(btt->sector_size, len);
 
-		ret = btt_map_read(arena, premap, &postmap, &t_flag, &e_flag,
-				NVDIMM_IO_ATOMIC);
+		if (arena != batch->arena || premap < batch->lba ||
+				premap >= batch->lba + batch->nr) {
+			batch->arena = arena;
+			batch->lba = premap;
+			batch->nr = min3(batch->left / btt->sector_size,
+					(u32)BTT_MAP_BATCH,
+					arena->external_nlba - premap);
+			batch->nr = max(batch->nr, 1U);
+			ret = btt_map_read_batch(arena, batch->lba, batch->nr,
+					batch->ent, NVDIMM_IO_ATOMIC);
+			if (ret) {
+				batch->nr = 0;
+				goto out_lane;
+			}
+		}
+
+		ret = btt_map_decode(premap, batch->ent[premap - batch->lba],
+				&postmap, &t_flag, &e_flag);
 		if (ret)
 			goto out_lane;
 
@@ -1224,7 +1291,7 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 
 			if (t_flag) {
 				zero_fill_data(page, off, cur_len);
-				goto out_lane;
+				goto next;
 			}
 
 			if (e_flag) {
@@ -1270,13 +1337,14 @@ static int btt_read_pg(struct btt *btt, struct bio_integrity_payload *bip,
 		}
 
 		arena->rtt[lane] = RTT_INVALID;
-		nd_region_release_lane(btt->nd_region, lane);
-
+ next:
 		len -= cur_len;
+		batch->left -= cur_len;
 		off += cur_len;
 		sector += btt->sector_size >> SECTOR_SHIFT;
 	}
 
+	nd_region_release_lane(btt->nd_region, lane);
 	return 0;
 
  out_rtt:
@@ -1307,17 +1375,21 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 {
 	int ret = 0;
 	struct arena_info *arena = NULL;
-	u32 premap = 0, old_postmap, new_postmap, lane = 0, i;
+	u32 premap = 0, old_postmap, new_postmap, lane, i;
 	struct log_entry log;
 	int sub;
 
+	/*
+	 * Hold the lane across the whole segment, it is only dropped to
+	 * clear a poisoned free block which may sleep.
+	 */
+	lane = nd_region_acquire_lane(btt->nd_region);
+
 	while (len) {
 		u32 cur_len;
 		int e_flag;
 
  retry:
-		lane = nd_region_acquire_lane(btt->nd_region);
-
 		ret = lba_to_arena(btt, sector, &premap, &arena);
 		if (ret)
 			goto out_lane;
@@ -1340,6 +1412,7 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 				return ret;
 
 			/* OK to acquire a different lane/free block */
+			lane = nd_region_acquire_lane(btt->nd_region);
 			goto retry;
 		}
 
@@ -1394,12 +1467,13 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 			goto out_map;
 
 		unlock_map(arena, premap);
-		nd_region_release_lane(btt->nd_region, lane);
 
 		if (e_flag) {
+			nd_region_release_lane(btt->nd_region, lane);
 			ret = arena_clear_freelist_error(arena, lane);
 			if (ret)
 				return ret;
+			lane = nd_region_acquire_lane(btt->nd_region);
 		}
 
 		len -= cur_len;
@@ -1407,6 +1481,7 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 		sector += btt->sector_size >> SECTOR_SHIFT;
 	}
 
+	nd_region_release_lane(btt->nd_region, lane);
 	return 0;
 
  out_map:
@@ -1418,12 +1493,13 @@ static int btt_write_pg(struct btt *btt, struct bio_integrity_payload *bip,
 
 static int btt_do_bvec(struct btt *btt, struct bio_integrity_payload *bip,
 			struct page *page, unsigned int len, unsigned int off,
-			enum req_op op, sector_t sector)
+			enum req_op op, sector_t sector,
+			struct btt_map_batch *batch)
 {
 	int ret;
 
 	if (!op_is_write(op)) {
-		ret = btt_read_pg(btt, bip, page, off, sector, len);
+		ret = btt_read_pg(btt, bip, page, off, sector, len, batch);
 		flush_dcache_page(page);
 	} else {
 		flush_dcache_page(page);
@@ -1437,6 +1513,7 @@ static void btt_submit_bio(struct bio *bio)
 {
 	struct bio_integrity_payload *bip = bio_integrity(bio);
 	struct btt *btt = bio->bi_bdev->bd_disk->private_data;
+	struct btt_map_batch batch = { };
 	struct bvec_iter iter;
 	unsigned long start;
 	struct bio_vec bvec;
@@ -1460,8 +1537,10 @@ static void btt_submit_bio(struct bio *bio)
 			break;
 		}
 
+		/* Let map reads look ahead into the following segments */
+		batch.left = iter.bi_size;
 		err = btt_do_bvec(btt, bip, bvec.bv_page, len, bvec.bv_offset,
-				  bio_op(bio), iter.bi_sector);
+				  bio_op(bio), iter.bi_sector, &batch);
 		if (err) {
 			dev_err(&btt->nd_btt->dev,
 					"io error in %s sector %lld, len %d,\n",
@@ -367,6 +367,7 @@ unsigned sizeof_namespace_label(struct nvdimm_drvdata *ndd);
 
 struct nd_percpu_lane {
 	int count;
+	unsigned int lane;
 	spinlock_t lock;
 };
 
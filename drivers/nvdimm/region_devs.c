@@ -927,7 +927,7 @@ void nd_region_advance_seeds(struct nd_region *nd_region, struct device *dev)
  * per-cpu.  For larger systems we need to lock to share lanes.  For now
  * this implementation assumes the cost of maintaining an allocator for
  * free lanes is on the order of the lock hold time, so it implements a
- * static lane = cpu % num_lanes mapping.
+ * static cpu to lane mapping, see nd_region_init_lanes().
  *
  * In the case of a BTT instance on top of a BLK namespace a lane may be
  * acquired recursively.  We lock on the first instance.
@@ -944,8 +944,8 @@ unsigned int nd_region_acquire_lane(struct nd_region *nd_region)
 	if (nd_region->num_lanes < nr_cpu_ids) {
 		struct nd_percpu_lane *ndl_lock, *ndl_count;
 
-		lane = cpu % nd_region->num_lanes;
 		ndl_count = per_cpu_ptr(nd_region->lane, cpu);
+		lane = ndl_count->lane;
 		ndl_lock = per_cpu_ptr(nd_region->lane, lane);
 		if (ndl_count->count++ == 0)
 			spin_lock(&ndl_lock->lock);
@@ -995,6 +995,61 @@ static unsigned long default_align(struct nd_region *nd_region)
 	return align;
 }
 
+/*
+ * When lanes are shared, hand out each node its own range of lanes sized
+ * in proportion to its cpu count, so that a contended lane lock is only
+ * ever bounced between cpus of the same node.  Fall back to the plain
+ * cpu % num_lanes mapping if the nodes can not each get a lane.
+ */
+static void nd_region_init_lanes(struct nd_region *nd_region)
+{
+	unsigned int num_lanes = nd_region->num_lanes;
+	unsigned int *node_cpus, *node_start, *node_lanes;
+	unsigned int cpu, node, total = 0, used = 0;
+	struct nd_percpu_lane *ndl;
+
+	for_each_possible_cpu(cpu) {
+		ndl = per_cpu_ptr(nd_region->lane, cpu);
+		ndl->lane = cpu % num_lanes;
+	}
+
+	if (num_lanes >= nr_cpu_ids || nr_node_ids == 1)
+		return;
+
+	node_cpus = kcalloc(3 * nr_node_ids, sizeof(*node_cpus), GFP_KERNEL);
+	if (!node_cpus)
+		return;
+	node_start = node_cpus + nr_node_ids;
+	node_lanes = node_start + nr_node_ids;
+
+	for_each_possible_cpu(cpu) {
+		node_cpus[cpu_to_node(cpu) == NUMA_NO_NODE ?
+			  0 : cpu_to_node(cpu)]++;
+		total++;
+	}
+
+	for (node = 0; node < nr_node_ids; node++) {
+		if (!node_cpus[node])
+			continue;
+		node_start[node] = used;
+		node_lanes[node] = max(1U, num_lanes * node_cpus[node] / total);
+		used += node_lanes[node];
+	}
+
+	if (used <= num_lanes) {
+		memset(node_cpus, 0, nr_node_ids * sizeof(*node_cpus));
+		for_each_possible_cpu(cpu) {
+			node = cpu_to_node(cpu) == NUMA_NO_NODE ?
+				0 : cpu_to_node(cpu);
+			ndl = per_cpu_ptr(nd_region->lane, cpu);
+			ndl->lane = node_start[node] +
+				node_cpus[node]++ % node_lanes[node];
+		}
+	}
+
+	kfree(node_cpus);
+}
+
 static struct lock_class_key nvdimm_region_key;
 
 static struct nd_region *nd_region_create(struct nvdimm_bus *nvdimm_bus,
@@ -1066,6 +1121,7 @@ static struct nd_region *nd_region_create(struct nvdimm_bus *nvdimm_bus,
 	nd_region->provider_data = ndr_desc->provider_data;
 	nd_region->nd_set = ndr_desc->nd_set;
 	nd_region->num_lanes = ndr_desc->num_lanes;
+	nd_region_init_lanes(nd_region);
 	nd_region->flags = ndr_desc->flags;
 	nd_region->ro = ro;
 	nd_region->numa_node = ndr_desc->numa_node;
@@ -331,6 +331,11 @@ int transport_alloc_session_tags(struct se_session *se_sess,
 		se_sess->sess_cmd_map = NULL;
 		return -ENOMEM;
 	}
+	/*
+	 * Commands of a session arrive on any CPU; keep each node on its own
+	 * tag words. Without the partitions the pool still works, just flat.
+	 */
+	sbitmap_partition_by_node(&se_sess->sess_tag_pool.sb, GFP_KERNEL);
 
 	return 0;
 }
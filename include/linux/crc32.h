@@ -66,6 +66,11 @@ static inline u32 __crc32c_le_combine(u32 crc1, u32 crc2, size_t len2)
 	return __crc32c_le_shift(crc1, len2) ^ crc2;
 }
 
+void crc32_le_multi(u32 *crcs, const u8 *const *bufs, size_t len,
+		    unsigned int nr);
+void __crc32c_le_multi(u32 *crcs, const u8 *const *bufs, size_t len,
+		       unsigned int nr);
+
 #define crc32(seed, data, length)  crc32_le(seed, (unsigned char const *)(data), length)
 
 /*
@@ -23,6 +23,9 @@ enum hrtimer_restart {
  *		which the timer is based. Is setup by adding
  *		slack to the _softexpires value. For non range timers
  *		identical to _softexpires.
+ * @park_node:	hlist node used instead of the timerqueue node while
+ *		the timer is parked in a far-out bucket. node.expires
+ *		stays valid.
  * @_softexpires: the absolute earliest expiry time of the hrtimer.
  *		The time which was given as expiry time when the timer
  *		was armed.
@@ -33,11 +36,16 @@ enum hrtimer_restart {
  * @is_soft:	Set if hrtimer will be expired in soft interrupt context.
  * @is_hard:	Set if hrtimer will be expired in hard interrupt context
  *		even on RT.
+ * @is_parked:	Set while the timer sits in a park bucket instead of
+ *		the timerqueue of its clock base.
  *
  * The hrtimer structure must be initialized by hrtimer_init()
  */
 struct hrtimer {
-	struct timerqueue_node		node;
+	union {
+		struct timerqueue_node	node;
+		struct hlist_node	park_node;
+	};
 	ktime_t				_softexpires;
 	enum hrtimer_restart		(*function)(struct hrtimer *);
 	struct hrtimer_clock_base	*base;
@@ -45,6 +53,7 @@ struct hrtimer {
 	u8				is_rel;
 	u8				is_soft;
 	u8				is_hard;
+	u8				is_parked;
 };
 
 #endif /* _LINUX_HRTIMER_TYPES_H */
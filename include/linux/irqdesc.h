@@ -61,6 +61,12 @@ struct irqstat {
  * @kobj:		kobject used to represent this struct in sysfs
  * @request_mutex:	mutex to protect request/free before locking desc->lock
  * @dir:		/proc/irq/ procfs entry
+ * @balance_count:	interrupt count at the last balancer pass
+ * @balance_rate:	interrupts per second measured by the balancer
+ * @balance_moved:	jiffies when the balancer last moved the interrupt
+ * @balance_cpu:	CPU the balancer last moved the interrupt to
+ * @balance_user:	affinity was set from user space, leave it alone
+ * @balance_mask:	affinity mask before the balancer first moved the interrupt
  * @debugfs_file:	dentry for the debugfs file
  * @name:		flow handler name for /proc/interrupts output
  */
@@ -102,6 +108,14 @@ struct irq_desc {
 #ifdef CONFIG_PROC_FS
 	struct proc_dir_entry	*dir;
 #endif
+#ifdef CONFIG_IRQ_BALANCE
+	unsigned int		balance_count;
+	unsigned int		balance_rate;
+	unsigned long		balance_moved;
+	unsigned int		balance_cpu;
+	bool			balance_user;
+	cpumask_var_t		balance_mask;
+#endif
 #ifdef CONFIG_GENERIC_IRQ_DEBUGFS
 	struct dentry		*debugfs_file;
 	const char		*dev_name;
@@ -150,6 +150,15 @@ typedef union {
 	LZ4_streamDecode_t_internal internal_donotuse;
 } LZ4_streamDecode_t;
 
+/*
+ * LZ4_dict_t - a dictionary digested once by LZ4_initDict() and then
+ *	shared, read-only, by any number of LZ4_compress_fast_dict() and
+ *	LZ4_decompress_safe_dict() calls, possibly running concurrently.
+ */
+typedef struct {
+	LZ4_stream_t stream;
+} LZ4_dict_t;
+
 /*-************************************************************************
  *	SIZE OF STATE
  **************************************************************************/
@@ -645,4 +654,66 @@ int LZ4_decompress_safe_usingDict(const char *source, char *dest,
 int LZ4_decompress_fast_usingDict(const char *source, char *dest,
 	int originalSize, const char *dictStart, int dictSize);
 
+/**
+ * LZ4_initDict() - Prepare a dictionary for sharing between calls
+ * @dict: the LZ4_dict_t to initialize
+ * @dictionary: dictionary to use
+ * @dictSize: size of the dictionary
+ *
+ * Hashes the dictionary once, so that it does not have to be loaded again
+ * with LZ4_loadDict() before every independent block. Only the last 64KB
+ * of @dictionary are used. The dictionary buffer itself is referenced, not
+ * copied: it must remain unmodified and accessible for as long as @dict is
+ * in use.
+ *
+ * Return: dictionary size, in bytes (necessarily <= 64KB)
+ */
+int LZ4_initDict(LZ4_dict_t *dict, const char *dictionary, int dictSize);
+
+/**
+ * LZ4_compress_fast_dict() - Compress an independent block with a
+ *	shared dictionary
+ * @dict: dictionary initialized with LZ4_initDict()
+ * @source: source address of the original data
+ * @dest: output buffer address of the compressed data
+ * @inputSize: size of the input data. Max supported value is LZ4_MAX_INPUT_SIZE
+ * @maxOutputSize: full or partial size of buffer 'dest'
+ *	which must be already allocated
+ * @acceleration: acceleration factor
+ * @wrkmem: address of the working memory.
+ *	This requires 'workmem' of LZ4_MEM_COMPRESS.
+ *
+ * Same as LZ4_loadDict() followed by LZ4_compress_fast_continue(), but the
+ * hashed dictionary is copied from @dict into @wrkmem instead of being
+ * rebuilt. @dict is not modified and may be used by several callers at once.
+ * The result can be decompressed with LZ4_decompress_safe_dict() or with
+ * LZ4_decompress_safe_usingDict() and the same dictionary.
+ *
+ * Return: Number of bytes written into buffer 'dest'
+ *	(necessarily <= maxOutputSize) or 0 if compression fails
+ */
+int LZ4_compress_fast_dict(const LZ4_dict_t *dict, const char *source,
+	char *dest, int inputSize, int maxOutputSize, int acceleration,
+	void *wrkmem);
+
+/**
+ * LZ4_decompress_safe_dict() - Decompress a block compressed with a
+ *	shared dictionary
+ * @dict: dictionary initialized with LZ4_initDict()
+ * @source: source address of the compressed data
+ * @dest: output buffer address of the uncompressed data
+ *	which must be already allocated
+ * @compressedSize: is the precise full size of the compressed block
+ * @maxDecompressedSize: is the size of 'dest' buffer
+ *
+ * Same as LZ4_decompress_safe_usingDict() with the part of the dictionary
+ * that LZ4_initDict() retained. @dict is not modified.
+ *
+ * Return: number of bytes decompressed into destination buffer
+ *	(necessarily <= maxDecompressedSize)
+ *	or a negative result in case of error
+ */
+int LZ4_decompress_safe_dict(const LZ4_dict_t *dict, const char *source,
+	char *dest, int compressedSize, int maxDecompressedSize);
+
 #endif
@@ -339,10 +339,26 @@ int mtree_alloc_rrange(struct maple_tree *mt, unsigned long *startp,
 		void *entry, unsigned long size, unsigned long min,
 		unsigned long max, gfp_t gfp);
 
+/**
+ * struct maple_range - A range and its entry for the bulk interfaces
+ * @index: The first index of the range
+ * @last: The last index of the range (inclusive)
+ * @entry: The entry to store over the range
+ */
+struct maple_range {
+	unsigned long index;
+	unsigned long last;
+	void *entry;
+};
+
 int mtree_store_range(struct maple_tree *mt, unsigned long first,
 		      unsigned long last, void *entry, gfp_t gfp);
 int mtree_store(struct maple_tree *mt, unsigned long index,
 		void *entry, gfp_t gfp);
+int mtree_bulk_load(struct maple_tree *mt, const struct maple_range *ranges,
+		    unsigned long nr);
+int mtree_bulk_store(struct maple_tree *mt, const struct maple_range *ranges,
+		     unsigned long nr, gfp_t gfp);
 void *mtree_erase(struct maple_tree *mt, unsigned long index);
 
 int mtree_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp);
@@ -1019,6 +1019,13 @@ struct mm_struct {
 #ifdef CONFIG_PREEMPT_RT
 		struct rcu_head delayed_drop;
 #endif
+#ifdef CONFIG_FUTEX
+		/* Serialises replacing futex_phash, see kernel/futex/core.c */
+		struct mutex futex_hash_lock;
+		struct futex_private_hash __rcu *futex_phash;
+		/* Hash size set by PR_FUTEX_HASH, don't resize automatically */
+		bool futex_hash_fixed;
+#endif
 #ifdef CONFIG_HUGETLB_PAGE
 		atomic_long_t hugetlb_usage;
 #endif
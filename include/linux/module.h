@@ -449,6 +449,10 @@ struct module {
 	unsigned int num_gpl_syms;
 	const struct kernel_symbol *gpl_syms;
 	const s32 *gpl_crcs;
+#ifdef CONFIG_MODULE_SYMBOL_INDEX
+	/* Nodes of syms and gpl_syms in the exported symbol index. */
+	struct sym_index_node *sym_index;
+#endif
 	bool using_gplonly_symbols;
 
 #ifdef CONFIG_MODULE_SIG
@@ -19,6 +19,8 @@
 
 #ifdef CONFIG_SMP
 
+struct percpu_counter_llc;
+
 struct percpu_counter {
 	raw_spinlock_t lock;
 	s64 count;
@@ -26,6 +28,7 @@ struct percpu_counter {
 	struct list_head list;	/* All percpu_counters are on a list */
 #endif
 	s32 __percpu *counters;
+	struct percpu_counter_llc __percpu *llc_counts; /* Per-LLC partial sums, optional */
 };
 
 extern int percpu_counter_batch;
@@ -60,6 +63,8 @@ int __percpu_counter_compare(struct percpu_counter *fbc, s64 rhs, s32 batch);
 bool __percpu_counter_limited_add(struct percpu_counter *fbc, s64 limit,
 				  s64 amount, s32 batch);
 void percpu_counter_sync(struct percpu_counter *fbc);
+int percpu_counter_enable_llc(struct percpu_counter *fbc, gfp_t gfp);
+s64 percpu_counter_sum_approx(struct percpu_counter *fbc);
 
 static inline int percpu_counter_compare(struct percpu_counter *fbc, s64 rhs)
 {
@@ -168,6 +173,17 @@ static inline void percpu_counter_set(struct percpu_counter *fbc, s64 amount)
 	fbc->count = amount;
 }
 
+static inline int percpu_counter_enable_llc(struct percpu_counter *fbc,
+					    gfp_t gfp)
+{
+	return 0;
+}
+
+static inline s64 percpu_counter_sum_approx(struct percpu_counter *fbc)
+{
+	return fbc->count;
+}
+
 static inline int percpu_counter_compare(struct percpu_counter *fbc, s64 rhs)
 {
 	if (fbc->count > rhs)
@@ -686,6 +686,7 @@ struct swevent_hlist {
 struct bpf_prog;
 struct perf_cgroup;
 struct perf_buffer;
+struct perf_stack_table;
 
 struct pmu_event_list {
 	raw_spinlock_t		lock;
@@ -845,6 +846,9 @@ struct perf_event {
 	/* for aux_output events */
 	struct perf_event		*aux_event;
 
+	/* callchains already emitted, for attr.callchain_dedup */
+	struct perf_stack_table		*stack_table;
+
 	void (*destroy)(struct perf_event *);
 	struct rcu_head			rcu_head;
 
@@ -1238,6 +1242,11 @@ struct perf_sample_data {
 	 */
 	u64				ip;
 	struct perf_callchain_entry	*callchain;
+	struct {
+		u64	nr;
+		u64	ctx;
+		u64	id;
+	}				stack_ref;
 	struct perf_raw_record		*raw;
 	struct perf_branch_stack	*br_stack;
 	u64				*br_stack_cntr;
@@ -67,13 +67,25 @@ extern const char raid6_empty_zero_page[PAGE_SIZE];
 #define CONFIG_RAID6_PQ_BENCHMARK 1
 #endif /* __KERNEL__ */
 
-/* Routine choices */
+/*
+ * Routine choices
+ *
+ * The _batch variants work on @nr stripes at once, whose pointer tables of
+ * @disks entries each follow one another in @ptrs.  They are optional for
+ * an implementation; the selected raid6_call always has one.
+ *
+ * async_tx and md/raid5 don't use them: each async_gen_syndrome() or
+ * async_raid6_*_recov() call carries a single stripe with its own offsets
+ * and dependency chain, so there is never more than one stripe to hand
+ * over.  They are meant for callers that already hold many stripes.
+ */
 struct raid6_calls {
 	void (*gen_syndrome)(int, size_t, void **);
 	void (*xor_syndrome)(int, int, int, size_t, void **);
 	int  (*valid)(void);	/* Returns 1 if this routine set is usable */
 	const char *name;	/* Name of this routine set */
 	int priority;		/* Relative priority ranking if non-zero */
+	void (*gen_syndrome_batch)(int, size_t, int, void **);
 };
 
 /* Selected algorithm */
@@ -115,6 +127,8 @@ struct raid6_recov_calls {
 	int  (*valid)(void);
 	const char *name;
 	int priority;
+	void (*data2_batch)(int, size_t, int, int, int, void **);
+	void (*datap_batch)(int, size_t, int, int, void **);
 };
 
 extern const struct raid6_recov_calls raid6_recov_intx1;
@@ -158,6 +172,20 @@ extern void (*raid6_datap_recov)(int disks, size_t bytes, int faila,
 void raid6_dual_recov(int disks, size_t bytes, int faila, int failb,
 		      void **ptrs);
 
+/* Batched recovery, same failed disks in all @nr stripes */
+extern void (*raid6_2data_recov_batch)(int disks, size_t bytes, int nr,
+				       int faila, int failb, void **ptrs);
+extern void (*raid6_datap_recov_batch)(int disks, size_t bytes, int nr,
+				       int faila, void **ptrs);
+
+/* Stripes whose deltas are computed together by the helpers below */
+#define RAID6_RECOV_BATCH	16
+
+int raid6_2data_recov_delta(int disks, size_t bytes, int nr, int faila,
+			    int failb, void **ptrs);
+int raid6_datap_recov_delta(int disks, size_t bytes, int nr, int faila,
+			    void **ptrs);
+
 /* Some definitions to allow code to be compiled for testing in userspace */
 #ifndef __KERNEL__
 
@@ -166,6 +194,7 @@ void raid6_dual_recov(int disks, size_t bytes, int faila, int failb,
 # define pr_err(format, ...) fprintf(stderr, format, ## __VA_ARGS__)
 # define pr_info(format, ...) fprintf(stdout, format, ## __VA_ARGS__)
 # define GFP_KERNEL	0
+# define __GFP_NOWARN	0
 # define __get_free_pages(x, y)	((unsigned long)mmap(NULL, PAGE_SIZE << (y), \
 						     PROT_READ|PROT_WRITE,   \
 						     MAP_PRIVATE|MAP_ANONYMOUS,\
@@ -65,7 +65,8 @@ struct rhash_lock_head {};
  * struct bucket_table - Table of hash buckets
  * @size: Number of hash buckets
  * @nest: Number of bits of first-level nested table.
- * @rehash: Current bucket being rehashed
+ * @rehash_next: Next bucket to be claimed for rehashing
+ * @rehash_done: Number of buckets rehashed by their claimant
  * @hash_rnd: Random seed to fold into hash
  * @walkers: List of active walkers
  * @rcu: RCU structure for freeing the table
@@ -77,6 +78,8 @@ struct bucket_table {
 	unsigned int		size;
 	unsigned int		nest;
 	u32			hash_rnd;
+	atomic_t		rehash_next;
+	atomic_t		rehash_done;
 	struct list_head	walkers;
 	struct rcu_head		rcu;
 
@@ -241,6 +244,8 @@ static inline int lockdep_rht_bucket_is_held(const struct bucket_table *tbl,
 
 void *rhashtable_insert_slow(struct rhashtable *ht, const void *key,
 			     struct rhash_head *obj);
+unsigned int rhashtable_insert_bulk(struct rhashtable *ht,
+				    struct rhash_head **objs, unsigned int nr);
 
 void rhashtable_walk_enter(struct rhashtable *ht,
 			   struct rhashtable_iter *iter);
@@ -82,6 +82,14 @@ struct sbitmap {
 	 * cachelines until the map is exhausted.
 	 */
 	unsigned int __percpu *alloc_hint;
+
+	/**
+	 * @node_start: If not %NULL, the words are partitioned by NUMA node
+	 * and words [node_start[n], node_start[n + 1]) belong to node n. CPUs
+	 * allocate from the partition of their node and only take bits from
+	 * other partitions when it is full. See sbitmap_partition_by_node().
+	 */
+	unsigned int *node_start;
 };
 
 #define SBQ_WAIT_QUEUES 8
@@ -187,8 +195,27 @@ static inline void sbitmap_free(struct sbitmap *sb)
 	free_percpu(sb->alloc_hint);
 	kvfree(sb->map);
 	sb->map = NULL;
+	kfree(sb->node_start);
+	sb->node_start = NULL;
 }
 
+/**
+ * sbitmap_partition_by_node() - Partition a &struct sbitmap by NUMA node.
+ * @sb: Bitmap to partition, initialized with allocation hints.
+ * @flags: Allocation flags.
+ *
+ * Splits the words of @sb into one partition per NUMA node, sized by the
+ * number of possible CPUs of each node. sbitmap_get(),
+ * sbitmap_get_shallow() and __sbitmap_queue_get_batch() then search the
+ * partition of the calling CPU's node first, so that on multi-socket
+ * systems the cachelines of a word are only shared between the CPUs of one
+ * node until that node's partition is full.
+ * A no-op on single node systems.
+ *
+ * Return: Zero on success or negative errno on failure.
+ */
+int sbitmap_partition_by_node(struct sbitmap *sb, gfp_t flags);
+
 /**
  * sbitmap_resize() - Resize a &struct sbitmap.
  * @sb: Bitmap to resize.
@@ -51,7 +51,7 @@ union handle_parts {
 };
 
 struct stack_record {
-	struct list_head hash_list;	/* Links in the hash table */
+	struct stack_record *next;	/* Link in the hash table bucket */
 	u32 hash;			/* Hash in hash table */
 	u32 size;			/* Number of stored frames */
 	union handle_parts handle;	/* Constant after initialization */
@@ -231,6 +231,19 @@ int stack_depot_snprint(depot_stack_handle_t handle, char *buf, size_t size,
  */
 void stack_depot_put(depot_stack_handle_t handle);
 
+/**
+ * stack_depot_put_batch - Drop references to several stack traces
+ *
+ * @handles:	Stack depot handles returned from stack_depot_save_flags()
+ * @nr:		Number of handles, 0 handles are skipped
+ *
+ * Same as calling stack_depot_put() on every handle, but stack traces that
+ * lose their last reference are evicted together, taking the depot lock once
+ * per batch instead of once per stack trace.
+ */
+void stack_depot_put_batch(const depot_stack_handle_t *handles,
+			   unsigned int nr);
+
 /**
  * stack_depot_set_extra_bits - Set extra bits in a stack depot handle
  *
@@ -327,6 +327,13 @@ __copy_from_user_inatomic_nocache(void *to, const void __user *from,
 	return __copy_from_user_inatomic(to, from, n);
 }
 
+static inline __must_check unsigned long
+__copy_to_user_inatomic_nocache(void __user *to, const void *from,
+				unsigned long n)
+{
+	return __copy_to_user_inatomic(to, from, n);
+}
+
 #endif		/* ARCH_HAS_NOCACHE_UACCESS */
 
 extern __must_check int check_zeroed_user(const void __user *from, size_t size);
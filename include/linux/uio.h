@@ -44,6 +44,7 @@ struct iov_iter {
 	u8 iter_type;
 	bool nofault;
 	bool data_source;
+	bool nocache;
 	size_t iov_offset;
 	/*
 	 * Hack alert: overlay ubuf_iovec with iovec + count, so
@@ -150,6 +151,17 @@ static inline bool user_backed_iter(const struct iov_iter *i)
 	return iter_is_ubuf(i) || iter_is_iovec(i);
 }
 
+/*
+ * Hint that the data copied through @i won't be touched again soon, so
+ * user copies may bypass the CPU cache with non-temporal stores.
+ */
+static inline void iov_iter_set_nocache(struct iov_iter *i, bool nocache)
+{
+	i->nocache = nocache;
+}
+
+bool iov_iter_nocache_size(size_t size);
+
 /*
  * Total number of bytes covered by an iovec.
  *
@@ -78,6 +78,7 @@ struct uprobe_task {
 
 	struct uprobe			*active_uprobe;
 	unsigned long			xol_vaddr;
+	unsigned int			xol_slot_hint;
 
 	struct arch_uprobe              *auprobe;
 
@@ -227,6 +227,73 @@ void xz_dec_reset(struct xz_dec *s);
  */
 void xz_dec_end(struct xz_dec *s);
 
+/**
+ * DOC: Block-level decoding
+ *
+ * A .xz Stream written by a multithreaded encoder consists of independently
+ * compressed Blocks whose Block Headers store both the compressed and the
+ * uncompressed size. xz_dec_scan() locates such Blocks without decompressing
+ * anything and xz_dec_block_run() decodes one of them, so the Blocks can be
+ * decoded in any order or in parallel, each with its own decoder state.
+ * Both work only in single-call mode (XZ_SINGLE). They are available if
+ * CONFIG_XZ_DEC_MT is enabled.
+ */
+
+/**
+ * struct xz_block - Location of a Block found by xz_dec_scan()
+ * @in_pos:     Offset of the Block Header in the input buffer given to
+ *              xz_dec_scan()
+ * @in_size:    Size of the Block, from the Block Header to the end of the
+ *              Check field
+ * @out_size:   Uncompressed size of the Block
+ * @check:      Check ID of the Stream, used by xz_dec_block_run()
+ */
+struct xz_block {
+	size_t in_pos;
+	size_t in_size;
+	size_t out_size;
+	uint8_t check;
+};
+
+/**
+ * xz_dec_scan() - Locate the Blocks of a .xz Stream
+ * @s:          Decoder state allocated using xz_dec_init() with XZ_SINGLE
+ * @b:          Input buffer holding the whole Stream from b->in[b->in_pos]
+ *              onward. The output buffer is not used.
+ * @blocks:     Array to store the Blocks in, or NULL to only count them
+ * @nr_blocks:  Size of the @blocks array on input, number of Blocks in
+ *              the Stream on output
+ *
+ * The Stream Header, the Block Headers, the Index, and the Stream Footer are
+ * validated just like xz_dec_run() validates them, so on success b->in_pos
+ * points right after the Stream Footer. The Blocks themselves are only
+ * validated when they are decoded.
+ *
+ * Returns XZ_STREAM_END on success, XZ_MEM_ERROR if @blocks is too small or
+ * a Block would not fit in memory, XZ_OPTIONS_ERROR if some Block Header
+ * doesn't store both sizes (the Stream has to be decoded with xz_dec_run()
+ * then), or any other error that xz_dec_run() could return for the headers.
+ * On failure, b->in_pos is not modified.
+ */
+enum xz_ret xz_dec_scan(struct xz_dec *s, struct xz_buf *b,
+			struct xz_block *blocks, size_t *nr_blocks);
+
+/**
+ * xz_dec_block_run() - Decode one Block found by xz_dec_scan()
+ * @s:          Decoder state allocated using xz_dec_init() with XZ_SINGLE
+ * @block:      The Block to decode
+ * @b:          Input and output buffers. b->in[b->in_pos] must be the start
+ *              of the Block and b->in_size - b->in_pos must equal
+ *              block->in_size. There must be room for block->out_size bytes
+ *              of output from b->out[b->out_pos] onward.
+ *
+ * Returns XZ_STREAM_END if the whole Block was successfully decoded.
+ * Otherwise b->in_pos and b->out_pos are not modified, like with xz_dec_run()
+ * in single-call mode.
+ */
+enum xz_ret xz_dec_block_run(struct xz_dec *s, const struct xz_block *block,
+			     struct xz_buf *b);
+
 /**
  * DOC: MicroLZMA decompressor
  *
@@ -460,7 +460,9 @@ struct perf_event_attr {
 				inherit_thread :  1, /* children only inherit if cloned with CLONE_THREAD */
 				remove_on_exec :  1, /* event is removed from task on exec */
 				sigtrap        :  1, /* send synchronous SIGTRAP on event */
-				__reserved_1   : 26;
+				wakeup_adaptive :  1, /* scale wakeup_watermark to the reader */
+				callchain_dedup :  1, /* callchains by PERF_RECORD_CALLCHAIN_STACK id */
+				__reserved_1   : 24;
 
 	union {
 		__u32		wakeup_events;	  /* wakeup every n events */
@@ -1226,6 +1228,23 @@ enum perf_event_type {
 	 */
 	PERF_RECORD_AUX_OUTPUT_HW_ID		= 21,
 
+	/*
+	 * With attr.callchain_dedup, a callchain is emitted once in this
+	 * record, before the first sample that refers to it. The callchain
+	 * of such samples then consists of PERF_CONTEXT_STACK_ID followed
+	 * by the id. Ids are never reused; a stack that was evicted from
+	 * the kernel's table is emitted again under a new id.
+	 *
+	 * struct {
+	 *	struct perf_event_header	header;
+	 *	u64				id;
+	 *	u64				nr;
+	 *	u64				ips[nr];
+	 *	struct sample_id		sample_id;
+	 * };
+	 */
+	PERF_RECORD_CALLCHAIN_STACK		= 22,
+
 	PERF_RECORD_MAX,			/* non-ABI */
 };
 
@@ -1261,6 +1280,8 @@ enum perf_callchain_context {
 	PERF_CONTEXT_GUEST_KERNEL	= (__u64)-2176,
 	PERF_CONTEXT_GUEST_USER		= (__u64)-2560,
 
+	PERF_CONTEXT_STACK_ID		= (__u64)-3072,
+
 	PERF_CONTEXT_MAX		= (__u64)-4095,
 };
 
@@ -102,6 +102,12 @@ static struct io_tlb_mem io_tlb_default_mem;
 static unsigned long default_nslabs = IO_TLB_DEFAULT_SIZE >> IO_TLB_SHIFT;
 static unsigned long default_nareas;
 
+/*
+ * Number of recently freed single slots that each area keeps aside for the
+ * lockless allocation fast path.
+ */
+#define IO_TLB_QUICK_SLOTS	8
+
 /**
  * struct io_tlb_area - IO TLB memory area descriptor
  *
@@ -111,11 +117,17 @@ static unsigned long default_nareas;
  * @index:	The slot index to start searching in this area for next round.
  * @lock:	The lock to protect the above data structures in the map and
  *		unmap calls.
+ * @quick:	Recently freed single slots, stored as slot index + 1 (zero
+ *		means empty). Entries are taken and added with atomic
+ *		exchanges, without @lock. Parked slots still count as @used
+ *		and stay off the free list until the area runs dry and drains
+ *		them under @lock.
  */
 struct io_tlb_area {
 	unsigned long used;
 	unsigned int index;
 	spinlock_t lock;
+	unsigned int quick[IO_TLB_QUICK_SLOTS];
 };
 
 /*
@@ -283,6 +295,7 @@ static void swiotlb_init_io_tlb_pool(struct io_tlb_pool *mem, phys_addr_t start,
 		spin_lock_init(&mem->areas[i].lock);
 		mem->areas[i].index = 0;
 		mem->areas[i].used = 0;
+		memset(mem->areas[i].quick, 0, sizeof(mem->areas[i].quick));
 	}
 
 	for (i = 0; i < mem->nslabs; i++) {
@@ -997,6 +1010,113 @@ static void dec_transient_used(struct io_tlb_mem *mem, unsigned int nslots)
 #endif /* CONFIG_DEBUG_FS */
 #endif /* CONFIG_SWIOTLB_DYNAMIC */
 
+/**
+ * swiotlb_free_slots_locked() - return slots to the free list of an area
+ * @pool:	Memory pool which owns the slots.
+ * @area:	Memory area which contains the slots; its lock must be held.
+ * @index:	Index of the first slot.
+ * @nslots:	Number of slots.
+ *
+ * Mark the slots free and merge them with the free slots above and below
+ * them within the same segment.
+ */
+static void swiotlb_free_slots_locked(struct io_tlb_pool *pool,
+		struct io_tlb_area *area, int index, int nslots)
+{
+	int count, i;
+
+	lockdep_assert_held(&area->lock);
+
+	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
+		count = pool->slots[index + nslots].list;
+	else
+		count = 0;
+
+	/*
+	 * Step 1: return the slots to the free list, merging the slots with
+	 * superceeding slots
+	 */
+	for (i = index + nslots - 1; i >= index; i--) {
+		pool->slots[i].list = ++count;
+		pool->slots[i].orig_addr = INVALID_PHYS_ADDR;
+		pool->slots[i].alloc_size = 0;
+		pool->slots[i].pad_slots = 0;
+	}
+
+	/*
+	 * Step 2: merge the returned slots with the preceding slots, if
+	 * available (non zero)
+	 */
+	for (i = index - 1;
+	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && pool->slots[i].list;
+	     i--)
+		pool->slots[i].list = ++count;
+	area->used -= nslots;
+}
+
+/**
+ * swiotlb_quick_get() - take a parked single slot from an area
+ * @area:	Memory area.
+ *
+ * Return: Index of the slot, or -1 if the area has no parked slots.
+ */
+static int swiotlb_quick_get(struct io_tlb_area *area)
+{
+	unsigned int i, slot;
+
+	for (i = 0; i < IO_TLB_QUICK_SLOTS; i++) {
+		if (!READ_ONCE(area->quick[i]))
+			continue;
+		slot = xchg(&area->quick[i], 0);
+		if (slot)
+			return slot - 1;
+	}
+	return -1;
+}
+
+/**
+ * swiotlb_quick_put() - park a freed single slot in its area
+ * @area:	Memory area which contains the slot.
+ * @index:	Index of the slot, whose descriptor must already be reset.
+ *
+ * Return: %true if the slot was parked, %false if the area is full.
+ */
+static bool swiotlb_quick_put(struct io_tlb_area *area, unsigned int index)
+{
+	unsigned int i;
+
+	for (i = 0; i < IO_TLB_QUICK_SLOTS; i++) {
+		if (!READ_ONCE(area->quick[i]) &&
+		    !cmpxchg(&area->quick[i], 0, index + 1))
+			return true;
+	}
+	return false;
+}
+
+/**
+ * swiotlb_quick_drain() - return all parked slots to the free list
+ * @pool:	Memory pool which owns the area.
+ * @area:	Memory area; its lock must be held.
+ *
+ * Return: Number of slots returned to the free list.
+ */
+static unsigned int swiotlb_quick_drain(struct io_tlb_pool *pool,
+		struct io_tlb_area *area)
+{
+	unsigned int i, slot, drained = 0;
+
+	for (i = 0; i < IO_TLB_QUICK_SLOTS; i++) {
+		if (!READ_ONCE(area->quick[i]))
+			continue;
+		slot = xchg(&area->quick[i], 0);
+		if (slot) {
+			swiotlb_free_slots_locked(pool, area, slot - 1, 1);
+			drained++;
+		}
+	}
+	return drained;
+}
+
 /**
  * swiotlb_search_pool_area() - search one memory area in one pool
  * @dev:	Device which maps the buffer.
@@ -1029,6 +1149,8 @@ static int swiotlb_search_pool_area(struct device *dev, struct io_tlb_pool *pool
 	unsigned long flags;
 	unsigned int slot_base;
 	unsigned int slot_index;
+	bool drained = false;
+	int quick;
 
 	BUG_ON(!nslots);
 	BUG_ON(area_index >= pool->nareas);
@@ -1058,7 +1180,24 @@ static int swiotlb_search_pool_area(struct device *dev, struct io_tlb_pool *pool
 	 */
 	stride = get_max_slots(max(alloc_align_mask, iotlb_align_mask));
 
+	/*
+	 * Any slot satisfies a single-slot request without extra alignment
+	 * constraints, so try the slots parked by recent unmaps first. This
+	 * is the common case for small streaming mappings and does not touch
+	 * the area lock.
+	 */
+	if (nslots == 1 && alloc_align_mask == IO_TLB_SIZE - 1 &&
+	    !iotlb_align_mask) {
+		quick = swiotlb_quick_get(area);
+		if (quick >= 0) {
+			pool->slots[quick].alloc_size = alloc_size - offset;
+			inc_used_and_hiwater(dev->dma_io_tlb_mem, 1);
+			return quick;
+		}
+	}
+
 	spin_lock_irqsave(&area->lock, flags);
+retry:
 	if (unlikely(nslots > pool->area_nslabs - area->used))
 		goto not_found;
 
@@ -1090,6 +1229,11 @@ static int swiotlb_search_pool_area(struct device *dev, struct io_tlb_pool *pool
 	}
 
 not_found:
+	if (!drained) {
+		drained = true;
+		if (swiotlb_quick_drain(pool, area))
+			goto retry;
+	}
 	spin_unlock_irqrestore(&area->lock, flags);
 	return -1;
 
@@ -1447,7 +1591,6 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr,
 	unsigned int offset = swiotlb_align_offset(dev, 0, tlb_addr);
 	int index, nslots, aindex;
 	struct io_tlb_area *area;
-	int count, i;
 
 	index = (tlb_addr - offset - mem->start) >> IO_TLB_SHIFT;
 	index -= mem->slots[index].pad_slots;
@@ -1455,40 +1598,32 @@ static void swiotlb_release_slots(struct device *dev, phys_addr_t tlb_addr,
 	aindex = index / mem->area_nslabs;
 	area = &mem->areas[aindex];
 
-	/*
-	 * Return the buffer to the free list by setting the corresponding
-	 * entries to indicate the number of contiguous entries available.
-	 * While returning the entries to the free list, we merge the entries
-	 * with slots below and above the pool being returned.
-	 */
 	BUG_ON(aindex >= mem->nareas);
 
-	spin_lock_irqsave(&area->lock, flags);
-	if (index + nslots < ALIGN(index + 1, IO_TLB_SEGSIZE))
-		count = mem->slots[index + nslots].list;
-	else
-		count = 0;
-
 	/*
-	 * Step 1: return the slots to the free list, merging the slots with
-	 * superceeding slots
+	 * Park single slots for the lockless fast path in
+	 * swiotlb_search_pool_area(). The slot stays allocated as far as the
+	 * free list is concerned, so its descriptor must be reset before it
+	 * is published.
 	 */
-	for (i = index + nslots - 1; i >= index; i--) {
-		mem->slots[i].list = ++count;
-		mem->slots[i].orig_addr = INVALID_PHYS_ADDR;
-		mem->slots[i].alloc_size = 0;
-		mem->slots[i].pad_slots = 0;
+	if (nslots == 1) {
+		mem->slots[index].orig_addr = INVALID_PHYS_ADDR;
+		mem->slots[index].alloc_size = 0;
+		mem->slots[index].pad_slots = 0;
+		if (swiotlb_quick_put(area, index)) {
+			dec_used(dev->dma_io_tlb_mem, nslots);
+			return;
+		}
 	}
 
 	/*
-	 * Step 2: merge the returned slots with the preceding slots, if
-	 * available (non zero)
+	 * Return the buffer to the free list by setting the corresponding
+	 * entries to indicate the number of contiguous entries available.
+	 * While returning the entries to the free list, we merge the entries
+	 * with slots below and above the pool being returned.
 	 */
-	for (i = index - 1;
-	     io_tlb_offset(i) != IO_TLB_SEGSIZE - 1 && mem->slots[i].list;
-	     i--)
-		mem->slots[i].list = ++count;
-	area->used -= nslots;
+	spin_lock_irqsave(&area->lock, flags);
+	swiotlb_free_slots_locked(mem, area, index, nslots);
 	spin_unlock_irqrestore(&area->lock, flags);
 
 	dec_used(dev->dma_io_tlb_mem, nslots);
@@ -8,6 +8,7 @@
  *  Copyright  ©  2009 Paul Mackerras, IBM Corp. <paulus@au1.ibm.com>
  */
 
+#include <linux/jhash.h>
 #include <linux/perf_event.h>
 #include <linux/slab.h>
 #include <linux/sched/task_stack.h>
@@ -292,3 +293,156 @@ int perf_event_max_stack_handler(const struct ctl_table *table, int write,
 
 	return ret;
 }
+
+/*
+ * Per-event table of callchains that were already emitted as
+ * PERF_RECORD_CALLCHAIN_STACK records. Stacks are looked up by a 64-bit
+ * hash of their entries and each slot keeps a copy of the entries, so that
+ * a hash collision is never mistaken for a hit. The table is set
+ * associative with a fixed size and evicts the least recently used stack
+ * of a set. An evicted stack is emitted again under a new id when it is
+ * seen next.
+ */
+#define PERF_STACK_TABLE_SETS	32
+#define PERF_STACK_TABLE_WAYS	4
+
+struct perf_stack_slot {
+	u64				hash;
+	u64				id;
+	u64				*ip;
+	u32				nr;
+};
+
+struct perf_stack_table {
+	atomic_t			busy;
+	u32				depth;
+	struct perf_stack_slot		slots[PERF_STACK_TABLE_SETS][PERF_STACK_TABLE_WAYS];
+	u64				ips[];
+};
+
+/* Stack ids are unique across events so that shared buffers stay unambiguous. */
+static atomic64_t perf_stack_next_id;
+
+/* @depth is the largest callchain, contexts included, the table can hold. */
+struct perf_stack_table *perf_stack_table_alloc(u32 depth)
+{
+	struct perf_stack_table *tbl;
+	int set, way;
+	u64 *ip;
+
+	tbl = kvzalloc(struct_size(tbl, ips, (size_t)depth *
+				   PERF_STACK_TABLE_SETS * PERF_STACK_TABLE_WAYS),
+		       GFP_KERNEL);
+	if (!tbl)
+		return NULL;
+
+	tbl->depth = depth;
+	ip = tbl->ips;
+	for (set = 0; set < PERF_STACK_TABLE_SETS; set++) {
+		for (way = 0; way < PERF_STACK_TABLE_WAYS; way++) {
+			tbl->slots[set][way].ip = ip;
+			ip += depth;
+		}
+	}
+
+	return tbl;
+}
+
+void perf_stack_table_free(struct perf_stack_table *tbl)
+{
+	kvfree(tbl);
+}
+
+bool perf_stack_table_trylock(struct perf_stack_table *tbl)
+{
+	return atomic_cmpxchg_acquire(&tbl->busy, 0, 1) == 0;
+}
+
+void perf_stack_table_unlock(struct perf_stack_table *tbl)
+{
+	atomic_set_release(&tbl->busy, 0);
+}
+
+/*
+ * Forget all stacks, for when the event moves to another buffer that has
+ * none of their records. Samples only ever hold the table briefly.
+ */
+void perf_stack_table_reset(struct perf_stack_table *tbl)
+{
+	int set, way;
+
+	while (!perf_stack_table_trylock(tbl))
+		cpu_relax();
+
+	for (set = 0; set < PERF_STACK_TABLE_SETS; set++) {
+		for (way = 0; way < PERF_STACK_TABLE_WAYS; way++) {
+			tbl->slots[set][way].hash = 0;
+			tbl->slots[set][way].id = 0;
+			tbl->slots[set][way].nr = 0;
+		}
+	}
+
+	perf_stack_table_unlock(tbl);
+}
+
+static u64 perf_stack_hash(struct perf_callchain_entry *entry)
+{
+	u32 len = entry->nr * (sizeof(u64) / sizeof(u32));
+	const u32 *words = (const u32 *)entry->ip;
+
+	return ((u64)jhash2(words, len, 0) << 32) |
+	       jhash2(words, len, 0x9e3779b9);
+}
+
+/*
+ * Look up @entry in @tbl. On a hit, *@id is set to its stack id, the slot
+ * becomes the most recently used of its set and 1 is returned. On a miss,
+ * *@id is a new id that must be passed to perf_stack_table_insert() once
+ * the stack record has been written and 0 is returned. A callchain too
+ * deep for the table gives -E2BIG. Must be called with the table locked.
+ */
+int perf_stack_table_lookup(struct perf_stack_table *tbl,
+			    struct perf_callchain_entry *entry,
+			    u64 *hash, u64 *id)
+{
+	struct perf_stack_slot *set, hit;
+	int way;
+
+	if (entry->nr > tbl->depth)
+		return -E2BIG;
+
+	*hash = perf_stack_hash(entry);
+	set = tbl->slots[*hash % PERF_STACK_TABLE_SETS];
+
+	for (way = 0; way < PERF_STACK_TABLE_WAYS; way++) {
+		if (!set[way].id || set[way].hash != *hash ||
+		    set[way].nr != entry->nr ||
+		    memcmp(set[way].ip, entry->ip, entry->nr * sizeof(u64)))
+			continue;
+
+		hit = set[way];
+		memmove(&set[1], &set[0], way * sizeof(*set));
+		set[0] = hit;
+		*id = hit.id;
+		return 1;
+	}
+
+	*id = atomic64_inc_return(&perf_stack_next_id);
+	return 0;
+}
+
+void perf_stack_table_insert(struct perf_stack_table *tbl,
+			     struct perf_callchain_entry *entry,
+			     u64 hash, u64 id)
+{
+	struct perf_stack_slot *set = tbl->slots[hash % PERF_STACK_TABLE_SETS];
+	u64 *ip = set[PERF_STACK_TABLE_WAYS - 1].ip;
+
+	/* The evicted slot hands its entry storage to the new stack. */
+	memmove(&set[1], &set[0], (PERF_STACK_TABLE_WAYS - 1) * sizeof(*set));
+	set[0].hash = hash;
+	set[0].id = id;
+	set[0].ip = ip;
+	set[0].nr = entry->nr;
+	memcpy(ip, entry->ip, entry->nr * sizeof(u64));
+}
@@ -5104,6 +5104,7 @@ static void free_event_rcu(struct rcu_head *head)
 	if (event->ns)
 		put_pid_ns(event->ns);
 	perf_event_free_filter(event);
+	perf_stack_table_free(event->stack_table);
 	kmem_cache_free(perf_event_cache, event);
 }
 
@@ -6398,6 +6399,10 @@ static void ring_buffer_attach(struct perf_event *event,
 
 	rcu_assign_pointer(event->rb, rb);
 
+	/* The new buffer has none of the stack records emitted so far. */
+	if (event->stack_table && rb != old_rb)
+		perf_stack_table_reset(event->stack_table);
+
 	if (old_rb) {
 		ring_buffer_put(old_rb);
 		/*
@@ -6696,6 +6701,10 @@ static int perf_mmap(struct file *file, struct vm_area_struct *vma)
 	if (nr_pages != 0 && !is_power_of_2(nr_pages))
 		return -EINVAL;
 
+	/* A read-only mapping is an overwrite buffer, see perf_copy_attr() */
+	if (event->attr.callchain_dedup && !(vma->vm_flags & VM_WRITE))
+		return -EINVAL;
+
 	if (vma_size != PAGE_SIZE * (1 + nr_pages))
 		return -EINVAL;
 
@@ -6765,6 +6774,9 @@ static int perf_mmap(struct file *file, struct vm_area_struct *vma)
 	if (vma->vm_flags & VM_WRITE)
 		flags |= RING_BUFFER_WRITABLE;
 
+	if (event->attr.wakeup_adaptive)
+		flags |= RING_BUFFER_ADAPTIVE;
+
 	if (!rb) {
 		rb = rb_alloc(nr_pages,
 			      event->attr.watermark ? event->attr.wakeup_watermark : 0,
@@ -8067,6 +8079,84 @@ static void perf_event_aux_pause(struct perf_event *event, bool pause)
 	ring_buffer_put(rb);
 }
 
+/* Shorter callchains are cheaper to emit than to look up. */
+#define PERF_STACK_DEDUP_MIN	4
+
+/*
+ * Replace the callchain of @data by a reference to a stack id. The full
+ * callchain is written in a PERF_RECORD_CALLCHAIN_STACK record the first
+ * time it is seen; if that fails, so would the sample, and the error is
+ * returned to drop it.
+ */
+static int perf_callchain_dedup(struct perf_event *event,
+				struct perf_sample_data *data,
+				int (*output_begin)(struct perf_output_handle *,
+						    struct perf_sample_data *,
+						    struct perf_event *,
+						    unsigned int))
+{
+	struct perf_event *owner = event->parent ?: event;
+	struct perf_callchain_entry *entry = data->callchain;
+	struct perf_stack_table *tbl = owner->stack_table;
+	struct perf_output_handle handle;
+	struct perf_event_header header;
+	int ret, err = 0;
+	u64 hash, id;
+
+	if (!tbl || !(data->sample_flags & PERF_SAMPLE_CALLCHAIN) ||
+	    entry->nr < PERF_STACK_DEDUP_MIN)
+		return 0;
+
+	/*
+	 * A sample nested in another one keeps its full callchain. So does
+	 * one of an inherited child that finds the parent's table held by a
+	 * sibling on another CPU: children have no table of their own, and
+	 * under contention they get no dedup rather than waiting for it.
+	 */
+	if (!perf_stack_table_trylock(tbl))
+		return 0;
+
+	/* So does one too deep for the table. */
+	ret = perf_stack_table_lookup(tbl, entry, &hash, &id);
+	if (ret < 0)
+		goto unlock;
+
+	if (!ret) {
+		header.type = PERF_RECORD_CALLCHAIN_STACK;
+		header.misc = 0;
+		header.size = sizeof(header) + sizeof(id) +
+			      (1 + entry->nr) * sizeof(u64);
+		/*
+		 * Reuse the sample's id fields rather than sampling them
+		 * again, so that the record is never ordered after the
+		 * sample that refers to it.
+		 */
+		if (event->attr.sample_id_all)
+			header.size += event->id_header_size;
+
+		err = output_begin(&handle, data, event, header.size);
+		if (err)
+			goto unlock;
+
+		perf_output_put(&handle, header);
+		perf_output_put(&handle, id);
+		__output_copy(&handle, entry, (1 + entry->nr) * sizeof(u64));
+		perf_event__output_id_sample(event, &handle, data);
+		perf_output_end(&handle);
+
+		perf_stack_table_insert(tbl, entry, hash, id);
+	}
+
+	data->dyn_size -= (entry->nr - 2) * sizeof(u64);
+	data->stack_ref.nr = 2;
+	data->stack_ref.ctx = PERF_CONTEXT_STACK_ID;
+	data->stack_ref.id = id;
+	data->callchain = (struct perf_callchain_entry *)&data->stack_ref;
+unlock:
+	perf_stack_table_unlock(tbl);
+	return err;
+}
+
 static __always_inline int
 __perf_event_output(struct perf_event *event,
 		    struct perf_sample_data *data,
@@ -8084,6 +8174,13 @@ __perf_event_output(struct perf_event *event,
 	rcu_read_lock();
 
 	perf_prepare_sample(data, event, regs);
+
+	if (unlikely(event->attr.callchain_dedup)) {
+		err = perf_callchain_dedup(event, data, output_begin);
+		if (err)
+			goto exit;
+	}
+
 	perf_prepare_header(&header, data, event, regs);
 
 	err = output_begin(&handle, data, event, header.size);
@@ -12432,6 +12529,20 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 				goto err;
 			event->attach_state |= PERF_ATTACH_CALLCHAIN;
 		}
+
+		/*
+		 * Only events that asked for dedup pay for the table; it holds
+		 * 128 callchains of the requested depth, shared with inherited
+		 * children.
+		 */
+		if (event->attr.callchain_dedup) {
+			event->stack_table = perf_stack_table_alloc(attr->sample_max_stack +
+						sysctl_perf_event_max_contexts_per_stack);
+			if (!event->stack_table) {
+				err = -ENOMEM;
+				goto err;
+			}
+		}
 	}
 
 	err = security_perf_event_alloc(event);
@@ -12565,6 +12676,18 @@ static int perf_copy_attr(struct perf_event_attr __user *uattr,
 	if (attr->sigtrap && !attr->remove_on_exec)
 		return -EINVAL;
 
+	/*
+	 * Stack records must not be overwritten before their samples; read-only
+	 * mappings are refused in perf_mmap() for the same reason.
+	 */
+	if (attr->callchain_dedup &&
+	    (!(attr->sample_type & PERF_SAMPLE_CALLCHAIN) || attr->write_backward))
+		return -EINVAL;
+
+	/* Adaptive wakeups scale a byte watermark, not an event count. */
+	if (attr->wakeup_adaptive && !attr->watermark && attr->wakeup_events)
+		return -EINVAL;
+
 out:
 	return ret;
 
@@ -12654,6 +12777,12 @@ perf_event_set_output(struct perf_event *event, struct perf_event *output_event)
 			ring_buffer_put(rb);
 			goto unlock;
 		}
+
+		/* Stack records must not be overwritten, see perf_copy_attr() */
+		if (event->attr.callchain_dedup && rb->overwrite) {
+			ring_buffer_put(rb);
+			goto unlock;
+		}
 	}
 
 	ring_buffer_attach(event, rb);
@@ -9,6 +9,7 @@
 /* Buffer handling */
 
 #define RING_BUFFER_WRITABLE		0x01
+#define RING_BUFFER_ADAPTIVE		0x02
 
 struct perf_buffer {
 	refcount_t			refcount;
@@ -30,6 +31,9 @@ struct perf_buffer {
 	local_t				lost;		/* nr records lost   */
 
 	long				watermark;	/* wakeup watermark  */
+	long				watermark_min;	/* adaptive: lower bound */
+	long				watermark_max;	/* adaptive: upper bound */
+	int				adaptive;	/* adapt watermark to reader */
 	long				aux_watermark;
 	/* poll crap */
 	spinlock_t			event_lock;
@@ -245,4 +249,18 @@ static inline bool arch_perf_have_user_stack_dump(void)
 #define perf_user_stack_pointer(regs) 0
 #endif /* CONFIG_HAVE_PERF_USER_STACK_DUMP */
 
+struct perf_stack_table;
+
+struct perf_stack_table *perf_stack_table_alloc(u32 depth);
+void perf_stack_table_free(struct perf_stack_table *tbl);
+bool perf_stack_table_trylock(struct perf_stack_table *tbl);
+void perf_stack_table_unlock(struct perf_stack_table *tbl);
+void perf_stack_table_reset(struct perf_stack_table *tbl);
+int perf_stack_table_lookup(struct perf_stack_table *tbl,
+			    struct perf_callchain_entry *entry,
+			    u64 *hash, u64 *id);
+void perf_stack_table_insert(struct perf_stack_table *tbl,
+			     struct perf_callchain_entry *entry,
+			     u64 hash, u64 id);
+
 #endif /* _KERNEL_EVENTS_INTERNAL_H */
@@ -138,6 +138,27 @@ static void perf_output_put_handle(struct perf_output_handle *handle)
 	preempt_enable();
 }
 
+/*
+ * With attr.wakeup_adaptive the watermark follows the reader. While the
+ * reader has consumed everything up to the previous wakeup, the watermark
+ * moves halfway towards its ceiling, so a reader that keeps up is woken
+ * less often than with the default watermark. As soon as the reader lags
+ * behind, it drops back to the default, so a slow reader is never woken
+ * later than without adapting.
+ */
+static void perf_output_adapt_watermark(struct perf_buffer *rb,
+					unsigned long tail, unsigned long wakeup)
+{
+	long watermark = READ_ONCE(rb->watermark);
+
+	if ((long)(tail - wakeup) >= 0)
+		watermark += (rb->watermark_max - watermark + 1) / 2;
+	else
+		watermark = rb->watermark_min;
+
+	WRITE_ONCE(rb->watermark, watermark);
+}
+
 static __always_inline bool
 ring_buffer_has_space(unsigned long head, unsigned long tail,
 		      unsigned long data_size, unsigned int size,
@@ -235,8 +256,12 @@ __perf_output_begin(struct perf_output_handle *handle,
 	 * none of the data stores below can be lifted up by the compiler.
 	 */
 
-	if (unlikely(head - local_read(&rb->wakeup) > rb->watermark))
-		local_add(rb->watermark, &rb->wakeup);
+	if (unlikely(head - local_read(&rb->wakeup) > READ_ONCE(rb->watermark))) {
+		if (rb->adaptive && !backward)
+			perf_output_adapt_watermark(rb, tail,
+						    local_read(&rb->wakeup));
+		local_add(READ_ONCE(rb->watermark), &rb->wakeup);
+	}
 
 	page_shift = PAGE_SHIFT + page_order(rb);
 
@@ -327,6 +352,18 @@ ring_buffer_init(struct perf_buffer *rb, long watermark, int flags)
 	else
 		rb->overwrite = 1;
 
+	/*
+	 * Adapting needs the reader position, which an overwritable
+	 * buffer does not have. Start from the watermark computed above
+	 * and leave the reader at least a quarter of the buffer of slack
+	 * at the ceiling.
+	 */
+	if ((flags & RING_BUFFER_ADAPTIVE) && !rb->overwrite) {
+		rb->watermark_min = rb->watermark;
+		rb->watermark_max = max(rb->watermark, max_size - max_size / 4);
+		rb->adaptive = 1;
+	}
+
 	refcount_set(&rb->refcount, 1);
 
 	INIT_LIST_HEAD(&rb->event_list);
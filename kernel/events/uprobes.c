@@ -100,7 +100,6 @@ static LIST_HEAD(delayed_uprobe_list);
  */
 struct xol_area {
 	wait_queue_head_t 		wq;		/* if all slots are busy */
-	atomic_t 			slot_count;	/* number of in-use slots */
 	unsigned long 			*bitmap;	/* 0 = free slot */
 
 	struct page			*page;
@@ -1569,7 +1568,6 @@ static struct xol_area *__create_xol_area(unsigned long vaddr)
 	init_waitqueue_head(&area->wq);
 	/* Reserve the 1st slot for get_trampoline_vaddr() */
 	set_bit(0, area->bitmap);
-	atomic_set(&area->slot_count, 1);
 	insns = arch_uprobe_trampoline(&insns_size);
 	arch_uprobe_copy_ixol(area->page, 0, insns, insns_size);
 
@@ -1643,36 +1641,46 @@ void uprobe_dup_mmap(struct mm_struct *oldmm, struct mm_struct *newmm)
 }
 
 /*
- *  - search for a free slot.
+ * Try the slot this task used last first: it is usually still free, and
+ * then claiming it doesn't need to scan the bitmap. Slot 0 is the
+ * trampoline, so a zero @hint means there is none.
  */
-static unsigned long xol_take_insn_slot(struct xol_area *area)
+static unsigned int xol_get_slot_nr(struct xol_area *area, unsigned int hint)
 {
-	unsigned long slot_addr;
-	int slot_nr;
+	unsigned int slot_nr;
 
-	do {
-		slot_nr = find_first_zero_bit(area->bitmap, UINSNS_PER_PAGE);
-		if (slot_nr < UINSNS_PER_PAGE) {
-			if (!test_and_set_bit(slot_nr, area->bitmap))
-				break;
+	if (hint && !test_bit(hint, area->bitmap) &&
+	    !test_and_set_bit(hint, area->bitmap))
+		return hint;
 
-			slot_nr = UINSNS_PER_PAGE;
-			continue;
-		}
-		wait_event(area->wq, (atomic_read(&area->slot_count) < UINSNS_PER_PAGE));
-	} while (slot_nr >= UINSNS_PER_PAGE);
+	slot_nr = find_first_zero_bit(area->bitmap, UINSNS_PER_PAGE);
+	if (slot_nr < UINSNS_PER_PAGE && !test_and_set_bit(slot_nr, area->bitmap))
+		return slot_nr;
+
+	return UINSNS_PER_PAGE;
+}
 
-	slot_addr = area->vaddr + (slot_nr * UPROBE_XOL_SLOT_BYTES);
-	atomic_inc(&area->slot_count);
+/*
+ *  - search for a free slot.
+ */
+static unsigned long xol_take_insn_slot(struct xol_area *area,
+					struct uprobe_task *utask)
+{
+	unsigned int slot_nr;
+
+	wait_event(area->wq, (slot_nr = xol_get_slot_nr(area,
+				utask->xol_slot_hint)) < UINSNS_PER_PAGE);
+	utask->xol_slot_hint = slot_nr;
 
-	return slot_addr;
+	return area->vaddr + (slot_nr * UPROBE_XOL_SLOT_BYTES);
 }
 
 /*
  * xol_get_insn_slot - allocate a slot for xol.
  * Returns the allocated slot address or 0.
  */
-static unsigned long xol_get_insn_slot(struct uprobe *uprobe)
+static unsigned long xol_get_insn_slot(struct uprobe *uprobe,
+				       struct uprobe_task *utask)
 {
 	struct xol_area *area;
 	unsigned long xol_vaddr;
@@ -1681,9 +1689,7 @@ static unsigned long xol_get_insn_slot(struct uprobe *uprobe)
 	if (!area)
 		return 0;
 
-	xol_vaddr = xol_take_insn_slot(area);
-	if (unlikely(!xol_vaddr))
-		return 0;
+	xol_vaddr = xol_take_insn_slot(area, utask);
 
 	arch_uprobe_copy_ixol(area->page, xol_vaddr,
 			      &uprobe->arch.ixol, sizeof(uprobe->arch.ixol));
@@ -1721,7 +1727,6 @@ static void xol_free_insn_slot(struct task_struct *tsk)
 			return;
 
 		clear_bit(slot_nr, area->bitmap);
-		atomic_dec(&area->slot_count);
 		smp_mb__after_atomic(); /* pairs with prepare_to_wait() */
 		if (waitqueue_active(&area->wq))
 			wake_up(&area->wq);
@@ -2007,7 +2012,7 @@ pre_ssout(struct uprobe *uprobe, struct pt_regs *regs, unsigned long bp_vaddr)
 	if (!try_get_uprobe(uprobe))
 		return -EINVAL;
 
-	xol_vaddr = xol_get_insn_slot(uprobe);
+	xol_vaddr = xol_get_insn_slot(uprobe, utask);
 	if (!xol_vaddr) {
 		err = -ENOMEM;
 		goto err_out;
@@ -2111,6 +2116,30 @@ static int is_trap_at_addr(struct mm_struct *mm, unsigned long vaddr)
 	return is_trap_insn(&opcode);
 }
 
+/*
+ * Look the uprobe up under the per-VMA lock instead of mmap_lock, which every
+ * thread of a process hitting breakpoints would otherwise share. Only a hit
+ * can be trusted: a miss may race with register_for_each_vma(), so it is
+ * left to find_active_uprobe_rcu() to sort out under mmap_lock.
+ */
+static struct uprobe *find_active_uprobe_speculative(unsigned long bp_vaddr)
+{
+	struct mm_struct *mm = current->mm;
+	struct uprobe *uprobe = NULL;
+	struct vm_area_struct *vma;
+
+	vma = lock_vma_under_rcu(mm, bp_vaddr);
+	if (!vma)
+		return NULL;
+
+	if (valid_vma(vma, false))
+		uprobe = find_uprobe_rcu(file_inode(vma->vm_file),
+					 vaddr_to_offset(vma, bp_vaddr));
+	vma_end_read(vma);
+
+	return uprobe;
+}
+
 /* assumes being inside RCU protected region */
 static struct uprobe *find_active_uprobe_rcu(unsigned long bp_vaddr, int *is_swbp)
 {
@@ -2118,6 +2147,10 @@ static struct uprobe *find_active_uprobe_rcu(unsigned long bp_vaddr, int *is_swb
 	struct uprobe *uprobe = NULL;
 	struct vm_area_struct *vma;
 
+	uprobe = find_active_uprobe_speculative(bp_vaddr);
+	if (uprobe)
+		return uprobe;
+
 	mmap_read_lock(mm);
 	vma = vma_lookup(mm, bp_vaddr);
 	if (vma) {
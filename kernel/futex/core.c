@@ -39,13 +39,15 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/prctl.h>
+#include <linux/sched/signal.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
 
 /*
  * The base of the bucket array and its size are always used together
- * (after initialization only in futex_hash()), so ensure that they
+ * (after initialization only in __futex_hash()), so ensure that they
  * reside in the same cacheline.
  */
 static struct {
@@ -55,6 +57,22 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * Private futexes of a multi-threaded process hash into a table owned by its
+ * mm rather than into the global one, so that unrelated processes do not
+ * contend on the same buckets. The table is replaced (never resized in place)
+ * under mm->futex_hash_lock; see futex_private_hash_replace().
+ */
+struct futex_private_hash {
+	struct rcu_head			rcu;
+	/* Replacement, valid once any bucket of this table is stale */
+	struct futex_private_hash __rcu	*next;
+	unsigned int			hash_mask;
+	struct futex_hash_bucket	queues[];
+};
+
+#define FUTEX_PRIVATE_HASH_MIN	16
+
 
 /*
  * Fault injections for futexes.
@@ -107,19 +125,96 @@ late_initcall(fail_futex_debugfs);
 
 #endif /* CONFIG_FAIL_FUTEX */
 
+static inline bool futex_key_is_private(union futex_key *key)
+{
+	return !(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED));
+}
+
+static struct futex_hash_bucket *
+__futex_hash(union futex_key *key, struct futex_private_hash *fph)
+{
+	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
+			  key->both.offset);
+
+	if (fph)
+		return &fph->queues[hash & fph->hash_mask];
+
+	return &futex_queues[hash & (futex_hashsize - 1)];
+}
+
 /**
- * futex_hash - Return the hash bucket in the global hash
+ * futex_hash - Return the hash bucket for a futex key
  * @key:	Pointer to the futex key for which the hash is calculated
  *
  * We hash on the keys returned from get_futex_key (see below) and return the
- * corresponding hash bucket in the global hash.
+ * corresponding hash bucket: in the private hash of the mm for private keys
+ * when the mm has one, in the global hash otherwise.
+ *
+ * Must be called under rcu_read_lock(). A private hash bucket can go stale
+ * until its lock is taken, so callers must check futex_hb_stale() with
+ * hb->lock held and look the key up again if it is set.
  */
 struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
-	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
-			  key->both.offset);
+	struct futex_private_hash *fph = NULL;
+	struct futex_hash_bucket *hb;
 
-	return &futex_queues[hash & (futex_hashsize - 1)];
+	if (futex_key_is_private(key))
+		fph = rcu_dereference(key->private.mm->futex_phash);
+
+	for (;;) {
+		hb = __futex_hash(key, fph);
+		if (!fph || !futex_hb_stale(hb))
+			return hb;
+		fph = rcu_dereference(fph->next);
+	}
+}
+
+/**
+ * futex_hash_pi - Return the hash bucket in the global hash
+ * @key:	Pointer to the futex key for which the hash is calculated
+ *
+ * PI and requeue-PI futexes always use the global hash: their waiters block
+ * on the rt_mutex with hb->lock dropped and reacquire it through state which
+ * a private hash resize cannot update. The global hash never goes stale.
+ */
+struct futex_hash_bucket *futex_hash_pi(union futex_key *key)
+{
+	return __futex_hash(key, NULL);
+}
+
+/**
+ * futex_hash_has_pi_waiter - Look for PI waiters futex_hash() can't find
+ * @key:	Pointer to the futex key
+ *
+ * When @key hashes into a private hash, its PI and requeue-PI waiters are
+ * still queued in the global hash. FUTEX_WAKE has to fail with -EINVAL on
+ * such a futex just as it does without a private hash.
+ */
+bool futex_hash_has_pi_waiter(union futex_key *key)
+{
+	struct futex_hash_bucket *hb;
+	struct futex_q *q;
+	bool found = false;
+
+	if (!futex_key_is_private(key) ||
+	    !rcu_access_pointer(key->private.mm->futex_phash))
+		return false;
+
+	hb = futex_hash_pi(key);
+	if (!futex_hb_waiters_pending(hb))
+		return false;
+
+	spin_lock(&hb->lock);
+	plist_for_each_entry(q, &hb->chain, list) {
+		if (futex_match(&q->key, key) && (q->pi_state || q->rt_waiter)) {
+			found = true;
+			break;
+		}
+	}
+	spin_unlock(&hb->lock);
+
+	return found;
 }
 
 
@@ -523,13 +618,14 @@ void __futex_unqueue(struct futex_q *q)
 	futex_hb_waiters_dec(hb);
 }
 
-/* The key must be already stored in q->key. */
-struct futex_hash_bucket *futex_q_lock(struct futex_q *q)
+static struct futex_hash_bucket *__futex_q_lock(struct futex_q *q, bool pi)
 	__acquires(&hb->lock)
 {
 	struct futex_hash_bucket *hb;
 
-	hb = futex_hash(&q->key);
+	rcu_read_lock();
+retry:
+	hb = pi ? futex_hash_pi(&q->key) : futex_hash(&q->key);
 
 	/*
 	 * Increment the counter before taking the lock so that
@@ -544,14 +640,35 @@ struct futex_hash_bucket *futex_q_lock(struct futex_q *q)
 	q->lock_ptr = &hb->lock;
 
 	spin_lock(&hb->lock);
+	if (futex_hb_stale(hb)) {
+		futex_hb_waiters_dec(hb);
+		spin_unlock(&hb->lock);
+		goto retry;
+	}
+	rcu_read_unlock();
 	return hb;
 }
 
+/*
+ * The key must be already stored in q->key. A requeue-PI waiter (one with
+ * q->rt_waiter set) is hashed like the PI futex it is going to be requeued to.
+ */
+struct futex_hash_bucket *futex_q_lock(struct futex_q *q)
+{
+	return __futex_q_lock(q, !!q->rt_waiter);
+}
+
+struct futex_hash_bucket *futex_q_lock_pi(struct futex_q *q)
+{
+	return __futex_q_lock(q, true);
+}
+
 void futex_q_unlock(struct futex_hash_bucket *hb)
 	__releases(&hb->lock)
 {
-	spin_unlock(&hb->lock);
+	/* A private hash bucket may be freed as soon as it is unlocked. */
 	futex_hb_waiters_dec(hb);
+	spin_unlock(&hb->lock);
 }
 
 void __futex_queue(struct futex_q *q, struct futex_hash_bucket *hb,
@@ -590,7 +707,13 @@ int futex_unqueue(struct futex_q *q)
 	spinlock_t *lock_ptr;
 	int ret = 0;
 
-	/* In the common case we don't take the spinlock, which is nice. */
+	/*
+	 * In the common case we don't take the spinlock, which is nice.
+	 *
+	 * The RCU read lock keeps the bucket lock_ptr points to around if a
+	 * private hash resize moves q to another table meanwhile.
+	 */
+	rcu_read_lock();
 retry:
 	/*
 	 * q->lock_ptr can change between this read and the following spin_lock.
@@ -624,6 +747,7 @@ int futex_unqueue(struct futex_q *q)
 		spin_unlock(lock_ptr);
 		ret = 1;
 	}
+	rcu_read_unlock();
 
 	return ret;
 }
@@ -984,7 +1108,7 @@ static void exit_pi_state_list(struct task_struct *curr)
 		next = head->next;
 		pi_state = list_entry(next, struct futex_pi_state, list);
 		key = pi_state->key;
-		hb = futex_hash(&key);
+		hb = futex_hash_pi(&key);
 
 		/*
 		 * We can race against put_pi_state() removing itself from the
@@ -1147,6 +1271,238 @@ void futex_exit_release(struct task_struct *tsk)
 	futex_cleanup_end(tsk, FUTEX_STATE_DEAD);
 }
 
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb, u64 gen)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+	hb->gen = gen;
+	hb->stale = false;
+}
+
+static struct futex_private_hash *
+futex_private_hash_alloc(unsigned int slots, u64 gen)
+{
+	struct futex_private_hash *fph;
+	unsigned int i;
+
+	fph = kvzalloc(struct_size(fph, queues, slots), GFP_KERNEL_ACCOUNT);
+	if (!fph)
+		return NULL;
+
+	fph->hash_mask = slots - 1;
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&fph->queues[i], gen);
+
+	return fph;
+}
+
+/*
+ * Replace the private hash of @mm by @new, which is NULL to make private
+ * futexes use the global hash again.
+ *
+ * Every bucket of the old table is locked in turn, marked stale and its
+ * waiters are moved over, updating their q->lock_ptr just like
+ * requeue_futex() does. Lookups racing with this find the key either in a
+ * bucket which was not moved yet or, once that bucket is stale, follow
+ * fph->next to where its waiters went. Old buckets are always locked before
+ * new ones, see double_lock_hb().
+ */
+static void futex_private_hash_replace(struct mm_struct *mm,
+				       struct futex_private_hash *new)
+{
+	struct futex_private_hash *old;
+	struct futex_hash_bucket *ob, *nb;
+	struct futex_q *q, *tmp;
+	unsigned int i;
+
+	lockdep_assert_held(&mm->futex_hash_lock);
+
+	old = rcu_dereference_protected(mm->futex_phash,
+					lockdep_is_held(&mm->futex_hash_lock));
+	if (!old) {
+		rcu_assign_pointer(mm->futex_phash, new);
+		return;
+	}
+
+	rcu_assign_pointer(old->next, new);
+
+	for (i = 0; i <= old->hash_mask; i++) {
+		ob = &old->queues[i];
+
+		spin_lock(&ob->lock);
+		smp_store_release(&ob->stale, true);
+		plist_for_each_entry_safe(q, tmp, &ob->chain, list) {
+			nb = __futex_hash(&q->key, new);
+
+			spin_lock_nested(&nb->lock, SINGLE_DEPTH_NESTING);
+			/*
+			 * ob->waiters is deliberately left alone so that a
+			 * waker which still reads it before finding ob
+			 * stale doesn't skip the wakeup.
+			 */
+			plist_del(&q->list, &ob->chain);
+			plist_add(&q->list, &nb->chain);
+			futex_hb_waiters_inc(nb);
+			WRITE_ONCE(q->lock_ptr, &nb->lock);
+			spin_unlock(&nb->lock);
+		}
+		spin_unlock(&ob->lock);
+	}
+
+	rcu_assign_pointer(mm->futex_phash, new);
+	kvfree_rcu(old, rcu);
+}
+
+static unsigned int futex_private_hash_default_slots(unsigned int threads)
+{
+	unsigned int slots;
+
+	threads = min(threads, num_online_cpus());
+	slots = roundup_pow_of_two(4 * threads);
+
+	return clamp_t(unsigned int, slots, FUTEX_PRIVATE_HASH_MIN,
+		       futex_hashsize);
+}
+
+/*
+ * A private hash can only be set up while nothing else can have private
+ * futexes of the mm queued in the global hash, as those are never moved:
+ * no other task may use the mm, and the caller must not have io_uring
+ * futex waits (IORING_OP_FUTEX_WAIT/WAITV) pending, which are queued on
+ * behalf of the ring rather than a task. As any of those could have been
+ * queued by then, that means the caller has never used io_uring.
+ */
+static bool futex_private_hash_may_create(struct mm_struct *mm)
+{
+	return atomic_read(&mm->mm_users) == 1 && get_nr_threads(current) == 1 &&
+	       !current->io_uring;
+}
+
+/**
+ * futex_hash_allocate_default - Size the private futex hash for a new thread
+ *
+ * Called from copy_process() for CLONE_THREAD before the new thread exists.
+ * Sets up the private hash of current->mm when the process becomes
+ * multi-threaded and grows it as the thread count grows, unless the size was
+ * fixed with PR_FUTEX_HASH. Failing to allocate is not fatal: the process
+ * keeps using the table it has, or the global one.
+ */
+void futex_hash_allocate_default(void)
+{
+	struct mm_struct *mm = current->mm;
+	struct futex_private_hash *fph, *new;
+	unsigned int slots, cur;
+
+	if (!mm || READ_ONCE(mm->futex_hash_fixed))
+		return;
+
+	slots = futex_private_hash_default_slots(get_nr_threads(current) + 1);
+
+	rcu_read_lock();
+	fph = rcu_dereference(mm->futex_phash);
+	cur = fph ? fph->hash_mask + 1 : 0;
+	rcu_read_unlock();
+
+	if (cur >= slots || (!cur && !futex_private_hash_may_create(mm)))
+		return;
+
+	mutex_lock(&mm->futex_hash_lock);
+	fph = rcu_dereference_protected(mm->futex_phash,
+					lockdep_is_held(&mm->futex_hash_lock));
+	if (mm->futex_hash_fixed)
+		goto unlock;
+	if (fph ? fph->hash_mask + 1 >= slots : !futex_private_hash_may_create(mm))
+		goto unlock;
+
+	new = futex_private_hash_alloc(slots, fph ? fph->queues[0].gen + 1 : 0);
+	if (new)
+		futex_private_hash_replace(mm, new);
+unlock:
+	mutex_unlock(&mm->futex_hash_lock);
+}
+
+static int futex_hash_set_slots(unsigned int slots)
+{
+	struct mm_struct *mm = current->mm;
+	struct futex_private_hash *fph, *new = NULL;
+	int ret = 0;
+
+	if (slots && (slots < 2 || !is_power_of_2(slots) ||
+		      slots > futex_hashsize))
+		return -EINVAL;
+
+	mutex_lock(&mm->futex_hash_lock);
+	fph = rcu_dereference_protected(mm->futex_phash,
+					lockdep_is_held(&mm->futex_hash_lock));
+	if (!fph && slots && !futex_private_hash_may_create(mm)) {
+		ret = -EBUSY;
+		goto unlock;
+	}
+
+	if (slots) {
+		new = futex_private_hash_alloc(slots,
+					       fph ? fph->queues[0].gen + 1 : 0);
+		if (!new) {
+			ret = -ENOMEM;
+			goto unlock;
+		}
+	}
+
+	futex_private_hash_replace(mm, new);
+	WRITE_ONCE(mm->futex_hash_fixed, true);
+unlock:
+	mutex_unlock(&mm->futex_hash_lock);
+	return ret;
+}
+
+static int futex_hash_get_slots(void)
+{
+	struct futex_private_hash *fph;
+	int ret = 0;
+
+	rcu_read_lock();
+	fph = rcu_dereference(current->mm->futex_phash);
+	if (fph)
+		ret = fph->hash_mask + 1;
+	rcu_read_unlock();
+
+	return ret;
+}
+
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3, unsigned long arg4)
+{
+	if (!current->mm)
+		return -EINVAL;
+
+	switch (arg2) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		if (arg4 || arg3 > UINT_MAX)
+			return -EINVAL;
+		return futex_hash_set_slots(arg3);
+
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (arg3 || arg4)
+			return -EINVAL;
+		return futex_hash_get_slots();
+	}
+
+	return -EINVAL;
+}
+
+void futex_mm_init(struct mm_struct *mm)
+{
+	mutex_init(&mm->futex_hash_lock);
+	RCU_INIT_POINTER(mm->futex_phash, NULL);
+	mm->futex_hash_fixed = false;
+}
+
+/* Called when the last user of @mm is gone, nothing can be queued anymore. */
+void futex_hash_free(struct mm_struct *mm)
+{
+	kvfree(rcu_access_pointer(mm->futex_phash));
+}
+
 static int __init futex_init(void)
 {
 	unsigned int futex_shift;
@@ -1164,11 +1520,9 @@ static int __init futex_init(void)
 					       futex_hashsize, futex_hashsize);
 	futex_hashsize = 1UL << futex_shift;
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	/* The global hash sorts after every private hash, see double_lock_hb() */
+	for (i = 0; i < futex_hashsize; i++)
+		futex_hash_bucket_init(&futex_queues[i], U64_MAX);
 
 	return 0;
 }
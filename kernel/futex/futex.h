@@ -116,8 +116,20 @@ struct futex_hash_bucket {
 	atomic_t waiters;
 	spinlock_t lock;
 	struct plist_head chain;
+	u64 gen;
+	bool stale;
 } ____cacheline_aligned_in_smp;
 
+/*
+ * A bucket of a private hash which has been replaced by a resize. Its waiters
+ * have been moved to the replacement table, so whoever finds it stale after
+ * taking hb->lock has to drop the lock and look the key up again.
+ */
+static inline bool futex_hb_stale(struct futex_hash_bucket *hb)
+{
+	return unlikely(smp_load_acquire(&hb->stale));
+}
+
 /*
  * Priority Inheritance state:
  */
@@ -201,6 +213,8 @@ futex_setup_timer(ktime_t *time, struct hrtimer_sleeper *timeout,
 		  int flags, u64 range_ns);
 
 extern struct futex_hash_bucket *futex_hash(union futex_key *key);
+extern struct futex_hash_bucket *futex_hash_pi(union futex_key *key);
+extern bool futex_hash_has_pi_waiter(union futex_key *key);
 
 /**
  * futex_match - Check whether two futex keys are equal
@@ -300,6 +314,7 @@ static inline int futex_hb_waiters_pending(struct futex_hash_bucket *hb)
 }
 
 extern struct futex_hash_bucket *futex_q_lock(struct futex_q *q);
+extern struct futex_hash_bucket *futex_q_lock_pi(struct futex_q *q);
 extern void futex_q_unlock(struct futex_hash_bucket *hb);
 
 
@@ -317,11 +332,15 @@ extern int fixup_pi_owner(u32 __user *uaddr, struct futex_q *q, int locked);
 
 /*
  * Express the locking dependencies for lockdep:
+ *
+ * Buckets of an older private hash are locked before those of its
+ * replacement (and before the global hash), which is the order a resize
+ * takes them in while moving waiters over.
  */
 static inline void
 double_lock_hb(struct futex_hash_bucket *hb1, struct futex_hash_bucket *hb2)
 {
-	if (hb1 > hb2)
+	if (hb1->gen > hb2->gen || (hb1->gen == hb2->gen && hb1 > hb2))
 		swap(hb1, hb2);
 
 	spin_lock(&hb1->lock);
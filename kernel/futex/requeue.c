@@ -443,12 +443,24 @@ int futex_requeue(u32 __user *uaddr1, unsigned int flags1,
 	if (requeue_pi && futex_match(&key1, &key2))
 		return -EINVAL;
 
-	hb1 = futex_hash(&key1);
-	hb2 = futex_hash(&key2);
-
 retry_private:
+	rcu_read_lock();
+	if (requeue_pi) {
+		hb1 = futex_hash_pi(&key1);
+		hb2 = futex_hash_pi(&key2);
+	} else {
+		hb1 = futex_hash(&key1);
+		hb2 = futex_hash(&key2);
+	}
 	futex_hb_waiters_inc(hb2);
 	double_lock_hb(hb1, hb2);
+	if (futex_hb_stale(hb1) || futex_hb_stale(hb2)) {
+		futex_hb_waiters_dec(hb2);
+		double_unlock_hb(hb1, hb2);
+		rcu_read_unlock();
+		goto retry_private;
+	}
+	rcu_read_unlock();
 
 	if (likely(cmpval != NULL)) {
 		u32 curval;
@@ -456,8 +468,8 @@ int futex_requeue(u32 __user *uaddr1, unsigned int flags1,
 		ret = futex_get_value_locked(&curval, uaddr1);
 
 		if (unlikely(ret)) {
-			double_unlock_hb(hb1, hb2);
 			futex_hb_waiters_dec(hb2);
+			double_unlock_hb(hb1, hb2);
 
 			ret = get_user(curval, uaddr1);
 			if (ret)
@@ -542,8 +554,8 @@ int futex_requeue(u32 __user *uaddr1, unsigned int flags1,
 		 * waiter::requeue_state is correct.
 		 */
 		case -EFAULT:
-			double_unlock_hb(hb1, hb2);
 			futex_hb_waiters_dec(hb2);
+			double_unlock_hb(hb1, hb2);
 			ret = fault_in_user_writeable(uaddr2);
 			if (!ret)
 				goto retry;
@@ -556,8 +568,8 @@ int futex_requeue(u32 __user *uaddr1, unsigned int flags1,
 			 *   exit to complete.
 			 * - EAGAIN: The user space value changed.
 			 */
-			double_unlock_hb(hb1, hb2);
 			futex_hb_waiters_dec(hb2);
+			double_unlock_hb(hb1, hb2);
 			/*
 			 * Handle the case where the owner is in the middle of
 			 * exiting. Wait for the exit to complete otherwise
@@ -674,9 +686,10 @@ int futex_requeue(u32 __user *uaddr1, unsigned int flags1,
 	put_pi_state(pi_state);
 
 out_unlock:
+	/* hb2 may be a private hash bucket, which can go away once unlocked */
+	futex_hb_waiters_dec(hb2);
 	double_unlock_hb(hb1, hb2);
 	wake_up_q(&wake_q);
-	futex_hb_waiters_dec(hb2);
 	return ret ? ret : task_count;
 }
 
@@ -170,13 +170,28 @@ int futex_wake(u32 __user *uaddr, unsigned int flags, int nr_wake, u32 bitset)
 	if ((flags & FLAGS_STRICT) && !nr_wake)
 		return 0;
 
+	if (futex_hash_has_pi_waiter(&key))
+		return -EINVAL;
+
+	rcu_read_lock();
+retry:
 	hb = futex_hash(&key);
 
-	/* Make sure we really have tasks to wakeup */
-	if (!futex_hb_waiters_pending(hb))
+	/*
+	 * Make sure we really have tasks to wakeup. A stale bucket may not
+	 * account for waiters which went to the replacing private hash.
+	 */
+	if (!futex_hb_waiters_pending(hb) && !futex_hb_stale(hb)) {
+		rcu_read_unlock();
 		return ret;
+	}
 
 	spin_lock(&hb->lock);
+	if (futex_hb_stale(hb)) {
+		spin_unlock(&hb->lock);
+		goto retry;
+	}
+	rcu_read_unlock();
 
 	plist_for_each_entry_safe(this, next, &hb->chain, list) {
 		if (futex_match (&this->key, &key)) {
@@ -267,11 +282,18 @@ int futex_wake_op(u32 __user *uaddr1, unsigned int flags, u32 __user *uaddr2,
 	if (unlikely(ret != 0))
 		return ret;
 
+retry_private:
+	rcu_read_lock();
 	hb1 = futex_hash(&key1);
 	hb2 = futex_hash(&key2);
-
-retry_private:
 	double_lock_hb(hb1, hb2);
+	if (futex_hb_stale(hb1) || futex_hb_stale(hb2)) {
+		double_unlock_hb(hb1, hb2);
+		rcu_read_unlock();
+		goto retry_private;
+	}
+	rcu_read_unlock();
+
 	op_ret = futex_atomic_op_inuser(op, uaddr2);
 	if (unlikely(op_ret < 0)) {
 		double_unlock_hb(hb1, hb2);
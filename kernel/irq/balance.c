@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Load-aware balancing of non-managed interrupts.
+ *
+ * A periodic worker derives the rate of every interrupt from its kstat
+ * counters and adds it to the load of the CPU the interrupt is delivered
+ * to. Within each NUMA node it then moves the busiest interrupt which
+ * narrows the gap from the most loaded CPU to the least loaded one, as long
+ * as the imbalance exceeds a threshold. An interrupt which was moved is left
+ * alone for a hold-off period so that it does not ping-pong between CPUs.
+ *
+ * An interrupt is only moved within its affinity mask as it was before the
+ * balancer first moved it. Managed interrupts, interrupts which user space
+ * may not move and interrupts whose affinity was set through
+ * /proc/irq/N/smp_affinity count towards the load but are never moved. The
+ * balancer is configured and enabled through /proc/irq/balance/.
+ */
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/topology.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+/* Moves per node and pass, to bound the disruption of a single pass */
+#define IRQ_BALANCE_MAX_MOVES	4
+
+/* Pass interval, 0 disables the balancer */
+static unsigned int irq_balance_interval_ms;
+/* Required imbalance between busiest and idlest CPU, in percent */
+static unsigned int irq_balance_threshold = 25;
+/* Interrupts per second below which a CPU is never considered busy */
+static unsigned int irq_balance_min_rate = 1000;
+/* Minimum time between two moves of the same interrupt */
+static unsigned int irq_balance_holdoff_ms = 10000;
+
+static unsigned long irq_balance_last;
+static bool irq_balance_primed;
+
+static void irq_balance_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_balance_work, irq_balance_fn);
+
+static bool irq_balance_movable(unsigned int irq, struct irq_desc *desc)
+{
+	return irq_can_set_affinity_usr(irq) &&
+		!irqd_is_per_cpu(&desc->irq_data) &&
+		!irqd_affinity_is_managed(&desc->irq_data) &&
+		!READ_ONCE(desc->balance_user) &&
+		(!desc->balance_moved ||
+		 time_after(jiffies, desc->balance_moved +
+			    msecs_to_jiffies(irq_balance_holdoff_ms)));
+}
+
+static unsigned int irq_balance_target(struct irq_desc *desc)
+{
+	return cpumask_first(irq_data_get_effective_affinity_mask(&desc->irq_data));
+}
+
+/*
+ * The CPUs @desc may be moved to. Once the balancer has moved an interrupt
+ * its affinity is a single CPU, so the mask it had before is used instead
+ * until someone else changes the affinity again.
+ */
+static const struct cpumask *irq_balance_allowed(struct irq_desc *desc)
+{
+	const struct cpumask *affinity = irq_data_get_affinity_mask(&desc->irq_data);
+
+	if (desc->balance_moved &&
+	    cpumask_equal(affinity, cpumask_of(desc->balance_cpu)))
+		return desc->balance_mask;
+	return affinity;
+}
+
+/* Least loaded online CPU of @node which @desc may be moved to */
+static unsigned int irq_balance_idlest(struct irq_desc *desc, int node,
+				       const unsigned long *load)
+{
+	unsigned int cpu, idlest = nr_cpu_ids;
+
+	for_each_cpu_and(cpu, irq_balance_allowed(desc), cpumask_of_node(node)) {
+		if (!cpu_online(cpu))
+			continue;
+		if (idlest >= nr_cpu_ids || load[cpu] < load[idlest])
+			idlest = cpu;
+	}
+	return idlest;
+}
+
+/* Update the rates of all interrupts and add them up per CPU */
+static void irq_balance_measure(unsigned long *load, unsigned int elapsed_ms)
+{
+	struct irq_desc *desc;
+	unsigned int irq, count, cpu;
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		if (!desc || !desc->action || irqd_is_per_cpu(&desc->irq_data))
+			continue;
+
+		count = kstat_irqs_desc(desc, cpu_possible_mask);
+		desc->balance_rate = elapsed_ms ?
+			div_u64((u64)(count - desc->balance_count) * MSEC_PER_SEC,
+				elapsed_ms) : 0;
+		desc->balance_count = count;
+
+		cpu = irq_balance_target(desc);
+		if (cpu < nr_cpu_ids)
+			load[cpu] += desc->balance_rate;
+	}
+}
+
+/*
+ * Find the movable interrupt on @from with the highest rate below the gap to
+ * the least loaded CPU it may move to, so that moving it reduces the load of
+ * the busiest CPU without making the target the new busiest. That target is
+ * returned in @to.
+ */
+static struct irq_desc *irq_balance_pick(int node, unsigned int from,
+					 const unsigned long *load,
+					 unsigned int threshold,
+					 unsigned int *to)
+{
+	struct irq_desc *desc, *best = NULL;
+	unsigned int irq, cpu;
+
+	for_each_active_irq(irq) {
+		desc = irq_to_desc(irq);
+		if (!desc || !desc->action || !desc->balance_rate ||
+		    irq_balance_target(desc) != from ||
+		    (best && desc->balance_rate <= best->balance_rate) ||
+		    !irq_balance_movable(irq, desc))
+			continue;
+
+		cpu = irq_balance_idlest(desc, node, load);
+		if (cpu >= nr_cpu_ids || cpu == from ||
+		    load[from] * 100 <= load[cpu] * (100 + threshold) ||
+		    desc->balance_rate >= load[from] - load[cpu])
+			continue;
+
+		best = desc;
+		*to = cpu;
+	}
+	return best;
+}
+
+static void irq_balance_node(int node, unsigned long *load)
+{
+	unsigned int threshold = READ_ONCE(irq_balance_threshold);
+	unsigned int min_rate = READ_ONCE(irq_balance_min_rate);
+	unsigned int busiest, idlest, cpu;
+	const struct cpumask *allowed;
+	struct irq_desc *desc;
+	int moves;
+
+	for (moves = 0; moves < IRQ_BALANCE_MAX_MOVES; moves++) {
+		busiest = nr_cpu_ids;
+		for_each_cpu_and(cpu, cpumask_of_node(node), cpu_online_mask) {
+			if (busiest >= nr_cpu_ids || load[cpu] > load[busiest])
+				busiest = cpu;
+		}
+		if (busiest >= nr_cpu_ids || load[busiest] < min_rate)
+			return;
+
+		desc = irq_balance_pick(node, busiest, load, threshold, &idlest);
+		if (!desc)
+			return;
+
+		allowed = irq_balance_allowed(desc);
+		if (allowed != desc->balance_mask)
+			cpumask_copy(desc->balance_mask, allowed);
+		if (irq_set_affinity(irq_desc_get_irq(desc), cpumask_of(idlest)))
+			return;
+
+		desc->balance_moved = jiffies;
+		desc->balance_cpu = idlest;
+		load[busiest] -= desc->balance_rate;
+		load[idlest] += desc->balance_rate;
+	}
+}
+
+static void irq_balance_fn(struct work_struct *work)
+{
+	unsigned int interval = READ_ONCE(irq_balance_interval_ms);
+	unsigned long *load;
+	int node;
+
+	if (!interval) {
+		irq_balance_primed = false;
+		return;
+	}
+
+	load = kcalloc(nr_cpu_ids, sizeof(*load), GFP_KERNEL);
+	if (load) {
+		irq_lock_sparse();
+		irq_balance_measure(load, irq_balance_primed ?
+				    jiffies_to_msecs(jiffies - irq_balance_last) : 0);
+		/* The first pass only takes the baseline counts */
+		if (irq_balance_primed) {
+			for_each_online_node(node)
+				irq_balance_node(node, load);
+		}
+		irq_unlock_sparse();
+		irq_balance_last = jiffies;
+		irq_balance_primed = true;
+		kfree(load);
+	}
+
+	queue_delayed_work(system_unbound_wq, &irq_balance_work,
+			   msecs_to_jiffies(interval));
+}
+
+static int irq_balance_param_show(struct seq_file *m, void *v)
+{
+	seq_printf(m, "%u\n", READ_ONCE(*(unsigned int *)m->private));
+	return 0;
+}
+
+static int irq_balance_param_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, irq_balance_param_show, pde_data(inode));
+}
+
+static ssize_t irq_balance_param_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *pos)
+{
+	unsigned int *param = pde_data(file_inode(file));
+	unsigned int val;
+	int err;
+
+	err = kstrtouint_from_user(buffer, count, 0, &val);
+	if (err)
+		return err;
+
+	WRITE_ONCE(*param, val);
+	if (param == &irq_balance_interval_ms && val)
+		mod_delayed_work(system_unbound_wq, &irq_balance_work,
+				 msecs_to_jiffies(val));
+	return count;
+}
+
+static const struct proc_ops irq_balance_param_proc_ops = {
+	.proc_open	= irq_balance_param_open,
+	.proc_read	= seq_read,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= single_release,
+	.proc_write	= irq_balance_param_write,
+};
+
+void irq_balance_init_proc(void)
+{
+	struct proc_dir_entry *dir;
+
+	dir = proc_mkdir("irq/balance", NULL);
+	if (!dir)
+		return;
+
+	proc_create_data("interval_ms", 0644, dir, &irq_balance_param_proc_ops,
+			 &irq_balance_interval_ms);
+	proc_create_data("threshold", 0644, dir, &irq_balance_param_proc_ops,
+			 &irq_balance_threshold);
+	proc_create_data("min_rate", 0644, dir, &irq_balance_param_proc_ops,
+			 &irq_balance_min_rate);
+	proc_create_data("holdoff_ms", 0644, dir, &irq_balance_param_proc_ops,
+			 &irq_balance_holdoff_ms);
+}
+
+#ifdef CONFIG_IRQ_BALANCE_KUNIT_TEST
+#include "balance_kunit.c"
+#endif
@@ -0,0 +1,171 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the interrupt balancer. Included from balance.c so that
+ * the tests can drive irq_balance_node() with a made up load.
+ */
+#include <kunit/test.h>
+
+struct irq_balance_test {
+	unsigned int irq;
+	unsigned int cpu[2];
+	int node;
+	unsigned long *load;
+};
+
+static irqreturn_t irq_balance_test_handler(int irq, void *dev_id)
+{
+	return IRQ_HANDLED;
+}
+
+static int irq_balance_test_set_affinity(struct irq_data *d,
+					 const struct cpumask *mask, bool force)
+{
+	irq_data_update_effective_affinity(d,
+		cpumask_of(cpumask_first_and(mask, cpu_online_mask)));
+	return IRQ_SET_MASK_OK;
+}
+
+static struct irq_chip irq_balance_test_chip = {
+	.name			= "balance-test",
+	.irq_set_affinity	= irq_balance_test_set_affinity,
+};
+
+static int irq_balance_test_init(struct kunit *test)
+{
+	struct irq_balance_test *t;
+	int ret;
+
+	if (READ_ONCE(irq_balance_interval_ms))
+		kunit_skip(test, "balancer is running");
+
+	t = kunit_kzalloc(test, sizeof(*t), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t);
+
+	/* Two online CPUs of the same node */
+	t->cpu[0] = cpumask_first(cpu_online_mask);
+	t->node = cpu_to_node(t->cpu[0]);
+	t->cpu[1] = cpumask_next_and(t->cpu[0], cpumask_of_node(t->node),
+				     cpu_online_mask);
+	if (t->cpu[1] >= nr_cpu_ids)
+		kunit_skip(test, "needs two online CPUs in one node");
+
+	t->load = kunit_kcalloc(test, nr_cpu_ids, sizeof(*t->load), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, t->load);
+
+	ret = irq_alloc_descs(-1, 1, 1, t->node);
+	KUNIT_ASSERT_GE(test, ret, 0);
+	t->irq = ret;
+
+	irq_set_chip_and_handler(t->irq, &irq_balance_test_chip,
+				 handle_simple_irq);
+	irq_set_status_flags(t->irq, IRQ_MOVE_PCNTXT);
+	ret = request_irq(t->irq, irq_balance_test_handler, 0, "balance-test", t);
+	if (ret) {
+		irq_free_descs(t->irq, 1);
+		KUNIT_ASSERT_EQ(test, ret, 0);
+	}
+
+	test->priv = t;
+	return 0;
+}
+
+static void irq_balance_test_exit(struct kunit *test)
+{
+	struct irq_balance_test *t = test->priv;
+
+	if (!t)
+		return;
+
+	free_irq(t->irq, t);
+	irq_free_descs(t->irq, 1);
+}
+
+/*
+ * Give the test interrupt the affinity @mask and put all the load of the
+ * node on @busy, most of it from the test interrupt.
+ */
+static struct irq_desc *irq_balance_test_setup(struct kunit *test,
+					       const struct cpumask *mask,
+					       unsigned int busy)
+{
+	struct irq_balance_test *t = test->priv;
+	struct irq_desc *desc = irq_to_desc(t->irq);
+
+	KUNIT_ASSERT_EQ(test, irq_set_affinity(t->irq, mask), 0);
+	KUNIT_ASSERT_EQ(test, irq_balance_target(desc), cpumask_first(mask));
+
+	memset(t->load, 0, nr_cpu_ids * sizeof(*t->load));
+	t->load[busy] = 20 * irq_balance_min_rate;
+	desc->balance_rate = 5 * irq_balance_min_rate;
+	desc->balance_moved = 0;
+	return desc;
+}
+
+static void irq_balance_test_move(struct kunit *test)
+{
+	struct irq_balance_test *t = test->priv;
+	struct irq_desc *desc;
+	struct cpumask *mask;
+
+	mask = kunit_kzalloc(test, cpumask_size(), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mask);
+	cpumask_set_cpu(t->cpu[0], mask);
+	cpumask_set_cpu(t->cpu[1], mask);
+
+	desc = irq_balance_test_setup(test, mask, t->cpu[0]);
+	irq_balance_node(t->node, t->load);
+	KUNIT_EXPECT_EQ(test, irq_balance_target(desc), t->cpu[1]);
+	KUNIT_EXPECT_TRUE(test, cpumask_equal(desc->balance_mask, mask));
+
+	/* Past the hold-off it may move back within its original mask */
+	memset(t->load, 0, nr_cpu_ids * sizeof(*t->load));
+	t->load[t->cpu[1]] = 20 * irq_balance_min_rate;
+	desc->balance_moved = jiffies -
+		msecs_to_jiffies(irq_balance_holdoff_ms) - 1;
+	irq_balance_node(t->node, t->load);
+	KUNIT_EXPECT_EQ(test, irq_balance_target(desc), t->cpu[0]);
+}
+
+static void irq_balance_test_affinity(struct kunit *test)
+{
+	struct irq_balance_test *t = test->priv;
+	struct irq_desc *desc;
+
+	/* The other CPU is idle but outside the affinity mask */
+	desc = irq_balance_test_setup(test, cpumask_of(t->cpu[0]), t->cpu[0]);
+	irq_balance_node(t->node, t->load);
+	KUNIT_EXPECT_EQ(test, irq_balance_target(desc), t->cpu[0]);
+}
+
+static void irq_balance_test_user(struct kunit *test)
+{
+	struct irq_balance_test *t = test->priv;
+	struct irq_desc *desc;
+	struct cpumask *mask;
+
+	mask = kunit_kzalloc(test, cpumask_size(), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, mask);
+	cpumask_set_cpu(t->cpu[0], mask);
+	cpumask_set_cpu(t->cpu[1], mask);
+
+	desc = irq_balance_test_setup(test, mask, t->cpu[0]);
+	irq_balance_set_user(desc, true);
+	irq_balance_node(t->node, t->load);
+	KUNIT_EXPECT_EQ(test, irq_balance_target(desc), t->cpu[0]);
+	irq_balance_set_user(desc, false);
+}
+
+static struct kunit_case irq_balance_test_cases[] = {
+	KUNIT_CASE(irq_balance_test_move),
+	KUNIT_CASE(irq_balance_test_affinity),
+	KUNIT_CASE(irq_balance_test_user),
+	{}
+};
+
+static struct kunit_suite irq_balance_test_suite = {
+	.name = "irq_balance",
+	.init = irq_balance_test_init,
+	.exit = irq_balance_test_exit,
+	.test_cases = irq_balance_test_cases,
+};
+kunit_test_suite(irq_balance_test_suite);
@@ -137,6 +137,17 @@ static inline void unregister_handler_proc(unsigned int irq,
 					   struct irqaction *action) { }
 #endif
 
+#ifdef CONFIG_IRQ_BALANCE
+void irq_balance_init_proc(void);
+static inline void irq_balance_set_user(struct irq_desc *desc, bool user)
+{
+	WRITE_ONCE(desc->balance_user, user);
+}
+#else
+static inline void irq_balance_init_proc(void) { }
+static inline void irq_balance_set_user(struct irq_desc *desc, bool user) { }
+#endif
+
 extern bool irq_can_set_affinity_usr(unsigned int irq);
 
 extern void irq_set_thread_affinity(struct irq_desc *desc);
@@ -67,6 +67,19 @@ static int alloc_masks(struct irq_desc *desc, int node)
 
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	if (!zalloc_cpumask_var_node(&desc->pending_mask, GFP_KERNEL, node)) {
+#ifdef CONFIG_GENERIC_IRQ_EFFECTIVE_AFF_MASK
+		free_cpumask_var(desc->irq_common_data.effective_affinity);
+#endif
+		free_cpumask_var(desc->irq_common_data.affinity);
+		return -ENOMEM;
+	}
+#endif
+
+#ifdef CONFIG_IRQ_BALANCE
+	if (!zalloc_cpumask_var_node(&desc->balance_mask, GFP_KERNEL, node)) {
+#ifdef CONFIG_GENERIC_PENDING_IRQ
+		free_cpumask_var(desc->pending_mask);
+#endif
 #ifdef CONFIG_GENERIC_IRQ_EFFECTIVE_AFF_MASK
 		free_cpumask_var(desc->irq_common_data.effective_affinity);
 #endif
@@ -87,6 +100,13 @@ static void desc_smp_init(struct irq_desc *desc, int node,
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	cpumask_clear(desc->pending_mask);
 #endif
+#ifdef CONFIG_IRQ_BALANCE
+	/* desc_set_defaults() zeroes the counts, restart the rate window */
+	desc->balance_count = 0;
+	desc->balance_rate = 0;
+	desc->balance_moved = 0;
+	desc->balance_user = false;
+#endif
 #ifdef CONFIG_NUMA
 	desc->irq_common_data.node = node;
 #endif
@@ -94,6 +114,9 @@ static void desc_smp_init(struct irq_desc *desc, int node,
 
 static void free_masks(struct irq_desc *desc)
 {
+#ifdef CONFIG_IRQ_BALANCE
+	free_cpumask_var(desc->balance_mask);
+#endif
 #ifdef CONFIG_GENERIC_PENDING_IRQ
 	free_cpumask_var(desc->pending_mask);
 #endif
@@ -163,10 +163,14 @@ static ssize_t write_irq_affinity(int type, struct file *file,
 		 * to set default SMP affinity.
 		 */
 		err = irq_select_affinity_usr(irq) ? -EINVAL : count;
+		if (err > 0)
+			irq_balance_set_user(irq_to_desc(irq), false);
 	} else {
 		err = irq_set_affinity(irq, new_value);
-		if (!err)
+		if (!err) {
+			irq_balance_set_user(irq_to_desc(irq), true);
 			err = count;
+		}
 	}
 
 free_cpumask:
@@ -441,6 +445,7 @@ void init_irq_proc(void)
 		return;
 
 	register_default_affinity_proc();
+	irq_balance_init_proc();
 
 	/*
 	 * Create entries for all existing IRQs.
@@ -11,6 +11,7 @@
 #include <linux/slab.h>
 #include <linux/sysfs.h>
 #include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 
 #include "internal.h"
 
@@ -200,54 +201,240 @@ static ssize_t module_xz_decompress(struct load_info *info,
 	return retval;
 }
 #elif defined(CONFIG_MODULE_COMPRESS_ZSTD)
+#include <linux/unaligned.h>
 #include <linux/zstd.h>
 #define MODULE_COMPRESSION	zstd
 #define MODULE_DECOMPRESS_FN	module_zstd_decompress
 
+/*
+ * Upper bound on the number of independent frames decoded in parallel.
+ * Modules with more frames fall back to the streaming decoder.
+ */
+#define MODULE_ZSTD_MAX_FRAMES	64
+
+struct module_zstd_frame {
+	struct work_struct work;
+	const void *src;
+	size_t src_size;
+	void *dst;
+	size_t dst_size;
+	int error;
+};
+
+static void module_zstd_decompress_frame(struct work_struct *work)
+{
+	struct module_zstd_frame *frame =
+		container_of(work, struct module_zstd_frame, work);
+	size_t wksp_size = zstd_dctx_workspace_bound();
+	zstd_dctx *dctx;
+	void *wksp;
+	size_t ret;
+
+	wksp = kvmalloc(wksp_size, GFP_KERNEL);
+	if (!wksp) {
+		frame->error = -ENOMEM;
+		return;
+	}
+
+	dctx = zstd_init_dctx(wksp, wksp_size);
+	if (!dctx) {
+		frame->error = -ENOMEM;
+		goto out;
+	}
+
+	ret = zstd_decompress_dctx(dctx, frame->dst, frame->dst_size,
+				   frame->src, frame->src_size);
+	if (zstd_is_error(ret)) {
+		pr_err("ZSTD-decompression failed with status %d\n",
+		       zstd_get_error_code(ret));
+		frame->error = -EINVAL;
+	} else if (ret != frame->dst_size) {
+		pr_err("ZSTD-compressed frame has wrong content size\n");
+		frame->error = -EINVAL;
+	}
+
+ out:
+	kvfree(wksp);
+}
+
+/*
+ * A module compressed as several independent frames, each recording its
+ * decompressed size (as produced by pzstd, for example), is decoded with one
+ * work item per frame straight into its final place. Return -EAGAIN if the
+ * data does not have that layout so that the caller uses the streaming
+ * decoder instead.
+ */
+static ssize_t module_zstd_decompress_frames(struct load_info *info,
+					     const void *buf, size_t size)
+{
+	struct module_zstd_frame *frames;
+	unsigned int nr_frames = 0, n_pages, i;
+	size_t pos = 0, total = 0;
+	ssize_t retval = -EAGAIN;
+	void *dst;
+
+	frames = kcalloc(MODULE_ZSTD_MAX_FRAMES, sizeof(*frames), GFP_KERNEL);
+	if (!frames)
+		return -ENOMEM;
+
+	while (pos < size) {
+		zstd_frame_header header;
+		size_t frame_size;
+
+		if (zstd_get_frame_header(&header, buf + pos, size - pos))
+			goto out;
+		frame_size = zstd_find_frame_compressed_size(buf + pos,
+							     size - pos);
+		if (zstd_is_error(frame_size))
+			goto out;
+
+		/* Skippable frames (pzstd, seekable format) carry no data. */
+		if (header.frameType == ZSTD_skippableFrame) {
+			pos += frame_size;
+			continue;
+		}
+
+		if (nr_frames == MODULE_ZSTD_MAX_FRAMES ||
+		    header.frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+		    header.frameContentSize > INT_MAX - total)
+			goto out;
+
+		frames[nr_frames].src = buf + pos;
+		frames[nr_frames].src_size = frame_size;
+		frames[nr_frames].dst_size = header.frameContentSize;
+		total += header.frameContentSize;
+		pos += frame_size;
+		nr_frames++;
+	}
+	if (nr_frames < 2 || !total)
+		goto out;
+
+	n_pages = DIV_ROUND_UP(total, PAGE_SIZE);
+	for (i = 0; i < n_pages; i++) {
+		struct page *page = module_get_next_page(info);
+
+		if (IS_ERR(page)) {
+			retval = PTR_ERR(page);
+			goto out;
+		}
+	}
+
+	dst = vmap(info->pages, info->used_pages, VM_MAP, PAGE_KERNEL);
+	if (!dst) {
+		retval = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0, pos = 0; i < nr_frames; i++) {
+		frames[i].dst = dst + pos;
+		pos += frames[i].dst_size;
+		INIT_WORK(&frames[i].work, module_zstd_decompress_frame);
+		if (i)
+			queue_work(system_unbound_wq, &frames[i].work);
+	}
+
+	/* The loading task decodes the first frame itself. */
+	module_zstd_decompress_frame(&frames[0].work);
+
+	retval = total;
+	for (i = 0; i < nr_frames; i++) {
+		if (i)
+			flush_work(&frames[i].work);
+		if (frames[i].error)
+			retval = frames[i].error;
+	}
+	vunmap(dst);
+
+ out:
+	kfree(frames);
+	return retval;
+}
+
+/*
+ * Find the largest window size used by any data frame, so that one stream
+ * can decode all of them.
+ */
+static int module_zstd_window_size(const void *buf, size_t size,
+				   unsigned long long *window_size)
+{
+	size_t pos = 0;
+
+	*window_size = 0;
+	while (pos < size) {
+		zstd_frame_header header;
+		size_t frame_size;
+
+		if (zstd_get_frame_header(&header, buf + pos, size - pos)) {
+			pr_err("ZSTD-compressed data has an incomplete frame header\n");
+			return -EINVAL;
+		}
+		if (header.frameType == ZSTD_frame &&
+		    header.windowSize > (1 << ZSTD_WINDOWLOG_MAX)) {
+			pr_err("ZSTD-compressed data has too large a window size\n");
+			return -EINVAL;
+		}
+		frame_size = zstd_find_frame_compressed_size(buf + pos,
+							     size - pos);
+		if (zstd_is_error(frame_size)) {
+			pr_err("ZSTD-compressed data is truncated\n");
+			return -EINVAL;
+		}
+
+		if (header.frameType == ZSTD_frame)
+			*window_size = max(*window_size, header.windowSize);
+		pos += frame_size;
+	}
+
+	if (!*window_size) {
+		pr_err("ZSTD-compressed data has no data frame\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static ssize_t module_zstd_decompress(struct load_info *info,
 				    const void *buf, size_t size)
 {
-	static const u8 signature[] = { 0x28, 0xb5, 0x2f, 0xfd };
 	ZSTD_outBuffer zstd_dec;
 	ZSTD_inBuffer zstd_buf;
-	zstd_frame_header header;
+	unsigned long long window_size;
 	size_t wksp_size;
 	void *wksp = NULL;
 	ZSTD_DStream *dstream;
 	size_t ret;
 	size_t new_size = 0;
+	ssize_t frames_size;
+	u32 magic;
 	int retval;
 
-	if (size < sizeof(signature) ||
-	    memcmp(buf, signature, sizeof(signature))) {
+	magic = size >= sizeof(magic) ? get_unaligned_le32(buf) : 0;
+	if (magic != ZSTD_MAGICNUMBER &&
+	    (magic & ZSTD_MAGIC_SKIPPABLE_MASK) != ZSTD_MAGIC_SKIPPABLE_START) {
 		pr_err("not a zstd compressed module\n");
 		return -EINVAL;
 	}
 
+	frames_size = module_zstd_decompress_frames(info, buf, size);
+	if (frames_size != -EAGAIN)
+		return frames_size;
+
 	zstd_buf.src = buf;
 	zstd_buf.pos = 0;
 	zstd_buf.size = size;
 
-	ret = zstd_get_frame_header(&header, zstd_buf.src, zstd_buf.size);
-	if (ret != 0) {
-		pr_err("ZSTD-compressed data has an incomplete frame header\n");
-		retval = -EINVAL;
+	retval = module_zstd_window_size(buf, size, &window_size);
+	if (retval)
 		goto out;
-	}
-	if (header.windowSize > (1 << ZSTD_WINDOWLOG_MAX)) {
-		pr_err("ZSTD-compressed data has too large a window size\n");
-		retval = -EINVAL;
-		goto out;
-	}
 
-	wksp_size = zstd_dstream_workspace_bound(header.windowSize);
+	wksp_size = zstd_dstream_workspace_bound(window_size);
 	wksp = kvmalloc(wksp_size, GFP_KERNEL);
 	if (!wksp) {
 		retval = -ENOMEM;
 		goto out;
 	}
 
-	dstream = zstd_init_dstream(header.windowSize, wksp, wksp_size);
+	dstream = zstd_init_dstream(window_size, wksp, wksp_size);
 	if (!dstream) {
 		pr_err("Can't initialize ZSTD stream\n");
 		retval = -ENOMEM;
@@ -266,14 +453,20 @@ static ssize_t module_zstd_decompress(struct load_info *info,
 		zstd_dec.pos = 0;
 		zstd_dec.size = PAGE_SIZE;
 
-		ret = zstd_decompress_stream(dstream, &zstd_dec, &zstd_buf);
+		/* A frame may end mid-page, fill the rest from the next one. */
+		do {
+			ret = zstd_decompress_stream(dstream, &zstd_dec,
+						     &zstd_buf);
+		} while (!zstd_is_error(ret) && zstd_dec.pos < PAGE_SIZE &&
+			 zstd_buf.pos < zstd_buf.size);
 		kunmap_local(zstd_dec.dst);
 		retval = zstd_get_error_code(ret);
 		if (retval)
 			break;
 
 		new_size += zstd_dec.pos;
-	} while (zstd_dec.pos == PAGE_SIZE && ret != 0);
+	} while (zstd_dec.pos == PAGE_SIZE &&
+		 (ret != 0 || zstd_buf.pos < zstd_buf.size));
 
 	if (retval) {
 		pr_err("ZSTD-decompression failed with status %d\n", retval);
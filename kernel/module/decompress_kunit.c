@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for in-kernel decompression of zstd modules made of several
+ * frames, including the skippable frames pzstd and zstd -T write.
+ */
+
+#include <kunit/test.h>
+#include <linux/slab.h>
+
+#include "internal.h"
+
+#define TEST_PAYLOAD		"module payload "
+#define TEST_PAYLOAD_SIZE	15000
+
+/*
+ * Byte @i of the decompressed test data. The data was split in frames of
+ * 5000, 7000 and 3000 bytes, so that frames end in the middle of a page,
+ * and each was compressed with zstd -19.
+ */
+static u8 test_byte(size_t i)
+{
+	return TEST_PAYLOAD[i % (sizeof(TEST_PAYLOAD) - 1)] ^ (u8)(i >> 10);
+}
+
+/*
+ * A 4-byte skippable frame, the three frames with their content size, an
+ * empty skippable frame before the last one. Decoded in parallel.
+ */
+static const u8 test_multi_frame[] = {
+	0x50, 0x2a, 0x4d, 0x18, 0x04, 0x00, 0x00, 0x00, 0x70, 0x7a, 0x73, 0x74,
+	0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x88, 0x12, 0xbd, 0x02, 0x00, 0xb2, 0x84,
+	0x11, 0x17, 0x90, 0xe9, 0x01, 0x80, 0x3d, 0xf0, 0x5f, 0xa0, 0xfd, 0x94,
+	0xd2, 0x5f, 0x5b, 0x51, 0x05, 0x33, 0x33, 0x63, 0xb3, 0xc4, 0xdd, 0x1e,
+	0x03, 0x80, 0x5a, 0x3b, 0xe5, 0xb2, 0x55, 0x31, 0x49, 0xd7, 0xe4, 0x4f,
+	0xda, 0x90, 0xe0, 0x17, 0x91, 0x3d, 0xc5, 0x26, 0xa0, 0xe8, 0x06, 0xec,
+	0x47, 0xd0, 0xb5, 0x2b, 0xae, 0xae, 0xf3, 0xd9, 0xe5, 0x7d, 0x2c, 0x7a,
+	0x5e, 0x9b, 0xc7, 0x9e, 0x11, 0x16, 0x98, 0x65, 0xe2, 0x7d, 0x07, 0x05,
+	0x44, 0x0f, 0x2d, 0x76, 0x81, 0x7b, 0xe0, 0x1e, 0xb8, 0x07, 0xee, 0x65,
+	0x06, 0xcf, 0x0b, 0xc5, 0x36, 0x28, 0xb5, 0x2f, 0xfd, 0x64, 0x58, 0x1a,
+	0xf5, 0x03, 0x00, 0x82, 0x07, 0x19, 0x16, 0x70, 0x3b, 0x06, 0x00, 0x55,
+	0xaa, 0xff, 0xef, 0x8a, 0x88, 0x88, 0xa8, 0x32, 0xf0, 0xff, 0x7f, 0x01,
+	0xd4, 0x00, 0x00, 0x10, 0x06, 0x8f, 0xe3, 0x4a, 0xbe, 0x1d, 0xce, 0x7a,
+	0x0f, 0xea, 0x31, 0xbd, 0x66, 0x3c, 0xfa, 0x39, 0xb9, 0x86, 0xf3, 0xa9,
+	0x4c, 0x72, 0x8d, 0x62, 0xd1, 0xb0, 0x26, 0xc4, 0x59, 0xb1, 0x49, 0x30,
+	0xbd, 0x18, 0x35, 0x46, 0x34, 0xd8, 0x31, 0xca, 0xef, 0xe9, 0x35, 0x28,
+	0x2f, 0x2d, 0xec, 0xc3, 0xb2, 0x96, 0xb0, 0xf8, 0xa4, 0xf4, 0x0b, 0xca,
+	0xb6, 0x7f, 0x0d, 0x25, 0xce, 0x41, 0x82, 0xde, 0x1c, 0x56, 0x01, 0xc2,
+	0x11, 0xf2, 0x0d, 0x20, 0xf9, 0xdc, 0x25, 0x05, 0x24, 0x01, 0x08, 0x60,
+	0x0f, 0xc0, 0xe3, 0x01, 0xce, 0x2a, 0xf7, 0x95, 0xfb, 0xca, 0xfd, 0xca,
+	0x7d, 0xe5, 0xbe, 0x72, 0xef, 0xca, 0x48, 0x4a, 0x02, 0x24, 0xb9, 0x37,
+	0x99, 0x51, 0x2a, 0x4d, 0x18, 0x00, 0x00, 0x00, 0x00, 0x28, 0xb5, 0x2f,
+	0xfd, 0x64, 0xb8, 0x0a, 0x3d, 0x02, 0x00, 0xc2, 0x83, 0x0d, 0x11, 0xa0,
+	0x6f, 0x58, 0x7a, 0xcb, 0xfe, 0x56, 0x5f, 0xf9, 0xad, 0xfc, 0xff, 0x36,
+	0x52, 0x55, 0xf7, 0x04, 0x3e, 0x5f, 0x1e, 0xcb, 0xed, 0x77, 0x19, 0xff,
+	0x5a, 0xa4, 0xa6, 0xca, 0x89, 0x50, 0xcc, 0x3b, 0x32, 0x9c, 0x4a, 0x87,
+	0xd4, 0x0a, 0x91, 0xed, 0x06, 0x45, 0x2a, 0x78, 0x6f, 0x10, 0x7c, 0x0b,
+	0x1c, 0xca, 0xcf, 0x9c, 0x04, 0x40, 0x0f, 0x86, 0x40, 0xe5, 0x1e, 0x54,
+	0xee, 0x41, 0xe5, 0x20, 0xea, 0x0c, 0xfc, 0xfa, 0xa6, 0x81,
+};
+
+/*
+ * A 4-byte skippable frame, then the three frames without their content
+ * size. Decoded by the streaming decoder.
+ */
+static const u8 test_stream_frames[] = {
+	0x50, 0x2a, 0x4d, 0x18, 0x04, 0x00, 0x00, 0x00, 0x70, 0x7a, 0x73, 0x74,
+	0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x68, 0xbd, 0x02, 0x00, 0xb2, 0x84, 0x11,
+	0x17, 0x90, 0xe9, 0x01, 0x80, 0x3d, 0xf0, 0x5f, 0xa0, 0xfd, 0x94, 0xd2,
+	0x5f, 0x5b, 0x51, 0x05, 0x33, 0x33, 0x63, 0xb3, 0xc4, 0xdd, 0x1e, 0x03,
+	0x80, 0x5a, 0x3b, 0xe5, 0xb2, 0x55, 0x31, 0x49, 0xd7, 0xe4, 0x4f, 0xda,
+	0x90, 0xe0, 0x17, 0x91, 0x3d, 0xc5, 0x26, 0xa0, 0xe8, 0x06, 0xec, 0x47,
+	0xd0, 0xb5, 0x2b, 0xae, 0xae, 0xf3, 0xd9, 0xe5, 0x7d, 0x2c, 0x7a, 0x5e,
+	0x9b, 0xc7, 0x9e, 0x11, 0x16, 0x98, 0x65, 0xe2, 0x7d, 0x07, 0x05, 0x44,
+	0x0f, 0x2d, 0x76, 0x81, 0x7b, 0xe0, 0x1e, 0xb8, 0x07, 0xee, 0x65, 0x06,
+	0xcf, 0x0b, 0xc5, 0x36, 0x28, 0xb5, 0x2f, 0xfd, 0x04, 0x68, 0xf5, 0x03,
+	0x00, 0x82, 0x07, 0x19, 0x16, 0x70, 0x3b, 0x06, 0x00, 0x55, 0xaa, 0xff,
+	0xef, 0x8a, 0x88, 0x88, 0xa8, 0x32, 0xf0, 0xff, 0x7f, 0x01, 0xd4, 0x00,
+	0x00, 0x10, 0x06, 0x8f, 0xe3, 0x4a, 0xbe, 0x1d, 0xce, 0x7a, 0x0f, 0xea,
+	0x31, 0xbd, 0x66, 0x3c, 0xfa, 0x39, 0xb9, 0x86, 0xf3, 0xa9, 0x4c, 0x72,
+	0x8d, 0x62, 0xd1, 0xb0, 0x26, 0xc4, 0x59, 0xb1, 0x49, 0x30, 0xbd, 0x18,
+	0x35, 0x46, 0x34, 0xd8, 0x31, 0xca, 0xef, 0xe9, 0x35, 0x28, 0x2f, 0x2d,
+	0xec, 0xc3, 0xb2, 0x96, 0xb0, 0xf8, 0xa4, 0xf4, 0x0b, 0xca, 0xb6, 0x7f,
+	0x0d, 0x25, 0xce, 0x41, 0x82, 0xde, 0x1c, 0x56, 0x01, 0xc2, 0x11, 0xf2,
+	0x0d, 0x20, 0xf9, 0xdc, 0x25, 0x05, 0x24, 0x01, 0x08, 0x60, 0x0f, 0xc0,
+	0xe3, 0x01, 0xce, 0x2a, 0xf7, 0x95, 0xfb, 0xca, 0xfd, 0xca, 0x7d, 0xe5,
+	0xbe, 0x72, 0xef, 0xca, 0x48, 0x4a, 0x02, 0x24, 0xb9, 0x37, 0x99, 0x28,
+	0xb5, 0x2f, 0xfd, 0x04, 0x68, 0x3d, 0x02, 0x00, 0xc2, 0x83, 0x0d, 0x11,
+	0xa0, 0x6f, 0x58, 0x7a, 0xcb, 0xfe, 0x56, 0x5f, 0xf9, 0xad, 0xfc, 0xff,
+	0x36, 0x52, 0x55, 0xf7, 0x04, 0x3e, 0x5f, 0x1e, 0xcb, 0xed, 0x77, 0x19,
+	0xff, 0x5a, 0xa4, 0xa6, 0xca, 0x89, 0x50, 0xcc, 0x3b, 0x32, 0x9c, 0x4a,
+	0x87, 0xd4, 0x0a, 0x91, 0xed, 0x06, 0x45, 0x2a, 0x78, 0x6f, 0x10, 0x7c,
+	0x0b, 0x1c, 0xca, 0xcf, 0x9c, 0x04, 0x40, 0x0f, 0x86, 0x40, 0xe5, 0x1e,
+	0x54, 0xee, 0x41, 0xe5, 0x20, 0xea, 0x0c, 0xfc, 0xfa, 0xa6, 0x81,
+};
+
+static void module_decompress_check(struct kunit *test, const u8 *buf,
+				    size_t size)
+{
+	struct load_info info = { };
+	const u8 *data;
+	size_t i;
+	int ret;
+
+	ret = module_decompress(&info, buf, size);
+	KUNIT_ASSERT_EQ(test, ret, 0);
+
+	KUNIT_EXPECT_EQ(test, info.len, TEST_PAYLOAD_SIZE);
+	data = (const u8 *)info.hdr;
+	for (i = 0; i < min_t(size_t, info.len, TEST_PAYLOAD_SIZE); i++) {
+		if (data[i] != test_byte(i)) {
+			KUNIT_FAIL(test, "mismatch at offset %zu", i);
+			break;
+		}
+	}
+
+	module_decompress_cleanup(&info);
+}
+
+static void module_decompress_test_frames(struct kunit *test)
+{
+	module_decompress_check(test, test_multi_frame,
+				sizeof(test_multi_frame));
+}
+
+static void module_decompress_test_stream(struct kunit *test)
+{
+	module_decompress_check(test, test_stream_frames,
+				sizeof(test_stream_frames));
+}
+
+static void module_decompress_test_only_skippable(struct kunit *test)
+{
+	struct load_info info = { };
+
+	/* The leading skippable frame alone holds no module. */
+	KUNIT_EXPECT_EQ(test, module_decompress(&info, test_stream_frames, 12),
+			-EINVAL);
+}
+
+static struct kunit_case module_decompress_test_cases[] = {
+	KUNIT_CASE(module_decompress_test_frames),
+	KUNIT_CASE(module_decompress_test_stream),
+	KUNIT_CASE(module_decompress_test_only_skippable),
+	{}
+};
+
+static struct kunit_suite module_decompress_test_suite = {
+	.name = "module_decompress",
+	.test_cases = module_decompress_test_cases,
+};
+kunit_test_suite(module_decompress_test_suite);
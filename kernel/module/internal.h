@@ -13,6 +13,7 @@
 #include <linux/rculist.h>
 #include <linux/rcupdate.h>
 #include <linux/mm.h>
+#include <linux/timekeeping.h>
 
 #ifndef ARCH_SHF_SMALL
 #define ARCH_SHF_SMALL 0
@@ -185,6 +186,23 @@ enum fail_dup_mod_reason {
 	FAIL_DUP_MOD_LOAD,
 };
 
+/**
+ * enum mod_stat_phase - phases of module loading timed by the statistics
+ * @MOD_PHASE_DECOMPRESS: module_decompress()
+ * @MOD_PHASE_LAYOUT: layout_and_allocate()
+ * @MOD_PHASE_SYMBOLS: simplify_symbols()
+ * @MOD_PHASE_RELOCS: apply_relocations() and post_relocation()
+ * @MOD_PHASE_INIT: do_init_module()
+ */
+enum mod_stat_phase {
+	MOD_PHASE_DECOMPRESS = 0,
+	MOD_PHASE_LAYOUT,
+	MOD_PHASE_SYMBOLS,
+	MOD_PHASE_RELOCS,
+	MOD_PHASE_INIT,
+	MOD_PHASE_MAX,
+};
+
 #ifdef CONFIG_MODULE_DEBUGFS
 extern struct dentry *mod_debugfs_root;
 #endif
@@ -193,6 +211,7 @@ extern struct dentry *mod_debugfs_root;
 
 #define mod_stat_add_long(count, var) atomic_long_add(count, var)
 #define mod_stat_inc(name) atomic_inc(name)
+#define mod_stat_clock() ktime_get_ns()
 
 extern atomic_long_t total_mod_size;
 extern atomic_long_t total_text_size;
@@ -212,11 +231,13 @@ struct mod_fail_load {
 int try_add_failed_module(const char *name, enum fail_dup_mod_reason reason);
 void mod_stat_bump_invalid(struct load_info *info, int flags);
 void mod_stat_bump_becoming(struct load_info *info, int flags);
+void mod_stat_phase_end(enum mod_stat_phase phase, u64 start);
 
 #else
 
 #define mod_stat_add_long(name, var)
 #define mod_stat_inc(name)
+#define mod_stat_clock() 0
 
 static inline int try_add_failed_module(const char *name,
 					enum fail_dup_mod_reason reason)
@@ -232,6 +253,10 @@ static inline void mod_stat_bump_becoming(struct load_info *info, int flags)
 {
 }
 
+static inline void mod_stat_phase_end(enum mod_stat_phase phase, u64 start)
+{
+}
+
 #endif /* CONFIG_MODULE_STATS */
 
 #ifdef CONFIG_MODULE_DEBUG_AUTOLOAD_DUPS
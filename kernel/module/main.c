@@ -59,6 +59,8 @@
 #include <linux/codetag.h>
 #include <linux/debugfs.h>
 #include <linux/execmem.h>
+#include <linux/hash.h>
+#include <linux/stringhash.h>
 #include <uapi/linux/module.h>
 #include "internal.h"
 
@@ -301,22 +303,207 @@ static bool find_exported_symbol_in_section(const struct symsearch *syms,
  * Find an exported symbol and return it, along with, (optional) crc and
  * (optional) module which owns it.  Needs preempt disabled or module_mutex.
  */
-bool find_symbol(struct find_symbol_arg *fsa)
+static const struct symsearch vmlinux_syms[] = {
+	{ __start___ksymtab, __stop___ksymtab, __start___kcrctab,
+	  NOT_GPL_ONLY },
+	{ __start___ksymtab_gpl, __stop___ksymtab_gpl,
+	  __start___kcrctab_gpl,
+	  GPL_ONLY },
+};
+
+#ifdef CONFIG_MODULE_SYMBOL_INDEX
+/*
+ * Hashed index of every exported symbol. The kernel's exports are added
+ * once at boot, a module's exports when it completes formation. Updates are
+ * serialized by module_mutex and nodes are freed only after an RCU grace
+ * period, so lookups run in the same context as find_symbol().
+ */
+#define SYM_INDEX_BITS	14
+
+struct sym_index_node {
+	struct hlist_node node;
+	const struct kernel_symbol *sym;
+	struct module *owner;
+	const s32 *crc;
+	enum mod_license license;
+	u32 hash;
+};
+
+static struct hlist_head *sym_index __read_mostly;
+
+static u32 sym_index_hash(const char *name)
+{
+	return full_name_hash(NULL, name, strlen(name));
+}
+
+static void sym_index_add(struct hlist_head *index,
+			  struct sym_index_node *nodes,
+			  const struct symsearch *syms, struct module *owner)
+{
+	const struct kernel_symbol *sym;
+	struct sym_index_node *n = nodes;
+
+	for (sym = syms->start; sym < syms->stop; sym++, n++) {
+		n->sym = sym;
+		n->owner = owner;
+		n->crc = symversion(syms->crcs, sym - syms->start);
+		n->license = syms->license;
+		n->hash = sym_index_hash(kernel_symbol_name(sym));
+		hlist_add_head_rcu(&n->node,
+				   &index[hash_32(n->hash, SYM_INDEX_BITS)]);
+	}
+}
+
+/*
+ * Look @fsa up in the index. Return false if there is no index yet, in
+ * which case the caller has to search the symbol tables, and otherwise
+ * report in @found whether the symbol exists.
+ */
+static bool sym_index_find(struct find_symbol_arg *fsa, bool *found)
+{
+	struct hlist_head *index = READ_ONCE(sym_index);
+	struct sym_index_node *n;
+	u32 hash;
+
+	if (!index)
+		return false;
+
+	*found = false;
+	hash = sym_index_hash(fsa->name);
+	hlist_for_each_entry_rcu(n, &index[hash_32(hash, SYM_INDEX_BITS)],
+				 node, lockdep_is_held(&module_mutex)) {
+		if (n->hash != hash ||
+		    strcmp(kernel_symbol_name(n->sym), fsa->name))
+			continue;
+		if (n->owner && n->owner->state == MODULE_STATE_UNFORMED)
+			continue;
+		if (!fsa->gplok && n->license == GPL_ONLY)
+			continue;
+
+		fsa->owner = n->owner;
+		fsa->crc = n->crc;
+		fsa->sym = n->sym;
+		fsa->license = n->license;
+		*found = true;
+		break;
+	}
+	return true;
+}
+
+/* Called with module_mutex held, before the module becomes visible. */
+static int sym_index_add_module(struct module *mod)
 {
-	static const struct symsearch arr[] = {
-		{ __start___ksymtab, __stop___ksymtab, __start___kcrctab,
+	const struct symsearch arr[] = {
+		{ mod->syms, mod->syms + mod->num_syms, mod->crcs,
 		  NOT_GPL_ONLY },
-		{ __start___ksymtab_gpl, __stop___ksymtab_gpl,
-		  __start___kcrctab_gpl,
+		{ mod->gpl_syms, mod->gpl_syms + mod->num_gpl_syms,
+		  mod->gpl_crcs,
 		  GPL_ONLY },
 	};
+	unsigned int n = mod->num_syms + mod->num_gpl_syms;
+	struct sym_index_node *nodes;
+
+	if (!sym_index || !n)
+		return 0;
+
+	nodes = kvmalloc_array(n, sizeof(*nodes), GFP_KERNEL);
+	if (!nodes)
+		return -ENOMEM;
+
+	sym_index_add(sym_index, nodes, &arr[0], mod);
+	sym_index_add(sym_index, nodes + mod->num_syms, &arr[1], mod);
+	mod->sym_index = nodes;
+	return 0;
+}
+
+/* Called with module_mutex held; free with sym_index_free_module(). */
+static void sym_index_del_module(struct module *mod)
+{
+	unsigned int i;
+
+	if (!mod->sym_index)
+		return;
+
+	for (i = 0; i < mod->num_syms + mod->num_gpl_syms; i++)
+		hlist_del_rcu(&mod->sym_index[i].node);
+}
+
+/* Called after an RCU grace period following sym_index_del_module(). */
+static void sym_index_free_module(struct module *mod)
+{
+	kvfree(mod->sym_index);
+	mod->sym_index = NULL;
+}
+
+static int __init sym_index_init(void)
+{
+	struct sym_index_node *nodes;
+	struct hlist_head *index;
+	unsigned long n = 0;
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(vmlinux_syms); i++)
+		n += vmlinux_syms[i].stop - vmlinux_syms[i].start;
+
+	index = kvmalloc_array(1 << SYM_INDEX_BITS, sizeof(*index),
+			       GFP_KERNEL);
+	nodes = kvmalloc_array(n, sizeof(*nodes), GFP_KERNEL);
+	if (!index || !nodes) {
+		pr_warn("failed to allocate the exported symbol index\n");
+		kvfree(index);
+		kvfree(nodes);
+		return 0;
+	}
+
+	for (i = 0; i < 1 << SYM_INDEX_BITS; i++)
+		INIT_HLIST_HEAD(&index[i]);
+
+	mutex_lock(&module_mutex);
+	for (i = 0; i < ARRAY_SIZE(vmlinux_syms); i++) {
+		sym_index_add(index, nodes, &vmlinux_syms[i], NULL);
+		nodes += vmlinux_syms[i].stop - vmlinux_syms[i].start;
+	}
+	smp_store_release(&sym_index, index);
+	mutex_unlock(&module_mutex);
+	return 0;
+}
+core_initcall(sym_index_init);
+#else
+static inline bool sym_index_find(struct find_symbol_arg *fsa, bool *found)
+{
+	return false;
+}
+
+static inline int sym_index_add_module(struct module *mod)
+{
+	return 0;
+}
+
+static inline void sym_index_del_module(struct module *mod)
+{
+}
+
+static inline void sym_index_free_module(struct module *mod)
+{
+}
+#endif /* CONFIG_MODULE_SYMBOL_INDEX */
+
+bool find_symbol(struct find_symbol_arg *fsa)
+{
 	struct module *mod;
 	unsigned int i;
+	bool found;
 
 	module_assert_mutex_or_preempt();
 
-	for (i = 0; i < ARRAY_SIZE(arr); i++)
-		if (find_exported_symbol_in_section(&arr[i], NULL, fsa))
+	if (sym_index_find(fsa, &found)) {
+		if (!found)
+			pr_debug("Failed to find symbol %s\n", fsa->name);
+		return found;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(vmlinux_syms); i++)
+		if (find_exported_symbol_in_section(&vmlinux_syms[i], NULL, fsa))
 			return true;
 
 	list_for_each_entry_rcu(mod, &modules, list,
@@ -1294,10 +1481,12 @@ static void free_module(struct module *mod)
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
 	mod_tree_remove(mod);
+	sym_index_del_module(mod);
 	/* Remove this module from bug list, this uses list_del_rcu */
 	module_bug_cleanup(mod);
 	/* Wait for RCU-sched synchronizing before releasing mod->list and buglist. */
 	synchronize_rcu();
+	sym_index_free_module(mod);
 	if (try_add_tainted_module(mod))
 		pr_err("%s: adding tainted module to the unloaded tainted modules list failed.\n",
 		       mod->name);
@@ -2762,6 +2951,10 @@ static int complete_formation(struct module *mod, struct load_info *info)
 	if (err)
 		goto out_strict_rwx;
 
+	err = sym_index_add_module(mod);
+	if (err)
+		goto out_strict_rwx;
+
 	/*
 	 * Mark state as coming so strong_try_module_get() ignores us,
 	 * but kallsyms etc. can see us.
@@ -2859,6 +3052,7 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	bool module_allocated = false;
 	long err = 0;
 	char *after_dashes;
+	u64 start;
 
 	/*
 	 * Do the signature check (if any) first. All that
@@ -2890,7 +3084,9 @@ static int load_module(struct load_info *info, const char __user *uargs,
 		goto free_copy;
 
 	/* Figure out module layout, and allocate all the memory. */
+	start = mod_stat_clock();
 	mod = layout_and_allocate(info, flags);
+	mod_stat_phase_end(MOD_PHASE_LAYOUT, start);
 	if (IS_ERR(mod)) {
 		err = PTR_ERR(mod);
 		goto free_copy;
@@ -2939,15 +3135,19 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	setup_modinfo(mod, info);
 
 	/* Fix up syms, so that st_value is a pointer to location. */
+	start = mod_stat_clock();
 	err = simplify_symbols(mod, info);
+	mod_stat_phase_end(MOD_PHASE_SYMBOLS, start);
 	if (err < 0)
 		goto free_modinfo;
 
+	start = mod_stat_clock();
 	err = apply_relocations(mod, info);
 	if (err < 0)
 		goto free_modinfo;
 
 	err = post_relocation(mod, info);
+	mod_stat_phase_end(MOD_PHASE_RELOCS, start);
 	if (err < 0)
 		goto free_modinfo;
 
@@ -3007,7 +3207,10 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Done! */
 	trace_module_load(mod);
 
-	return do_init_module(mod);
+	start = mod_stat_clock();
+	err = do_init_module(mod);
+	mod_stat_phase_end(MOD_PHASE_INIT, start);
+	return err;
 
  sysfs_cleanup:
 	mod_sysfs_teardown(mod);
@@ -3039,9 +3242,11 @@ static int load_module(struct load_info *info, const char __user *uargs,
 	/* Unlink carefully: kallsyms could be walking list. */
 	list_del_rcu(&mod->list);
 	mod_tree_remove(mod);
+	sym_index_del_module(mod);
 	wake_up_all(&module_wq);
 	/* Wait for RCU-sched synchronizing before releasing mod->list. */
 	synchronize_rcu();
+	sym_index_free_module(mod);
 	mutex_unlock(&module_mutex);
  free_module:
 	mod_stat_bump_invalid(info, flags);
@@ -3184,7 +3389,10 @@ static int init_module_from_file(struct file *f, const char __user * uargs, int
 	}
 
 	if (flags & MODULE_INIT_COMPRESSED_FILE) {
+		u64 start = mod_stat_clock();
 		int err = module_decompress(&info, buf, len);
+
+		mod_stat_phase_end(MOD_PHASE_DECOMPRESS, start);
 		vfree(buf); /* compressed data is no longer needed */
 		if (err) {
 			mod_stat_inc(&failed_decompress);
@@ -205,6 +205,39 @@ atomic_t failed_decompress;
 static atomic_t failed_becoming;
 static atomic_t failed_load_modules;
 
+/**
+ * DOC: module loading phase times
+ *
+ * The time spent in each phase of loading a module is accumulated so that
+ * slow boots can be attributed to decompression, symbol resolution,
+ * relocation or the module's own init routine:
+ *
+ *  * decompress: module_decompress() of compressed module files
+ *  * layout: layout_and_allocate(), which copies the sections into place
+ *  * symbols: simplify_symbols(), which resolves undefined symbols
+ *  * relocs: apply_relocations() and post_relocation()
+ *  * init: do_init_module(), including the module's init routine
+ *
+ * Each phase has a total in nanoseconds and a count of how many times it
+ * ran, shown in the stats file and as phase_<name>_ns and
+ * phase_<name>_count files.
+ */
+static const char * const mod_phase_names[MOD_PHASE_MAX] = {
+	[MOD_PHASE_DECOMPRESS]	= "decompress",
+	[MOD_PHASE_LAYOUT]	= "layout",
+	[MOD_PHASE_SYMBOLS]	= "symbols",
+	[MOD_PHASE_RELOCS]	= "relocs",
+	[MOD_PHASE_INIT]	= "init",
+};
+static atomic_long_t mod_phase_ns[MOD_PHASE_MAX];
+static atomic_t mod_phase_count[MOD_PHASE_MAX];
+
+void mod_stat_phase_end(enum mod_stat_phase phase, u64 start)
+{
+	atomic_long_add(ktime_get_ns() - start, &mod_phase_ns[phase]);
+	atomic_inc(&mod_phase_count[phase]);
+}
+
 static const char *mod_fail_to_str(struct mod_fail_load *mod_fail)
 {
 	if (test_bit(FAIL_DUP_MOD_BECOMING, &mod_fail->dup_fail_mask) &&
@@ -262,21 +295,23 @@ int try_add_failed_module(const char *name, enum fail_dup_mod_reason reason)
 }
 
 /*
- * At 64 bytes per module and assuming a 1024 bytes preamble we can fit the
- * 112 module prints within 8k.
+ * At 64 bytes per module and assuming a 2048 bytes preamble we can fit the
+ * 96 module prints within 8k.
  *
- * 1024 + (64*112) = 8k
+ * 2048 + (64*96) = 8k
  */
-#define MAX_PREAMBLE 1024
-#define MAX_FAILED_MOD_PRINT 112
+#define MAX_PREAMBLE 2048
+#define MAX_FAILED_MOD_PRINT 96
 #define MAX_BYTES_PER_MOD 64
 static ssize_t read_file_mod_stats(struct file *file, char __user *user_buf,
 				   size_t count, loff_t *ppos)
 {
 	struct mod_fail_load *mod_fail;
 	unsigned int len, size, count_failed = 0;
+	unsigned long phase_ns;
+	unsigned int phase_count;
 	char *buf;
-	int ret;
+	int ret, i;
 	u32 live_mod_count, fkreads, fdecompress, fbecoming, floads;
 	unsigned long total_size, text_size, ikread_bytes, ibecoming_bytes,
 		idecompress_bytes, imod_bytes, total_virtual_lost;
@@ -368,6 +403,19 @@ static ssize_t read_file_mod_stats(struct file *file, char __user *user_buf,
 				 DIV_ROUND_UP(imod_bytes, floads));
 	}
 
+	for (i = 0; i < MOD_PHASE_MAX; i++) {
+		phase_ns = atomic_long_read(&mod_phase_ns[i]);
+		phase_count = atomic_read(&mod_phase_count[i]);
+		if (!phase_count)
+			continue;
+		len += scnprintf(buf + len, size - len, "%18s %-6s\t%lu\n",
+				 "Total us in", mod_phase_names[i],
+				 phase_ns / NSEC_PER_USEC);
+		len += scnprintf(buf + len, size - len, "%18s %-6s\t%lu\n",
+				 "Average us in", mod_phase_names[i],
+				 phase_ns / NSEC_PER_USEC / phase_count);
+	}
+
 	/* End of our debug preamble header. */
 
 	/* Catch when we've gone beyond our expected preamble */
@@ -410,6 +458,9 @@ static const struct file_operations fops_mod_stats = {
 #define mod_debug_add_atomic(name) debugfs_create_atomic_t(#name, 0400, mod_debugfs_root, &name)
 static int __init module_stats_init(void)
 {
+	char name[32];
+	int i;
+
 	mod_debug_add_ulong(total_mod_size);
 	mod_debug_add_ulong(total_text_size);
 	mod_debug_add_ulong(invalid_kread_bytes);
@@ -423,6 +474,16 @@ static int __init module_stats_init(void)
 	mod_debug_add_atomic(failed_becoming);
 	mod_debug_add_atomic(failed_load_modules);
 
+	for (i = 0; i < MOD_PHASE_MAX; i++) {
+		snprintf(name, sizeof(name), "phase_%s_ns", mod_phase_names[i]);
+		debugfs_create_ulong(name, 0400, mod_debugfs_root,
+				     (unsigned long *)&mod_phase_ns[i].counter);
+		snprintf(name, sizeof(name), "phase_%s_count",
+			 mod_phase_names[i]);
+		debugfs_create_atomic_t(name, 0400, mod_debugfs_root,
+					&mod_phase_count[i]);
+	}
+
 	debugfs_create_file("stats", 0400, mod_debugfs_root, mod_debugfs_root, &fops_mod_stats);
 
 	return 0;
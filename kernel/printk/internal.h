@@ -93,6 +93,22 @@ bool is_printk_legacy_deferred(void);
 
 u16 printk_parse_prefix(const char *text, int *level,
 			enum printk_info_flags *flags);
+__printf(5, 0)
+u16 printk_sprint(char *text, u16 size, int facility,
+		  enum printk_info_flags *flags, const char *fmt,
+		  va_list args);
+
+__printf(8, 0)
+int printk_stage_store(int facility, int level, enum printk_info_flags flags,
+		       const struct dev_printk_info *dev_info, u64 ts_nsec,
+		       u32 caller_id, u16 reserve_size, const char *fmt,
+		       va_list args);
+int printk_stage_enable(bool enable);
+bool printk_stage_active(void);
+void printk_stage_flush(void);
+void printk_stage_flush_this_cpu(void);
+void printk_stage_flush_on_panic(void);
+void printk_stage_stats(unsigned long *overflows, unsigned long *dropped);
 void console_lock_spinning_enable(void);
 int console_lock_spinning_disable_and_check(int cookie);
 
@@ -186,6 +202,8 @@ static inline void nbcon_kthread_wake(struct console *con)
 #define printk_safe_exit_irqrestore(flags) local_irq_restore(flags)
 
 static inline bool printk_percpu_data_ready(void) { return false; }
+static inline void printk_stage_flush(void) { }
+static inline void printk_stage_flush_on_panic(void) { }
 static inline void defer_console_output(void) { }
 static inline bool is_printk_legacy_deferred(void) { return false; }
 static inline u64 nbcon_seq_read(struct console *con) { return 0; }
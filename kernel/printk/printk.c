@@ -2188,9 +2188,9 @@ u16 printk_parse_prefix(const char *text, int *level,
 }
 
 __printf(5, 0)
-static u16 printk_sprint(char *text, u16 size, int facility,
-			 enum printk_info_flags *flags, const char *fmt,
-			 va_list args)
+u16 printk_sprint(char *text, u16 size, int facility,
+		  enum printk_info_flags *flags, const char *fmt,
+		  va_list args)
 {
 	u16 text_len;
 
@@ -2218,6 +2218,32 @@ static u16 printk_sprint(char *text, u16 size, int facility,
 	return text_len;
 }
 
+/*
+ * Only complete lines are staged in the per-CPU rings. Partial lines must
+ * be in the ringbuffer immediately so that continuations can be appended.
+ * Emergency and panic messages bypass staging so that they are printed
+ * from the calling context. Either way, the lines already staged on this
+ * CPU are merged first, see printk_stage_flush_this_cpu().
+ */
+static bool printk_stage_allowed(enum printk_info_flags flags,
+				 const struct dev_printk_info *dev_info,
+				 const char *fmt)
+{
+	size_t len;
+
+	if (flags & LOG_CONT)
+		return false;
+
+	if (panic_in_progress() || nbcon_get_default_prio() != NBCON_PRIO_NORMAL)
+		return false;
+
+	if (dev_info)
+		return true;
+
+	len = strlen(fmt);
+	return len && fmt[len - 1] == '\n';
+}
+
 __printf(4, 0)
 int vprintk_store(int facility, int level,
 		  const struct dev_printk_info *dev_info,
@@ -2273,6 +2299,17 @@ int vprintk_store(int facility, int level,
 	if (dev_info)
 		flags |= LOG_NEWLINE;
 
+	if (printk_stage_allowed(flags, dev_info, fmt)) {
+		ret = printk_stage_store(facility, level, flags, dev_info, ts_nsec,
+					 caller_id, reserve_size, fmt, args);
+		if (ret >= 0)
+			goto out;
+		ret = 0;
+	}
+
+	/* Keep the lines staged earlier on this CPU ahead of this record. */
+	printk_stage_flush_this_cpu();
+
 	if (flags & LOG_CONT) {
 		prb_rec_init_wr(&r, reserve_size);
 		if (prb_reserve_in_last(&e, prb, &r, caller_id, PRINTKRB_RECORD_MAX)) {
@@ -2343,6 +2380,8 @@ void printk_legacy_allow_panic_sync(void)
 
 	legacy_allow_panic_sync = true;
 
+	printk_stage_flush_on_panic();
+
 	printk_get_console_flush_type(&ft);
 	if (ft.legacy_direct) {
 		if (console_trylock())
@@ -3431,6 +3470,8 @@ void console_flush_on_panic(enum con_flush_mode mode)
 	 */
 	console_may_schedule = 0;
 
+	printk_stage_flush_on_panic();
+
 	if (mode == CONSOLE_REPLAY_ALL)
 		__console_rewind_all();
 
@@ -4348,6 +4389,9 @@ static bool __pr_flush(struct console *con, int timeout_ms, bool reset_on_progre
 
 	might_sleep();
 
+	/* Records still staged on other CPUs must be waited for too. */
+	printk_stage_flush();
+
 	seq = prb_next_reserve_seq(prb);
 
 	/* Flush the consoles so that records up to @seq are printed. */
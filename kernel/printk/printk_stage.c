@@ -0,0 +1,519 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * printk_stage.c - Per-CPU staging of printk records
+ *
+ * Under message storms every printing CPU contends on the head of the
+ * descriptor ring in printk_ringbuffer.c. When staging is enabled
+ * ("printk.stage=1"), complete lines are instead written into a
+ * single-producer ring owned by the printing CPU, which needs no
+ * atomic operations on shared cachelines. A per-CPU irq_work merges the
+ * staged records of all CPUs into the global ringbuffer in timestamp
+ * order, so that /dev/kmsg, syslog and the consoles see them as usual.
+ * Any CPU can merge for the others, so a CPU stuck with interrupts
+ * disabled does not hold back the records it staged.
+ *
+ * Records that cannot be staged (NMI context, continuation lines,
+ * emergency and panic sections, or a full staging ring) are stored
+ * directly into the ringbuffer as before, so staging never drops a
+ * message that the ringbuffer would have accepted. Before such a record
+ * is stored, the records staged on the same CPU are merged, so that the
+ * records of a CPU keep their order (except for those stored from NMI).
+ */
+
+#include <linux/cpumask.h>
+#include <linux/dev_printk.h>
+#include <linux/init.h>
+#include <linux/irq_work.h>
+#include <linux/kstrtox.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/preempt.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include "internal.h"
+#include "printk_ringbuffer.h"
+
+#undef MODULE_PARAM_PREFIX
+#define MODULE_PARAM_PREFIX "printk."
+
+/* Size of each per-CPU staging ring, must be a power of 2. */
+#define PRINTK_STAGE_SIZE	(16 * 1024)
+#define PRINTK_STAGE_MASK	(PRINTK_STAGE_SIZE - 1)
+
+/* Maximum number of records merged by one run of the irq_work. */
+#define PRINTK_STAGE_BATCH	256
+
+enum printk_stage_kind {
+	PRINTK_STAGE_REC,	/* record without device info */
+	PRINTK_STAGE_REC_DEV,	/* record followed by struct dev_printk_info */
+	PRINTK_STAGE_PAD,	/* unused space up to the end of the ring */
+};
+
+/*
+ * A staged record. It is followed by the optional device info and the
+ * text. Entries never wrap around the end of the ring: if the remaining
+ * space is too small, it is skipped with a padding entry (or implicitly
+ * when not even a header fits).
+ */
+struct printk_stage_entry {
+	u64	ts_nsec;
+	u32	caller_id;
+	u16	size;		/* bytes used in the ring, including alignment */
+	u16	text_len;
+	u8	facility;
+	u8	level;
+	u8	flags;
+	u8	kind;
+};
+
+/*
+ * @head and @tail are free running byte positions. @head is only
+ * written by the owning CPU with interrupts disabled, @tail only by the
+ * merger under @printk_stage_lock.
+ */
+struct printk_stage {
+	unsigned long	head ____cacheline_aligned;
+	unsigned long	overflows;
+	unsigned long	tail ____cacheline_aligned;
+	char		*buf;
+};
+
+static DEFINE_PER_CPU(struct printk_stage *, printk_stage);
+
+static bool printk_stage_want;
+static bool printk_stage_enabled;
+static DEFINE_MUTEX(printk_stage_mutex);
+
+/* Serializes the merger, which is the only consumer of all rings. */
+static DEFINE_RAW_SPINLOCK(printk_stage_lock);
+/* CPU merging under @printk_stage_lock, so that it does not wait for itself */
+static int printk_stage_owner = -1;
+static unsigned long printk_stage_dropped;
+
+static void printk_stage_work_func(struct irq_work *work);
+static DEFINE_PER_CPU(struct irq_work, printk_stage_work) =
+	IRQ_WORK_INIT(printk_stage_work_func);
+
+static int printk_stage_alloc(void)
+{
+	struct printk_stage *st;
+	int cpu;
+
+	lockdep_assert_held(&printk_stage_mutex);
+
+	for_each_possible_cpu(cpu) {
+		if (per_cpu(printk_stage, cpu))
+			continue;
+
+		st = kzalloc_node(sizeof(*st), GFP_KERNEL, cpu_to_node(cpu));
+		if (!st)
+			return -ENOMEM;
+		st->buf = kmalloc_node(PRINTK_STAGE_SIZE, GFP_KERNEL, cpu_to_node(cpu));
+		if (!st->buf) {
+			kfree(st);
+			return -ENOMEM;
+		}
+		/* Rings are never freed, the merger may access them any time. */
+		smp_store_release(per_cpu_ptr(&printk_stage, cpu), st);
+	}
+	return 0;
+}
+
+/**
+ * printk_stage_enable - Enable or disable per-CPU staging
+ * @enable:	New state
+ *
+ * Disabling only stops new records from being staged. Records already
+ * staged are still merged into the ringbuffer.
+ *
+ * Return: 0 on success or -ENOMEM if the rings could not be allocated.
+ */
+int printk_stage_enable(bool enable)
+{
+	int ret = 0;
+
+	mutex_lock(&printk_stage_mutex);
+	if (enable)
+		ret = printk_stage_alloc();
+	if (!ret)
+		WRITE_ONCE(printk_stage_enabled, enable);
+	mutex_unlock(&printk_stage_mutex);
+
+	if (!enable)
+		printk_stage_flush();
+
+	return ret;
+}
+
+bool printk_stage_active(void)
+{
+	return READ_ONCE(printk_stage_enabled);
+}
+
+static int printk_stage_param_set(const char *val, const struct kernel_param *kp)
+{
+	bool enable;
+	int ret;
+
+	ret = kstrtobool(val, &enable);
+	if (ret)
+		return ret;
+
+	printk_stage_want = enable;
+
+	/* Early parameters are applied by printk_stage_init(). */
+	if (!slab_is_available())
+		return 0;
+
+	return printk_stage_enable(enable);
+}
+
+static const struct kernel_param_ops printk_stage_param_ops = {
+	.set	= printk_stage_param_set,
+	.get	= param_get_bool,
+};
+module_param_cb(stage, &printk_stage_param_ops, &printk_stage_want, 0644);
+MODULE_PARM_DESC(stage, "Stage complete lines in per-CPU rings before merging them into the log buffer");
+
+static int __init printk_stage_init(void)
+{
+	if (printk_stage_want && printk_stage_enable(true))
+		pr_warn("printk: failed to allocate staging rings\n");
+	return 0;
+}
+core_initcall(printk_stage_init);
+
+/**
+ * printk_stage_store - Stage a complete line on the current CPU
+ * @facility:	Syslog facility
+ * @level:	Log level
+ * @flags:	Record flags parsed from the prefix
+ * @dev_info:	Optional device info
+ * @ts_nsec:	Timestamp taken by the caller
+ * @caller_id:	Caller id of the current context
+ * @reserve_size: Space required for the formatted text, including '\0'
+ * @fmt:	Format string
+ * @args:	Format arguments
+ *
+ * Context: Interrupts disabled, not NMI. Called from vprintk_store(),
+ *	    which also guards against recursion on this CPU.
+ * Return: The length of the stored text or a negative error code if the
+ *	   record was not staged and must be stored directly.
+ */
+int printk_stage_store(int facility, int level, enum printk_info_flags flags,
+		       const struct dev_printk_info *dev_info, u64 ts_nsec,
+		       u32 caller_id, u16 reserve_size, const char *fmt,
+		       va_list args)
+{
+	struct printk_stage_entry *ent;
+	unsigned long head, off, size;
+	unsigned long pad = 0;
+	struct printk_stage *st;
+	u16 text_len;
+	char *text;
+
+	if (!READ_ONCE(printk_stage_enabled) || in_nmi())
+		return -EAGAIN;
+
+	st = this_cpu_read(printk_stage);
+	if (!st)
+		return -EAGAIN;
+
+	size = sizeof(*ent) + reserve_size;
+	if (dev_info)
+		size += sizeof(*dev_info);
+	size = ALIGN(size, sizeof(u64));
+
+	head = st->head;
+	off = head & PRINTK_STAGE_MASK;
+	if (off + size > PRINTK_STAGE_SIZE)
+		pad = PRINTK_STAGE_SIZE - off;
+
+	/* Pairs with smp_store_release() in printk_stage_merge_one(). */
+	if (head + pad + size - smp_load_acquire(&st->tail) > PRINTK_STAGE_SIZE) {
+		st->overflows++;
+		return -ENOSPC;
+	}
+
+	if (pad) {
+		if (pad >= sizeof(*ent)) {
+			ent = (struct printk_stage_entry *)&st->buf[off];
+			ent->size = pad;
+			ent->kind = PRINTK_STAGE_PAD;
+		}
+		head += pad;
+		off = 0;
+	}
+
+	ent = (struct printk_stage_entry *)&st->buf[off];
+	text = (char *)(ent + 1);
+	if (dev_info) {
+		memcpy(text, dev_info, sizeof(*dev_info));
+		text += sizeof(*dev_info);
+	}
+
+	text_len = printk_sprint(text, reserve_size, facility, &flags, fmt, args);
+
+	ent->ts_nsec = ts_nsec;
+	ent->caller_id = caller_id;
+	ent->size = size;
+	ent->text_len = text_len;
+	ent->facility = facility;
+	ent->level = level & 7;
+	/* Staged records are final, even if the text was truncated. */
+	ent->flags = (flags | LOG_NEWLINE) & 0x1f;
+	ent->kind = dev_info ? PRINTK_STAGE_REC_DEV : PRINTK_STAGE_REC;
+
+	/* Pairs with smp_load_acquire() in printk_stage_peek(). */
+	smp_store_release(&st->head, head + size);
+
+	/* Avoid the atomic claim when a merge is already pending. */
+	if (!irq_work_is_pending(this_cpu_ptr(&printk_stage_work)))
+		irq_work_queue(this_cpu_ptr(&printk_stage_work));
+
+	return text_len;
+}
+
+/* Find the oldest record in @st that has not been merged yet. */
+static struct printk_stage_entry *printk_stage_peek(struct printk_stage *st)
+{
+	struct printk_stage_entry *ent;
+	unsigned long head, pos, off;
+
+	/* Pairs with smp_store_release() in printk_stage_store(). */
+	head = smp_load_acquire(&st->head);
+	pos = st->tail;
+
+	while (pos != head) {
+		off = pos & PRINTK_STAGE_MASK;
+		if (PRINTK_STAGE_SIZE - off < sizeof(*ent)) {
+			pos += PRINTK_STAGE_SIZE - off;
+			continue;
+		}
+
+		ent = (struct printk_stage_entry *)&st->buf[off];
+		if (ent->kind != PRINTK_STAGE_PAD) {
+			if (pos != st->tail)
+				smp_store_release(&st->tail, pos);
+			return ent;
+		}
+		pos += ent->size;
+	}
+
+	if (pos != st->tail)
+		smp_store_release(&st->tail, pos);
+	return NULL;
+}
+
+/* Copy @ent into the ringbuffer and release its space in @st. */
+static void printk_stage_merge_one(struct printk_stage *st,
+				   struct printk_stage_entry *ent)
+{
+	const struct dev_printk_info *dev_info = NULL;
+	struct prb_reserved_entry e;
+	struct printk_record r;
+	const char *text;
+
+	text = (const char *)(ent + 1);
+	if (ent->kind == PRINTK_STAGE_REC_DEV) {
+		dev_info = (const struct dev_printk_info *)text;
+		text += sizeof(*dev_info);
+	}
+
+	prb_rec_init_wr(&r, ent->text_len);
+	if (prb_reserve(&e, prb, &r)) {
+		memcpy(&r.text_buf[0], text, ent->text_len);
+		r.info->text_len = ent->text_len;
+		r.info->facility = ent->facility;
+		r.info->level = ent->level;
+		r.info->flags = ent->flags;
+		r.info->ts_nsec = ent->ts_nsec;
+		r.info->caller_id = ent->caller_id;
+		if (dev_info)
+			memcpy(&r.info->dev_info, dev_info, sizeof(r.info->dev_info));
+		prb_final_commit(&e);
+	} else {
+		printk_stage_dropped++;
+	}
+
+	/* Pairs with smp_load_acquire() in printk_stage_store(). */
+	smp_store_release(&st->tail, st->tail + ent->size);
+}
+
+/*
+ * Merge up to @budget records from all staging rings in timestamp order.
+ * Returns the number of records merged.
+ *
+ * Context: @printk_stage_lock held, or on the panic CPU once all other
+ *	    CPUs are stopped.
+ */
+static unsigned int printk_stage_merge(unsigned int budget)
+{
+	struct printk_stage_entry *best, *ent;
+	struct printk_stage *best_st, *st;
+	unsigned int n;
+	int cpu;
+
+	WRITE_ONCE(printk_stage_owner, smp_processor_id());
+
+	for (n = 0; n < budget; n++) {
+		best = NULL;
+		best_st = NULL;
+
+		for_each_possible_cpu(cpu) {
+			st = READ_ONCE(per_cpu(printk_stage, cpu));
+			if (!st)
+				continue;
+
+			ent = printk_stage_peek(st);
+			if (ent && (!best || ent->ts_nsec < best->ts_nsec)) {
+				best = ent;
+				best_st = st;
+			}
+		}
+
+		if (!best)
+			break;
+
+		printk_stage_merge_one(best_st, best);
+	}
+
+	WRITE_ONCE(printk_stage_owner, -1);
+	return n;
+}
+
+/**
+ * printk_stage_flush_this_cpu - Merge the records staged on this CPU
+ *
+ * Called before a record is stored directly into the ringbuffer, so that
+ * it cannot overtake lines printed earlier on the same CPU.
+ *
+ * Context: Interrupts disabled.
+ */
+void printk_stage_flush_this_cpu(void)
+{
+	struct printk_stage_entry *ent;
+	struct printk_stage *st;
+	int cpu;
+
+	st = this_cpu_read(printk_stage);
+	if (!st || st->head == READ_ONCE(st->tail))
+		return;
+
+	/*
+	 * NMIs must not spin on the lock, and a printk() from within the
+	 * merger on this CPU would deadlock.
+	 */
+	cpu = smp_processor_id();
+	if (in_nmi() || READ_ONCE(printk_stage_owner) == cpu)
+		return;
+
+	raw_spin_lock(&printk_stage_lock);
+	WRITE_ONCE(printk_stage_owner, cpu);
+	while ((ent = printk_stage_peek(st)))
+		printk_stage_merge_one(st, ent);
+	WRITE_ONCE(printk_stage_owner, -1);
+	raw_spin_unlock(&printk_stage_lock);
+}
+
+static void printk_stage_output(void)
+{
+	struct console_flush_type ft;
+
+	printk_get_console_flush_type(&ft);
+	if (ft.nbcon_atomic)
+		nbcon_atomic_flush_pending();
+	if (ft.nbcon_offload)
+		nbcon_kthreads_wake();
+
+	/* Legacy consoles cannot be flushed from this context. */
+	if (ft.legacy_direct || ft.legacy_offload)
+		defer_console_output();
+	else
+		wake_up_klogd();
+}
+
+static void printk_stage_work_func(struct irq_work *work)
+{
+	unsigned long flags;
+	unsigned int n;
+
+	raw_spin_lock_irqsave(&printk_stage_lock, flags);
+	n = printk_stage_merge(PRINTK_STAGE_BATCH);
+	raw_spin_unlock_irqrestore(&printk_stage_lock, flags);
+
+	/* Give other work a chance before continuing with a large backlog. */
+	if (n == PRINTK_STAGE_BATCH)
+		irq_work_queue(work);
+
+	if (n)
+		printk_stage_output();
+}
+
+/**
+ * printk_stage_flush - Merge all staged records into the ringbuffer
+ *
+ * Used by pr_flush() so that the caller waits for records that were
+ * staged before the call.
+ *
+ * Context: Any context except NMI.
+ */
+void printk_stage_flush(void)
+{
+	unsigned long flags;
+	unsigned int n;
+
+	do {
+		raw_spin_lock_irqsave(&printk_stage_lock, flags);
+		n = printk_stage_merge(PRINTK_STAGE_BATCH);
+		raw_spin_unlock_irqrestore(&printk_stage_lock, flags);
+	} while (n == PRINTK_STAGE_BATCH);
+}
+
+/**
+ * printk_stage_flush_on_panic - Merge all staged records on panic
+ *
+ * The other CPUs are stopped at this point. If one of them was stopped
+ * while merging, it never releases the lock, so the panic CPU merges
+ * without it, as nbcon takes over consoles unsafely. The record the
+ * stopped CPU was merging may then be stored twice.
+ */
+void printk_stage_flush_on_panic(void)
+{
+	unsigned long flags;
+
+	if (raw_spin_trylock_irqsave(&printk_stage_lock, flags)) {
+		printk_stage_merge(UINT_MAX);
+		raw_spin_unlock_irqrestore(&printk_stage_lock, flags);
+		return;
+	}
+
+	if (!this_cpu_in_panic())
+		return;
+
+	local_irq_save(flags);
+	printk_stage_merge(UINT_MAX);
+	local_irq_restore(flags);
+}
+
+/**
+ * printk_stage_stats - Read staging statistics
+ * @overflows:	Number of records stored directly because a ring was full
+ * @dropped:	Number of staged records the ringbuffer did not accept
+ */
+void printk_stage_stats(unsigned long *overflows, unsigned long *dropped)
+{
+	struct printk_stage *st;
+	int cpu;
+
+	*overflows = 0;
+	for_each_possible_cpu(cpu) {
+		st = READ_ONCE(per_cpu(printk_stage, cpu));
+		if (st)
+			*overflows += READ_ONCE(st->overflows);
+	}
+	*dropped = READ_ONCE(printk_stage_dropped);
+}
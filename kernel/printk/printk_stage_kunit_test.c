@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Stress test for the per-CPU printk staging rings
+ *
+ * One thread per online CPU (up to STAGE_TEST_MAX_THREADS) floods printk
+ * with numbered lines. Afterwards the ringbuffer must contain every line
+ * exactly once, and the lines of each thread must appear in the order they
+ * were printed, even when a staging ring overflowed.
+ */
+
+#include <kunit/test.h>
+#include <linux/bitmap.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/kthread.h>
+#include <linux/printk.h>
+#include <linux/slab.h>
+#include "internal.h"
+#include "printk_ringbuffer.h"
+
+#define STAGE_TEST_LINES	200
+#define STAGE_TEST_MAX_THREADS	8
+#define STAGE_TEST_TAG		"printk_stage_test"
+
+struct stage_test_thread {
+	struct task_struct	*task;
+	struct completion	done;
+	unsigned int		id;
+	unsigned int		next;	/* next line expected in the ringbuffer */
+	bool			ordered;
+	DECLARE_BITMAP(seen, STAGE_TEST_LINES);
+};
+
+static int stage_test_fn(void *arg)
+{
+	struct stage_test_thread *t = arg;
+	unsigned int i;
+
+	for (i = 0; i < STAGE_TEST_LINES; i++)
+		printk(KERN_DEBUG STAGE_TEST_TAG ": t=%u n=%u\n", t->id, i);
+
+	/* @t may be freed as soon as the test sees @done */
+	kthread_complete_and_exit(&t->done, 0);
+}
+
+static void stage_test_stress(struct kunit *test)
+{
+	unsigned long overflows_before, overflows, dropped_before, dropped;
+	struct stage_test_thread *threads;
+	char *text_buf, *text;
+	unsigned int nr = 0, i;
+	struct printk_info info;
+	struct printk_record r;
+	bool was_active;
+	u64 start, seq;
+	int cpu;
+
+	was_active = printk_stage_active();
+	KUNIT_ASSERT_EQ(test, printk_stage_enable(true), 0);
+
+	threads = kunit_kcalloc(test, STAGE_TEST_MAX_THREADS, sizeof(*threads), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, threads);
+	text_buf = kunit_kzalloc(test, PRINTKRB_RECORD_MAX, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, text_buf);
+
+	printk_stage_stats(&overflows_before, &dropped_before);
+	start = prb_next_reserve_seq(prb);
+
+	for_each_online_cpu(cpu) {
+		struct stage_test_thread *t = &threads[nr];
+
+		if (nr == STAGE_TEST_MAX_THREADS)
+			break;
+
+		t->id = nr;
+		t->ordered = true;
+		init_completion(&t->done);
+		t->task = kthread_run_on_cpu(stage_test_fn, t, cpu, "printk_stage/%u");
+		if (IS_ERR(t->task)) {
+			KUNIT_FAIL(test, "kthread_run_on_cpu() failed: %pe", t->task);
+			break;
+		}
+		nr++;
+	}
+
+	for (i = 0; i < nr; i++)
+		wait_for_completion(&threads[i].done);
+
+	printk_stage_flush();
+	printk_stage_stats(&overflows, &dropped);
+	overflows -= overflows_before;
+	dropped -= dropped_before;
+
+	if (!was_active)
+		printk_stage_enable(false);
+
+	KUNIT_EXPECT_EQ(test, dropped, 0);
+
+	if (prb_first_valid_seq(prb) > start)
+		kunit_skip(test, "log buffer too small, test records were overwritten");
+
+	prb_rec_init_rd(&r, &info, text_buf, PRINTKRB_RECORD_MAX);
+	prb_for_each_record(start, prb, seq, &r) {
+		unsigned int id, n;
+
+		text = text_buf;
+		text[min_t(unsigned int, info.text_len, PRINTKRB_RECORD_MAX - 1)] = '\0';
+		if (sscanf(text, STAGE_TEST_TAG ": t=%u n=%u", &id, &n) != 2)
+			continue;
+		if (id >= nr || n >= STAGE_TEST_LINES) {
+			KUNIT_FAIL(test, "unexpected record: %s", text);
+			continue;
+		}
+
+		KUNIT_EXPECT_FALSE_MSG(test, test_and_set_bit(n, threads[id].seen),
+				       "thread %u line %u stored twice", id, n);
+		if (n != threads[id].next)
+			threads[id].ordered = false;
+		threads[id].next = n + 1;
+	}
+
+	for (i = 0; i < nr; i++) {
+		KUNIT_EXPECT_EQ_MSG(test, bitmap_weight(threads[i].seen, STAGE_TEST_LINES),
+				    STAGE_TEST_LINES, "thread %u lost lines", i);
+		KUNIT_EXPECT_TRUE_MSG(test, threads[i].ordered,
+				      "thread %u lines out of order", i);
+	}
+
+	kunit_info(test, "%u threads, %lu overflows\n", nr, overflows);
+}
+
+static struct kunit_case printk_stage_test_cases[] = {
+	KUNIT_CASE_SLOW(stage_test_stress),
+	{}
+};
+
+static struct kunit_suite printk_stage_test_suite = {
+	.name = "printk-stage",
+	.test_cases = printk_stage_test_cases,
+};
+kunit_test_suite(printk_stage_test_suite);
+
+MODULE_DESCRIPTION("Stress test for printk per-CPU staging");
+MODULE_LICENSE("GPL");
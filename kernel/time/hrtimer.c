@@ -1076,12 +1076,19 @@ u64 hrtimer_forward(struct hrtimer *timer, ktime_t now, ktime_t interval)
 }
 EXPORT_SYMBOL_GPL(hrtimer_forward);
 
+static bool hrtimer_park_timer(struct hrtimer *timer,
+			       struct hrtimer_clock_base *base);
+static void hrtimer_unpark_timer(struct hrtimer *timer);
+
 /*
  * enqueue_hrtimer - internal function to (re)start a timer
  *
  * The timer is inserted in expiry order. Insertion into the
  * red black tree is O(log(n)). Must hold the base lock.
  *
+ * Far-out timers on the local CLOCK_MONOTONIC bases may instead be
+ * parked in a bucket, see hrtimer_park_timer().
+ *
  * Returns 1 when the new timer is the leftmost timer in the tree.
  */
 static int enqueue_hrtimer(struct hrtimer *timer,
@@ -1096,6 +1103,9 @@ static int enqueue_hrtimer(struct hrtimer *timer,
 	/* Pairs with the lockless read in hrtimer_is_queued() */
 	WRITE_ONCE(timer->state, HRTIMER_STATE_ENQUEUED);
 
+	if (hrtimer_park_timer(timer, base))
+		return 0;
+
 	return timerqueue_add(&base->active, &timer->node);
 }
 
@@ -1121,6 +1131,15 @@ static void __remove_hrtimer(struct hrtimer *timer,
 	if (!(state & HRTIMER_STATE_ENQUEUED))
 		return;
 
+	/*
+	 * A parked timer is never cpu_base->next_timer and the park
+	 * sweeper keeps the base active, so nothing else to do.
+	 */
+	if (timer->is_parked) {
+		hrtimer_unpark_timer(timer);
+		return;
+	}
+
 	if (!timerqueue_del(&base->active, &timer->node))
 		cpu_base->active_bases &= ~(1 << base->index);
 
@@ -1136,6 +1155,263 @@ static void __remove_hrtimer(struct hrtimer *timer,
 		hrtimer_force_reprogram(cpu_base, 1);
 }
 
+/*
+ * Parking of far-out timers
+ *
+ * Connection timeouts armed through timerfd, epoll or nanosleep are
+ * usually seconds away and most of them get cancelled or re-armed
+ * long before they expire. With tens of thousands of such timers per
+ * CPU every start and cancel pays for a rebalancing insertion into a
+ * deep rbtree.
+ *
+ * When enabled with "hrtimer_park=1", timers on the local
+ * CLOCK_MONOTONIC bases whose soft expiry is at least two buckets
+ * ahead are hashed into a per CPU array of HRTIMER_PARK_SIZE buckets
+ * of 2^HRTIMER_PARK_SHIFT ns (~134ms) each instead. Parking and
+ * cancelling are O(1). A per base sweeper hrtimer, which lives in the
+ * timerqueue like any other timer, moves each bucket into the
+ * timerqueue one bucket period before the bucket starts. From there
+ * on the timers are regular hrtimers, so their expiry precision and
+ * the batching of timers within their slack (see
+ * __hrtimer_run_queues()) are not affected. The clock event device
+ * only sees the sweeper, which fires at most once per bucket period
+ * while timers are parked.
+ *
+ * Parked timers stay HRTIMER_STATE_ENQUEUED. Everything is protected
+ * by cpu_base->lock.
+ */
+#define HRTIMER_PARK_BITS	8
+#define HRTIMER_PARK_SIZE	(1UL << HRTIMER_PARK_BITS)
+#define HRTIMER_PARK_MASK	(HRTIMER_PARK_SIZE - 1)
+#define HRTIMER_PARK_SHIFT	27
+
+struct hrtimer_park {
+	struct hrtimer		sweeper;
+	/* Lowest bucket number which has not been swept yet */
+	u64			next_bn;
+	unsigned int		count;
+	DECLARE_BITMAP(pending, HRTIMER_PARK_SIZE);
+	struct hlist_head	buckets[HRTIMER_PARK_SIZE];
+};
+
+/* One park for HRTIMER_BASE_MONOTONIC and one for HRTIMER_BASE_MONOTONIC_SOFT */
+static DEFINE_PER_CPU(struct hrtimer_park, hrtimer_parks[2]);
+
+static bool hrtimer_park_enabled __read_mostly;
+
+static int __init setup_hrtimer_park(char *str)
+{
+	return (kstrtobool(str, &hrtimer_park_enabled) == 0);
+}
+__setup("hrtimer_park=", setup_hrtimer_park);
+
+static struct hrtimer_park *hrtimer_park_of(struct hrtimer_clock_base *base)
+{
+	int cpu = base->cpu_base->cpu;
+
+	switch (base->index) {
+	case HRTIMER_BASE_MONOTONIC:
+		return &per_cpu(hrtimer_parks[0], cpu);
+	case HRTIMER_BASE_MONOTONIC_SOFT:
+		return &per_cpu(hrtimer_parks[1], cpu);
+	default:
+		return NULL;
+	}
+}
+
+static inline u64 hrtimer_park_bucket(struct hrtimer *timer)
+{
+	return (u64)hrtimer_get_softexpires_tv64(timer) >> HRTIMER_PARK_SHIFT;
+}
+
+/* Bucket number of the first pending bucket, park->count must not be 0 */
+static u64 hrtimer_park_first(struct hrtimer_park *park)
+{
+	unsigned long start = park->next_bn & HRTIMER_PARK_MASK;
+	unsigned long idx;
+
+	idx = find_next_bit(park->pending, HRTIMER_PARK_SIZE, start);
+	if (idx >= HRTIMER_PARK_SIZE)
+		idx = find_first_bit(park->pending, HRTIMER_PARK_SIZE);
+
+	return park->next_bn + ((idx - start) & HRTIMER_PARK_MASK);
+}
+
+/*
+ * Make sure the sweeper expires no later than one bucket period before
+ * bucket @bn starts.
+ */
+static void hrtimer_park_arm(struct hrtimer_park *park,
+			     struct hrtimer_clock_base *base, u64 bn)
+{
+	struct hrtimer *sweeper = &park->sweeper;
+	ktime_t expires = (ktime_t)((bn - 1) << HRTIMER_PARK_SHIFT);
+
+	if (sweeper->state & HRTIMER_STATE_ENQUEUED) {
+		if (hrtimer_get_expires_tv64(sweeper) <= expires)
+			return;
+		debug_deactivate(sweeper);
+		__remove_hrtimer(sweeper, base, HRTIMER_STATE_INACTIVE, 0);
+	} else {
+		/*
+		 * Either idle or its callback is running with the lock
+		 * dropped. In the latter case queue it here, the callback
+		 * return value is then ignored by __run_hrtimer().
+		 */
+		expires = (ktime_t)((hrtimer_park_first(park) - 1) << HRTIMER_PARK_SHIFT);
+	}
+
+	hrtimer_set_expires(sweeper, expires);
+	if (enqueue_hrtimer(sweeper, base, HRTIMER_MODE_ABS))
+		hrtimer_reprogram(sweeper, true);
+}
+
+static bool hrtimer_park_timer(struct hrtimer *timer,
+			       struct hrtimer_clock_base *base)
+{
+	struct hrtimer_park *park;
+	u64 bn, now_bn;
+
+	if (!hrtimer_park_enabled)
+		return false;
+
+	/*
+	 * Only local timers are parked: the sweeper might have to be
+	 * armed earlier than the next event of a remote CPU.
+	 */
+	if (base->cpu_base != this_cpu_ptr(&hrtimer_bases))
+		return false;
+
+	park = hrtimer_park_of(base);
+	if (!park || timer == &park->sweeper)
+		return false;
+
+	bn = hrtimer_park_bucket(timer);
+	now_bn = (u64)base->get_time() >> HRTIMER_PARK_SHIFT;
+
+	if (!park->count)
+		park->next_bn = now_bn + 1;
+
+	/*
+	 * The bucket must not be due for sweeping within the next bucket
+	 * period and must not alias a bucket which is not yet swept.
+	 */
+	if (bn < now_bn + 2 || bn < park->next_bn ||
+	    bn - park->next_bn >= HRTIMER_PARK_SIZE)
+		return false;
+
+	hlist_add_head(&timer->park_node, &park->buckets[bn & HRTIMER_PARK_MASK]);
+	__set_bit(bn & HRTIMER_PARK_MASK, park->pending);
+	timer->is_parked = 1;
+	park->count++;
+
+	hrtimer_park_arm(park, base, bn);
+	return true;
+}
+
+static void hrtimer_unpark_timer(struct hrtimer *timer)
+{
+	struct hrtimer_park *park = hrtimer_park_of(timer->base);
+	unsigned long idx = hrtimer_park_bucket(timer) & HRTIMER_PARK_MASK;
+
+	hlist_del(&timer->park_node);
+	if (hlist_empty(&park->buckets[idx]))
+		__clear_bit(idx, park->pending);
+	timer->is_parked = 0;
+	park->count--;
+}
+
+/* Move all timers of bucket @idx into the timerqueue of @base */
+static void hrtimer_park_flush_bucket(struct hrtimer_park *park,
+				      struct hrtimer_clock_base *base,
+				      unsigned long idx)
+{
+	struct hlist_node *tmp;
+	struct hrtimer *timer;
+
+	/* The timerqueue might be empty while the sweeper callback runs */
+	base->cpu_base->active_bases |= 1 << base->index;
+
+	hlist_for_each_entry_safe(timer, tmp, &park->buckets[idx], park_node) {
+		hlist_del(&timer->park_node);
+		timer->is_parked = 0;
+		park->count--;
+		timerqueue_add(&base->active, &timer->node);
+	}
+	__clear_bit(idx, park->pending);
+}
+
+static enum hrtimer_restart hrtimer_park_sweep(struct hrtimer *sweeper)
+{
+	struct hrtimer_park *park = container_of(sweeper, struct hrtimer_park, sweeper);
+	struct hrtimer_clock_base *base = sweeper->base;
+	enum hrtimer_restart ret = HRTIMER_NORESTART;
+	unsigned long flags;
+	u64 limit;
+
+	raw_spin_lock_irqsave(&base->cpu_base->lock, flags);
+
+	/* Everything which starts within the next bucket period is due */
+	limit = ((u64)base->get_time() >> HRTIMER_PARK_SHIFT) + 1;
+	for (; park->count && park->next_bn <= limit; park->next_bn++)
+		hrtimer_park_flush_bucket(park, base, park->next_bn & HRTIMER_PARK_MASK);
+	park->next_bn = limit + 1;
+
+	if (park->count && !(sweeper->state & HRTIMER_STATE_ENQUEUED)) {
+		hrtimer_set_expires(sweeper, (ktime_t)((hrtimer_park_first(park) - 1)
+						       << HRTIMER_PARK_SHIFT));
+		ret = HRTIMER_RESTART;
+	}
+
+	raw_spin_unlock_irqrestore(&base->cpu_base->lock, flags);
+	return ret;
+}
+
+static void hrtimer_park_init(unsigned int cpu)
+{
+	struct hrtimer_cpu_base *cpu_base = &per_cpu(hrtimer_bases, cpu);
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct hrtimer_park *park = &per_cpu(hrtimer_parks[i], cpu);
+		int j;
+
+		hrtimer_setup(&park->sweeper, hrtimer_park_sweep, CLOCK_MONOTONIC,
+			      i ? HRTIMER_MODE_ABS_PINNED_SOFT : HRTIMER_MODE_ABS_PINNED_HARD);
+		/* hrtimer_setup() picked the base of the CPU it runs on */
+		park->sweeper.base = &cpu_base->clock_base[i ? HRTIMER_BASE_MONOTONIC_SOFT :
+								HRTIMER_BASE_MONOTONIC];
+		park->next_bn = 0;
+		park->count = 0;
+		bitmap_zero(park->pending, HRTIMER_PARK_SIZE);
+		for (j = 0; j < HRTIMER_PARK_SIZE; j++)
+			INIT_HLIST_HEAD(&park->buckets[j]);
+	}
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+ * Stop the sweeper and move all parked timers of @base back into its
+ * timerqueue so migrate_hrtimer_list() can hand them to the new CPU.
+ */
+static void hrtimer_park_drain(struct hrtimer_clock_base *base)
+{
+	struct hrtimer_park *park = hrtimer_park_of(base);
+	unsigned long idx;
+
+	if (!park)
+		return;
+
+	if (park->sweeper.state & HRTIMER_STATE_ENQUEUED) {
+		debug_deactivate(&park->sweeper);
+		__remove_hrtimer(&park->sweeper, base, HRTIMER_STATE_INACTIVE, 0);
+	}
+
+	for_each_set_bit(idx, park->pending, HRTIMER_PARK_SIZE)
+		hrtimer_park_flush_bucket(park, base, idx);
+}
+#endif
+
 /*
  * remove hrtimer, called with base lock held
  */
@@ -2293,6 +2569,7 @@ int hrtimers_prepare_cpu(unsigned int cpu)
 
 	cpu_base->cpu = cpu;
 	hrtimer_cpu_base_init_expiry_lock(cpu_base);
+	hrtimer_park_init(cpu);
 	return 0;
 }
 
@@ -2360,6 +2637,7 @@ int hrtimers_cpu_dying(unsigned int dying_cpu)
 	raw_spin_lock_nested(&new_base->lock, SINGLE_DEPTH_NESTING);
 
 	for (i = 0; i < HRTIMER_MAX_CLOCK_BASES; i++) {
+		hrtimer_park_drain(&old_base->clock_base[i]);
 		migrate_hrtimer_list(&old_base->clock_base[i],
 				     &new_base->clock_base[i]);
 	}
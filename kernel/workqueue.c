@@ -243,6 +243,7 @@ enum pool_workqueue_stats {
 	PWQ_STAT_REPATRIATED,	/* unbound workers brought back into scope */
 	PWQ_STAT_MAYDAY,	/* maydays to rescuer */
 	PWQ_STAT_RESCUED,	/* linked work items executed by rescuer */
+	PWQ_STAT_STOLEN,	/* work items redirected here from a busy pod */
 
 	PWQ_NR_STATS,
 };
@@ -476,6 +477,20 @@ static bool wq_debug_force_rr_cpu = false;
 #endif
 module_param_named(debug_force_rr_cpu, wq_debug_force_rr_cpu, bool, 0644);
 
+/*
+ * An unbound work item queued to a pool which has no idle worker but pending
+ * work items may be redirected to the pool of a neighbouring pod which has an
+ * idle worker. wq_steal_distance bounds the locality cost as the maximum
+ * node_distance() between the two pods, e.g. LOCAL_DISTANCE to only steal
+ * between pods of the same node. Zero disables redirection.
+ * wq_steal_probes is the number of neighbouring pods looked at.
+ */
+static unsigned int wq_steal_distance;
+module_param_named(steal_distance, wq_steal_distance, uint, 0644);
+
+static unsigned int wq_steal_probes = 2;
+module_param_named(steal_probes, wq_steal_probes, uint, 0644);
+
 /* to raise softirq for the BH worker pools on other CPUs */
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct irq_work [NR_STD_WORKER_POOLS], bh_pool_irq_works);
 
@@ -2232,6 +2247,62 @@ static int wq_select_unbound_cpu(int cpu)
 	return new_cpu;
 }
 
+/**
+ * wq_steal_pwq - look for an idle neighbour of a busy unbound pwq
+ * @wq: the target unbound workqueue
+ * @pwq: pwq selected for @cpu
+ * @cpu: CPU @pwq was selected for
+ *
+ * If the pool of @pwq has pending work items and no idle worker, look at the
+ * pods following @cpu's pod in the pod type of @wq and return the pwq of the
+ * first one whose pool has an idle worker and whose node is within
+ * wq_steal_distance. Otherwise, return @pwq.
+ *
+ * All the tests are racy hints; the caller locks and validates the returned
+ * pwq as usual. The pod type tables are never freed once set up, so they can
+ * be read under RCU alone.
+ */
+static struct pool_workqueue *wq_steal_pwq(struct workqueue_struct *wq,
+					   struct pool_workqueue *pwq, int cpu)
+{
+	unsigned int distance = READ_ONCE(wq_steal_distance);
+	struct worker_pool *pool = pwq->pool;
+	const struct wq_pod_type *pt;
+	enum wq_affn_scope scope;
+	int pod, i;
+
+	if (data_race(pool->nr_idle) || list_empty_careful(&pool->worklist))
+		return pwq;
+
+	scope = READ_ONCE(wq->unbound_attrs->affn_scope);
+	if (scope == WQ_AFFN_DFL)
+		scope = READ_ONCE(wq_affn_dfl);
+	pt = &wq_pod_types[scope];
+	if (pt->nr_pods <= 1)
+		return pwq;
+
+	pod = pt->cpu_pod[cpu];
+	for (i = 0; i < min_t(int, wq_steal_probes, pt->nr_pods - 1); i++) {
+		struct pool_workqueue *cand;
+		int cand_cpu;
+
+		if (++pod >= pt->nr_pods)
+			pod = 0;
+		if (node_distance(pt->pod_node[pt->cpu_pod[cpu]],
+				  pt->pod_node[pod]) > distance)
+			continue;
+
+		cand_cpu = cpumask_first_and(pt->pod_cpus[pod], cpu_online_mask);
+		if (cand_cpu >= nr_cpu_ids)
+			continue;
+
+		cand = rcu_dereference(*per_cpu_ptr(wq->cpu_pwq, cand_cpu));
+		if (cand->pool != pool && data_race(cand->pool->nr_idle))
+			return cand;
+	}
+	return pwq;
+}
+
 static void __queue_work(int cpu, struct workqueue_struct *wq,
 			 struct work_struct *work)
 {
@@ -2239,6 +2310,7 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 	struct worker_pool *last_pool, *pool;
 	unsigned int work_flags;
 	unsigned int req_cpu = cpu;
+	bool stolen;
 
 	/*
 	 * While a work item is PENDING && off queue, a task trying to
@@ -2267,6 +2339,17 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 	}
 
 	pwq = rcu_dereference(*per_cpu_ptr(wq->cpu_pwq, cpu));
+
+	/* spread bursts on an unbound wq over idle neighbouring pods */
+	stolen = false;
+	if (unlikely(READ_ONCE(wq_steal_distance)) &&
+	    req_cpu == WORK_CPU_UNBOUND &&
+	    (wq->flags & (WQ_UNBOUND | __WQ_ORDERED)) == WQ_UNBOUND) {
+		struct pool_workqueue *alt = wq_steal_pwq(wq, pwq, cpu);
+
+		stolen = alt != pwq;
+		pwq = alt;
+	}
 	pool = pwq->pool;
 
 	/*
@@ -2289,6 +2372,7 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 		if (worker && worker->current_pwq->wq == wq) {
 			pwq = worker->current_pwq;
 			pool = pwq->pool;
+			stolen = false;
 			WARN_ON_ONCE(pool != last_pool);
 		} else {
 			/* meh... not running there, queue here */
@@ -2325,6 +2409,8 @@ static void __queue_work(int cpu, struct workqueue_struct *wq,
 
 	pwq->nr_in_flight[pwq->work_color]++;
 	work_flags = work_color_to_flags(pwq->work_color);
+	if (stolen)
+		pwq->stats[PWQ_STAT_STOLEN]++;
 
 	/*
 	 * Limit the number of concurrently active work items to max_active.
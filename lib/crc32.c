@@ -31,6 +31,7 @@
 #include <linux/module.h>
 #include <linux/types.h>
 #include <linux/sched.h>
+#include <linux/unaligned.h>
 #include "crc32defs.h"
 
 #if CRC_LE_BITS > 8
@@ -132,6 +133,82 @@ crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
 }
 #endif
 
+#if CRC_LE_BITS == 64 && defined(__LITTLE_ENDIAN)
+/*
+ * Slicing-by-8 is bound by the latency of the table lookups feeding each
+ * step of a single CRC.  Running several independent streams in lockstep
+ * keeps more lookups in flight.  Only done for the little-endian table
+ * layout, which is where the generic code is used in practice.
+ */
+# define CRC32_STREAMS	4
+/* Shortest buffer worth splitting into CRC32_STREAMS stripes */
+# define CRC32_FOLD_MIN	1024
+
+static u32 __attribute_const__ gf2_multiply(u32 x, u32 y, u32 modulus);
+static u32 __attribute_const__ crc32_generic_shift(u32 crc, size_t len,
+						   u32 polynomial);
+
+static void crc32_le_streams(u32 *crcp, const u8 *const *bufs, size_t len,
+			     const u32 (*tab)[256])
+{
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+	u32 crcs[CRC32_STREAMS], q, r;
+	size_t i;
+	int s;
+
+	for (s = 0; s < CRC32_STREAMS; s++)
+		crcs[s] = crcp[s];
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		for (s = 0; s < CRC32_STREAMS; s++) {
+			q = crcs[s] ^ get_unaligned_le32(bufs[s] + i);
+			r = get_unaligned_le32(bufs[s] + i + 4);
+			crcs[s] = t7[q & 255] ^ t6[(q >> 8) & 255] ^
+				  t5[(q >> 16) & 255] ^ t4[q >> 24] ^
+				  t3[r & 255] ^ t2[(r >> 8) & 255] ^
+				  t1[(r >> 16) & 255] ^ t0[r >> 24];
+		}
+	}
+	for (; i < len; i++)
+		for (s = 0; s < CRC32_STREAMS; s++)
+			crcs[s] = t0[(crcs[s] ^ bufs[s][i]) & 255] ^ (crcs[s] >> 8);
+
+	for (s = 0; s < CRC32_STREAMS; s++)
+		crcp[s] = crcs[s];
+}
+
+/*
+ * Checksum a large buffer as CRC32_STREAMS interleaved stripes, the first
+ * one seeded with @crc and the others with 0, and fold the partial CRCs
+ * back together.  Multiplying a CRC by x^(8 * stripe length) modulo the
+ * polynomial has the same effect as running it over that many zero bytes,
+ * after which it only needs to be xored with the CRC of the next stripe.
+ */
+static u32 __pure crc32_le_fold(u32 crc, unsigned char const *p, size_t len,
+				const u32 (*tab)[256], u32 polynomial)
+{
+	size_t stripe = (len / CRC32_STREAMS) & ~(size_t)7;
+	u32 crcs[CRC32_STREAMS] = { crc };
+	const u8 *bufs[CRC32_STREAMS];
+	u32 power;
+	int s;
+
+	for (s = 0; s < CRC32_STREAMS; s++)
+		bufs[s] = p + s * stripe;
+	crc32_le_streams(crcs, bufs, stripe, tab);
+
+	/* x^(8 * stripe); the lsbit is the x^31 coefficient, see below */
+	power = crc32_generic_shift(0x80000000, stripe, polynomial);
+	crc = crcs[0];
+	for (s = 1; s < CRC32_STREAMS; s++)
+		crc = gf2_multiply(crc, power, polynomial) ^ crcs[s];
+
+	return crc32_body(crc, p + CRC32_STREAMS * stripe,
+			  len - CRC32_STREAMS * stripe, tab);
+}
+#endif
+
 
 /**
  * crc32_le_generic() - Calculate bitwise little-endian Ethernet AUTODIN II
@@ -175,6 +252,10 @@ static inline u32 __pure crc32_le_generic(u32 crc, unsigned char const *p,
 		crc = (crc >> 8) ^ tab[0][crc & 255];
 	}
 # else
+#  ifdef CRC32_STREAMS
+	if (len >= CRC32_FOLD_MIN)
+		return crc32_le_fold(crc, p, len, tab, polynomial);
+#  endif
 	crc = (__force u32) __cpu_to_le32(crc);
 	crc = crc32_body(crc, p, len, tab);
 	crc = __le32_to_cpu((__force __le32)crc);
@@ -208,6 +289,68 @@ u32 __pure crc32_le_base(u32, unsigned char const *, size_t) __alias(crc32_le);
 u32 __pure __crc32c_le_base(u32, unsigned char const *, size_t) __alias(__crc32c_le);
 u32 __pure crc32_be_base(u32, unsigned char const *, size_t) __alias(crc32_be);
 
+static void crc32_le_multi_generic(u32 *crcs, const u8 *const *bufs,
+				   size_t len, unsigned int nr,
+				   u32 (*crc_fn)(u32, unsigned char const *, size_t),
+				   u32 (*base_fn)(u32, unsigned char const *, size_t),
+				   const u32 (*tab)[256])
+{
+	unsigned int i = 0;
+
+#ifdef CRC32_STREAMS
+	/* An architecture override beats interleaving the generic tables */
+	if (crc_fn == base_fn) {
+		for (; i + CRC32_STREAMS <= nr; i += CRC32_STREAMS)
+			crc32_le_streams(crcs + i, bufs + i, len, tab);
+	}
+#endif
+	for (; i < nr; i++)
+		crcs[i] = crc_fn(crcs[i], bufs[i], len);
+}
+
+/**
+ * crc32_le_multi() - Calculate crc32_le() over several buffers at once
+ * @crcs: array of @nr seeds, replaced with the resulting CRCs
+ * @bufs: array of @nr buffers
+ * @len: length of each buffer
+ * @nr: number of buffers
+ *
+ * Equivalent to calling crc32_le() on each buffer in turn, but the generic
+ * implementation interleaves the buffers to make better use of the CPU.
+ */
+void crc32_le_multi(u32 *crcs, const u8 *const *bufs, size_t len,
+		    unsigned int nr)
+{
+	crc32_le_multi_generic(crcs, bufs, len, nr, crc32_le, crc32_le_base,
+#if CRC_LE_BITS == 1
+			       NULL);
+#else
+			       crc32table_le);
+#endif
+}
+EXPORT_SYMBOL(crc32_le_multi);
+
+/**
+ * __crc32c_le_multi() - Calculate __crc32c_le() over several buffers at once
+ * @crcs: array of @nr seeds, replaced with the resulting CRCs
+ * @bufs: array of @nr buffers
+ * @len: length of each buffer
+ * @nr: number of buffers
+ *
+ * See crc32_le_multi().
+ */
+void __crc32c_le_multi(u32 *crcs, const u8 *const *bufs, size_t len,
+		       unsigned int nr)
+{
+	crc32_le_multi_generic(crcs, bufs, len, nr, __crc32c_le, __crc32c_le_base,
+#if CRC_LE_BITS == 1
+			       NULL);
+#else
+			       crc32ctable_le);
+#endif
+}
+EXPORT_SYMBOL(__crc32c_le_multi);
+
 /*
  * This multiplies the polynomials x and y modulo the given modulus.
  * This follows the "little-endian" CRC convention that the lsbit
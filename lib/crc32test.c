@@ -829,6 +829,78 @@ static int __init crc32_combine_test(void)
 	return 0;
 }
 
+#define CRC32_MULTI_BUFS	8
+#define CRC32_MULTI_LEN		(sizeof(test_buf) / CRC32_MULTI_BUFS)
+#define CRC32_MULTI_LOOPS	1000
+
+static int __init crc32_multi_test(void)
+{
+	const u8 *bufs[CRC32_MULTI_BUFS];
+	u32 crcs[CRC32_MULTI_BUFS], crc, crcc;
+	u64 nsec, nsec_multi;
+	unsigned long flags;
+	int i, j, errors = 0;
+
+	for (i = 0; i < CRC32_MULTI_BUFS; i++)
+		bufs[i] = test_buf + i * CRC32_MULTI_LEN;
+
+	/* The whole buffer is long enough to be folded from stripes */
+	crc = crc32_le(~0, bufs[0], CRC32_MULTI_LEN);
+	crcc = __crc32c_le(~0, bufs[0], CRC32_MULTI_LEN);
+	for (i = 1; i < CRC32_MULTI_BUFS; i++) {
+		crc = crc32_le_combine(crc, crc32_le(0, bufs[i],
+				       CRC32_MULTI_LEN), CRC32_MULTI_LEN);
+		crcc = __crc32c_le_combine(crcc, __crc32c_le(0, bufs[i],
+					   CRC32_MULTI_LEN), CRC32_MULTI_LEN);
+	}
+	if (crc != crc32_le(~0, test_buf, sizeof(test_buf)))
+		errors++;
+	if (crcc != __crc32c_le(~0, test_buf, sizeof(test_buf)))
+		errors++;
+
+	for (i = 0; i < CRC32_MULTI_BUFS; i++)
+		crcs[i] = i;
+	crc32_le_multi(crcs, bufs, CRC32_MULTI_LEN, CRC32_MULTI_BUFS);
+	for (i = 0; i < CRC32_MULTI_BUFS; i++) {
+		if (crcs[i] != crc32_le(i, bufs[i], CRC32_MULTI_LEN))
+			errors++;
+		crcs[i] = i;
+	}
+	/* An odd count and length take the leftover paths as well */
+	__crc32c_le_multi(crcs, bufs, CRC32_MULTI_LEN - 3, CRC32_MULTI_BUFS - 1);
+	for (i = 0; i < CRC32_MULTI_BUFS - 1; i++) {
+		if (crcs[i] != __crc32c_le(i, bufs[i], CRC32_MULTI_LEN - 3))
+			errors++;
+	}
+
+	/* reduce OS noise */
+	local_irq_save(flags);
+
+	nsec = ktime_get_ns();
+	for (j = 0; j < CRC32_MULTI_LOOPS; j++) {
+		for (i = 0; i < CRC32_MULTI_BUFS; i++)
+			crcs[i] = __crc32c_le(crcs[i], bufs[i], CRC32_MULTI_LEN);
+	}
+	nsec = ktime_get_ns() - nsec;
+
+	nsec_multi = ktime_get_ns();
+	for (j = 0; j < CRC32_MULTI_LOOPS; j++)
+		__crc32c_le_multi(crcs, bufs, CRC32_MULTI_LEN, CRC32_MULTI_BUFS);
+	nsec_multi = ktime_get_ns() - nsec_multi;
+
+	local_irq_restore(flags);
+
+	if (errors)
+		pr_warn("crc32_multi: %d self tests failed\n", errors);
+	else {
+		pr_info("crc32_multi: self tests passed, %d x %zu byte crc32c in %lld nsec one at a time, %lld nsec at once\n",
+			CRC32_MULTI_BUFS * CRC32_MULTI_LOOPS, CRC32_MULTI_LEN,
+			nsec, nsec_multi);
+	}
+
+	return 0;
+}
+
 static int __init crc32test_init(void)
 {
 	crc32_test();
@@ -837,6 +909,8 @@ static int __init crc32test_init(void)
 	crc32_combine_test();
 	crc32c_combine_test();
 
+	crc32_multi_test();
+
 	return 0;
 }
 
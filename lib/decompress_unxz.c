@@ -247,6 +247,190 @@ void *memmove(void *dest, const void *src, size_t size)
 /* Size of the input and output buffers in multi-call mode */
 #define XZ_IOBUF_SIZE 4096
 
+/* Report the result of decoding like the other decompressors do */
+static int INIT unxz_result(enum xz_ret ret, void (*error)(char *x))
+{
+	switch (ret) {
+	case XZ_STREAM_END:
+		return 0;
+
+	case XZ_MEM_ERROR:
+		/* This can occur only in multi-call or parallel mode. */
+		error("XZ decompressor ran out of memory");
+		break;
+
+	case XZ_FORMAT_ERROR:
+		error("Input is not in the XZ format (wrong magic bytes)");
+		break;
+
+	case XZ_OPTIONS_ERROR:
+		error("Input was encoded with settings that are not "
+				"supported by this XZ decoder");
+		break;
+
+	case XZ_DATA_ERROR:
+	case XZ_BUF_ERROR:
+		error("XZ-compressed data is corrupt");
+		break;
+
+	default:
+		error("Bug in the XZ decompressor");
+		break;
+	}
+
+	return -1;
+}
+
+#if !defined(XZ_PREBOOT) && defined(CONFIG_XZ_DEC_MT)
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/mm.h>
+#include <linux/workqueue.h>
+
+/*
+ * Streams written by xz -T consist of independent Blocks. When the whole
+ * input is in memory and the output goes to flush(), which is how initramfs
+ * is unpacked, those are decoded by unbound workers into buffers of their
+ * own, and the calling thread passes the buffers to flush() in order.
+ * flush() thus sees the same data, from the same thread, as it would with
+ * sequential decoding.
+ */
+struct unxz_block {
+	struct work_struct work;
+	struct completion done;
+	const struct xz_block *block;
+	const uint8_t *in;
+	uint8_t *out;
+	enum xz_ret ret;
+};
+
+static void INIT unxz_block_work(struct work_struct *work)
+{
+	struct unxz_block *w = container_of(work, struct unxz_block, work);
+	struct xz_buf b = {
+		.in = w->in + w->block->in_pos,
+		.in_size = w->block->in_size,
+		.out = w->out,
+		.out_size = w->block->out_size,
+	};
+	struct xz_dec *s;
+
+	s = xz_dec_init(XZ_SINGLE, 0);
+	w->ret = s != NULL ? xz_dec_block_run(s, w->block, &b) : XZ_MEM_ERROR;
+	xz_dec_end(s);
+
+	complete(&w->done);
+}
+
+/*
+ * Decode a multi-block Stream in parallel. Returns XZ_OK without consuming
+ * any input if the Stream has to be decoded sequentially instead: it has
+ * only one Block, some Block Header lacks the sizes, a Block is too big to
+ * be buffered, the first buffer can't be allocated, or the headers are
+ * corrupt, in which case the sequential decoder reports the error.
+ */
+static enum xz_ret INIT unxz_mt(unsigned char *in, long in_size,
+				long (*flush)(void *src, unsigned long size),
+				long *in_used)
+{
+	struct xz_buf b = { .in = in, .in_size = in_size };
+	size_t nr = 0, next = 0, done = 0, window, i;
+	unsigned long limit, queued = 0;
+	struct unxz_block *work = NULL;
+	struct xz_block *blocks = NULL;
+	struct unxz_block *w;
+	enum xz_ret ret = XZ_OK;
+	struct xz_dec *s;
+
+	if (num_online_cpus() < 2)
+		return XZ_OK;
+
+	s = xz_dec_init(XZ_SINGLE, 0);
+	if (s == NULL)
+		return XZ_OK;
+
+	/* Count the Blocks first; most Streams have only one. */
+	if (xz_dec_scan(s, &b, NULL, &nr) != XZ_STREAM_END || nr < 2)
+		goto out;
+
+	blocks = kvmalloc_array(nr, sizeof(*blocks), GFP_KERNEL);
+	work = kvcalloc(nr, sizeof(*work), GFP_KERNEL);
+	b.in_pos = 0;
+	if (blocks == NULL || work == NULL
+			|| xz_dec_scan(s, &b, blocks, &nr) != XZ_STREAM_END)
+		goto out;
+
+	/*
+	 * One Block per CPU plus the one being flushed, but don't hold more
+	 * than 1/16 of RAM in decoded Blocks. The sequential decoder needs no
+	 * output buffer, so leave any Stream with a bigger Block to it.
+	 */
+	window = num_online_cpus() + 1;
+	limit = min_t(u64, (u64)totalram_pages() << (PAGE_SHIFT - 4),
+		      ULONG_MAX);
+	for (i = 0; i < nr; i++)
+		if (blocks[i].out_size > limit)
+			goto out;
+
+	ret = XZ_STREAM_END;
+	while (done < nr) {
+		while (ret == XZ_STREAM_END && next < nr
+				&& next - done < window
+				&& blocks[next].out_size <= limit - queued) {
+			w = &work[next];
+			w->out = large_malloc(max_t(size_t,
+						    blocks[next].out_size, 1));
+			if (w->out == NULL) {
+				/* Nothing was flushed yet, decode sequentially */
+				if (next == 0) {
+					ret = XZ_OK;
+					goto out;
+				}
+				if (next == done)
+					ret = XZ_MEM_ERROR;
+				break;
+			}
+
+			w->block = &blocks[next];
+			w->in = in;
+			init_completion(&w->done);
+			INIT_WORK(&w->work, unxz_block_work);
+			queue_work(system_unbound_wq, &w->work);
+
+			queued += blocks[next].out_size;
+			++next;
+		}
+
+		/* Nothing left to wait for after an error */
+		if (done == next)
+			break;
+
+		w = &work[done];
+		wait_for_completion(&w->done);
+
+		if (ret == XZ_STREAM_END)
+			ret = w->ret;
+
+		if (ret == XZ_STREAM_END && flush(w->out, w->block->out_size)
+				!= (long)w->block->out_size)
+			ret = XZ_BUF_ERROR;
+
+		large_free(w->out);
+		queued -= w->block->out_size;
+		++done;
+	}
+
+	if (in_used != NULL)
+		*in_used = b.in_pos;
+
+out:
+	kvfree(work);
+	kvfree(blocks);
+	xz_dec_end(s);
+	return ret;
+}
+#endif
+
 /*
  * This function implements the API defined in <linux/decompress/generic.h>.
  *
@@ -273,6 +457,14 @@ STATIC int INIT unxz(unsigned char *in, long in_size,
 	if (in_used != NULL)
 		*in_used = 0;
 
+#if !defined(XZ_PREBOOT) && defined(CONFIG_XZ_DEC_MT)
+	if (in != NULL && fill == NULL && flush != NULL) {
+		ret = unxz_mt(in, in_size, flush, in_used);
+		if (ret != XZ_OK)
+			return unxz_result(ret, error);
+	}
+#endif
+
 	if (fill == NULL && flush == NULL)
 		s = xz_dec_init(XZ_SINGLE, 0);
 	else
@@ -355,35 +547,7 @@ STATIC int INIT unxz(unsigned char *in, long in_size,
 
 	xz_dec_end(s);
 
-	switch (ret) {
-	case XZ_STREAM_END:
-		return 0;
-
-	case XZ_MEM_ERROR:
-		/* This can occur only in multi-call mode. */
-		error("XZ decompressor ran out of memory");
-		break;
-
-	case XZ_FORMAT_ERROR:
-		error("Input is not in the XZ format (wrong magic bytes)");
-		break;
-
-	case XZ_OPTIONS_ERROR:
-		error("Input was encoded with settings that are not "
-				"supported by this XZ decoder");
-		break;
-
-	case XZ_DATA_ERROR:
-	case XZ_BUF_ERROR:
-		error("XZ-compressed data is corrupt");
-		break;
-
-	default:
-		error("Bug in the XZ decompressor");
-		break;
-	}
-
-	return -1;
+	return unxz_result(ret, error);
 
 error_alloc_in:
 	if (flush != NULL)
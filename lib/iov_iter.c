@@ -10,6 +10,7 @@
 #include <linux/splice.h>
 #include <linux/compat.h>
 #include <linux/scatterlist.h>
+#include <linux/sysctl.h>
 #include <linux/instrumented.h>
 #include <linux/iov_iter.h>
 
@@ -27,6 +28,20 @@ size_t copy_to_user_iter(void __user *iter_to, size_t progress,
 	return len;
 }
 
+static __always_inline
+size_t copy_to_user_iter_uncached(void __user *iter_to, size_t progress,
+				  size_t len, void *from, void *priv2)
+{
+	if (should_fail_usercopy())
+		return len;
+	if (access_ok(iter_to, len)) {
+		from += progress;
+		instrument_copy_to_user(iter_to, from, len);
+		len = __copy_to_user_inatomic_nocache(iter_to, from, len);
+	}
+	return len;
+}
+
 static __always_inline
 size_t copy_to_user_iter_nofault(void __user *iter_to, size_t progress,
 				 size_t len, void *from, void *priv2)
@@ -58,6 +73,23 @@ size_t copy_from_user_iter(void __user *iter_from, size_t progress,
 	return res;
 }
 
+static __always_inline
+size_t copy_from_user_iter_uncached(void __user *iter_from, size_t progress,
+				    size_t len, void *to, void *priv2)
+{
+	size_t res = len;
+
+	if (should_fail_usercopy())
+		return len;
+	if (access_ok(iter_from, len)) {
+		to += progress;
+		instrument_copy_from_user_before(to, iter_from, len);
+		res = __copy_from_user_inatomic_nocache(to, iter_from, len);
+		instrument_copy_from_user_after(to, iter_from, len, res);
+	}
+	return res;
+}
+
 static __always_inline
 size_t memcpy_to_iter(void *iter_to, size_t progress,
 		      size_t len, void *from, void *priv2)
@@ -74,6 +106,53 @@ size_t memcpy_from_iter(void *iter_from, size_t progress,
 	return 0;
 }
 
+/*
+ * User copies are done with non-temporal stores, where the architecture
+ * has them, when the iterator was marked with iov_iter_set_nocache() or
+ * when at least this many bytes are left in it. Streaming multi-megabyte
+ * reads and writes then don't wipe out the last level cache. 0 disables
+ * the size based selection.
+ */
+static unsigned long iov_iter_nocache_threshold __read_mostly;
+
+/*
+ * Whether a transfer of @size bytes is large enough for uncached copies.
+ * Also lets callers decide whether to set the iov_iter_set_nocache() hint.
+ */
+bool iov_iter_nocache_size(size_t size)
+{
+	unsigned long threshold = READ_ONCE(iov_iter_nocache_threshold);
+
+	return threshold && size >= threshold;
+}
+EXPORT_SYMBOL(iov_iter_nocache_size);
+
+static __always_inline bool iov_iter_use_nocache(const struct iov_iter *i)
+{
+	if (!user_backed_iter(i))
+		return false;
+	return i->nocache || iov_iter_nocache_size(iov_iter_count(i));
+}
+
+#ifdef CONFIG_SYSCTL
+static struct ctl_table iov_iter_sysctls[] = {
+	{
+		.procname	= "iov_iter_nocache_threshold",
+		.data		= &iov_iter_nocache_threshold,
+		.maxlen		= sizeof(iov_iter_nocache_threshold),
+		.mode		= 0644,
+		.proc_handler	= proc_doulongvec_minmax,
+	},
+};
+
+static int __init iov_iter_sysctl_init(void)
+{
+	register_sysctl_init("vm", iov_iter_sysctls);
+	return 0;
+}
+subsys_initcall(iov_iter_sysctl_init);
+#endif /* CONFIG_SYSCTL */
+
 /*
  * fault_in_iov_iter_readable - fault in iov iterator for reading
  * @i: iterator
@@ -182,6 +261,10 @@ size_t _copy_to_iter(const void *addr, size_t bytes, struct iov_iter *i)
 		return 0;
 	if (user_backed_iter(i))
 		might_fault();
+	if (iov_iter_use_nocache(i))
+		return iterate_and_advance(i, bytes, (void *)addr,
+					   copy_to_user_iter_uncached,
+					   memcpy_to_iter);
 	return iterate_and_advance(i, bytes, (void *)addr,
 				   copy_to_user_iter, memcpy_to_iter);
 }
@@ -246,6 +329,10 @@ EXPORT_SYMBOL_GPL(_copy_mc_to_iter);
 static __always_inline
 size_t __copy_from_iter(void *addr, size_t bytes, struct iov_iter *i)
 {
+	if (iov_iter_use_nocache(i))
+		return iterate_and_advance(i, bytes, addr,
+					   copy_from_user_iter_uncached,
+					   memcpy_from_iter);
 	return iterate_and_advance(i, bytes, addr,
 				   copy_from_user_iter, memcpy_from_iter);
 }
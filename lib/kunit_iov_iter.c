@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0-only
-/* I/O iterator tests.  This can only test kernel-backed iterator types.
+/* I/O iterator tests.  This can only test kernel-backed iterator types,
+ * apart from the user copy benchmark which runs against a KUnit mm.
  *
  * Copyright (C) 2023 Red Hat, Inc. All Rights Reserved.
  * Written by David Howells (dhowells@redhat.com)
@@ -10,6 +11,9 @@
 #include <linux/module.h>
 #include <linux/vmalloc.h>
 #include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/ktime.h>
+#include <linux/sizes.h>
 #include <linux/uio.h>
 #include <linux/bvec.h>
 #include <linux/folio_queue.h>
@@ -1012,6 +1016,69 @@ static void __init iov_kunit_extract_pages_xarray(struct kunit *test)
 	KUNIT_SUCCEED(test);
 }
 
+#define IOV_KUNIT_BENCH_SIZE	(8 * 1024 * 1024)
+#define IOV_KUNIT_BENCH_LOOPS	16
+#define IOV_KUNIT_BENCH_MB	((u64)IOV_KUNIT_BENCH_SIZE / SZ_1M * IOV_KUNIT_BENCH_LOOPS)
+
+/*
+ * Copy a buffer larger than most last level caches to and from a
+ * user-backed iterator with cached and with non-temporal stores, check the
+ * data arrived intact and report the throughput of each.
+ */
+static void __init iov_kunit_copy_user_nocache(struct kunit *test)
+{
+	struct page **spages, **bpages;
+	struct iov_iter iter;
+	unsigned long uaddr;
+	void __user *ubuf;
+	u64 start, to_ns, from_ns;
+	size_t npages, copied;
+	u8 *scratch, *buffer;
+	int i, loop, nc;
+
+	npages = IOV_KUNIT_BENCH_SIZE / PAGE_SIZE;
+	scratch = iov_kunit_create_buffer(test, &spages, npages);
+	buffer = iov_kunit_create_buffer(test, &bpages, npages);
+
+	uaddr = kunit_vm_mmap(test, NULL, 0, IOV_KUNIT_BENCH_SIZE,
+			      PROT_READ | PROT_WRITE,
+			      MAP_ANONYMOUS | MAP_PRIVATE, 0);
+	if (!uaddr || uaddr >= TASK_SIZE)
+		kunit_skip(test, "no user memory");
+	ubuf = (void __user *)uaddr;
+
+	for (i = 0; i < IOV_KUNIT_BENCH_SIZE; i++)
+		buffer[i] = pattern(i);
+
+	for (nc = 0; nc < 2; nc++) {
+		start = ktime_get_ns();
+		for (loop = 0; loop < IOV_KUNIT_BENCH_LOOPS; loop++) {
+			iov_iter_ubuf(&iter, ITER_DEST, ubuf, IOV_KUNIT_BENCH_SIZE);
+			iov_iter_set_nocache(&iter, nc);
+			copied = copy_to_iter(buffer, IOV_KUNIT_BENCH_SIZE, &iter);
+			KUNIT_ASSERT_EQ(test, copied, IOV_KUNIT_BENCH_SIZE);
+		}
+		to_ns = ktime_get_ns() - start;
+
+		memset(scratch, 0, IOV_KUNIT_BENCH_SIZE);
+		start = ktime_get_ns();
+		for (loop = 0; loop < IOV_KUNIT_BENCH_LOOPS; loop++) {
+			iov_iter_ubuf(&iter, ITER_SOURCE, ubuf, IOV_KUNIT_BENCH_SIZE);
+			iov_iter_set_nocache(&iter, nc);
+			copied = copy_from_iter(scratch, IOV_KUNIT_BENCH_SIZE, &iter);
+			KUNIT_ASSERT_EQ(test, copied, IOV_KUNIT_BENCH_SIZE);
+		}
+		from_ns = ktime_get_ns() - start;
+
+		KUNIT_EXPECT_EQ(test, memcmp(scratch, buffer, IOV_KUNIT_BENCH_SIZE), 0);
+
+		kunit_info(test, "%s: to user %llu MB/s, from user %llu MB/s\n",
+			   nc ? "non-temporal" : "cached",
+			   div64_u64(IOV_KUNIT_BENCH_MB * NSEC_PER_SEC, to_ns ?: 1),
+			   div64_u64(IOV_KUNIT_BENCH_MB * NSEC_PER_SEC, from_ns ?: 1));
+	}
+}
+
 static struct kunit_case __refdata iov_kunit_cases[] = {
 	KUNIT_CASE(iov_kunit_copy_to_kvec),
 	KUNIT_CASE(iov_kunit_copy_from_kvec),
@@ -1025,6 +1092,7 @@ static struct kunit_case __refdata iov_kunit_cases[] = {
 	KUNIT_CASE(iov_kunit_extract_pages_bvec),
 	KUNIT_CASE(iov_kunit_extract_pages_folioq),
 	KUNIT_CASE(iov_kunit_extract_pages_xarray),
+	KUNIT_CASE_SLOW(iov_kunit_copy_user_nocache),
 	{}
 };
 
@@ -936,5 +936,30 @@ int LZ4_compress_fast_continue(LZ4_stream_t *LZ4_stream, const char *source,
 }
 EXPORT_SYMBOL(LZ4_compress_fast_continue);
 
+int LZ4_initDict(LZ4_dict_t *dict, const char *dictionary, int dictSize)
+{
+	LZ4_resetStream(&dict->stream);
+	return LZ4_loadDict(&dict->stream, dictionary, dictSize);
+}
+EXPORT_SYMBOL(LZ4_initDict);
+
+int LZ4_compress_fast_dict(const LZ4_dict_t *dict, const char *source,
+	char *dest, int inputSize, int maxOutputSize, int acceleration,
+	void *wrkmem)
+{
+	LZ4_stream_t *stream = (LZ4_stream_t *)wrkmem;
+
+	/*
+	 * Compression updates the hash table, so work on a private copy.
+	 * Copying the table costs about as much as the reset that
+	 * LZ4_compress_fast() does anyway, far less than hashing the
+	 * dictionary again.
+	 */
+	memcpy(stream, &dict->stream, sizeof(*stream));
+	return LZ4_compress_fast_continue(stream, source, dest, inputSize,
+		maxOutputSize, acceleration);
+}
+EXPORT_SYMBOL(LZ4_compress_fast_dict);
+
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("LZ4 compressor");
@@ -705,6 +705,18 @@ int LZ4_decompress_fast_usingDict(const char *source, char *dest,
 		dictStart, dictSize);
 }
 
+int LZ4_decompress_safe_dict(const LZ4_dict_t *dict, const char *source,
+			     char *dest, int compressedSize, int maxOutputSize)
+{
+	const LZ4_stream_t_internal *d = &dict->stream.internal_donotuse;
+
+	if (d->dictSize == 0)
+		return LZ4_decompress_safe(source, dest,
+					   compressedSize, maxOutputSize);
+	return LZ4_decompress_safe_forceExtDict(source, dest,
+		compressedSize, maxOutputSize, d->dictionary, d->dictSize);
+}
+
 #ifndef STATIC
 EXPORT_SYMBOL(LZ4_decompress_safe);
 EXPORT_SYMBOL(LZ4_decompress_safe_partial);
@@ -714,6 +726,7 @@ EXPORT_SYMBOL(LZ4_decompress_safe_continue);
 EXPORT_SYMBOL(LZ4_decompress_fast_continue);
 EXPORT_SYMBOL(LZ4_decompress_safe_usingDict);
 EXPORT_SYMBOL(LZ4_decompress_fast_usingDict);
+EXPORT_SYMBOL(LZ4_decompress_safe_dict);
 
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("LZ4 decompressor");
@@ -0,0 +1,282 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests and benchmark for LZ4 shared dictionaries.
+ */
+
+#include <kunit/test.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/prandom.h>
+#include <linux/slab.h>
+
+#define LZ4_TEST_FRAGS		64
+#define LZ4_TEST_FRAG_MAX	192
+#define LZ4_TEST_DICT_SIZE	(LZ4_TEST_FRAGS * LZ4_TEST_FRAG_MAX)
+#define LZ4_TEST_PAGES		64
+#define LZ4_BENCH_LOOPS		64
+
+struct lz4_test_data {
+	char	*dict;
+	int	dict_size;
+	char	*pages;		/* LZ4_TEST_PAGES pages of input */
+	char	*comp;		/* one compressed page per input page */
+	int	*comp_len;
+	char	*out;
+	void	*wrkmem;
+};
+
+/*
+ * Pages are made of fragments that also appear in the dictionary, with a
+ * few bytes changed here and there, like slab pages full of similar
+ * objects. A single page repeats few of them, so most of the redundancy
+ * is only visible with the dictionary.
+ */
+static void lz4_test_make_data(struct lz4_test_data *d)
+{
+	static const char alnum[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+	int frag_len[LZ4_TEST_FRAGS];
+	char *frag[LZ4_TEST_FRAGS];
+	struct rnd_state rnd;
+	char *p = d->dict;
+	int i, j, len;
+
+	prandom_seed_state(&rnd, 42);
+
+	for (i = 0; i < LZ4_TEST_FRAGS; i++) {
+		frag[i] = p;
+		frag_len[i] = 64 + prandom_u32_state(&rnd) % (LZ4_TEST_FRAG_MAX - 64);
+		for (j = 0; j < frag_len[i]; j++)
+			p[j] = alnum[prandom_u32_state(&rnd) % (sizeof(alnum) - 1)];
+		p += frag_len[i];
+	}
+	d->dict_size = p - d->dict;
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		p = d->pages + i * PAGE_SIZE;
+		for (j = 0; j < PAGE_SIZE; j += len) {
+			int f = prandom_u32_state(&rnd) % LZ4_TEST_FRAGS;
+
+			len = min_t(int, frag_len[f], PAGE_SIZE - j);
+			memcpy(p + j, frag[f], len);
+			p[j + prandom_u32_state(&rnd) % len] ^= 0x20;
+		}
+	}
+}
+
+static struct lz4_test_data *lz4_test_alloc(struct kunit *test)
+{
+	struct lz4_test_data *d;
+
+	d = kunit_kzalloc(test, sizeof(*d), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, d);
+	d->dict = kunit_kmalloc(test, LZ4_TEST_DICT_SIZE, GFP_KERNEL);
+	d->pages = kunit_kmalloc(test, LZ4_TEST_PAGES * PAGE_SIZE, GFP_KERNEL);
+	d->comp = kunit_kmalloc(test, LZ4_TEST_PAGES * LZ4_COMPRESSBOUND(PAGE_SIZE),
+				GFP_KERNEL);
+	d->comp_len = kunit_kcalloc(test, LZ4_TEST_PAGES, sizeof(int), GFP_KERNEL);
+	d->out = kunit_kmalloc(test, PAGE_SIZE, GFP_KERNEL);
+	d->wrkmem = kunit_kmalloc(test, LZ4_MEM_COMPRESS, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, d->dict);
+	KUNIT_ASSERT_NOT_NULL(test, d->pages);
+	KUNIT_ASSERT_NOT_NULL(test, d->comp);
+	KUNIT_ASSERT_NOT_NULL(test, d->comp_len);
+	KUNIT_ASSERT_NOT_NULL(test, d->out);
+	KUNIT_ASSERT_NOT_NULL(test, d->wrkmem);
+
+	lz4_test_make_data(d);
+	return d;
+}
+
+static char *lz4_test_comp(struct lz4_test_data *d, int i)
+{
+	return d->comp + i * LZ4_COMPRESSBOUND(PAGE_SIZE);
+}
+
+static void lz4_test_dict_roundtrip(struct kunit *test)
+{
+	struct lz4_test_data *d = lz4_test_alloc(test);
+	LZ4_dict_t *dict, *copy;
+	int i, ret;
+
+	dict = kunit_kmalloc(test, sizeof(*dict), GFP_KERNEL);
+	copy = kunit_kmalloc(test, sizeof(*copy), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, dict);
+	KUNIT_ASSERT_NOT_NULL(test, copy);
+
+	KUNIT_ASSERT_EQ(test, LZ4_initDict(dict, d->dict, d->dict_size),
+			d->dict_size);
+	memcpy(copy, dict, sizeof(*dict));
+
+	for (i = 0; i < LZ4_TEST_PAGES; i++) {
+		char *page = d->pages + i * PAGE_SIZE;
+
+		ret = LZ4_compress_fast_dict(dict, page, lz4_test_comp(d, i),
+					     PAGE_SIZE, LZ4_COMPRESSBOUND(PAGE_SIZE),
+					     LZ4_ACCELERATION_DEFAULT, d->wrkmem);
+		KUNIT_ASSERT_GT(test, ret, 0);
+		d->comp_len[i] = ret;
+
+		memset(d->out, 0, PAGE_SIZE);
+		ret = LZ4_decompress_safe_dict(dict, lz4_test_comp(d, i), d->out,
+					       d->comp_len[i], PAGE_SIZE);
+		KUNIT_ASSERT_EQ(test, ret, PAGE_SIZE);
+		KUNIT_EXPECT_MEMEQ(test, d->out, page, PAGE_SIZE);
+
+		/* The format is plain LZ4 with an external dictionary */
+		memset(d->out, 0, PAGE_SIZE);
+		ret = LZ4_decompress_safe_usingDict(lz4_test_comp(d, i), d->out,
+						    d->comp_len[i], PAGE_SIZE,
+						    d->dict, d->dict_size);
+		KUNIT_ASSERT_EQ(test, ret, PAGE_SIZE);
+		KUNIT_EXPECT_MEMEQ(test, d->out, page, PAGE_SIZE);
+	}
+
+	/* Nothing may write to a shared dictionary */
+	KUNIT_EXPECT_MEMEQ(test, dict, copy, sizeof(*dict));
+
+	/* A truncated block must not decompress */
+	ret = LZ4_decompress_safe_dict(dict, lz4_test_comp(d, 0), d->out,
+				       d->comp_len[0] - 1, PAGE_SIZE);
+	KUNIT_EXPECT_LT(test, ret, 0);
+}
+
+static void lz4_test_dict_small(struct kunit *test)
+{
+	struct lz4_test_data *d = lz4_test_alloc(test);
+	LZ4_dict_t *dict;
+	int ret;
+
+	dict = kunit_kmalloc(test, sizeof(*dict), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, dict);
+
+	/* Too short to hash: compresses as if there was no dictionary */
+	KUNIT_EXPECT_EQ(test, LZ4_initDict(dict, d->dict, 2), 0);
+	ret = LZ4_compress_fast_dict(dict, d->pages, d->comp, PAGE_SIZE,
+				     LZ4_COMPRESSBOUND(PAGE_SIZE),
+				     LZ4_ACCELERATION_DEFAULT, d->wrkmem);
+	KUNIT_ASSERT_GT(test, ret, 0);
+	KUNIT_ASSERT_EQ(test, LZ4_decompress_safe(d->comp, d->out, ret, PAGE_SIZE),
+			PAGE_SIZE);
+	KUNIT_EXPECT_MEMEQ(test, d->out, d->pages, PAGE_SIZE);
+}
+
+enum lz4_bench_mode {
+	LZ4_BENCH_NODICT,
+	LZ4_BENCH_LOADDICT,	/* LZ4_loadDict() before every page */
+	LZ4_BENCH_SHARED,	/* LZ4_initDict() once */
+};
+
+static const char * const lz4_bench_names[] = {
+	[LZ4_BENCH_NODICT]	= "no dict",
+	[LZ4_BENCH_LOADDICT]	= "loadDict",
+	[LZ4_BENCH_SHARED]	= "shared dict",
+};
+
+static int lz4_bench_compress(struct lz4_test_data *d, LZ4_dict_t *dict,
+			      enum lz4_bench_mode mode, int i)
+{
+	char *page = d->pages + i * PAGE_SIZE;
+
+	switch (mode) {
+	case LZ4_BENCH_NODICT:
+		return LZ4_compress_fast(page, lz4_test_comp(d, i), PAGE_SIZE,
+					 LZ4_COMPRESSBOUND(PAGE_SIZE),
+					 LZ4_ACCELERATION_DEFAULT, d->wrkmem);
+	case LZ4_BENCH_LOADDICT:
+		LZ4_resetStream(d->wrkmem);
+		LZ4_loadDict(d->wrkmem, d->dict, d->dict_size);
+		return LZ4_compress_fast_continue(d->wrkmem, page,
+						  lz4_test_comp(d, i), PAGE_SIZE,
+						  LZ4_COMPRESSBOUND(PAGE_SIZE),
+						  LZ4_ACCELERATION_DEFAULT);
+	default:
+		return LZ4_compress_fast_dict(dict, page, lz4_test_comp(d, i),
+					      PAGE_SIZE, LZ4_COMPRESSBOUND(PAGE_SIZE),
+					      LZ4_ACCELERATION_DEFAULT, d->wrkmem);
+	}
+}
+
+static int lz4_bench_decompress(struct lz4_test_data *d, LZ4_dict_t *dict,
+				enum lz4_bench_mode mode, int i)
+{
+	switch (mode) {
+	case LZ4_BENCH_NODICT:
+		return LZ4_decompress_safe(lz4_test_comp(d, i), d->out,
+					   d->comp_len[i], PAGE_SIZE);
+	case LZ4_BENCH_LOADDICT:
+		return LZ4_decompress_safe_usingDict(lz4_test_comp(d, i), d->out,
+						     d->comp_len[i], PAGE_SIZE,
+						     d->dict, d->dict_size);
+	default:
+		return LZ4_decompress_safe_dict(dict, lz4_test_comp(d, i), d->out,
+						d->comp_len[i], PAGE_SIZE);
+	}
+}
+
+static u64 lz4_bench_mbps(u64 ns)
+{
+	return div64_u64((u64)LZ4_BENCH_LOOPS * LZ4_TEST_PAGES * PAGE_SIZE *
+			 NSEC_PER_SEC, (ns ?: 1) << 20);
+}
+
+static void lz4_bench(struct kunit *test)
+{
+	struct lz4_test_data *d = lz4_test_alloc(test);
+	u64 start, comp_ns, decomp_ns, total;
+	enum lz4_bench_mode mode;
+	LZ4_dict_t *dict;
+	int i, loop, ret;
+
+	dict = kunit_kmalloc(test, sizeof(*dict), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, dict);
+	LZ4_initDict(dict, d->dict, d->dict_size);
+
+	for (mode = LZ4_BENCH_NODICT; mode <= LZ4_BENCH_SHARED; mode++) {
+		total = 0;
+		start = ktime_get_ns();
+		for (loop = 0; loop < LZ4_BENCH_LOOPS; loop++) {
+			for (i = 0; i < LZ4_TEST_PAGES; i++) {
+				ret = lz4_bench_compress(d, dict, mode, i);
+				KUNIT_ASSERT_GT(test, ret, 0);
+				d->comp_len[i] = ret;
+			}
+			cond_resched();
+		}
+		comp_ns = ktime_get_ns() - start;
+
+		for (i = 0; i < LZ4_TEST_PAGES; i++)
+			total += d->comp_len[i];
+
+		start = ktime_get_ns();
+		for (loop = 0; loop < LZ4_BENCH_LOOPS; loop++) {
+			for (i = 0; i < LZ4_TEST_PAGES; i++) {
+				ret = lz4_bench_decompress(d, dict, mode, i);
+				KUNIT_ASSERT_EQ(test, ret, PAGE_SIZE);
+			}
+			cond_resched();
+		}
+		decomp_ns = ktime_get_ns() - start;
+
+		kunit_info(test, "%-11s: ratio %llu.%02llu, compress %llu MB/s, decompress %llu MB/s\n",
+			   lz4_bench_names[mode],
+			   div64_u64((u64)LZ4_TEST_PAGES * PAGE_SIZE, total),
+			   div64_u64((u64)LZ4_TEST_PAGES * PAGE_SIZE * 100, total) % 100,
+			   lz4_bench_mbps(comp_ns), lz4_bench_mbps(decomp_ns));
+	}
+}
+
+static struct kunit_case lz4_test_cases[] = {
+	KUNIT_CASE(lz4_test_dict_roundtrip),
+	KUNIT_CASE(lz4_test_dict_small),
+	KUNIT_CASE_SLOW(lz4_bench),
+	{}
+};
+
+static struct kunit_suite lz4_test_suite = {
+	.name = "lz4",
+	.test_cases = lz4_test_cases,
+};
+kunit_test_suite(lz4_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests and benchmark for LZ4 shared dictionaries");
+MODULE_LICENSE("GPL");
@@ -6375,6 +6375,142 @@ int mtree_store_range(struct maple_tree *mt, unsigned long index,
 }
 EXPORT_SYMBOL(mtree_store_range);
 
+/**
+ * mtree_bulk_load() - Build a tree from a sorted array of ranges.
+ * @mt: The maple tree, which must be empty and not in RCU mode
+ * @ranges: The ranges to store, sorted by index and not overlapping
+ * @nr: The number of elements in @ranges
+ *
+ * All nodes are allocated up front with the bulk allocator and the ranges are
+ * appended in bulk mode, which fills each node before starting the next one
+ * and only rebalances the final node (see mas_expected_entries()).  This avoids
+ * the repeated splits of storing the ranges one by one.  The tree must not be
+ * visible to readers until this returns.
+ *
+ * Context: Process context.  Takes and releases the mt_lock.  May sleep.
+ * Return: 0 on success, -EINVAL if @ranges is not sorted, overlaps or @mt is
+ * in RCU mode, -EEXIST if @mt is not empty, -ENOMEM if memory could not be
+ * allocated.
+ */
+int mtree_bulk_load(struct maple_tree *mt, const struct maple_range *ranges,
+		    unsigned long nr)
+{
+	MA_STATE(mas, mt, 0, 0);
+	unsigned long i;
+	int ret;
+
+	if (mt_in_rcu(mt))
+		return -EINVAL;
+
+	for (i = 0; i < nr; i++) {
+		if (WARN_ON_ONCE(xa_is_advanced(ranges[i].entry)))
+			return -EINVAL;
+		if (ranges[i].index > ranges[i].last)
+			return -EINVAL;
+		if (i && ranges[i].index <= ranges[i - 1].last)
+			return -EINVAL;
+	}
+
+	if (!nr)
+		return 0;
+
+	/* Allocates with GFP_KERNEL, so do it before taking the lock */
+	ret = mas_expected_entries(&mas, nr);
+	if (ret)
+		return ret;
+
+	mtree_lock(mt);
+	if (!mtree_empty(mt)) {
+		ret = -EEXIST;
+		goto out;
+	}
+
+	for (i = 0; i < nr; i++) {
+		mas_set_range(&mas, ranges[i].index, ranges[i].last);
+		mas_store(&mas, ranges[i].entry);
+		if (mas_is_err(&mas)) {
+			ret = xa_err(mas.node);
+			break;
+		}
+	}
+
+out:
+	mas_destroy(&mas);
+	mtree_unlock(mt);
+	return ret;
+}
+EXPORT_SYMBOL(mtree_bulk_load);
+
+/* Number of upcoming stores to allocate nodes for in mtree_bulk_store() */
+#define MAPLE_BULK_STORE_BATCH	16
+
+/**
+ * mtree_bulk_store() - Store a batch of ranges.
+ * @mt: The maple tree
+ * @ranges: The ranges to store
+ * @nr: The number of elements in @ranges
+ * @gfp: The GFP_FLAGS to use for allocations
+ *
+ * Equivalent to calling mtree_store_range() for each element of @ranges in
+ * order, so later ranges overwrite earlier ones.  The lock is taken once for
+ * the whole batch and nodes are preallocated for up to
+ * %MAPLE_BULK_STORE_BATCH stores at a time, and any left over are carried into
+ * the next store instead of being freed.
+ *
+ * Return: 0 on success, -EINVAL on an invalid range, -ENOMEM if memory could
+ * not be allocated.  On -ENOMEM the ranges before the failing one have been
+ * stored.
+ */
+int mtree_bulk_store(struct maple_tree *mt, const struct maple_range *ranges,
+		     unsigned long nr, gfp_t gfp)
+{
+	MA_STATE(mas, mt, 0, 0);
+	unsigned long i;
+	int ret = 0;
+
+	for (i = 0; i < nr; i++) {
+		if (WARN_ON_ONCE(xa_is_advanced(ranges[i].entry)))
+			return -EINVAL;
+		if (ranges[i].index > ranges[i].last)
+			return -EINVAL;
+	}
+
+	mtree_lock(mt);
+	for (i = 0; i < nr; i++) {
+		const struct maple_range *r = &ranges[i];
+		MA_WR_STATE(wr_mas, &mas, r->entry);
+		int request;
+
+		mas_set_range(&mas, r->index, r->last);
+		trace_ma_write(__func__, &mas, 0, r->entry);
+retry:
+		mas_wr_prealloc_setup(&wr_mas);
+		mas_wr_store_type(&wr_mas);
+		request = mas_prealloc_calc(&mas, r->entry);
+		if (request && mas_allocated(&mas) < request)
+			mas_node_count(&mas, request * (1 + min_t(unsigned long,
+					nr - i - 1, MAPLE_BULK_STORE_BATCH)));
+
+		if (unlikely(mas_nomem(&mas, gfp))) {
+			if (!r->entry)
+				__mas_set_range(&mas, r->index, r->last);
+			goto retry;
+		}
+
+		if (mas_is_err(&mas)) {
+			ret = xa_err(mas.node);
+			break;
+		}
+
+		mas_wr_store_entry(&wr_mas);
+	}
+
+	mas_destroy(&mas);
+	mtree_unlock(mt);
+	return ret;
+}
+EXPORT_SYMBOL(mtree_bulk_store);
+
 /**
  * mtree_store() - Store an entry at a given index.
  * @mt: The maple tree
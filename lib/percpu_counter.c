@@ -9,6 +9,7 @@
 #include <linux/cpu.h>
 #include <linux/module.h>
 #include <linux/debugobjects.h>
+#include <linux/topology.h>
 
 #ifdef CONFIG_HOTPLUG_CPU
 static LIST_HEAD(percpu_counters);
@@ -57,6 +58,193 @@ static inline void debug_percpu_counter_deactivate(struct percpu_counter *fbc)
 { }
 #endif	/* CONFIG_DEBUG_OBJECTS_PERCPU_COUNTER */
 
+/*
+ * Counters set up with percpu_counter_enable_llc() fold per-cpu overflow
+ * into a partial sum shared by the CPUs of one last level cache instead of
+ * into fbc->count. The partial sum lives in the percpu area of the first
+ * CPU of that cache ("leader"), and only when it reaches batch times the
+ * number of CPUs sharing the cache is it moved to fbc->count under the
+ * lock. Readers that need more than percpu_counter_read() can then add up
+ * one partial sum per cache instead of one count per CPU.
+ *
+ * Until the topology is known every CPU uses CPU 0 as its leader. Leaders
+ * are never removed from percpu_counter_llc_leaders, so partial sums left
+ * behind by a topology change are still accounted for.
+ *
+ * A fold moves a per-cpu count into a partial sum without fbc->lock, so an
+ * exact sum could see the amount in both places or in neither. Each partial
+ * sum therefore counts the folds that started and finished on it, and exact
+ * sums retry until no fold overlapped them, see percpu_counter_sum_locked().
+ */
+struct percpu_counter_llc {
+	atomic64_t	count;
+	atomic_t	started;
+	atomic_t	finished;
+};
+
+#ifdef CONFIG_SCHED_MC
+#define percpu_counter_llc_mask(cpu)	cpu_coregroup_mask(cpu)
+#else
+#define percpu_counter_llc_mask(cpu)	cpumask_of_node(cpu_to_node(cpu))
+#endif
+
+static DEFINE_PER_CPU_READ_MOSTLY(int, percpu_counter_llc_leader);
+static DEFINE_PER_CPU_READ_MOSTLY(unsigned int, percpu_counter_llc_weight) = 1;
+static struct cpumask percpu_counter_llc_leaders __read_mostly = {
+	CPU_BITS_CPU0
+};
+
+static void percpu_counter_update_llc(void)
+{
+	const struct cpumask *mask;
+	int cpu, leader;
+
+	for_each_online_cpu(cpu) {
+		mask = percpu_counter_llc_mask(cpu);
+		leader = cpumask_first(mask);
+		if (leader >= nr_cpu_ids)
+			leader = cpu;
+
+		/* Summers must see the leader before anybody folds into it */
+		cpumask_set_cpu(leader, &percpu_counter_llc_leaders);
+		smp_mb__after_atomic();
+		WRITE_ONCE(per_cpu(percpu_counter_llc_leader, cpu), leader);
+		WRITE_ONCE(per_cpu(percpu_counter_llc_weight, cpu),
+			   max(cpumask_weight(mask), 1U));
+	}
+}
+
+/*
+ * Move this CPU's count plus @amount into its LLC partial sum. Called with
+ * interrupts disabled.
+ */
+static void percpu_counter_fold_llc(struct percpu_counter *fbc, s64 amount,
+				    s32 batch)
+{
+	struct percpu_counter_llc *llc;
+	s64 count;
+
+	llc = per_cpu_ptr(fbc->llc_counts,
+			  __this_cpu_read(percpu_counter_llc_leader));
+
+	/* Pairs with the second smp_rmb() in percpu_counter_sum_locked() */
+	atomic_inc(&llc->started);
+	smp_mb__after_atomic();
+	count = __this_cpu_read(*fbc->counters);
+	__this_cpu_sub(*fbc->counters, count);
+	/* Fully ordered, pairs with the first smp_rmb() */
+	count = atomic64_add_return(count + amount, &llc->count);
+	atomic_inc(&llc->finished);
+
+	/* Outside the fold, so that exact summers holding the lock finish */
+	if (abs(count) >= (s64)batch * __this_cpu_read(percpu_counter_llc_weight)) {
+		raw_spin_lock(&fbc->lock);
+		fbc->count += atomic64_xchg(&llc->count, 0);
+		raw_spin_unlock(&fbc->lock);
+	}
+}
+
+static s64 percpu_counter_llc_sum(struct percpu_counter *fbc)
+{
+	s64 ret = 0;
+	int cpu;
+
+	for_each_cpu(cpu, &percpu_counter_llc_leaders)
+		ret += atomic64_read(&per_cpu_ptr(fbc->llc_counts, cpu)->count);
+	return ret;
+}
+
+static unsigned int percpu_counter_llc_folds(struct percpu_counter *fbc,
+					     bool finished)
+{
+	struct percpu_counter_llc *llc;
+	unsigned int ret = 0;
+	int cpu;
+
+	for_each_cpu(cpu, &percpu_counter_llc_leaders) {
+		llc = per_cpu_ptr(fbc->llc_counts, cpu);
+		ret += atomic_read(finished ? &llc->finished : &llc->started);
+	}
+	return ret;
+}
+
+/*
+ * Exact value of the counter. The lock keeps everything but folds into the
+ * LLC partial sums away; those are only short sections with interrupts
+ * disabled, so the retry converges.
+ */
+static s64 percpu_counter_sum_locked(struct percpu_counter *fbc)
+{
+	unsigned int folds = 0;
+	s64 ret;
+	int cpu;
+
+	lockdep_assert_held(&fbc->lock);
+retry:
+	if (fbc->llc_counts) {
+		folds = percpu_counter_llc_folds(fbc, true);
+		smp_rmb();
+	}
+	ret = fbc->count;
+	for_each_cpu_or(cpu, cpu_online_mask, cpu_dying_mask) {
+		s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
+		ret += *pcount;
+	}
+	if (fbc->llc_counts) {
+		ret += percpu_counter_llc_sum(fbc);
+		smp_rmb();
+		if (percpu_counter_llc_folds(fbc, false) != folds) {
+			cpu_relax();
+			goto retry;
+		}
+	}
+	return ret;
+}
+
+/**
+ * percpu_counter_enable_llc - aggregate a counter per last level cache
+ * @fbc: initialized counter
+ * @gfp: allocation flags
+ *
+ * Intended for counters that are updated on many CPUs and compared against
+ * a limit often, see percpu_counter_sum_approx(). The error of
+ * percpu_counter_read() doubles once this is enabled.
+ *
+ * Return: 0 on success, -ENOMEM if the partial sums could not be allocated.
+ */
+int percpu_counter_enable_llc(struct percpu_counter *fbc, gfp_t gfp)
+{
+	struct percpu_counter_llc __percpu *llc_counts;
+
+	if (fbc->llc_counts)
+		return 0;
+
+	llc_counts = alloc_percpu_gfp(struct percpu_counter_llc, gfp);
+	if (!llc_counts)
+		return -ENOMEM;
+
+	if (cmpxchg(&fbc->llc_counts, NULL, llc_counts))
+		free_percpu(llc_counts);
+	return 0;
+}
+EXPORT_SYMBOL(percpu_counter_enable_llc);
+
+/*
+ * Add up fbc->count and the LLC partial sums. Only the per-cpu counts are
+ * missing, so the result is within batch * num_online_cpus() of the exact
+ * value while touching one cache line per LLC. Without the LLC level this
+ * is percpu_counter_read().
+ */
+s64 percpu_counter_sum_approx(struct percpu_counter *fbc)
+{
+	s64 ret = READ_ONCE(fbc->count);
+
+	if (fbc->llc_counts)
+		ret += percpu_counter_llc_sum(fbc);
+	return ret;
+}
+EXPORT_SYMBOL(percpu_counter_sum_approx);
+
 void percpu_counter_set(struct percpu_counter *fbc, s64 amount)
 {
 	int cpu;
@@ -66,6 +254,8 @@ void percpu_counter_set(struct percpu_counter *fbc, s64 amount)
 	for_each_possible_cpu(cpu) {
 		s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
 		*pcount = 0;
+		if (fbc->llc_counts)
+			atomic64_set(&per_cpu_ptr(fbc->llc_counts, cpu)->count, 0);
 	}
 	fbc->count = amount;
 	raw_spin_unlock_irqrestore(&fbc->lock, flags);
@@ -98,6 +288,12 @@ void percpu_counter_add_batch(struct percpu_counter *fbc, s64 amount, s32 batch)
 	count = this_cpu_read(*fbc->counters);
 	do {
 		if (unlikely(abs(count + amount) >= batch)) {
+			if (fbc->llc_counts) {
+				local_irq_save(flags);
+				percpu_counter_fold_llc(fbc, amount, batch);
+				local_irq_restore(flags);
+				return;
+			}
 			raw_spin_lock_irqsave(&fbc->lock, flags);
 			/*
 			 * Note: by now we might have migrated to another CPU
@@ -124,7 +320,9 @@ void percpu_counter_add_batch(struct percpu_counter *fbc, s64 amount, s32 batch)
 
 	local_irq_save(flags);
 	count = __this_cpu_read(*fbc->counters) + amount;
-	if (abs(count) >= batch) {
+	if (abs(count) >= batch && fbc->llc_counts) {
+		percpu_counter_fold_llc(fbc, amount, batch);
+	} else if (abs(count) >= batch) {
 		raw_spin_lock(&fbc->lock);
 		fbc->count += count;
 		__this_cpu_sub(*fbc->counters, count - amount);
@@ -152,6 +350,9 @@ void percpu_counter_sync(struct percpu_counter *fbc)
 	count = __this_cpu_read(*fbc->counters);
 	fbc->count += count;
 	__this_cpu_sub(*fbc->counters, count);
+	if (fbc->llc_counts)
+		fbc->count += atomic64_xchg(&per_cpu_ptr(fbc->llc_counts,
+				__this_cpu_read(percpu_counter_llc_leader))->count, 0);
 	raw_spin_unlock_irqrestore(&fbc->lock, flags);
 }
 EXPORT_SYMBOL(percpu_counter_sync);
@@ -171,15 +372,10 @@ EXPORT_SYMBOL(percpu_counter_sync);
 s64 __percpu_counter_sum(struct percpu_counter *fbc)
 {
 	s64 ret;
-	int cpu;
 	unsigned long flags;
 
 	raw_spin_lock_irqsave(&fbc->lock, flags);
-	ret = fbc->count;
-	for_each_cpu_or(cpu, cpu_online_mask, cpu_dying_mask) {
-		s32 *pcount = per_cpu_ptr(fbc->counters, cpu);
-		ret += *pcount;
-	}
+	ret = percpu_counter_sum_locked(fbc);
 	raw_spin_unlock_irqrestore(&fbc->lock, flags);
 	return ret;
 }
@@ -210,6 +406,7 @@ int __percpu_counter_init_many(struct percpu_counter *fbc, s64 amount,
 #endif
 		fbc[i].count = amount;
 		fbc[i].counters = (void __percpu *)counters + i * counter_size;
+		fbc[i].llc_counts = NULL;
 
 		debug_percpu_counter_activate(&fbc[i]);
 	}
@@ -247,8 +444,11 @@ void percpu_counter_destroy_many(struct percpu_counter *fbc, u32 nr_counters)
 
 	free_percpu(fbc[0].counters);
 
-	for (i = 0; i < nr_counters; i++)
+	for (i = 0; i < nr_counters; i++) {
 		fbc[i].counters = NULL;
+		free_percpu(fbc[i].llc_counts);
+		fbc[i].llc_counts = NULL;
+	}
 }
 EXPORT_SYMBOL(percpu_counter_destroy_many);
 
@@ -260,6 +460,7 @@ static int compute_batch_value(unsigned int cpu)
 	int nr = num_online_cpus();
 
 	percpu_counter_batch = max(32, nr*2);
+	percpu_counter_update_llc();
 	return 0;
 }
 
@@ -291,16 +492,23 @@ static int percpu_counter_cpu_dead(unsigned int cpu)
  */
 int __percpu_counter_compare(struct percpu_counter *fbc, s64 rhs, s32 batch)
 {
-	s64	count;
+	s64	count, unknown;
 
 	count = percpu_counter_read(fbc);
+	unknown = (s64)batch * num_online_cpus();
 	/* Check to see if rough count will be sufficient for comparison */
-	if (abs(count - rhs) > (batch * num_online_cpus())) {
+	if (abs(count - rhs) > (fbc->llc_counts ? 2 * unknown : unknown)) {
 		if (count > rhs)
 			return 1;
 		else
 			return -1;
 	}
+	/* The LLC partial sums narrow it down to the per-cpu counts */
+	if (fbc->llc_counts) {
+		count = percpu_counter_sum_approx(fbc);
+		if (abs(count - rhs) > unknown)
+			return count > rhs ? 1 : -1;
+	}
 	/* Need to use precise count */
 	count = percpu_counter_sum(fbc);
 	if (count > rhs)
@@ -337,6 +545,9 @@ bool __percpu_counter_limited_add(struct percpu_counter *fbc,
 
 	local_irq_save(flags);
 	unknown = batch * num_online_cpus();
+	/* fbc->count also misses the LLC partial sums */
+	if (fbc->llc_counts)
+		unknown *= 2;
 	count = __this_cpu_read(*fbc->counters);
 
 	/* Skip taking the lock when safe */
@@ -364,14 +575,28 @@ bool __percpu_counter_limited_add(struct percpu_counter *fbc,
 			good = true;
 	}
 
-	if (!good) {
-		s32 *pcount;
-		int cpu;
-
-		for_each_cpu_or(cpu, cpu_online_mask, cpu_dying_mask) {
-			pcount = per_cpu_ptr(fbc->counters, cpu);
-			count += *pcount;
+	/*
+	 * Try the LLC partial sums before walking every CPU. A concurrent fold
+	 * only moves an amount that is part of the per-cpu error.
+	 */
+	if (!good && fbc->llc_counts) {
+		count += percpu_counter_llc_sum(fbc);
+		unknown /= 2;
+		if (amount > 0) {
+			if (count - unknown > limit)
+				goto out;
+			if (count + unknown <= limit)
+				good = true;
+		} else {
+			if (count + unknown < limit)
+				goto out;
+			if (count - unknown >= limit)
+				good = true;
 		}
+	}
+
+	if (!good) {
+		count = percpu_counter_sum_locked(fbc) + amount;
 		if (amount > 0) {
 			if (count > limit)
 				goto out;
@@ -1,5 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0-only
 #include <linux/module.h>
+#include <linux/ktime.h>
+#include <linux/percpu_counter.h>
+#include <linux/smp.h>
 
 /* validate @native and @pcp counter values match @expected */
 #define CHECK(native, pcp, expected)                                    \
@@ -17,6 +20,63 @@
 static DEFINE_PER_CPU(long, long_counter);
 static DEFINE_PER_CPU(unsigned long, ulong_counter);
 
+#define PCC_BENCH_LOOPS		10000
+
+static void percpu_counter_bench_add(void *info)
+{
+	struct percpu_counter *fbc = info;
+	int i;
+
+	/* Leave something behind in the per-cpu and LLC counts */
+	for (i = 0; i < 3 * percpu_counter_batch; i++)
+		percpu_counter_add(fbc, 1);
+}
+
+/*
+ * Time exact sums, approximate sums and limited adds close to the limit,
+ * with and without the per-LLC level.
+ */
+static void __init percpu_counter_bench(bool llc)
+{
+	struct percpu_counter fbc;
+	u64 t0, t1, t2, t3;
+	s64 sum = 0, approx = 0;
+	int i;
+
+	if (percpu_counter_init(&fbc, 0, GFP_KERNEL))
+		return;
+	if (llc && percpu_counter_enable_llc(&fbc, GFP_KERNEL))
+		goto out;
+
+	on_each_cpu(percpu_counter_bench_add, &fbc, 1);
+
+	t0 = ktime_get_ns();
+	for (i = 0; i < PCC_BENCH_LOOPS; i++)
+		sum = percpu_counter_sum(&fbc);
+	t1 = ktime_get_ns();
+	for (i = 0; i < PCC_BENCH_LOOPS; i++)
+		approx = percpu_counter_sum_approx(&fbc);
+	t2 = ktime_get_ns();
+	for (i = 0; i < PCC_BENCH_LOOPS; i++) {
+		if (percpu_counter_limited_add(&fbc, sum + 1, 1))
+			percpu_counter_sub(&fbc, 1);
+	}
+	t3 = ktime_get_ns();
+
+	WARN(sum != (s64)num_online_cpus() * 3 * percpu_counter_batch,
+	     "percpu_counter sum %lld != expected %lld", sum,
+	     (s64)num_online_cpus() * 3 * percpu_counter_batch);
+	WARN(abs(sum - approx) > (s64)percpu_counter_batch * num_online_cpus(),
+	     "percpu_counter approx %lld too far from sum %lld", approx, sum);
+
+	pr_info("percpu_counter%s: %u cpus, sum %llu ns, sum_approx %llu ns, limited_add %llu ns\n",
+		llc ? " (llc)" : "", num_online_cpus(),
+		(t1 - t0) / PCC_BENCH_LOOPS, (t2 - t1) / PCC_BENCH_LOOPS,
+		(t3 - t2) / PCC_BENCH_LOOPS);
+out:
+	percpu_counter_destroy(&fbc);
+}
+
 static int __init percpu_test_init(void)
 {
 	/*
@@ -123,6 +183,9 @@ static int __init percpu_test_init(void)
 
 	preempt_enable();
 
+	percpu_counter_bench(false);
+	percpu_counter_bench(true);
+
 	pr_info("percpu test done\n");
 	return -EAGAIN;  /* Fail will directly unload the module */
 }
@@ -94,6 +94,12 @@ EXPORT_SYMBOL_GPL(raid6_2data_recov);
 void (*raid6_datap_recov)(int, size_t, int, void **);
 EXPORT_SYMBOL_GPL(raid6_datap_recov);
 
+void (*raid6_2data_recov_batch)(int, size_t, int, int, int, void **);
+EXPORT_SYMBOL_GPL(raid6_2data_recov_batch);
+
+void (*raid6_datap_recov_batch)(int, size_t, int, int, void **);
+EXPORT_SYMBOL_GPL(raid6_datap_recov_batch);
+
 const struct raid6_recov_calls *const raid6_recov_algos[] = {
 #ifdef CONFIG_X86
 #ifdef CONFIG_AS_AVX512
@@ -130,6 +136,43 @@ const struct raid6_recov_calls *const raid6_recov_algos[] = {
 
 #define RAID6_TEST_DISKS	8
 #define RAID6_TEST_DISKS_ORDER	3
+/* Benchmark on several stripes, as a batch when supported */
+#define RAID6_TEST_STRIPES_ORDER 2
+#define RAID6_TEST_STRIPES	(1 << RAID6_TEST_STRIPES_ORDER)
+
+/* Fallbacks for implementations without batch versions */
+static void raid6_gen_batch(const struct raid6_calls *calls, int disks,
+			    size_t bytes, int nr, void **ptrs)
+{
+	if (calls->gen_syndrome_batch) {
+		calls->gen_syndrome_batch(disks, bytes, nr, ptrs);
+		return;
+	}
+
+	for (; nr > 0; nr--, ptrs += disks)
+		calls->gen_syndrome(disks, bytes, ptrs);
+}
+
+static void raid6_gen_syndrome_batch_loop(int disks, size_t bytes, int nr,
+					  void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_call.gen_syndrome(disks, bytes, ptrs);
+}
+
+static void raid6_2data_recov_batch_loop(int disks, size_t bytes, int nr,
+					 int faila, int failb, void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_2data_recov(disks, bytes, faila, failb, ptrs);
+}
+
+static void raid6_datap_recov_batch_loop(int disks, size_t bytes, int nr,
+					 int faila, void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_datap_recov(disks, bytes, faila, ptrs);
+}
 
 static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 {
@@ -144,6 +187,10 @@ static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 	if (best) {
 		raid6_2data_recov = best->data2;
 		raid6_datap_recov = best->datap;
+		raid6_2data_recov_batch = best->data2_batch ?:
+					  raid6_2data_recov_batch_loop;
+		raid6_datap_recov_batch = best->datap_batch ?:
+					  raid6_datap_recov_batch_loop;
 
 		pr_info("raid6: using %s recovery algorithm\n", best->name);
 	} else
@@ -153,7 +200,8 @@ static inline const struct raid6_recov_calls *raid6_choose_recov(void)
 }
 
 static inline const struct raid6_calls *raid6_choose_gen(
-	void *(*const dptrs)[RAID6_TEST_DISKS], const int disks)
+	void *(*const dptrs)[RAID6_TEST_STRIPES * RAID6_TEST_DISKS],
+	const int disks, const int stripes_order)
 {
 	unsigned long perf, bestgenperf, j0, j1;
 	int start = (disks>>1)-1, stop = disks-3;	/* work on the second half of the disks */
@@ -178,7 +226,8 @@ static inline const struct raid6_calls *raid6_choose_gen(
 				cpu_relax();
 			while (time_before(jiffies,
 					    j1 + (1<<RAID6_TIME_JIFFIES_LG2))) {
-				(*algo)->gen_syndrome(disks, PAGE_SIZE, *dptrs);
+				raid6_gen_batch(*algo, disks, PAGE_SIZE,
+						1 << stripes_order, *dptrs);
 				perf++;
 			}
 			preempt_enable();
@@ -189,7 +238,8 @@ static inline const struct raid6_calls *raid6_choose_gen(
 			}
 			pr_info("raid6: %-8s gen() %5ld MB/s\n", (*algo)->name,
 				(perf * HZ * (disks-2)) >>
-				(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2));
+				(20 - PAGE_SHIFT - stripes_order +
+				 RAID6_TIME_JIFFIES_LG2));
 		}
 	}
 
@@ -199,6 +249,8 @@ static inline const struct raid6_calls *raid6_choose_gen(
 	}
 
 	raid6_call = *best;
+	if (!raid6_call.gen_syndrome_batch)
+		raid6_call.gen_syndrome_batch = raid6_gen_syndrome_batch_loop;
 
 	if (!IS_ENABLED(CONFIG_RAID6_PQ_BENCHMARK)) {
 		pr_info("raid6: skipped pq benchmark and selected %s\n",
@@ -209,7 +261,8 @@ static inline const struct raid6_calls *raid6_choose_gen(
 	pr_info("raid6: using algorithm %s gen() %ld MB/s\n",
 		best->name,
 		(bestgenperf * HZ * (disks - 2)) >>
-		(20 - PAGE_SHIFT + RAID6_TIME_JIFFIES_LG2));
+		(20 - PAGE_SHIFT - stripes_order +
+		 RAID6_TIME_JIFFIES_LG2));
 
 	if (best->xor_syndrome) {
 		perf = 0;
@@ -245,37 +298,44 @@ int __init raid6_select_algo(void)
 
 	const struct raid6_calls *gen_best;
 	const struct raid6_recov_calls *rec_best;
+	int stripes_order = RAID6_TEST_STRIPES_ORDER;
+	int order = RAID6_TEST_DISKS_ORDER + stripes_order;
 	char *disk_ptr, *p;
-	void *dptrs[RAID6_TEST_DISKS];
-	int i, cycle;
-
-	/* prepare the buffer and fill it circularly with gfmul table */
-	disk_ptr = (char *)__get_free_pages(GFP_KERNEL, RAID6_TEST_DISKS_ORDER);
+	void *dptrs[RAID6_TEST_STRIPES * RAID6_TEST_DISKS];
+	size_t size, chunk;
+	int i;
+
+	/*
+	 * prepare the buffer and fill it circularly with gfmul table, P and
+	 * Q blocks included as they are overwritten anyway.  If the batch
+	 * sized buffer is not available, benchmark a single stripe.
+	 */
+	disk_ptr = (char *)__get_free_pages(GFP_KERNEL | __GFP_NOWARN, order);
+	if (!disk_ptr) {
+		stripes_order = 0;
+		order = RAID6_TEST_DISKS_ORDER;
+		disk_ptr = (char *)__get_free_pages(GFP_KERNEL, order);
+	}
 	if (!disk_ptr) {
 		pr_err("raid6: Yikes!  No memory available.\n");
 		return -ENOMEM;
 	}
 
-	p = disk_ptr;
-	for (i = 0; i < disks; i++)
-		dptrs[i] = p + PAGE_SIZE * i;
-
-	cycle = ((disks - 2) * PAGE_SIZE) / 65536;
-	for (i = 0; i < cycle; i++) {
-		memcpy(p, raid6_gfmul, 65536);
-		p += 65536;
-	}
+	for (i = 0; i < (disks << stripes_order); i++)
+		dptrs[i] = disk_ptr + PAGE_SIZE * i;
 
-	if ((disks - 2) * PAGE_SIZE % 65536)
-		memcpy(p, raid6_gfmul, (disks - 2) * PAGE_SIZE % 65536);
+	size = PAGE_SIZE << order;
+	chunk = size < 65536 ? size : 65536;
+	for (p = disk_ptr; p < disk_ptr + size; p += chunk)
+		memcpy(p, raid6_gfmul, chunk);
 
 	/* select raid gen_syndrome function */
-	gen_best = raid6_choose_gen(&dptrs, disks);
+	gen_best = raid6_choose_gen(&dptrs, disks, stripes_order);
 
 	/* select raid recover functions */
 	rec_best = raid6_choose_recov();
 
-	free_pages((unsigned long)disk_ptr, RAID6_TEST_DISKS_ORDER);
+	free_pages((unsigned long)disk_ptr, order);
 
 	return gen_best && rec_best ? 0 : -EINVAL;
 }
@@ -31,7 +31,7 @@ static int raid6_have_avx2(void)
 /*
  * Plain AVX2 implementation
  */
-static void raid6_avx21_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx21_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -41,8 +41,6 @@ static void raid6_avx21_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];		/* XOR parity */
 	q = dptr[z0+2];		/* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa %0,%%ymm0" : : "m" (raid6_avx2_constants.x1d[0]));
 	asm volatile("vpxor %ymm3,%ymm3,%ymm3");	/* Zero temp */
 
@@ -74,11 +72,10 @@ static void raid6_avx21_gen_syndrome(int disks, size_t bytes, void **ptrs)
 		asm volatile("vmovntdq %%ymm4,%0" : "=m" (q[d]));
 		asm volatile("vpxor %ymm4,%ymm4,%ymm4");
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx21)
+
 static void raid6_avx21_xor_syndrome(int disks, int start, int stop,
 				     size_t bytes, void **ptrs)
 {
@@ -132,13 +129,14 @@ const struct raid6_calls raid6_avx2x1 = {
 	raid6_avx21_xor_syndrome,
 	raid6_have_avx2,
 	"avx2x1",
+	.gen_syndrome_batch = raid6_avx21_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX2 over priority 1 (SSE2 and others) */
 };
 
 /*
  * Unrolled-by-2 AVX2 implementation
  */
-static void raid6_avx22_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx22_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -148,8 +146,6 @@ static void raid6_avx22_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];		/* XOR parity */
 	q = dptr[z0+2];		/* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa %0,%%ymm0" : : "m" (raid6_avx2_constants.x1d[0]));
 	asm volatile("vpxor %ymm1,%ymm1,%ymm1"); /* Zero temp */
 
@@ -184,11 +180,10 @@ static void raid6_avx22_gen_syndrome(int disks, size_t bytes, void **ptrs)
 		asm volatile("vmovntdq %%ymm4,%0" : "=m" (q[d]));
 		asm volatile("vmovntdq %%ymm6,%0" : "=m" (q[d+32]));
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx22)
+
 static void raid6_avx22_xor_syndrome(int disks, int start, int stop,
 				     size_t bytes, void **ptrs)
 {
@@ -262,6 +257,7 @@ const struct raid6_calls raid6_avx2x2 = {
 	raid6_avx22_xor_syndrome,
 	raid6_have_avx2,
 	"avx2x2",
+	.gen_syndrome_batch = raid6_avx22_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX2 over priority 1 (SSE2 and others) */
 };
 
@@ -270,7 +266,7 @@ const struct raid6_calls raid6_avx2x2 = {
 /*
  * Unrolled-by-4 AVX2 implementation
  */
-static void raid6_avx24_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx24_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -280,8 +276,6 @@ static void raid6_avx24_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];		/* XOR parity */
 	q = dptr[z0+2];		/* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa %0,%%ymm0" : : "m" (raid6_avx2_constants.x1d[0]));
 	asm volatile("vpxor %ymm1,%ymm1,%ymm1");	/* Zero temp */
 	asm volatile("vpxor %ymm2,%ymm2,%ymm2");	/* P[0] */
@@ -345,11 +339,10 @@ static void raid6_avx24_gen_syndrome(int disks, size_t bytes, void **ptrs)
 		asm volatile("vmovntdq %%ymm14,%0" : "=m" (q[d+96]));
 		asm volatile("vpxor %ymm14,%ymm14,%ymm14");
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx24)
+
 static void raid6_avx24_xor_syndrome(int disks, int start, int stop,
 				     size_t bytes, void **ptrs)
 {
@@ -465,6 +458,7 @@ const struct raid6_calls raid6_avx2x4 = {
 	raid6_avx24_xor_syndrome,
 	raid6_have_avx2,
 	"avx2x4",
+	.gen_syndrome_batch = raid6_avx24_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX2 over priority 1 (SSE2 and others) */
 };
 #endif /* CONFIG_X86_64 */
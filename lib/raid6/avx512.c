@@ -41,7 +41,7 @@ static int raid6_have_avx512(void)
 		boot_cpu_has(X86_FEATURE_AVX512DQ);
 }
 
-static void raid6_avx5121_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx5121_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -51,8 +51,6 @@ static void raid6_avx5121_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];         /* XOR parity */
 	q = dptr[z0+2];         /* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa64 %0,%%zmm0\n\t"
 		     "vpxorq %%zmm1,%%zmm1,%%zmm1" /* Zero temp */
 		     :
@@ -93,11 +91,10 @@ static void raid6_avx5121_gen_syndrome(int disks, size_t bytes, void **ptrs)
 			     :
 			     : "m" (p[d]), "m" (q[d]));
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx5121)
+
 static void raid6_avx5121_xor_syndrome(int disks, int start, int stop,
 				       size_t bytes, void **ptrs)
 {
@@ -162,13 +159,14 @@ const struct raid6_calls raid6_avx512x1 = {
 	raid6_avx5121_xor_syndrome,
 	raid6_have_avx512,
 	"avx512x1",
+	.gen_syndrome_batch = raid6_avx5121_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX512 over priority 1 (SSE2 and others) */
 };
 
 /*
  * Unrolled-by-2 AVX512 implementation
  */
-static void raid6_avx5122_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx5122_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -178,8 +176,6 @@ static void raid6_avx5122_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];         /* XOR parity */
 	q = dptr[z0+2];         /* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa64 %0,%%zmm0\n\t"
 		     "vpxorq %%zmm1,%%zmm1,%%zmm1" /* Zero temp */
 		     :
@@ -225,11 +221,10 @@ static void raid6_avx5122_gen_syndrome(int disks, size_t bytes, void **ptrs)
 			     : "m" (p[d]), "m" (p[d+64]), "m" (q[d]),
 			       "m" (q[d+64]));
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx5122)
+
 static void raid6_avx5122_xor_syndrome(int disks, int start, int stop,
 				       size_t bytes, void **ptrs)
 {
@@ -319,6 +314,7 @@ const struct raid6_calls raid6_avx512x2 = {
 	raid6_avx5122_xor_syndrome,
 	raid6_have_avx512,
 	"avx512x2",
+	.gen_syndrome_batch = raid6_avx5122_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX512 over priority 1 (SSE2 and others) */
 };
 
@@ -327,7 +323,7 @@ const struct raid6_calls raid6_avx512x2 = {
 /*
  * Unrolled-by-4 AVX2 implementation
  */
-static void raid6_avx5124_gen_syndrome(int disks, size_t bytes, void **ptrs)
+static void raid6_avx5124_gen_stripe(int disks, size_t bytes, void **ptrs)
 {
 	u8 **dptr = (u8 **)ptrs;
 	u8 *p, *q;
@@ -337,8 +333,6 @@ static void raid6_avx5124_gen_syndrome(int disks, size_t bytes, void **ptrs)
 	p = dptr[z0+1];         /* XOR parity */
 	q = dptr[z0+2];         /* RS syndrome */
 
-	kernel_fpu_begin();
-
 	asm volatile("vmovdqa64 %0,%%zmm0\n\t"
 		     "vpxorq %%zmm1,%%zmm1,%%zmm1\n\t"       /* Zero temp */
 		     "vpxorq %%zmm2,%%zmm2,%%zmm2\n\t"       /* P[0] */
@@ -415,11 +409,10 @@ static void raid6_avx5124_gen_syndrome(int disks, size_t bytes, void **ptrs)
 			       "m" (p[d+192]), "m" (q[d]), "m" (q[d+64]),
 			       "m" (q[d+128]), "m" (q[d+192]));
 	}
-
-	asm volatile("sfence" : : : "memory");
-	kernel_fpu_end();
 }
 
+RAID6_X86_GEN_SYNDROME(raid6_avx5124)
+
 static void raid6_avx5124_xor_syndrome(int disks, int start, int stop,
 				       size_t bytes, void **ptrs)
 {
@@ -557,6 +550,7 @@ const struct raid6_calls raid6_avx512x4 = {
 	raid6_avx5124_xor_syndrome,
 	raid6_have_avx512,
 	"avx512x4",
+	.gen_syndrome_batch = raid6_avx5124_gen_syndrome_batch,
 	.priority = 2		/* Prefer AVX512 over priority 1 (SSE2 and others) */
 };
 #endif
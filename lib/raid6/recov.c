@@ -100,6 +100,71 @@ const struct raid6_recov_calls raid6_recov_intx1 = {
 	.priority = 0,
 };
 
+/*
+ * First half of batched two-data recovery: leave delta p and delta q in
+ * the failed data blocks of up to RAID6_RECOV_BATCH stripes, using a single
+ * gen_syndrome_batch() call, exactly as the single-stripe versions above
+ * do for one.  Returns the number of stripes done; the pointer tables are
+ * restored on return.
+ */
+int raid6_2data_recov_delta(int disks, size_t bytes, int nr, int faila,
+			    int failb, void **ptrs)
+{
+	void *p[RAID6_RECOV_BATCH], *q[RAID6_RECOV_BATCH];
+	void **stripe;
+	int i;
+
+	if (nr > RAID6_RECOV_BATCH)
+		nr = RAID6_RECOV_BATCH;
+
+	for (i = 0, stripe = ptrs; i < nr; i++, stripe += disks) {
+		p[i] = stripe[disks-2];
+		q[i] = stripe[disks-1];
+		stripe[disks-2] = stripe[faila];
+		stripe[faila]   = (void *)raid6_empty_zero_page;
+		stripe[disks-1] = stripe[failb];
+		stripe[failb]   = (void *)raid6_empty_zero_page;
+	}
+
+	raid6_call.gen_syndrome_batch(disks, bytes, nr, ptrs);
+
+	for (i = 0, stripe = ptrs; i < nr; i++, stripe += disks) {
+		stripe[faila]   = stripe[disks-2];
+		stripe[failb]   = stripe[disks-1];
+		stripe[disks-2] = p[i];
+		stripe[disks-1] = q[i];
+	}
+
+	return nr;
+}
+
+/* Same for data+P recovery, leaving delta q in the failed data block */
+int raid6_datap_recov_delta(int disks, size_t bytes, int nr, int faila,
+			    void **ptrs)
+{
+	void *q[RAID6_RECOV_BATCH];
+	void **stripe;
+	int i;
+
+	if (nr > RAID6_RECOV_BATCH)
+		nr = RAID6_RECOV_BATCH;
+
+	for (i = 0, stripe = ptrs; i < nr; i++, stripe += disks) {
+		q[i] = stripe[disks-1];
+		stripe[disks-1] = stripe[faila];
+		stripe[faila]   = (void *)raid6_empty_zero_page;
+	}
+
+	raid6_call.gen_syndrome_batch(disks, bytes, nr, ptrs);
+
+	for (i = 0, stripe = ptrs; i < nr; i++, stripe += disks) {
+		stripe[faila]   = stripe[disks-1];
+		stripe[disks-1] = q[i];
+	}
+
+	return nr;
+}
+
 #ifndef __KERNEL__
 /* Testing only */
 
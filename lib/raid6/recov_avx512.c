@@ -21,45 +21,12 @@ static int raid6_has_avx512(void)
 		boot_cpu_has(X86_FEATURE_AVX512DQ);
 }
 
-static void raid6_2data_recov_avx512(int disks, size_t bytes, int faila,
-				     int failb, void **ptrs)
+/* Turn delta p and q into the missing blocks, in an FPU section */
+static void raid6_2data_fixup_avx512(size_t bytes, u8 *p, u8 *q, u8 *dp,
+				     u8 *dq, const u8 *pbmul, const u8 *qmul)
 {
-	u8 *p, *q, *dp, *dq;
-	const u8 *pbmul;	/* P multiplier table for B data */
-	const u8 *qmul;		/* Q multiplier table (for both) */
 	const u8 x0f = 0x0f;
 
-	p = (u8 *)ptrs[disks-2];
-	q = (u8 *)ptrs[disks-1];
-
-	/*
-	 * Compute syndrome with zero for the missing data pages
-	 * Use the dead data pages as temporary storage for
-	 * delta p and delta q
-	 */
-
-	dp = (u8 *)ptrs[faila];
-	ptrs[faila] = (void *)raid6_empty_zero_page;
-	ptrs[disks-2] = dp;
-	dq = (u8 *)ptrs[failb];
-	ptrs[failb] = (void *)raid6_empty_zero_page;
-	ptrs[disks-1] = dq;
-
-	raid6_call.gen_syndrome(disks, bytes, ptrs);
-
-	/* Restore pointer table */
-	ptrs[faila]   = dp;
-	ptrs[failb]   = dq;
-	ptrs[disks-2] = p;
-	ptrs[disks-1] = q;
-
-	/* Now, pick the proper data tables */
-	pbmul = raid6_vgfmul[raid6_gfexi[failb-faila]];
-	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^
-		raid6_gfexp[failb]]];
-
-	kernel_fpu_begin();
-
 	/* zmm0 = x0f[16] */
 	asm volatile("vpbroadcastb %0, %%zmm7" : : "m" (x0f));
 
@@ -220,39 +187,73 @@ static void raid6_2data_recov_avx512(int disks, size_t bytes, int faila,
 		dq += 64;
 #endif
 	}
-
-	kernel_fpu_end();
 }
 
-static void raid6_datap_recov_avx512(int disks, size_t bytes, int faila,
-				     void **ptrs)
+static void raid6_2data_recov_avx512(int disks, size_t bytes, int faila,
+				     int failb, void **ptrs)
 {
-	u8 *p, *q, *dq;
-	const u8 *qmul;		/* Q multiplier table */
-	const u8 x0f = 0x0f;
+	u8 *p, *q, *dp, *dq;
+	const u8 *pbmul;	/* P multiplier table for B data */
+	const u8 *qmul;		/* Q multiplier table (for both) */
 
 	p = (u8 *)ptrs[disks-2];
 	q = (u8 *)ptrs[disks-1];
 
 	/*
-	 * Compute syndrome with zero for the missing data page
-	 * Use the dead data page as temporary storage for delta q
+	 * Compute syndrome with zero for the missing data pages
+	 * Use the dead data pages as temporary storage for
+	 * delta p and delta q
 	 */
 
-	dq = (u8 *)ptrs[faila];
+	dp = (u8 *)ptrs[faila];
 	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-2] = dp;
+	dq = (u8 *)ptrs[failb];
+	ptrs[failb] = (void *)raid6_empty_zero_page;
 	ptrs[disks-1] = dq;
 
 	raid6_call.gen_syndrome(disks, bytes, ptrs);
 
 	/* Restore pointer table */
-	ptrs[faila]   = dq;
+	ptrs[faila]   = dp;
+	ptrs[failb]   = dq;
+	ptrs[disks-2] = p;
 	ptrs[disks-1] = q;
 
 	/* Now, pick the proper data tables */
-	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+	pbmul = raid6_vgfmul[raid6_gfexi[failb-faila]];
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^
+		raid6_gfexp[failb]]];
 
 	kernel_fpu_begin();
+	raid6_2data_fixup_avx512(bytes, p, q, dp, dq, pbmul, qmul);
+	kernel_fpu_end();
+}
+
+static void raid6_2data_recov_avx512_batch(int disks, size_t bytes, int nr,
+					   int faila, int failb, void **ptrs)
+{
+	const u8 *pbmul = raid6_vgfmul[raid6_gfexi[failb-faila]];
+	const u8 *qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila] ^
+		raid6_gfexp[failb]]];
+	int i, n;
+
+	for (; nr > 0; nr -= n) {
+		n = raid6_2data_recov_delta(disks, bytes, nr, faila, failb, ptrs);
+
+		kernel_fpu_begin();
+		for (i = 0; i < n; i++, ptrs += disks)
+			raid6_2data_fixup_avx512(bytes, ptrs[disks-2], ptrs[disks-1],
+						 ptrs[faila], ptrs[failb], pbmul, qmul);
+		kernel_fpu_end();
+	}
+}
+
+/* Turn delta q into the missing data and fix up p, in an FPU section */
+static void raid6_datap_fixup_avx512(size_t bytes, u8 *p, u8 *q, u8 *dq,
+				     const u8 *qmul)
+{
+	const u8 x0f = 0x0f;
 
 	asm volatile("vpbroadcastb %0, %%zmm7" : : "m" (x0f));
 
@@ -362,13 +363,62 @@ static void raid6_datap_recov_avx512(int disks, size_t bytes, int faila,
 		dq += 64;
 #endif
 	}
+}
+
+static void raid6_datap_recov_avx512(int disks, size_t bytes, int faila,
+				     void **ptrs)
+{
+	u8 *p, *q, *dq;
+	const u8 *qmul;		/* Q multiplier table */
 
+	p = (u8 *)ptrs[disks-2];
+	q = (u8 *)ptrs[disks-1];
+
+	/*
+	 * Compute syndrome with zero for the missing data page
+	 * Use the dead data page as temporary storage for delta q
+	 */
+
+	dq = (u8 *)ptrs[faila];
+	ptrs[faila] = (void *)raid6_empty_zero_page;
+	ptrs[disks-1] = dq;
+
+	raid6_call.gen_syndrome(disks, bytes, ptrs);
+
+	/* Restore pointer table */
+	ptrs[faila]   = dq;
+	ptrs[disks-1] = q;
+
+	/* Now, pick the proper data tables */
+	qmul  = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+
+	kernel_fpu_begin();
+	raid6_datap_fixup_avx512(bytes, p, q, dq, qmul);
 	kernel_fpu_end();
 }
 
+static void raid6_datap_recov_avx512_batch(int disks, size_t bytes, int nr,
+					   int faila, void **ptrs)
+{
+	const u8 *qmul = raid6_vgfmul[raid6_gfinv[raid6_gfexp[faila]]];
+	int i, n;
+
+	for (; nr > 0; nr -= n) {
+		n = raid6_datap_recov_delta(disks, bytes, nr, faila, ptrs);
+
+		kernel_fpu_begin();
+		for (i = 0; i < n; i++, ptrs += disks)
+			raid6_datap_fixup_avx512(bytes, ptrs[disks-2], ptrs[disks-1],
+						 ptrs[faila], qmul);
+		kernel_fpu_end();
+	}
+}
+
 const struct raid6_recov_calls raid6_recov_avx512 = {
 	.data2 = raid6_2data_recov_avx512,
 	.datap = raid6_datap_recov_avx512,
+	.data2_batch = raid6_2data_recov_avx512_batch,
+	.datap_batch = raid6_datap_recov_avx512_batch,
 	.valid = raid6_has_avx512,
 #ifdef CONFIG_X86_64
 	.name = "avx512x2",
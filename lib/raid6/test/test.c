@@ -0,0 +1,314 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   Copyright 2002-2007 H. Peter Anvin - All Rights Reserved
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6test.c
+ *
+ * Test RAID-6 recovery with various algorithms, single and batched, and
+ * report their throughput
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <linux/raid/pq.h>
+
+#define NDISKS		16	/* Including P and Q */
+#define NSTRIPES	32	/* For the batched tests */
+#define BENCH_BYTES	(1 << 30)	/* Data bytes per throughput run */
+
+const char raid6_empty_zero_page[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+char *dataptrs[NDISKS];
+char data[NDISKS][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+char recovi[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+char recovj[PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+void *sptrs[NSTRIPES * NDISKS];
+char sdata[NSTRIPES][NDISKS][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+char sgood[NSTRIPES][NDISKS][PAGE_SIZE] __attribute__((aligned(PAGE_SIZE)));
+
+static void makedata(int start, int stop)
+{
+	int i, j;
+
+	for (i = start; i <= stop; i++) {
+		for (j = 0; j < PAGE_SIZE; j++)
+			data[i][j] = rand();
+
+		dataptrs[i] = data[i];
+	}
+}
+
+static char disk_type(int d)
+{
+	switch (d) {
+	case NDISKS-2:
+		return 'P';
+	case NDISKS-1:
+		return 'Q';
+	default:
+		return 'D';
+	}
+}
+
+static int test_disks(int i, int j)
+{
+	int erra, errb;
+
+	memset(recovi, 0xf0, PAGE_SIZE);
+	memset(recovj, 0xba, PAGE_SIZE);
+
+	dataptrs[i] = recovi;
+	dataptrs[j] = recovj;
+
+	raid6_dual_recov(NDISKS, PAGE_SIZE, i, j, (void **)&dataptrs);
+
+	erra = memcmp(data[i], recovi, PAGE_SIZE);
+	errb = memcmp(data[j], recovj, PAGE_SIZE);
+
+	if (i < NDISKS-2 && j == NDISKS-1) {
+		/* We don't implement the DQ failure scenario, since it's
+		   equivalent to a RAID-5 failure (XOR, then recompute Q) */
+		erra = errb = 0;
+	} else {
+		printf("algo=%-8s  faila=%3d(%c)  failb=%3d(%c)  %s\n",
+		       raid6_call.name, i, disk_type(i), j, disk_type(j),
+		       (!erra && !errb) ? "OK" :
+		       !erra ? "ERRB" :
+		       !errb ? "ERRA" : "ERRAB");
+	}
+
+	dataptrs[i] = data[i];
+	dataptrs[j] = data[j];
+
+	return erra || errb;
+}
+
+/* Same fallbacks as algos.c uses for implementations without batching */
+static void gen_syndrome_batch_loop(int disks, size_t bytes, int nr,
+				    void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_call.gen_syndrome(disks, bytes, ptrs);
+}
+
+static void data2_batch_loop(int disks, size_t bytes, int nr, int faila,
+			     int failb, void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_2data_recov(disks, bytes, faila, failb, ptrs);
+}
+
+static void datap_batch_loop(int disks, size_t bytes, int nr, int faila,
+			     void **ptrs)
+{
+	for (; nr > 0; nr--, ptrs += disks)
+		raid6_datap_recov(disks, bytes, faila, ptrs);
+}
+
+static void make_stripes(void)
+{
+	int s, d, j;
+
+	for (s = 0; s < NSTRIPES; s++) {
+		for (d = 0; d < NDISKS; d++) {
+			for (j = 0; j < PAGE_SIZE; j++)
+				sdata[s][d][j] = rand();
+			sptrs[s * NDISKS + d] = sdata[s][d];
+		}
+		raid6_call.gen_syndrome(NDISKS, PAGE_SIZE, &sptrs[s * NDISKS]);
+	}
+	memcpy(sgood, sdata, sizeof(sdata));
+}
+
+/* Wipe the failed blocks of every stripe, recover them in one call */
+static int test_batch(int faila, int failb)
+{
+	int s, err = 0;
+
+	for (s = 0; s < NSTRIPES; s++) {
+		memset(sdata[s][faila], 0xf0, PAGE_SIZE);
+		memset(sdata[s][failb], 0xba, PAGE_SIZE);
+	}
+
+	if (failb == NDISKS-2)
+		raid6_datap_recov_batch(NDISKS, PAGE_SIZE, NSTRIPES, faila, sptrs);
+	else
+		raid6_2data_recov_batch(NDISKS, PAGE_SIZE, NSTRIPES, faila,
+					failb, sptrs);
+
+	for (s = 0; s < NSTRIPES; s++)
+		err |= memcmp(sdata[s], sgood[s], sizeof(sdata[s])) != 0;
+
+	printf("algo=%-8s  batch of %d  faila=%3d(%c)  failb=%3d(%c)  %s\n",
+	       raid6_call.name, NSTRIPES, faila, disk_type(faila), failb,
+	       disk_type(failb), err ? "ERR" : "OK");
+
+	/* A failed run leaves garbage behind for the next one */
+	memcpy(sdata, sgood, sizeof(sdata));
+	return err;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* MB/s of data disks processed by @nr calls covering @stripes stripes each */
+static double mbps(double start, int nr, int stripes)
+{
+	return (double)nr * stripes * (NDISKS - 2) * PAGE_SIZE /
+	       (now() - start) / (1 << 20);
+}
+
+static void bench_gen(void)
+{
+	int loops = BENCH_BYTES / ((NDISKS - 2) * PAGE_SIZE * NSTRIPES);
+	double start, single, batch;
+	int i, s;
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		for (s = 0; s < NSTRIPES; s++)
+			raid6_call.gen_syndrome(NDISKS, PAGE_SIZE,
+						&sptrs[s * NDISKS]);
+	single = mbps(start, loops, NSTRIPES);
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		raid6_call.gen_syndrome_batch(NDISKS, PAGE_SIZE, NSTRIPES, sptrs);
+	batch = mbps(start, loops, NSTRIPES);
+
+	printf("algo=%-8s  gen()   %8.0f MB/s  batch %8.0f MB/s\n",
+	       raid6_call.name, single, batch);
+}
+
+static void bench_recov(const char *name)
+{
+	int loops = BENCH_BYTES / ((NDISKS - 2) * PAGE_SIZE * NSTRIPES);
+	double start, single, batch;
+	int i, s;
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		for (s = 0; s < NSTRIPES; s++)
+			raid6_2data_recov(NDISKS, PAGE_SIZE, 1, 4,
+					  &sptrs[s * NDISKS]);
+	single = mbps(start, loops, NSTRIPES);
+
+	start = now();
+	for (i = 0; i < loops; i++)
+		raid6_2data_recov_batch(NDISKS, PAGE_SIZE, NSTRIPES, 1, 4, sptrs);
+	batch = mbps(start, loops, NSTRIPES);
+
+	printf("recov=%-8s gen=%-8s  2data() %8.0f MB/s  batch %8.0f MB/s\n",
+	       name, raid6_call.name, single, batch);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct raid6_calls *const *algo;
+	const struct raid6_recov_calls *const *ra;
+	int i, j, p1, p2;
+	int err = 0;
+
+	makedata(0, NDISKS-1);
+
+	for (ra = raid6_recov_algos; *ra; ra++) {
+		if ((*ra)->valid  && !(*ra)->valid())
+			continue;
+
+		raid6_2data_recov = (*ra)->data2;
+		raid6_datap_recov = (*ra)->datap;
+		raid6_2data_recov_batch = (*ra)->data2_batch ?: data2_batch_loop;
+		raid6_datap_recov_batch = (*ra)->datap_batch ?: datap_batch_loop;
+
+		printf("using recovery %s\n", (*ra)->name);
+
+		for (algo = raid6_algos; *algo; algo++) {
+			if ((*algo)->valid && !(*algo)->valid())
+				continue;
+
+			raid6_call = **algo;
+			if (!raid6_call.gen_syndrome_batch)
+				raid6_call.gen_syndrome_batch = gen_syndrome_batch_loop;
+
+			/* Nuke syndromes */
+			memset(data[NDISKS-2], 0xee, 2*PAGE_SIZE);
+
+			/* Generate assumed good syndrome */
+			raid6_call.gen_syndrome(NDISKS, PAGE_SIZE,
+						(void **)&dataptrs);
+
+			for (i = 0; i < NDISKS-1; i++)
+				for (j = i+1; j < NDISKS; j++)
+					err += test_disks(i, j);
+
+			make_stripes();
+			for (i = 0; i < NDISKS-2; i++)
+				for (j = i+1; j < NDISKS-1; j++)
+					err += test_batch(i, j);
+
+			if (!raid6_call.xor_syndrome)
+				continue;
+
+			for (p1 = 0; p1 < NDISKS-2; p1++)
+				for (p2 = p1; p2 < NDISKS-2; p2++) {
+
+					/* Simulate rmw run */
+					raid6_call.xor_syndrome(NDISKS, p1, p2, PAGE_SIZE,
+								(void **)&dataptrs);
+					makedata(p1, p2);
+					raid6_call.xor_syndrome(NDISKS, p1, p2, PAGE_SIZE,
+								(void **)&dataptrs);
+
+					for (i = 0; i < NDISKS-1; i++)
+						for (j = i+1; j < NDISKS; j++)
+							err += test_disks(i, j);
+				}
+
+		}
+		printf("\n");
+	}
+
+	printf("\n");
+
+	/* Throughput, one stripe per call against batches of NSTRIPES */
+	for (algo = raid6_algos; *algo; algo++) {
+		if ((*algo)->valid && !(*algo)->valid())
+			continue;
+
+		raid6_call = **algo;
+		if (!raid6_call.gen_syndrome_batch)
+			raid6_call.gen_syndrome_batch = gen_syndrome_batch_loop;
+		bench_gen();
+	}
+	printf("\n");
+
+	/* Pick the best algorithm test, recovery is timed on top of it */
+	raid6_select_algo();
+	printf("\n");
+
+	for (ra = raid6_recov_algos; *ra; ra++) {
+		if ((*ra)->valid  && !(*ra)->valid())
+			continue;
+
+		raid6_2data_recov = (*ra)->data2;
+		raid6_2data_recov_batch = (*ra)->data2_batch ?: data2_batch_loop;
+		bench_recov((*ra)->name);
+	}
+
+	if (err)
+		printf("\n*** ERRORS FOUND ***\n");
+
+	return err;
+}
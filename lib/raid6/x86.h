@@ -71,5 +71,36 @@ static inline int boot_cpu_has(int flag)
 
 #endif /* ndef __KERNEL__ */
 
+/*
+ * Build the gen_syndrome() and gen_syndrome_batch() entry points around
+ * name##_gen_stripe(), which does one stripe and expects to be called in
+ * an FPU section.  Up to RAID6_RECOV_BATCH stripes of a batch share one FPU
+ * section, and one sfence to order their non-temporal stores, so that
+ * preemption stays bounded for large batches.
+ */
+#define RAID6_X86_GEN_SYNDROME(name)					\
+static void name##_gen_syndrome(int disks, size_t bytes, void **ptrs)	\
+{									\
+	kernel_fpu_begin();						\
+	name##_gen_stripe(disks, bytes, ptrs);				\
+	asm volatile("sfence" : : : "memory");				\
+	kernel_fpu_end();						\
+}									\
+									\
+static void name##_gen_syndrome_batch(int disks, size_t bytes, int nr,	\
+				      void **ptrs)			\
+{									\
+	int i;								\
+									\
+	for (; nr > 0; nr -= i) {					\
+		kernel_fpu_begin();					\
+		for (i = 0; i < nr && i < RAID6_RECOV_BATCH;		\
+		     i++, ptrs += disks)				\
+			name##_gen_stripe(disks, bytes, ptrs);		\
+		asm volatile("sfence" : : : "memory");			\
+		kernel_fpu_end();					\
+	}								\
+}
+
 #endif
 #endif
@@ -226,10 +226,10 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_one(struct rhashtable *ht,
+				 struct bucket_table *old_tbl,
 				 struct rhash_lock_head __rcu **bkt,
 				 unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	int err = -EAGAIN;
 	struct rhash_head *head, *next, *entry;
@@ -278,9 +278,9 @@ static int rhashtable_rehash_one(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_chain(struct rhashtable *ht,
-				    unsigned int old_hash)
+				   struct bucket_table *old_tbl,
+				   unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct rhash_lock_head __rcu **bkt = rht_bucket_var(old_tbl, old_hash);
 	unsigned long flags;
 	int err;
@@ -289,7 +289,7 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 		return 0;
 	flags = rht_lock(old_tbl, bkt);
 
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
+	while (!(err = rhashtable_rehash_one(ht, old_tbl, bkt, old_hash)))
 		;
 
 	if (err == -ENOENT)
@@ -328,13 +328,31 @@ static int rhashtable_rehash_table(struct rhashtable *ht)
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
-		err = rhashtable_rehash_chain(ht, old_hash);
+	/* Inserters claim buckets from the same cursor, see rhashtable_rehash_help(). */
+	while ((old_hash = atomic_inc_return(&old_tbl->rehash_next) - 1) <
+	       old_tbl->size) {
+		err = rhashtable_rehash_chain(ht, old_tbl, old_hash);
 		if (err)
 			return err;
+		atomic_inc(&old_tbl->rehash_done);
 		cond_resched();
 	}
 
+	/*
+	 * Buckets claimed by inserters may still be in flight, or failed
+	 * because the new table is nested. A pass over all buckets waits
+	 * for the former on the bucket locks and retries the latter.
+	 * Buckets which are already empty only cost a lock round trip.
+	 */
+	if (atomic_read_acquire(&old_tbl->rehash_done) != old_tbl->size) {
+		for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
+			err = rhashtable_rehash_chain(ht, old_tbl, old_hash);
+			if (err)
+				return err;
+			cond_resched();
+		}
+	}
+
 	/* Publish the new table pointer. */
 	rcu_assign_pointer(ht->tbl, new_tbl);
 
@@ -491,6 +509,43 @@ static int rhashtable_insert_rehash(struct rhashtable *ht,
 	return err;
 }
 
+/*
+ * Migrate up to RHT_REHASH_HELP buckets of @old_tbl on behalf of
+ * rht_deferred_worker(). With every slow path insert doing a bounded
+ * share of the work, growth completes at the pace of insertions rather
+ * than at the pace of a single worker, and the window in which the new
+ * table can itself overflow and force -EBUSY or a further rehash
+ * shrinks accordingly.
+ *
+ * Called under rcu_read_lock(), which keeps @old_tbl alive even if the
+ * worker publishes the new table concurrently. Buckets are claimed from
+ * a shared cursor so no bucket is migrated twice by helpers.
+ */
+#define RHT_REHASH_HELP	4u
+
+static void rhashtable_rehash_help(struct rhashtable *ht,
+				   struct bucket_table *old_tbl)
+{
+	unsigned int i, old_hash;
+
+	for (i = 0; i < RHT_REHASH_HELP; i++) {
+		/* Do not let the cursor run away once all buckets are claimed */
+		if (atomic_read(&old_tbl->rehash_next) >= old_tbl->size)
+			return;
+
+		old_hash = atomic_inc_return(&old_tbl->rehash_next) - 1;
+		if (old_hash >= old_tbl->size)
+			return;
+
+		if (rhashtable_rehash_chain(ht, old_tbl, old_hash))
+			return;
+
+		/* Pairs with atomic_read_acquire() in rhashtable_rehash_table() */
+		smp_mb__before_atomic();
+		atomic_inc(&old_tbl->rehash_done);
+	}
+}
+
 static void *rhashtable_lookup_one(struct rhashtable *ht,
 				   struct rhash_lock_head __rcu **bkt,
 				   struct bucket_table *tbl, unsigned int hash,
@@ -599,6 +654,9 @@ static void *rhashtable_try_insert(struct rhashtable *ht, const void *key,
 
 	new_tbl = rcu_dereference(ht->tbl);
 
+	if (rcu_access_pointer(new_tbl->future_tbl))
+		rhashtable_rehash_help(ht, new_tbl);
+
 	do {
 		tbl = new_tbl;
 		hash = rht_head_hashfn(ht, tbl, obj, ht->p);
@@ -653,6 +711,74 @@ void *rhashtable_insert_slow(struct rhashtable *ht, const void *key,
 }
 EXPORT_SYMBOL_GPL(rhashtable_insert_slow);
 
+/*
+ * Grow the table up front so that @nr more elements fit below the 75%
+ * threshold, instead of growing and rehashing repeatedly on the way.
+ */
+static void rhashtable_reserve(struct rhashtable *ht, unsigned int nr)
+{
+	struct bucket_table *tbl;
+	unsigned int need, size;
+
+	mutex_lock(&ht->mutex);
+
+	tbl = rht_dereference(ht->tbl, ht);
+	tbl = rhashtable_last_table(ht, tbl);
+
+	/*
+	 * Clamp before rounding up, so that a huge @nr can neither wrap
+	 * @need nor the table size computed from it.
+	 */
+	size = ht->p.max_size ?: 1U << 31;
+	if (!check_add_overflow((unsigned int)atomic_read(&ht->nelems), nr,
+				&need) &&
+	    need < size / 4 * 3)
+		size = roundup_pow_of_two(need + need / 3 + 1);
+
+	if (size > tbl->size && !rhashtable_rehash_alloc(ht, tbl, size) &&
+	    rhashtable_rehash_table(ht))
+		schedule_work(&ht->run_work);
+
+	mutex_unlock(&ht->mutex);
+}
+
+/**
+ * rhashtable_insert_bulk - insert a batch of objects into a hash table
+ * @ht:		hash table
+ * @objs:	objects to insert
+ * @nr:		number of objects in @objs
+ *
+ * Sizes the table once for the whole batch and then inserts the
+ * objects, so that loading many objects does not trigger a series of
+ * rehashes. As with rhashtable_insert_fast(), keys are not checked for
+ * duplicates. Not for use with rhltable.
+ *
+ * Must be called from process context.
+ *
+ * Returns the number of objects inserted. If this is less than @nr,
+ * inserting objs[ret] failed.
+ */
+unsigned int rhashtable_insert_bulk(struct rhashtable *ht,
+				    struct rhash_head **objs, unsigned int nr)
+{
+	unsigned int i;
+
+	might_sleep();
+
+	if (WARN_ON_ONCE(ht->rhlist))
+		return 0;
+
+	rhashtable_reserve(ht, nr);
+
+	for (i = 0; i < nr; i++) {
+		if (IS_ERR(rhashtable_insert_slow(ht, NULL, objs[i])))
+			break;
+	}
+
+	return i;
+}
+EXPORT_SYMBOL_GPL(rhashtable_insert_bulk);
+
 /**
  * rhashtable_walk_enter - Initialise an iterator
  * @ht:		Table to walk over
@@ -26,6 +26,20 @@ static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 	return 0;
 }
 
+/* Pick a starting bit inside the partition of @node */
+static unsigned int sbitmap_node_hint(struct sbitmap *sb, int node,
+				      unsigned int depth)
+{
+	unsigned int start = sb->node_start[node] << sb->shift;
+	unsigned int end = min(sb->node_start[node + 1] << sb->shift, depth);
+
+	if (start >= end)
+		return depth ? get_random_u32_below(depth) : 0;
+	if (sb->round_robin)
+		return start;
+	return start + get_random_u32_below(end - start);
+}
+
 static inline unsigned update_alloc_hint_before_get(struct sbitmap *sb,
 						    unsigned int depth)
 {
@@ -33,7 +47,10 @@ static inline unsigned update_alloc_hint_before_get(struct sbitmap *sb,
 
 	hint = this_cpu_read(*sb->alloc_hint);
 	if (unlikely(hint >= depth)) {
-		hint = depth ? get_random_u32_below(depth) : 0;
+		if (sb->node_start)
+			hint = sbitmap_node_hint(sb, numa_node_id(), depth);
+		else
+			hint = depth ? get_random_u32_below(depth) : 0;
 		this_cpu_write(*sb->alloc_hint, hint);
 	}
 
@@ -116,6 +133,7 @@ int sbitmap_init_node(struct sbitmap *sb, unsigned int depth, int shift,
 	sb->depth = depth;
 	sb->map_nr = DIV_ROUND_UP(sb->depth, bits_per_word);
 	sb->round_robin = round_robin;
+	sb->node_start = NULL;
 
 	if (depth == 0) {
 		sb->map = NULL;
@@ -142,6 +160,46 @@ int sbitmap_init_node(struct sbitmap *sb, unsigned int depth, int shift,
 }
 EXPORT_SYMBOL_GPL(sbitmap_init_node);
 
+/* Give each node a share of the words proportional to its possible CPUs */
+static void sbitmap_update_partitions(struct sbitmap *sb)
+{
+	unsigned int total = num_possible_cpus(), cpus = 0;
+	int node, cpu;
+
+	for (node = 0; node < nr_node_ids; node++) {
+		sb->node_start[node] = div_u64((u64)sb->map_nr * cpus, total);
+		for_each_possible_cpu(cpu) {
+			if (cpu_to_node(cpu) == node)
+				cpus++;
+		}
+	}
+	sb->node_start[nr_node_ids] = sb->map_nr;
+}
+
+int sbitmap_partition_by_node(struct sbitmap *sb, gfp_t flags)
+{
+	int cpu;
+
+	if (nr_node_ids == 1 || !sb->depth)
+		return 0;
+
+	if (WARN_ON_ONCE(!sb->alloc_hint))
+		return -EINVAL;
+
+	sb->node_start = kcalloc(nr_node_ids + 1, sizeof(*sb->node_start), flags);
+	if (!sb->node_start)
+		return -ENOMEM;
+
+	sbitmap_update_partitions(sb);
+
+	for_each_possible_cpu(cpu)
+		*per_cpu_ptr(sb->alloc_hint, cpu) =
+			sbitmap_node_hint(sb, cpu_to_node(cpu), sb->depth);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(sbitmap_partition_by_node);
+
 void sbitmap_resize(struct sbitmap *sb, unsigned int depth)
 {
 	unsigned int bits_per_word = 1U << sb->shift;
@@ -152,6 +210,8 @@ void sbitmap_resize(struct sbitmap *sb, unsigned int depth)
 
 	sb->depth = depth;
 	sb->map_nr = DIV_ROUND_UP(sb->depth, bits_per_word);
+	if (sb->node_start)
+		sbitmap_update_partitions(sb);
 }
 EXPORT_SYMBOL_GPL(sbitmap_resize);
 
@@ -208,16 +268,28 @@ static int sbitmap_find_bit_in_word(struct sbitmap_word *map,
 	return nr;
 }
 
-static int sbitmap_find_bit(struct sbitmap *sb,
-			    unsigned int depth,
-			    unsigned int index,
-			    unsigned int alloc_hint,
-			    bool wrap)
-{
-	unsigned int i;
+/*
+ * Search the @nr_words words from @start on (wrapping at sb->map_nr),
+ * beginning at word @index and wrapping back to @start.
+ */
+static int sbitmap_find_bit_window(struct sbitmap *sb,
+				   unsigned int depth,
+				   unsigned int start,
+				   unsigned int nr_words,
+				   unsigned int index,
+				   unsigned int alloc_hint,
+				   bool wrap)
+{
+	unsigned int i, off;
 	int nr = -1;
 
-	for (i = 0; i < sb->map_nr; i++) {
+	off = index >= start ? index - start : index + sb->map_nr - start;
+
+	for (i = 0; i < nr_words; i++) {
+		index = start + off;
+		if (index >= sb->map_nr)
+			index -= sb->map_nr;
+
 		nr = sbitmap_find_bit_in_word(&sb->map[index],
 					      min_t(unsigned int,
 						    __map_depth(sb, index),
@@ -231,13 +303,50 @@ static int sbitmap_find_bit(struct sbitmap *sb,
 
 		/* Jump to next index. */
 		alloc_hint = 0;
-		if (++index >= sb->map_nr)
-			index = 0;
+		if (++off >= nr_words)
+			off = 0;
 	}
 
 	return nr;
 }
 
+static int sbitmap_find_bit(struct sbitmap *sb,
+			    unsigned int depth,
+			    unsigned int index,
+			    unsigned int alloc_hint,
+			    bool wrap)
+{
+	unsigned int map_nr = sb->map_nr, start, end, nr_words;
+	int node, nr;
+
+	if (!sb->node_start)
+		return sbitmap_find_bit_window(sb, depth, 0, map_nr, index,
+					       alloc_hint, wrap);
+
+	node = numa_node_id();
+	start = min(sb->node_start[node], map_nr);
+	end = min(sb->node_start[node + 1], map_nr);
+
+	if (start < end) {
+		if (index < start || index >= end) {
+			index = start;
+			alloc_hint = 0;
+		}
+		nr = sbitmap_find_bit_window(sb, depth, start, end - start,
+					     index, alloc_hint, wrap);
+		if (nr != -1)
+			return nr;
+	}
+
+	/* The local partition is full, steal from the other nodes. */
+	nr_words = map_nr - (end - start);
+	if (!nr_words)
+		return -1;
+	if (end == map_nr)
+		end = 0;
+	return sbitmap_find_bit_window(sb, depth, end, nr_words, end, 0, wrap);
+}
+
 static int __sbitmap_get(struct sbitmap *sb, unsigned int alloc_hint)
 {
 	unsigned int index;
@@ -496,28 +605,33 @@ int __sbitmap_queue_get(struct sbitmap_queue *sbq)
 }
 EXPORT_SYMBOL_GPL(__sbitmap_queue_get);
 
-unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
-					unsigned int *offset)
+/*
+ * Take up to @nr_tags consecutive bits from one of the @nr_words words from
+ * @start on, walked like sbitmap_find_bit_window() does.
+ */
+static unsigned long sbitmap_get_batch_window(struct sbitmap *sb,
+					      unsigned int start,
+					      unsigned int nr_words,
+					      unsigned int index, int nr_tags,
+					      unsigned int *offset)
 {
-	struct sbitmap *sb = &sbq->sb;
-	unsigned int hint, depth;
-	unsigned long index, nr;
-	int i;
+	unsigned int i, off;
+	unsigned long nr;
 
-	if (unlikely(sb->round_robin))
-		return 0;
+	off = index >= start ? index - start : index + sb->map_nr - start;
 
-	depth = READ_ONCE(sb->depth);
-	hint = update_alloc_hint_before_get(sb, depth);
-
-	index = SB_NR_TO_INDEX(sb, hint);
-
-	for (i = 0; i < sb->map_nr; i++) {
-		struct sbitmap_word *map = &sb->map[index];
+	for (i = 0; i < nr_words; i++) {
+		struct sbitmap_word *map;
 		unsigned long get_mask;
-		unsigned int map_depth = __map_depth(sb, index);
+		unsigned int map_depth;
 		unsigned long val;
 
+		index = start + off;
+		if (index >= sb->map_nr)
+			index -= sb->map_nr;
+		map = &sb->map[index];
+		map_depth = __map_depth(sb, index);
+
 		sbitmap_deferred_clear(map, 0, 0, 0);
 		val = READ_ONCE(map->word);
 		if (val == (1UL << (map_depth - 1)) - 1)
@@ -534,20 +648,69 @@ unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
 			get_mask = (get_mask & ~val) >> nr;
 			if (get_mask) {
 				*offset = nr + (index << sb->shift);
-				update_alloc_hint_after_get(sb, depth, hint,
-							*offset + nr_tags - 1);
 				return get_mask;
 			}
 		}
 next:
 		/* Jump to next index. */
-		if (++index >= sb->map_nr)
-			index = 0;
+		if (++off >= nr_words)
+			off = 0;
 	}
 
 	return 0;
 }
 
+unsigned long __sbitmap_queue_get_batch(struct sbitmap_queue *sbq, int nr_tags,
+					unsigned int *offset)
+{
+	struct sbitmap *sb = &sbq->sb;
+	unsigned int hint, depth, index, start, end, nr_words;
+	unsigned int map_nr = sb->map_nr;
+	unsigned long mask;
+	int node;
+
+	if (unlikely(sb->round_robin))
+		return 0;
+
+	depth = READ_ONCE(sb->depth);
+	hint = update_alloc_hint_before_get(sb, depth);
+
+	index = SB_NR_TO_INDEX(sb, hint);
+
+	if (!sb->node_start) {
+		mask = sbitmap_get_batch_window(sb, 0, map_nr, index, nr_tags,
+						offset);
+		goto out;
+	}
+
+	/* Same order as sbitmap_find_bit(): local partition first */
+	node = numa_node_id();
+	start = min(sb->node_start[node], map_nr);
+	end = min(sb->node_start[node + 1], map_nr);
+
+	if (start < end) {
+		if (index < start || index >= end)
+			index = start;
+		mask = sbitmap_get_batch_window(sb, start, end - start, index,
+						nr_tags, offset);
+		if (mask)
+			goto out;
+	}
+
+	nr_words = map_nr - (end - start);
+	if (!nr_words)
+		return 0;
+	if (end == map_nr)
+		end = 0;
+	mask = sbitmap_get_batch_window(sb, end, nr_words, end, nr_tags,
+					offset);
+out:
+	if (mask)
+		update_alloc_hint_after_get(sb, depth, hint,
+					    *offset + nr_tags - 1);
+	return mask;
+}
+
 int sbitmap_queue_get_shallow(struct sbitmap_queue *sbq,
 			      unsigned int shallow_depth)
 {
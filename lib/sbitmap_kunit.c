@@ -0,0 +1,209 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests and tag allocation benchmark for sbitmap.
+ */
+
+#include <kunit/test.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/sbitmap.h>
+#include <linux/slab.h>
+
+#define SBITMAP_TEST_DEPTH	1024
+#define SBITMAP_BENCH_DEPTH	256	/* a typical hardware queue depth */
+#define SBITMAP_BENCH_MS	1000
+#define SBITMAP_BENCH_THREADS	64
+
+static void sbitmap_test_exhaust(struct kunit *test, bool partitioned)
+{
+	unsigned long *seen;
+	struct sbitmap sb;
+	int i, nr;
+
+	KUNIT_ASSERT_EQ(test, sbitmap_init_node(&sb, SBITMAP_TEST_DEPTH, -1,
+						GFP_KERNEL, NUMA_NO_NODE,
+						false, true), 0);
+	if (partitioned)
+		KUNIT_ASSERT_EQ(test, sbitmap_partition_by_node(&sb, GFP_KERNEL), 0);
+
+	seen = kunit_kcalloc(test, BITS_TO_LONGS(SBITMAP_TEST_DEPTH),
+			     sizeof(long), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, seen);
+
+	/* Every bit is handed out exactly once, local or stolen */
+	for (i = 0; i < SBITMAP_TEST_DEPTH; i++) {
+		nr = sbitmap_get(&sb);
+		KUNIT_ASSERT_GE(test, nr, 0);
+		KUNIT_ASSERT_LT(test, nr, SBITMAP_TEST_DEPTH);
+		KUNIT_EXPECT_FALSE(test, test_and_set_bit(nr, seen));
+	}
+	KUNIT_EXPECT_EQ(test, sbitmap_get(&sb), -1);
+	KUNIT_EXPECT_EQ(test, sbitmap_weight(&sb), SBITMAP_TEST_DEPTH);
+
+	for (i = 0; i < SBITMAP_TEST_DEPTH; i++)
+		sbitmap_clear_bit(&sb, i);
+	KUNIT_EXPECT_FALSE(test, sbitmap_any_bit_set(&sb));
+
+	sbitmap_free(&sb);
+}
+
+static void sbitmap_test_flat(struct kunit *test)
+{
+	sbitmap_test_exhaust(test, false);
+}
+
+static void sbitmap_test_partitioned(struct kunit *test)
+{
+	sbitmap_test_exhaust(test, true);
+}
+
+static void sbitmap_test_local_first(struct kunit *test)
+{
+	unsigned int start, end, i;
+	struct sbitmap sb;
+	int node, nr;
+
+	if (nr_node_ids == 1)
+		kunit_skip(test, "single NUMA node");
+
+	KUNIT_ASSERT_EQ(test, sbitmap_init_node(&sb, SBITMAP_TEST_DEPTH, -1,
+						GFP_KERNEL, NUMA_NO_NODE,
+						false, true), 0);
+	KUNIT_ASSERT_EQ(test, sbitmap_partition_by_node(&sb, GFP_KERNEL), 0);
+	KUNIT_ASSERT_NOT_NULL(test, sb.node_start);
+
+	KUNIT_EXPECT_EQ(test, sb.node_start[0], 0);
+	KUNIT_EXPECT_EQ(test, sb.node_start[nr_node_ids], sb.map_nr);
+	for (i = 0; i < nr_node_ids; i++)
+		KUNIT_EXPECT_LE(test, sb.node_start[i], sb.node_start[i + 1]);
+
+	migrate_disable();
+	node = numa_node_id();
+	start = sb.node_start[node] << sb.shift;
+	end = min(sb.node_start[node + 1] << sb.shift, sb.depth);
+
+	/* The local partition is used up before any other bit */
+	for (i = start; i < end; i++) {
+		nr = sbitmap_get(&sb);
+		KUNIT_EXPECT_GE(test, nr, start);
+		KUNIT_EXPECT_LT(test, nr, end);
+	}
+
+	nr = sbitmap_get(&sb);
+	if (end - start < sb.depth) {
+		KUNIT_EXPECT_GE(test, nr, 0);
+		KUNIT_EXPECT_TRUE(test, nr < start || nr >= end);
+	}
+	migrate_enable();
+
+	sbitmap_free(&sb);
+}
+
+struct sbitmap_bench_thread {
+	struct task_struct	*task;
+	struct sbitmap_queue	*sbq;
+	u64			gets;
+};
+
+/*
+ * Get and free one tag at a time until stopped. Only successful gets are
+ * counted; a get that finds the map full allocated nothing.
+ */
+static int sbitmap_bench_fn(void *arg)
+{
+	struct sbitmap_bench_thread *t = arg;
+	int nr;
+
+	while (!kthread_should_stop()) {
+		nr = __sbitmap_queue_get(t->sbq);
+		if (nr >= 0) {
+			sbitmap_queue_clear(t->sbq, nr, raw_smp_processor_id());
+			t->gets++;
+		}
+		cond_resched();
+	}
+	return 0;
+}
+
+static void sbitmap_bench_run(struct kunit *test, bool partitioned)
+{
+	struct sbitmap_bench_thread *threads;
+	struct sbitmap_queue sbq;
+	unsigned int nr = 0, i;
+	u64 start, ns, gets = 0;
+	bool failed = false;
+	int cpu;
+
+	KUNIT_ASSERT_EQ(test, sbitmap_queue_init_node(&sbq, SBITMAP_BENCH_DEPTH,
+						      -1, false, GFP_KERNEL,
+						      NUMA_NO_NODE), 0);
+	if (partitioned && sbitmap_partition_by_node(&sbq.sb, GFP_KERNEL)) {
+		sbitmap_queue_free(&sbq);
+		KUNIT_FAIL(test, "sbitmap_partition_by_node() failed");
+		return;
+	}
+
+	threads = kunit_kcalloc(test, SBITMAP_BENCH_THREADS, sizeof(*threads),
+				GFP_KERNEL);
+	if (!threads) {
+		sbitmap_queue_free(&sbq);
+		KUNIT_FAIL(test, "out of memory");
+		return;
+	}
+
+	start = ktime_get_ns();
+	for_each_online_cpu(cpu) {
+		struct sbitmap_bench_thread *t = &threads[nr];
+
+		if (nr == SBITMAP_BENCH_THREADS)
+			break;
+		t->sbq = &sbq;
+		t->task = kthread_run_on_cpu(sbitmap_bench_fn, t, cpu,
+					     "sbitmap_bench/%u");
+		if (IS_ERR(t->task)) {
+			KUNIT_FAIL(test, "kthread_run_on_cpu() failed: %pe", t->task);
+			failed = true;
+			break;
+		}
+		nr++;
+	}
+
+	if (!failed)
+		msleep(SBITMAP_BENCH_MS);
+	for (i = 0; i < nr; i++) {
+		kthread_stop(threads[i].task);
+		gets += threads[i].gets;
+	}
+	ns = ktime_get_ns() - start;
+
+	kunit_info(test, "%s: %u threads, %llu tag allocations/s\n",
+		   partitioned ? "per-node" : "flat", nr,
+		   div64_u64(gets * NSEC_PER_SEC, ns ?: 1));
+
+	sbitmap_queue_free(&sbq);
+}
+
+static void sbitmap_bench(struct kunit *test)
+{
+	sbitmap_bench_run(test, false);
+	sbitmap_bench_run(test, true);
+}
+
+static struct kunit_case sbitmap_test_cases[] = {
+	KUNIT_CASE(sbitmap_test_flat),
+	KUNIT_CASE(sbitmap_test_partitioned),
+	KUNIT_CASE(sbitmap_test_local_first),
+	KUNIT_CASE_SLOW(sbitmap_bench),
+	{}
+};
+
+static struct kunit_suite sbitmap_test_suite = {
+	.name = "sbitmap",
+	.test_cases = sbitmap_test_cases,
+};
+kunit_test_suite(sbitmap_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests and benchmark for sbitmap");
+MODULE_LICENSE("GPL");
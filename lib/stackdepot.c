@@ -22,6 +22,7 @@
 #include <linux/list.h>
 #include <linux/mm.h>
 #include <linux/mutex.h>
+#include <linux/percpu.h>
 #include <linux/poison.h>
 #include <linux/printk.h>
 #include <linux/rculist.h>
@@ -55,7 +56,7 @@ static bool __stack_depot_early_init_passed __initdata;
 #define STACK_HASH_SEED 0x9747b28c
 
 /* Hash table of stored stack records. */
-static struct list_head *stack_table;
+static struct stack_record **stack_table;
 /* Fixed order of the number of table buckets. Used when KASAN is enabled. */
 static unsigned int stack_bucket_number_order;
 /* Hash mask for indexing the table. */
@@ -71,9 +72,30 @@ static int pools_num;
 static size_t pool_offset = DEPOT_POOL_SIZE;
 /* Freelist of stack records within stack_pools. */
 static LIST_HEAD(free_stacks);
-/* The lock must be held when performing pool or freelist modifications. */
+/*
+ * The lock must be held when performing pool or freelist modifications, and
+ * when unlinking records from the hash table. Linking new records into the
+ * hash table is lock-free.
+ */
 static DEFINE_RAW_SPINLOCK(pool_lock);
 
+/*
+ * Each CPU reserves a chunk of the current pool under pool_lock and then
+ * carves new records out of it without the lock. A record that lost an
+ * insertion race is kept as spare and used for the next allocation.
+ */
+#define DEPOT_CHUNK_SIZE (DEPOT_POOL_SIZE / 4)
+static_assert(sizeof(struct stack_record) <= DEPOT_CHUNK_SIZE);
+
+struct depot_chunk {
+	u32 pool_index;
+	size_t offset;			/* Offset of the unused space in the pool */
+	size_t end;			/* End of the chunk in the pool */
+	struct stack_record *spare;
+	size_t spare_size;
+};
+static DEFINE_PER_CPU(struct depot_chunk, depot_chunks);
+
 /* Statistics counters for debugfs. */
 enum depot_counter_id {
 	DEPOT_COUNTER_REFD_ALLOCS,
@@ -84,7 +106,7 @@ enum depot_counter_id {
 	DEPOT_COUNTER_PERSIST_BYTES,
 	DEPOT_COUNTER_COUNT,
 };
-static long counters[DEPOT_COUNTER_COUNT];
+static DEFINE_PER_CPU(long, counters[DEPOT_COUNTER_COUNT]);
 static const char *const counter_names[] = {
 	[DEPOT_COUNTER_REFD_ALLOCS]	= "refcounted_allocations",
 	[DEPOT_COUNTER_REFD_FREES]	= "refcounted_frees",
@@ -109,13 +131,13 @@ void __init stack_depot_request_early_init(void)
 	__stack_depot_early_init_requested = true;
 }
 
-/* Initialize list_head's within the hash table. */
+/* Initialize the buckets of the hash table. */
 static void init_stack_table(unsigned long entries)
 {
 	unsigned long i;
 
 	for (i = 0; i < entries; i++)
-		INIT_LIST_HEAD(&stack_table[i]);
+		stack_table[i] = NULL;
 }
 
 /* Allocates a hash table via memblock. Can only be used during early boot. */
@@ -160,7 +182,7 @@ int __init stack_depot_early_init(void)
 		entries = 1UL << stack_bucket_number_order;
 	pr_info("allocating hash table via alloc_large_system_hash\n");
 	stack_table = alloc_large_system_hash("stackdepot",
-						sizeof(struct list_head),
+						sizeof(struct stack_record *),
 						entries,
 						STACK_HASH_TABLE_SCALE,
 						HASH_EARLY,
@@ -221,7 +243,7 @@ int stack_depot_init(void)
 		entries = 1UL << STACK_BUCKET_NUMBER_ORDER_MAX;
 
 	pr_info("allocating hash table of %lu entries via kvcalloc\n", entries);
-	stack_table = kvcalloc(entries, sizeof(struct list_head), GFP_KERNEL);
+	stack_table = kvcalloc(entries, sizeof(struct stack_record *), GFP_KERNEL);
 	if (!stack_table) {
 		pr_err("hash table allocation failed, disabling\n");
 		stack_depot_disabled = true;
@@ -304,39 +326,100 @@ static void depot_keep_new_pool(void **prealloc)
 }
 
 /*
- * Try to initialize a new stack record from the current pool, a cached pool, or
- * the current pre-allocation.
+ * Reserve @size bytes from the current pool, a cached pool, or the current
+ * pre-allocation.
  */
-static struct stack_record *depot_pop_free_pool(void **prealloc, size_t size)
+static bool depot_reserve(void **prealloc, size_t size, u32 *pool_index,
+			  size_t *offset)
 {
-	struct stack_record *stack;
-	void *current_pool;
-	u32 pool_index;
-
 	lockdep_assert_held(&pool_lock);
 
 	if (pool_offset + size > DEPOT_POOL_SIZE) {
 		if (!depot_init_pool(prealloc))
-			return NULL;
+			return false;
 	}
 
 	if (WARN_ON_ONCE(pools_num < 1))
-		return NULL;
-	pool_index = pools_num - 1;
-	current_pool = stack_pools[pool_index];
-	if (WARN_ON_ONCE(!current_pool))
-		return NULL;
+		return false;
+	*pool_index = pools_num - 1;
+	if (WARN_ON_ONCE(!stack_pools[*pool_index]))
+		return false;
 
-	stack = current_pool + pool_offset;
+	*offset = pool_offset;
+	pool_offset += size;
+
+	return true;
+}
+
+static struct stack_record *depot_init_record(u32 pool_index, size_t offset)
+{
+	struct stack_record *stack = stack_pools[pool_index] + offset;
 
 	/* Pre-initialize handle once. */
 	stack->handle.pool_index_plus_1 = pool_index + 1;
-	stack->handle.offset = pool_offset >> DEPOT_STACK_ALIGN;
+	stack->handle.offset = offset >> DEPOT_STACK_ALIGN;
 	stack->handle.extra = 0;
-	INIT_LIST_HEAD(&stack->hash_list);
+	stack->next = NULL;
 
-	pool_offset += size;
+	return stack;
+}
+
+/* Try to initialize a new stack record directly from the pools. */
+static struct stack_record *depot_pop_free_pool(void **prealloc, size_t size)
+{
+	size_t offset;
+	u32 pool_index;
 
+	if (!depot_reserve(prealloc, size, &pool_index, &offset))
+		return NULL;
+
+	return depot_init_record(pool_index, offset);
+}
+
+/*
+ * Try to initialize a new stack record from this CPU's spare record or
+ * chunk, reserving a new chunk if the current one is used up.
+ */
+static struct stack_record *depot_pop_free_chunk(void **prealloc, size_t size)
+{
+	struct stack_record *stack = NULL;
+	struct depot_chunk *chunk;
+	unsigned long flags;
+	size_t offset;
+	u32 pool_index;
+
+	local_irq_save(flags);
+	chunk = this_cpu_ptr(&depot_chunks);
+
+	if (chunk->spare && chunk->spare_size >= size) {
+		stack = chunk->spare;
+		chunk->spare = NULL;
+		goto out;
+	}
+
+	if (chunk->offset + size > chunk->end) {
+		raw_spin_lock(&pool_lock);
+		printk_deferred_enter();
+		if (depot_reserve(prealloc, DEPOT_CHUNK_SIZE, &pool_index, &offset)) {
+			/* The rest of the old chunk is lost. */
+			chunk->pool_index = pool_index;
+			chunk->offset = offset;
+			chunk->end = offset + DEPOT_CHUNK_SIZE;
+		} else {
+			/* No room for a whole chunk, try to fit just this record. */
+			stack = depot_pop_free_pool(prealloc, size);
+		}
+		printk_deferred_exit();
+		raw_spin_unlock(&pool_lock);
+
+		if (stack || chunk->offset + size > chunk->end)
+			goto out;
+	}
+
+	stack = depot_init_record(chunk->pool_index, chunk->offset);
+	chunk->offset += size;
+out:
+	local_irq_restore(flags);
 	return stack;
 }
 
@@ -361,7 +444,7 @@ static struct stack_record *depot_pop_free(void)
 		return NULL;
 
 	list_del(&stack->free_list);
-	counters[DEPOT_COUNTER_FREELIST_SIZE]--;
+	this_cpu_dec(counters[DEPOT_COUNTER_FREELIST_SIZE]);
 
 	return stack;
 }
@@ -376,14 +459,18 @@ static inline size_t depot_stack_record_size(struct stack_record *s, unsigned in
 	return ALIGN(sizeof(struct stack_record) - unused, 1 << DEPOT_STACK_ALIGN);
 }
 
-/* Allocates a new stack in a stack depot pool. */
+/*
+ * Allocates a new stack in a stack depot pool. The record is not visible to
+ * anybody until depot_insert_stack() links it into the hash table.
+ */
 static struct stack_record *
 depot_alloc_stack(unsigned long *entries, unsigned int nr_entries, u32 hash, depot_flags_t flags, void **prealloc)
 {
 	struct stack_record *stack = NULL;
 	size_t record_size;
+	unsigned long irqflags;
 
-	lockdep_assert_held(&pool_lock);
+	lockdep_assert_not_held(&pool_lock);
 
 	/* This should already be checked by public API entry points. */
 	if (WARN_ON_ONCE(!nr_entries))
@@ -393,22 +480,44 @@ depot_alloc_stack(unsigned long *entries, unsigned int nr_entries, u32 hash, dep
 	if (nr_entries > CONFIG_STACKDEPOT_MAX_FRAMES)
 		nr_entries = CONFIG_STACKDEPOT_MAX_FRAMES;
 
-	if (flags & STACK_DEPOT_FLAG_GET) {
-		/*
-		 * Evictable entries have to allocate the max. size so they may
-		 * safely be re-used by differently sized allocations.
-		 */
+	/*
+	 * Evictable entries have to allocate the max. size so they may safely
+	 * be re-used by differently sized allocations.
+	 */
+	if (flags & STACK_DEPOT_FLAG_GET)
 		record_size = depot_stack_record_size(stack, CONFIG_STACKDEPOT_MAX_FRAMES);
-		stack = depot_pop_free();
-	} else {
+	else
 		record_size = depot_stack_record_size(stack, nr_entries);
-	}
 
-	if (!stack) {
-		stack = depot_pop_free_pool(prealloc, record_size);
-		if (!stack)
+	if (in_nmi()) {
+		/*
+		 * An NMI may have interrupted this CPU while it was carving a
+		 * record out of its chunk, so go to the pools directly. Best
+		 * effort; bail if we fail to take the lock.
+		 */
+		if (!raw_spin_trylock_irqsave(&pool_lock, irqflags))
 			return NULL;
+		printk_deferred_enter();
+		if (flags & STACK_DEPOT_FLAG_GET)
+			stack = depot_pop_free();
+		if (!stack)
+			stack = depot_pop_free_pool(prealloc, record_size);
+		printk_deferred_exit();
+		raw_spin_unlock_irqrestore(&pool_lock, irqflags);
+	} else {
+		/* data race ok: the freelist is checked again under the lock */
+		if ((flags & STACK_DEPOT_FLAG_GET) && !data_race(list_empty(&free_stacks))) {
+			raw_spin_lock_irqsave(&pool_lock, irqflags);
+			printk_deferred_enter();
+			stack = depot_pop_free();
+			printk_deferred_exit();
+			raw_spin_unlock_irqrestore(&pool_lock, irqflags);
+		}
+		if (!stack)
+			stack = depot_pop_free_chunk(prealloc, record_size);
 	}
+	if (!stack)
+		return NULL;
 
 	/* Save the stack trace. */
 	stack->hash = hash;
@@ -418,13 +527,9 @@ depot_alloc_stack(unsigned long *entries, unsigned int nr_entries, u32 hash, dep
 
 	if (flags & STACK_DEPOT_FLAG_GET) {
 		refcount_set(&stack->count, 1);
-		counters[DEPOT_COUNTER_REFD_ALLOCS]++;
-		counters[DEPOT_COUNTER_REFD_INUSE]++;
 	} else {
 		/* Warn on attempts to switch to refcounting this entry. */
 		refcount_set(&stack->count, REFCOUNT_SATURATED);
-		counters[DEPOT_COUNTER_PERSIST_COUNT]++;
-		counters[DEPOT_COUNTER_PERSIST_BYTES] += record_size;
 	}
 
 	/*
@@ -436,6 +541,43 @@ depot_alloc_stack(unsigned long *entries, unsigned int nr_entries, u32 hash, dep
 	return stack;
 }
 
+/* Accounts for a record that made it into the hash table. */
+static void depot_count_stack(struct stack_record *stack, depot_flags_t flags)
+{
+	if (flags & STACK_DEPOT_FLAG_GET) {
+		this_cpu_inc(counters[DEPOT_COUNTER_REFD_ALLOCS]);
+		this_cpu_inc(counters[DEPOT_COUNTER_REFD_INUSE]);
+	} else {
+		this_cpu_inc(counters[DEPOT_COUNTER_PERSIST_COUNT]);
+		this_cpu_add(counters[DEPOT_COUNTER_PERSIST_BYTES],
+			     depot_stack_record_size(stack, stack->size));
+	}
+}
+
+/*
+ * Keeps a record that lost an insertion race for the next allocation on this
+ * CPU. It was never visible to anybody, so it can be reused right away.
+ */
+static void depot_discard_stack(struct stack_record *stack, depot_flags_t flags)
+{
+	struct depot_chunk *chunk;
+	unsigned long irqflags;
+
+	/* NMIs must not touch the chunk; the record is lost, which is rare. */
+	if (in_nmi())
+		return;
+
+	local_irq_save(irqflags);
+	chunk = this_cpu_ptr(&depot_chunks);
+	if (!chunk->spare) {
+		chunk->spare = stack;
+		chunk->spare_size = depot_stack_record_size(stack,
+			(flags & STACK_DEPOT_FLAG_GET) ? CONFIG_STACKDEPOT_MAX_FRAMES :
+							 stack->size);
+	}
+	local_irq_restore(irqflags);
+}
+
 static struct stack_record *depot_fetch_stack(depot_stack_handle_t handle)
 {
 	const int pools_num_cached = READ_ONCE(pools_num);
@@ -464,45 +606,74 @@ static struct stack_record *depot_fetch_stack(depot_stack_handle_t handle)
 	return stack;
 }
 
-/* Links stack into the freelist. */
-static void depot_free_stack(struct stack_record *stack)
+/*
+ * Removes stack from its hash table bucket. Inserters only ever replace the
+ * bucket head, all other links are only changed under pool_lock.
+ */
+static void depot_unlink_stack(struct stack_record *stack)
+{
+	struct stack_record **bucket = &stack_table[stack->hash & stack_hash_mask];
+	struct stack_record *prev;
+
+	lockdep_assert_held(&pool_lock);
+
+	prev = cmpxchg(bucket, stack, stack->next);
+	if (prev == stack)
+		return;
+
+	/* Not (or no longer) the head, so prev->next is stable. */
+	while (prev->next != stack)
+		prev = prev->next;
+	WRITE_ONCE(prev->next, stack->next);
+}
+
+/* Links stacks into the freelist. */
+static void depot_free_stacks(struct stack_record **stacks, unsigned int nr)
 {
+	struct stack_record *stack;
 	unsigned long flags;
+	unsigned int i;
 
 	lockdep_assert_not_held(&pool_lock);
 
 	raw_spin_lock_irqsave(&pool_lock, flags);
 	printk_deferred_enter();
 
-	/*
-	 * Remove the entry from the hash list. Concurrent list traversal may
-	 * still observe the entry, but since the refcount is zero, this entry
-	 * will no longer be considered as valid.
-	 */
-	list_del_rcu(&stack->hash_list);
+	for (i = 0; i < nr; i++) {
+		stack = stacks[i];
 
-	/*
-	 * Due to being used from constrained contexts such as the allocators,
-	 * NMI, or even RCU itself, stack depot cannot rely on primitives that
-	 * would sleep (such as synchronize_rcu()) or recursively call into
-	 * stack depot again (such as call_rcu()).
-	 *
-	 * Instead, get an RCU cookie, so that we can ensure this entry isn't
-	 * moved onto another list until the next grace period, and concurrent
-	 * RCU list traversal remains safe.
-	 */
-	stack->rcu_state = get_state_synchronize_rcu();
+		/*
+		 * Remove the entry from the hash list. Concurrent list
+		 * traversal may still observe the entry, but since the
+		 * refcount is zero, this entry will no longer be considered
+		 * as valid.
+		 */
+		depot_unlink_stack(stack);
 
-	/*
-	 * Add the entry to the freelist tail, so that older entries are
-	 * considered first - their RCU cookie is more likely to no longer be
-	 * associated with the current grace period.
-	 */
-	list_add_tail(&stack->free_list, &free_stacks);
+		/*
+		 * Due to being used from constrained contexts such as the
+		 * allocators, NMI, or even RCU itself, stack depot cannot rely
+		 * on primitives that would sleep (such as synchronize_rcu())
+		 * or recursively call into stack depot again (such as
+		 * call_rcu()).
+		 *
+		 * Instead, get an RCU cookie, so that we can ensure this entry
+		 * isn't moved onto another list until the next grace period,
+		 * and concurrent RCU list traversal remains safe.
+		 */
+		stack->rcu_state = get_state_synchronize_rcu();
 
-	counters[DEPOT_COUNTER_FREELIST_SIZE]++;
-	counters[DEPOT_COUNTER_REFD_FREES]++;
-	counters[DEPOT_COUNTER_REFD_INUSE]--;
+		/*
+		 * Add the entry to the freelist tail, so that older entries
+		 * are considered first - their RCU cookie is more likely to no
+		 * longer be associated with the current grace period.
+		 */
+		list_add_tail(&stack->free_list, &free_stacks);
+	}
+
+	this_cpu_add(counters[DEPOT_COUNTER_FREELIST_SIZE], nr);
+	this_cpu_add(counters[DEPOT_COUNTER_REFD_FREES], nr);
+	this_cpu_sub(counters[DEPOT_COUNTER_REFD_INUSE], nr);
 
 	printk_deferred_exit();
 	raw_spin_unlock_irqrestore(&pool_lock, flags);
@@ -531,8 +702,13 @@ int stackdepot_memcmp(const unsigned long *u1, const unsigned long *u2,
 	return 0;
 }
 
-/* Finds a stack in a bucket of the hash table. */
-static inline struct stack_record *find_stack(struct list_head *bucket,
+/*
+ * Finds a stack in a bucket of the hash table, only looking at the records in
+ * front of @stop. The head of the bucket that was searched is stored in @head.
+ */
+static inline struct stack_record *find_stack(struct stack_record **bucket,
+					      struct stack_record *stop,
+					      struct stack_record **head,
 					      unsigned long *entries, int size,
 					      u32 hash, depot_flags_t flags)
 {
@@ -549,12 +725,14 @@ static inline struct stack_record *find_stack(struct list_head *bucket,
 	 */
 	rcu_read_lock_sched_notrace();
 
-	list_for_each_entry_rcu(stack, bucket, hash_list) {
+	*head = rcu_dereference_raw(*bucket);
+	for (stack = *head; stack && stack != stop;
+	     stack = rcu_dereference_raw(stack->next)) {
 		if (stack->hash != hash || stack->size != size)
 			continue;
 
 		/*
-		 * This may race with depot_free_stack() accessing the freelist
+		 * This may race with depot_free_stacks() accessing the freelist
 		 * management state unioned with @entries. The refcount is zero
 		 * in that case and the below refcount_inc_not_zero() will fail.
 		 */
@@ -581,13 +759,44 @@ static inline struct stack_record *find_stack(struct list_head *bucket,
 	return ret;
 }
 
+/*
+ * Links a new record into its bucket with cmpxchg() on the bucket head,
+ * unless somebody inserted the same stack since the bucket was last searched
+ * with @seen as head. Returns the record that is in the hash table.
+ */
+static struct stack_record *depot_insert_stack(struct stack_record **bucket,
+					       struct stack_record *seen,
+					       struct stack_record *new,
+					       unsigned long *entries, int size,
+					       u32 hash, depot_flags_t flags)
+{
+	struct stack_record *found, *head;
+
+	for (;;) {
+		found = find_stack(bucket, seen, &head, entries, size, hash, flags);
+		if (found)
+			return found;
+
+		/*
+		 * This releases the stack record into the bucket and makes it
+		 * visible to readers in find_stack().
+		 */
+		new->next = head;
+		if (cmpxchg(bucket, head, new) == head)
+			return new;
+
+		/* Only look at what was added in front of head next time. */
+		seen = head;
+	}
+}
+
 depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
 					    unsigned int nr_entries,
 					    gfp_t alloc_flags,
 					    depot_flags_t depot_flags)
 {
-	struct list_head *bucket;
-	struct stack_record *found = NULL;
+	struct stack_record **bucket;
+	struct stack_record *found = NULL, *head, *new;
 	depot_stack_handle_t handle = 0;
 	struct page *page = NULL;
 	void *prealloc = NULL;
@@ -615,7 +824,7 @@ depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
 	bucket = &stack_table[hash & stack_hash_mask];
 
 	/* Fast path: look the stack trace up without locking. */
-	found = find_stack(bucket, entries, nr_entries, hash, depot_flags);
+	found = find_stack(bucket, NULL, &head, entries, nr_entries, hash, depot_flags);
 	if (found)
 		goto exit;
 
@@ -630,31 +839,18 @@ depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
 			prealloc = page_address(page);
 	}
 
-	if (in_nmi()) {
-		/* We can never allocate in NMI context. */
-		WARN_ON_ONCE(can_alloc);
-		/* Best effort; bail if we fail to take the lock. */
-		if (!raw_spin_trylock_irqsave(&pool_lock, flags))
-			goto exit;
-	} else {
-		raw_spin_lock_irqsave(&pool_lock, flags);
-	}
-	printk_deferred_enter();
+	/* We can never allocate in NMI context. */
+	WARN_ON_ONCE(in_nmi() && can_alloc);
 
-	/* Try to find again, to avoid concurrently inserting duplicates. */
-	found = find_stack(bucket, entries, nr_entries, hash, depot_flags);
-	if (!found) {
-		struct stack_record *new =
-			depot_alloc_stack(entries, nr_entries, hash, depot_flags, &prealloc);
-
-		if (new) {
-			/*
-			 * This releases the stack record into the bucket and
-			 * makes it visible to readers in find_stack().
-			 */
-			list_add_rcu(&new->hash_list, bucket);
-			found = new;
-		}
+	new = depot_alloc_stack(entries, nr_entries, hash, depot_flags, &prealloc);
+	if (new) {
+		/* The insertion re-checks for a concurrently added duplicate. */
+		found = depot_insert_stack(bucket, head, new, entries, nr_entries,
+					   hash, depot_flags);
+		if (found == new)
+			depot_count_stack(new, depot_flags);
+		else
+			depot_discard_stack(new, depot_flags);
 	}
 
 	if (prealloc) {
@@ -663,11 +859,12 @@ depot_stack_handle_t stack_depot_save_flags(unsigned long *entries,
 		 * depot_alloc_stack() did not consume the preallocated memory.
 		 * Try to keep the preallocated memory for future.
 		 */
+		raw_spin_lock_irqsave(&pool_lock, flags);
+		printk_deferred_enter();
 		depot_keep_new_pool(&prealloc);
+		printk_deferred_exit();
+		raw_spin_unlock_irqrestore(&pool_lock, flags);
 	}
-
-	printk_deferred_exit();
-	raw_spin_unlock_irqrestore(&pool_lock, flags);
 exit:
 	if (prealloc) {
 		/* Stack depot didn't use this memory, free it. */
@@ -740,10 +937,45 @@ void stack_depot_put(depot_stack_handle_t handle)
 		return;
 
 	if (refcount_dec_and_test(&stack->count))
-		depot_free_stack(stack);
+		depot_free_stacks(&stack, 1);
 }
 EXPORT_SYMBOL_GPL(stack_depot_put);
 
+/* Number of stacks evicted under one pool_lock section. */
+#define DEPOT_EVICT_BATCH 16
+
+void stack_depot_put_batch(const depot_stack_handle_t *handles,
+			   unsigned int nr)
+{
+	struct stack_record *batch[DEPOT_EVICT_BATCH];
+	struct stack_record *stack;
+	unsigned int i, n = 0;
+
+	if (stack_depot_disabled)
+		return;
+
+	for (i = 0; i < nr; i++) {
+		if (!handles[i])
+			continue;
+
+		stack = depot_fetch_stack(handles[i]);
+		if (WARN(!stack, "corrupt handle or unbalanced stack_depot_put_batch()"))
+			continue;
+		if (!refcount_dec_and_test(&stack->count))
+			continue;
+
+		batch[n++] = stack;
+		if (n == DEPOT_EVICT_BATCH) {
+			depot_free_stacks(batch, n);
+			n = 0;
+		}
+	}
+
+	if (n)
+		depot_free_stacks(batch, n);
+}
+EXPORT_SYMBOL_GPL(stack_depot_put_batch);
+
 void stack_depot_print(depot_stack_handle_t stack)
 {
 	unsigned long *entries;
@@ -796,8 +1028,14 @@ static int stats_show(struct seq_file *seq, void *v)
 	 * statistics are ok for debugging.
 	 */
 	seq_printf(seq, "pools: %d\n", data_race(pools_num));
-	for (int i = 0; i < DEPOT_COUNTER_COUNT; i++)
-		seq_printf(seq, "%s: %ld\n", counter_names[i], data_race(counters[i]));
+	for (int i = 0; i < DEPOT_COUNTER_COUNT; i++) {
+		long sum = 0;
+		int cpu;
+
+		for_each_possible_cpu(cpu)
+			sum += data_race(per_cpu(counters[i], cpu));
+		seq_printf(seq, "%s: %ld\n", counter_names[i], sum);
+	}
 
 	return 0;
 }
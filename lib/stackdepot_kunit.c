@@ -0,0 +1,207 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests and insertion stress test for stack depot.
+ */
+
+#include <kunit/test.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/slab.h>
+#include <linux/stackdepot.h>
+
+#define DEPOT_TEST_FRAMES	8
+#define DEPOT_TEST_STACKS	64
+#define DEPOT_STRESS_STACKS	1024
+#define DEPOT_STRESS_MS		1000
+#define DEPOT_STRESS_THREADS	64
+
+/* Fake, but distinct and stable, stack traces. */
+static void depot_test_fill(unsigned long *entries, unsigned int id)
+{
+	unsigned long base = (unsigned long)depot_test_fill;
+	int i;
+
+	for (i = 0; i < DEPOT_TEST_FRAMES; i++)
+		entries[i] = base + ((unsigned long)id << 8) + i;
+}
+
+static depot_stack_handle_t depot_test_save(unsigned int id)
+{
+	unsigned long entries[DEPOT_TEST_FRAMES];
+
+	depot_test_fill(entries, id);
+	return stack_depot_save_flags(entries, DEPOT_TEST_FRAMES, GFP_KERNEL,
+				      STACK_DEPOT_FLAG_CAN_ALLOC |
+				      STACK_DEPOT_FLAG_GET);
+}
+
+static void depot_test_dedup(struct kunit *test)
+{
+	unsigned long expected[DEPOT_TEST_FRAMES], *entries;
+	depot_stack_handle_t handles[3];
+
+	handles[0] = depot_test_save(0);
+	handles[1] = depot_test_save(0);
+	handles[2] = depot_test_save(1);
+	KUNIT_ASSERT_NE(test, handles[0], 0);
+	KUNIT_EXPECT_EQ(test, handles[0], handles[1]);
+	KUNIT_EXPECT_NE(test, handles[0], handles[2]);
+
+	depot_test_fill(expected, 0);
+	KUNIT_ASSERT_EQ(test, stack_depot_fetch(handles[0], &entries),
+			DEPOT_TEST_FRAMES);
+	KUNIT_EXPECT_MEMEQ(test, entries, expected, sizeof(expected));
+
+	stack_depot_put_batch(handles, ARRAY_SIZE(handles));
+}
+
+static void depot_test_put_batch(struct kunit *test)
+{
+	unsigned long expected[DEPOT_TEST_FRAMES], *entries;
+	depot_stack_handle_t *handles;
+	unsigned int i;
+
+	handles = kunit_kcalloc(test, DEPOT_TEST_STACKS, sizeof(*handles), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, handles);
+
+	/* Two references each; every other slot is left empty. */
+	for (i = 0; i < DEPOT_TEST_STACKS; i += 2) {
+		handles[i] = depot_test_save(i);
+		KUNIT_ASSERT_NE(test, handles[i], 0);
+		KUNIT_ASSERT_EQ(test, depot_test_save(i), handles[i]);
+	}
+
+	/* Dropping one reference keeps all of them around. */
+	stack_depot_put_batch(handles, DEPOT_TEST_STACKS);
+	for (i = 0; i < DEPOT_TEST_STACKS; i += 2) {
+		depot_test_fill(expected, i);
+		KUNIT_ASSERT_EQ(test, stack_depot_fetch(handles[i], &entries),
+				DEPOT_TEST_FRAMES);
+		KUNIT_EXPECT_MEMEQ(test, entries, expected, sizeof(expected));
+	}
+
+	stack_depot_put_batch(handles, DEPOT_TEST_STACKS);
+}
+
+struct depot_stress {
+	depot_stack_handle_t	handles[DEPOT_STRESS_STACKS];
+	atomic_t		mismatches;
+};
+
+struct depot_stress_thread {
+	struct depot_stress	*s;
+	struct task_struct	*task;
+	unsigned int		id;
+	unsigned int		loops;
+	depot_stack_handle_t	held[DEPOT_STRESS_STACKS];
+	depot_stack_handle_t	handles[DEPOT_STRESS_STACKS];
+};
+
+static void depot_stress_save_all(struct depot_stress_thread *t,
+				  depot_stack_handle_t *handles)
+{
+	struct depot_stress *s = t->s;
+	depot_stack_handle_t handle, old;
+	unsigned int i, id;
+
+	for (i = 0; i < DEPOT_STRESS_STACKS; i++) {
+		id = (i + t->id * 7) % DEPOT_STRESS_STACKS;
+		handle = depot_test_save(id);
+		old = cmpxchg(&s->handles[id], 0, handle);
+		if (!handle || (old && old != handle))
+			atomic_inc(&s->mismatches);
+		handles[id] = handle;
+	}
+}
+
+/*
+ * Every thread saves all stacks, starting at a different one, so that the
+ * same new stacks are inserted concurrently, and keeps one reference to each
+ * until it is stopped. Meanwhile it repeatedly takes and drops further
+ * references. Since no stack can be evicted while it is held, all threads
+ * must always get the same handle for a stack.
+ */
+static int depot_stress_fn(void *arg)
+{
+	struct depot_stress_thread *t = arg;
+
+	depot_stress_save_all(t, t->held);
+	while (!kthread_should_stop()) {
+		depot_stress_save_all(t, t->handles);
+		stack_depot_put_batch(t->handles, DEPOT_STRESS_STACKS);
+		t->loops++;
+		cond_resched();
+	}
+	stack_depot_put_batch(t->held, DEPOT_STRESS_STACKS);
+	return 0;
+}
+
+static void depot_test_stress(struct kunit *test)
+{
+	struct depot_stress_thread *threads;
+	unsigned int nr = 0, i;
+	struct depot_stress *s;
+	u64 start, ns, saves = 0;
+	bool failed = false;
+	int cpu;
+
+	s = kunit_kzalloc(test, sizeof(*s), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, s);
+	threads = kunit_kcalloc(test, DEPOT_STRESS_THREADS, sizeof(*threads), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, threads);
+
+	start = ktime_get_ns();
+	for_each_online_cpu(cpu) {
+		struct depot_stress_thread *t = &threads[nr];
+
+		if (nr == DEPOT_STRESS_THREADS)
+			break;
+		t->s = s;
+		t->id = nr;
+		t->task = kthread_run_on_cpu(depot_stress_fn, t, cpu, "depot_stress/%u");
+		if (IS_ERR(t->task)) {
+			KUNIT_FAIL(test, "kthread_run_on_cpu() failed: %pe", t->task);
+			failed = true;
+			break;
+		}
+		nr++;
+	}
+
+	/* Stopping also waits for the threads to drop their references. */
+	if (!failed)
+		msleep(DEPOT_STRESS_MS);
+	for (i = 0; i < nr; i++) {
+		kthread_stop(threads[i].task);
+		saves += (u64)(1 + threads[i].loops) * DEPOT_STRESS_STACKS;
+	}
+	ns = ktime_get_ns() - start;
+
+	KUNIT_EXPECT_EQ(test, atomic_read(&s->mismatches), 0);
+
+	kunit_info(test, "%u threads, %llu saves/s\n", nr,
+		   div64_u64(saves * NSEC_PER_SEC, ns ?: 1));
+}
+
+static int depot_test_init(struct kunit *test)
+{
+	return stack_depot_init();
+}
+
+static struct kunit_case depot_test_cases[] = {
+	KUNIT_CASE(depot_test_dedup),
+	KUNIT_CASE(depot_test_put_batch),
+	KUNIT_CASE_SLOW(depot_test_stress),
+	{}
+};
+
+static struct kunit_suite depot_test_suite = {
+	.name = "stackdepot",
+	.init = depot_test_init,
+	.test_cases = depot_test_cases,
+};
+kunit_test_suite(depot_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests and stress test for stack depot");
+MODULE_LICENSE("GPL");
@@ -48,6 +48,8 @@ atomic_t maple_tree_tests_passed;
 /* #define BENCH_FORK */
 /* #define BENCH_MAS_FOR_EACH */
 /* #define BENCH_MAS_PREV */
+/* #define BENCH_BULK_LOAD */
+/* #define BENCH_BULK_STORE */
 
 #ifdef __KERNEL__
 #define mt_set_non_kernel(x)		do {} while (0)
@@ -1996,6 +1998,64 @@ static noinline void __init check_mas_store_gfp(struct maple_tree *mt)
 	mtree_destroy(&newmt);
 }
 
+#if defined(BENCH_BULK_LOAD)
+static noinline void __init bench_bulk_load(void)
+{
+	int i, nr = 100000, count = 200;
+	struct maple_range *ranges;
+	struct maple_tree mt;
+
+	ranges = kcalloc(nr, sizeof(*ranges), GFP_KERNEL);
+	BUG_ON(!ranges);
+
+	/* Laid out like the mappings of a large process being restored */
+	for (i = 0; i < nr; i++) {
+		ranges[i].index = i * 16;
+		ranges[i].last = i * 16 + 9;
+		ranges[i].entry = xa_mk_value(i);
+	}
+
+	for (i = 0; i < count; i++) {
+		mt_init_flags(&mt, MT_FLAGS_ALLOC_RANGE);
+		BUG_ON(mtree_bulk_load(&mt, ranges, nr));
+		mtree_destroy(&mt);
+	}
+
+	kfree(ranges);
+}
+#endif
+
+#if defined(BENCH_BULK_STORE)
+static noinline void __init bench_bulk_store(struct maple_tree *mt)
+{
+	int i, nr = 100000, count = 200;
+	struct maple_range *ranges;
+
+	ranges = kcalloc(nr, sizeof(*ranges), GFP_KERNEL);
+	BUG_ON(!ranges);
+
+	for (i = 0; i < nr; i++)
+		mtree_store_range(mt, i * 16, i * 16 + 9, xa_mk_value(i),
+				  GFP_KERNEL);
+
+	/* Each store overlaps the tail of a range and the following gap */
+	for (i = 0; i < nr; i++) {
+		ranges[i].index = i * 16 + 5;
+		ranges[i].last = i * 16 + 12;
+	}
+
+	for (i = 0; i < count; i++) {
+		int j;
+
+		for (j = 0; j < nr; j++)
+			ranges[j].entry = xa_mk_value(i + j);
+		BUG_ON(mtree_bulk_store(mt, ranges, nr, GFP_KERNEL));
+	}
+
+	kfree(ranges);
+}
+#endif
+
 #if defined(BENCH_FORK)
 static noinline void __init bench_forking(void)
 {
@@ -2769,6 +2829,62 @@ static noinline void __init check_dup(struct maple_tree *mt)
 	}
 }
 
+static struct maple_range bulk_ranges[1000];
+
+static noinline void __init check_bulk(struct maple_tree *mt)
+{
+	unsigned long i, nr = ARRAY_SIZE(bulk_ranges);
+
+	/* Ranges with gaps between them, as VMAs usually are */
+	for (i = 0; i < nr; i++) {
+		bulk_ranges[i].index = i * 16;
+		bulk_ranges[i].last = i * 16 + 9;
+		bulk_ranges[i].entry = xa_mk_value(i);
+	}
+
+	/* Out of order input is rejected before anything is stored */
+	swap(bulk_ranges[10], bulk_ranges[11]);
+	MT_BUG_ON(mt, mtree_bulk_load(mt, bulk_ranges, nr) != -EINVAL);
+	MT_BUG_ON(mt, !mtree_empty(mt));
+	swap(bulk_ranges[10], bulk_ranges[11]);
+
+	MT_BUG_ON(mt, mtree_bulk_load(mt, bulk_ranges, nr) != 0);
+	mt_validate(mt);
+	for (i = 0; i < nr; i++) {
+		MT_BUG_ON(mt, mtree_load(mt, i * 16) != xa_mk_value(i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 9) != xa_mk_value(i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 10) != NULL);
+	}
+
+	/* Only empty trees can be bulk loaded */
+	MT_BUG_ON(mt, mtree_bulk_load(mt, bulk_ranges, nr) != -EEXIST);
+
+	/* Overwrite the tail of every range and the gap after it */
+	for (i = 0; i < nr; i++) {
+		bulk_ranges[i].index = i * 16 + 5;
+		bulk_ranges[i].last = i * 16 + 12;
+		bulk_ranges[i].entry = xa_mk_value(nr + i);
+	}
+	MT_BUG_ON(mt, mtree_bulk_store(mt, bulk_ranges, nr, GFP_KERNEL) != 0);
+	mt_validate(mt);
+	for (i = 0; i < nr; i++) {
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 4) != xa_mk_value(i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 5) != xa_mk_value(nr + i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 12) != xa_mk_value(nr + i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 13) != NULL);
+	}
+
+	/* Storing NULL erases */
+	for (i = 0; i < nr; i++)
+		bulk_ranges[i].entry = NULL;
+	MT_BUG_ON(mt, mtree_bulk_store(mt, bulk_ranges, nr, GFP_KERNEL) != 0);
+	mt_validate(mt);
+	for (i = 0; i < nr; i++) {
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 4) != xa_mk_value(i));
+		MT_BUG_ON(mt, mtree_load(mt, i * 16 + 5) != NULL);
+	}
+}
+
 static noinline void __init check_bnode_min_spanning(struct maple_tree *mt)
 {
 	int i = 50;
@@ -3709,6 +3825,18 @@ static int __init maple_tree_seed(void)
 	mtree_destroy(&tree);
 	goto skip;
 #endif
+#if defined(BENCH_BULK_LOAD)
+#define BENCH
+	bench_bulk_load();
+	goto skip;
+#endif
+#if defined(BENCH_BULK_STORE)
+#define BENCH
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	bench_bulk_store(&tree);
+	mtree_destroy(&tree);
+	goto skip;
+#endif
 
 	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
 	check_root_expand(&tree);
@@ -3903,6 +4031,10 @@ static int __init maple_tree_seed(void)
 	check_dup(&tree);
 	mtree_destroy(&tree);
 
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	check_bulk(&tree);
+	mtree_destroy(&tree);
+
 	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
 	check_bnode_min_spanning(&tree);
 	mtree_destroy(&tree);
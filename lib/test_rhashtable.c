@@ -20,6 +20,7 @@
 #include <linux/rhashtable.h>
 #include <linux/slab.h>
 #include <linux/sched.h>
+#include <linux/sort.h>
 #include <linux/random.h>
 #include <linux/vmalloc.h>
 #include <linux/wait.h>
@@ -206,13 +207,36 @@ static void test_bucket_stats(struct rhashtable *ht, unsigned int entries)
 		pr_warn("Test failed: Total count mismatch ^^^");
 }
 
+static int __init cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * The table starts small and grows through every rehash on the way, so
+ * the tail of the distribution shows what inserts pay while a rehash is
+ * in progress.
+ */
+static void __init test_insert_latency(u32 *lat, unsigned int entries)
+{
+	if (!entries)
+		return;
+
+	sort(lat, entries, sizeof(*lat), cmp_u32, NULL);
+	pr_info("  Insert latency during growth: p50 %u ns, p99 %u ns, max %u ns\n",
+		lat[entries / 2], lat[entries - 1 - entries / 100],
+		lat[entries - 1]);
+}
+
 static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
-				  unsigned int entries)
+				  u32 *lat, unsigned int entries)
 {
 	struct test_obj *obj;
 	int err;
 	unsigned int i, insert_retries = 0;
-	s64 start, end;
+	s64 start, end, t;
 
 	/*
 	 * Insertion Test:
@@ -224,7 +248,9 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 		struct test_obj *obj = &array[i];
 
 		obj->value.id = i * 2;
+		t = ktime_get_ns();
 		err = insert_retry(ht, obj, test_rht_params);
+		lat[i] = min_t(s64, ktime_get_ns() - t, U32_MAX);
 		if (err > 0)
 			insert_retries += err;
 		else if (err)
@@ -235,6 +261,8 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 		pr_info("  %u insertions retried due to memory pressure\n",
 			insert_retries);
 
+	test_insert_latency(lat, entries);
+
 	test_bucket_stats(ht, entries);
 	rcu_read_lock();
 	test_rht_lookup(ht, array, entries);
@@ -267,6 +295,47 @@ static s64 __init test_rhashtable(struct rhashtable *ht, struct test_obj *array,
 static struct rhashtable ht;
 static struct rhltable rhlt;
 
+static int __init test_rhashtable_bulk(struct test_obj *array,
+				       unsigned int entries)
+{
+	struct rhash_head **objs;
+	unsigned int i, inserted;
+	s64 start, end;
+	int err;
+
+	objs = vmalloc(array_size(entries, sizeof(*objs)));
+	if (!objs)
+		return -ENOMEM;
+
+	err = rhashtable_init(&ht, &test_rht_params);
+	if (err) {
+		vfree(objs);
+		return err;
+	}
+
+	for (i = 0; i < entries; i++) {
+		array[i].value.id = i * 2;
+		objs[i] = &array[i].node;
+	}
+
+	start = ktime_get_ns();
+	inserted = rhashtable_insert_bulk(&ht, objs, entries);
+	end = ktime_get_ns();
+
+	pr_info("  Bulk insert of %u of %u keys: %lld ns\n",
+		inserted, entries, end - start);
+
+	rcu_read_lock();
+	err = test_rht_lookup(&ht, array, inserted);
+	rcu_read_unlock();
+	if (!err && inserted != entries)
+		err = -ENOMEM;
+
+	rhashtable_destroy(&ht);
+	vfree(objs);
+	return err;
+}
+
 static int __init test_rhltable(unsigned int entries)
 {
 	struct test_obj_rhl *rhl_test_objects;
@@ -686,6 +755,7 @@ static int __init test_rht_init(void)
 	u64 total_time = 0;
 	struct thread_data *tdata;
 	struct test_obj *objs;
+	u32 *lat;
 
 	if (parm_entries < 0)
 		parm_entries = 1;
@@ -701,6 +771,12 @@ static int __init test_rht_init(void)
 	if (!objs)
 		return -ENOMEM;
 
+	lat = vmalloc(array_size(sizeof(*lat), entries));
+	if (!lat) {
+		vfree(objs);
+		return -ENOMEM;
+	}
+
 	pr_info("Running rhashtable test nelem=%d, max_size=%d, shrinking=%d\n",
 		size, max_size, shrinking);
 
@@ -717,9 +793,10 @@ static int __init test_rht_init(void)
 			continue;
 		}
 
-		time = test_rhashtable(&ht, objs, entries);
+		time = test_rhashtable(&ht, objs, lat, entries);
 		rhashtable_destroy(&ht);
 		if (time < 0) {
+			vfree(lat);
 			vfree(objs);
 			pr_warn("Test failed: return code %lld\n", time);
 			return -EINVAL;
@@ -731,6 +808,13 @@ static int __init test_rht_init(void)
 	pr_info("test if its possible to exceed max_size %d: %s\n",
 			test_rht_params.max_size, test_rhashtable_max(objs, entries) == 0 ?
 			"no, ok" : "YES, failed");
+
+	memset(objs, 0, test_rht_params.max_size * sizeof(struct test_obj));
+	err = test_rhashtable_bulk(objs, entries);
+	if (err)
+		pr_warn("Test failed: bulk insert returned %d\n", err);
+
+	vfree(lat);
 	vfree(objs);
 
 	do_div(total_time, runs);
@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit tests for block-level XZ decoding (xz_dec_scan() and
+ * xz_dec_block_run()).
+ */
+
+#include <kunit/test.h>
+#include <linux/slab.h>
+#include <linux/xz.h>
+
+#define XZ_TEST_LINE		"%05u: block-parallel xz test line\n"
+#define XZ_TEST_LINE_LEN	35
+#define XZ_TEST_MULTI_LINES	400
+#define XZ_TEST_MULTI_BLOCKS	4
+
+/*
+ * xz --check=crc32 -T2 --block-size=4096 of 400 XZ_TEST_LINE lines, which
+ * stores both sizes in every Block Header.
+ */
+static const uint8_t xz_test_multi[] = {
+	0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x01, 0x69, 0x22, 0xde, 0x36,
+	0x03, 0xc0, 0xbc, 0x01, 0x80, 0x20, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+	0x3d, 0x0c, 0x37, 0x36, 0xe0, 0x0f, 0xff, 0x00, 0xb4, 0x5d, 0x00, 0x18,
+	0x69, 0x0a, 0x84, 0x06, 0x63, 0xf3, 0xe7, 0x62, 0x23, 0xb6, 0x32, 0x30,
+	0xa9, 0x59, 0x97, 0xc3, 0xd6, 0xdc, 0x50, 0xe2, 0x31, 0x84, 0x99, 0xb5,
+	0xbe, 0xdf, 0x4f, 0x85, 0xa4, 0x0a, 0xab, 0xca, 0x21, 0x49, 0x17, 0x71,
+	0xdb, 0xf8, 0xb8, 0x52, 0xff, 0x19, 0xb9, 0x77, 0x7a, 0x1d, 0x09, 0x73,
+	0x04, 0xdf, 0x36, 0x66, 0x26, 0xa7, 0x0f, 0xff, 0x8e, 0x26, 0xce, 0x3c,
+	0xc2, 0x15, 0x43, 0x34, 0xc1, 0xfc, 0x9b, 0xdf, 0xc8, 0xd0, 0x4f, 0x46,
+	0xf7, 0xb4, 0xec, 0x94, 0x46, 0x90, 0x6d, 0x3c, 0xfe, 0x6d, 0x29, 0xad,
+	0x54, 0x4d, 0x5b, 0x50, 0x5f, 0xc7, 0xf5, 0xaf, 0xa4, 0x47, 0x6e, 0xce,
+	0x31, 0x39, 0xf9, 0xa9, 0x4e, 0xdc, 0x23, 0x85, 0x88, 0x5b, 0x37, 0xda,
+	0x86, 0x0b, 0x72, 0x58, 0x21, 0x01, 0xb0, 0xec, 0x48, 0xaa, 0x9c, 0x47,
+	0xb3, 0xe1, 0xc0, 0xc4, 0xcc, 0x41, 0xe2, 0x9c, 0xb3, 0xc6, 0x1b, 0x71,
+	0x27, 0x7a, 0x69, 0x86, 0x7d, 0xfa, 0x35, 0x0f, 0xa3, 0xe0, 0xae, 0xd2,
+	0x61, 0xb1, 0x28, 0xce, 0xee, 0x6e, 0x0c, 0x54, 0x86, 0x2c, 0x1b, 0xae,
+	0xc9, 0x73, 0x6a, 0x21, 0x33, 0x50, 0x5e, 0x43, 0x7b, 0x02, 0xa7, 0x13,
+	0x32, 0x45, 0xb2, 0x15, 0xdd, 0x8a, 0x17, 0x66, 0xe0, 0xa1, 0x07, 0x00,
+	0xd3, 0x45, 0x7f, 0x58, 0x03, 0xc0, 0xd7, 0x01, 0x80, 0x20, 0x21, 0x01,
+	0x16, 0x00, 0x00, 0x00, 0xba, 0xf3, 0x30, 0x1f, 0xe0, 0x0f, 0xff, 0x00,
+	0xcf, 0x5d, 0x00, 0x18, 0x0c, 0x6c, 0x6e, 0x3d, 0x8f, 0xbf, 0x57, 0x88,
+	0xba, 0x16, 0xff, 0x61, 0xf8, 0x8b, 0xed, 0x34, 0x30, 0xa1, 0x85, 0x4f,
+	0xba, 0xcc, 0xff, 0x68, 0x76, 0x82, 0xb7, 0xdc, 0x2c, 0x14, 0xf7, 0x4d,
+	0x97, 0xba, 0xe5, 0xa9, 0x84, 0x93, 0x45, 0x4b, 0x74, 0xe7, 0xd8, 0x02,
+	0xb4, 0x27, 0x8b, 0xb9, 0xe2, 0x34, 0x0d, 0xa9, 0x66, 0x84, 0xca, 0xfe,
+	0x69, 0xe1, 0x5e, 0x44, 0x94, 0x37, 0xc6, 0x3b, 0x87, 0x5e, 0x8c, 0xeb,
+	0x4d, 0x17, 0xae, 0xf5, 0xcb, 0x2c, 0x30, 0x65, 0x9e, 0x11, 0xce, 0xb5,
+	0xa4, 0x3b, 0xd5, 0x3f, 0xe6, 0x58, 0xb8, 0x12, 0x22, 0xa9, 0x53, 0xa6,
+	0xf0, 0xcf, 0x05, 0x8c, 0x07, 0x26, 0x04, 0xf7, 0x25, 0x08, 0x80, 0x50,
+	0xb3, 0xe1, 0xfe, 0x91, 0x2f, 0xba, 0xd1, 0x9b, 0x0d, 0x43, 0x3f, 0x89,
+	0xd0, 0x19, 0x69, 0xd2, 0xeb, 0x87, 0xa9, 0xdf, 0xeb, 0x63, 0x44, 0xef,
+	0x8a, 0x51, 0x04, 0xd1, 0xda, 0x0d, 0xaa, 0x10, 0x3a, 0x4a, 0xcb, 0x4f,
+	0x36, 0x1f, 0x11, 0x1c, 0x57, 0x7a, 0x9c, 0x73, 0xcd, 0xfc, 0x30, 0x77,
+	0x95, 0xb0, 0x97, 0x83, 0x13, 0x1a, 0xbe, 0x87, 0x77, 0x24, 0x23, 0xaa,
+	0xb2, 0xf9, 0xbb, 0x12, 0x62, 0xff, 0x2e, 0xdd, 0x56, 0x60, 0xf9, 0x55,
+	0x93, 0xb3, 0xc3, 0xf2, 0x57, 0x79, 0x22, 0x20, 0x58, 0xde, 0xd4, 0x54,
+	0xa5, 0xcd, 0x01, 0x1e, 0xef, 0x0d, 0xbc, 0x94, 0x30, 0xb0, 0x24, 0xa8,
+	0x57, 0x9e, 0x36, 0x69, 0x64, 0x88, 0x00, 0x00, 0x85, 0x0e, 0xb9, 0xfd,
+	0x03, 0xc0, 0xba, 0x01, 0x80, 0x20, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00,
+	0x7a, 0x7c, 0x29, 0x3b, 0xe0, 0x0f, 0xff, 0x00, 0xb2, 0x5d, 0x00, 0x19,
+	0x0c, 0xc2, 0xdd, 0x7a, 0x2a, 0x6b, 0x73, 0x17, 0x9b, 0x39, 0x2e, 0x5a,
+	0x64, 0x77, 0x79, 0x9a, 0xc7, 0x69, 0xbe, 0x09, 0x25, 0xb7, 0xf4, 0x5b,
+	0x63, 0x9e, 0x6f, 0xd4, 0xfd, 0x41, 0x49, 0x10, 0x34, 0xd1, 0x48, 0x08,
+	0x40, 0x9d, 0xa6, 0xe8, 0xc9, 0x35, 0x85, 0x4f, 0x48, 0xf7, 0x54, 0x94,
+	0x77, 0x33, 0xcc, 0x68, 0x42, 0xef, 0x76, 0x56, 0xac, 0x82, 0xd1, 0x55,
+	0xcd, 0xe7, 0x98, 0x83, 0x5d, 0x4c, 0x49, 0xda, 0x6e, 0x57, 0x2a, 0xcc,
+	0x09, 0x9d, 0x7b, 0x21, 0xd8, 0xa0, 0xe9, 0x96, 0xd9, 0xa8, 0xd1, 0x0c,
+	0x32, 0x57, 0x2e, 0x96, 0x2a, 0x09, 0x66, 0xa4, 0xb4, 0xc6, 0xac, 0xee,
+	0x0d, 0x26, 0x15, 0xa1, 0x0f, 0x38, 0xf9, 0x94, 0x2b, 0xe7, 0x60, 0x45,
+	0x72, 0xea, 0x50, 0xff, 0x52, 0x3a, 0xc3, 0xd0, 0x45, 0x5f, 0x33, 0xd0,
+	0x9c, 0x23, 0xc4, 0xa0, 0xed, 0x85, 0x14, 0xc5, 0x68, 0xe1, 0x86, 0xa8,
+	0x73, 0x6c, 0x08, 0x53, 0xbd, 0xb4, 0x42, 0xc2, 0xe0, 0x31, 0x3f, 0xeb,
+	0x31, 0x92, 0xd5, 0x7c, 0xb8, 0x67, 0x39, 0x1b, 0x9f, 0xea, 0x1e, 0xc0,
+	0xb3, 0x66, 0x2a, 0xbb, 0x7d, 0xa6, 0xc2, 0x2c, 0xcd, 0xdc, 0x8c, 0x34,
+	0xc5, 0xd0, 0x36, 0x64, 0x8d, 0xb7, 0xfd, 0x08, 0x52, 0x00, 0x00, 0x00,
+	0xc1, 0xae, 0x82, 0x9f, 0x03, 0xc0, 0x88, 0x01, 0xb0, 0x0d, 0x21, 0x01,
+	0x16, 0x00, 0x00, 0x00, 0x5e, 0x25, 0x88, 0x7c, 0xe0, 0x06, 0xaf, 0x00,
+	0x80, 0x5d, 0x00, 0x1a, 0x8c, 0x43, 0xb1, 0xf7, 0xad, 0xa5, 0x27, 0xa6,
+	0xc8, 0x51, 0x52, 0x43, 0xb5, 0x71, 0x92, 0x38, 0x43, 0x01, 0xc5, 0x4d,
+	0x07, 0xbd, 0xb8, 0x2b, 0x32, 0x2d, 0x9b, 0x33, 0xe6, 0xda, 0x0b, 0xf3,
+	0xd7, 0x3e, 0xa8, 0x3e, 0xe2, 0xd5, 0x2c, 0xd2, 0x89, 0x4b, 0x97, 0xe0,
+	0x86, 0x52, 0x0a, 0x52, 0x6a, 0xb7, 0x0a, 0x8b, 0xd6, 0xd7, 0xed, 0xd0,
+	0xd3, 0xd3, 0x7b, 0x40, 0xbd, 0xd6, 0x67, 0x2f, 0xd1, 0x23, 0x2c, 0x82,
+	0x94, 0x49, 0xcb, 0x05, 0x71, 0xfd, 0x69, 0x09, 0xdf, 0x29, 0xb8, 0xbc,
+	0xea, 0x9b, 0x14, 0x99, 0x44, 0xba, 0x08, 0x48, 0x76, 0x53, 0x80, 0x33,
+	0x03, 0x9d, 0xdf, 0x98, 0x0b, 0x25, 0xca, 0xa0, 0xc2, 0xd5, 0x9a, 0xb0,
+	0xbf, 0x4a, 0xd8, 0xb2, 0xcc, 0x1e, 0x8f, 0x23, 0x12, 0x32, 0x83, 0xfc,
+	0x17, 0x1e, 0x0b, 0x27, 0x5a, 0x6a, 0x4b, 0xc2, 0xe8, 0x80, 0x00, 0x00,
+	0x3c, 0x83, 0x3b, 0xed, 0x00, 0x04, 0xd0, 0x01, 0x80, 0x20, 0xeb, 0x01,
+	0x80, 0x20, 0xce, 0x01, 0x80, 0x20, 0x9c, 0x01, 0xb0, 0x0d, 0x00, 0x00,
+	0x7d, 0x92, 0xd8, 0x5b, 0x86, 0x00, 0x08, 0x96, 0x05, 0x00, 0x00, 0x00,
+	0x00, 0x01, 0x59, 0x5a,
+};
+
+/* xz --check=crc32 -T1 of 64 lines: a single Block without sizes */
+static const uint8_t xz_test_single[] = {
+	0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x01, 0x69, 0x22, 0xde, 0x36,
+	0x02, 0x00, 0x21, 0x01, 0x16, 0x00, 0x00, 0x00, 0x74, 0x2f, 0xe5, 0xa3,
+	0xe0, 0x08, 0xbf, 0x00, 0x8c, 0x5d, 0x00, 0x18, 0x69, 0x0a, 0x84, 0x06,
+	0x63, 0xf3, 0xe7, 0x62, 0x23, 0xb6, 0x32, 0x30, 0xa9, 0x59, 0x97, 0xc3,
+	0xd6, 0xdc, 0x50, 0xe2, 0x31, 0x84, 0x99, 0xb5, 0xbe, 0xdf, 0x4f, 0x85,
+	0xa4, 0x0a, 0xab, 0xca, 0x21, 0x49, 0x17, 0x71, 0xdb, 0xf8, 0xb8, 0x52,
+	0xff, 0x19, 0xb9, 0x77, 0x7a, 0x1d, 0x09, 0x73, 0x04, 0xdf, 0x36, 0x66,
+	0x26, 0xa7, 0x0f, 0xff, 0x8e, 0x26, 0xce, 0x3c, 0xc2, 0x15, 0x43, 0x34,
+	0xc1, 0xfc, 0x9b, 0xdf, 0xc8, 0xd0, 0x4f, 0x46, 0xf7, 0xb4, 0xec, 0x94,
+	0x46, 0x90, 0x6d, 0x3c, 0xfe, 0x6d, 0x29, 0xad, 0x54, 0x4d, 0x5b, 0x50,
+	0x5f, 0xc7, 0xf5, 0xaf, 0xa4, 0x47, 0x6e, 0xce, 0x31, 0x39, 0xf9, 0xa9,
+	0x4e, 0xdc, 0x23, 0x85, 0x88, 0x5b, 0x37, 0xda, 0x86, 0x0b, 0x72, 0x58,
+	0x21, 0x01, 0xb0, 0xec, 0x48, 0xaa, 0x9c, 0x47, 0xb3, 0xe1, 0xc0, 0xc4,
+	0xcc, 0x41, 0xe2, 0x9c, 0xb3, 0xc6, 0x1b, 0x71, 0x27, 0x7a, 0x50, 0xc8,
+	0xf6, 0x4f, 0x00, 0x00, 0xbd, 0xaa, 0x7d, 0xeb, 0x00, 0x01, 0xa4, 0x01,
+	0xc0, 0x11, 0x00, 0x00, 0xd4, 0x89, 0x11, 0x17, 0x3e, 0x30, 0x0d, 0x8b,
+	0x02, 0x00, 0x00, 0x00, 0x00, 0x01, 0x59, 0x5a,
+};
+
+static char *xz_test_expected(struct kunit *test, unsigned int lines)
+{
+	char *buf;
+	unsigned int i;
+
+	buf = kunit_kmalloc(test, lines * XZ_TEST_LINE_LEN + 1, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+
+	for (i = 0; i < lines; i++)
+		scnprintf(buf + i * XZ_TEST_LINE_LEN, XZ_TEST_LINE_LEN + 1,
+			  XZ_TEST_LINE, i);
+	return buf;
+}
+
+static struct xz_dec *xz_test_dec(struct kunit *test)
+{
+	struct xz_dec *s = xz_dec_init(XZ_SINGLE, 0);
+
+	KUNIT_ASSERT_NOT_NULL(test, s);
+	return s;
+}
+
+/* Copy @in so that tests can corrupt it, with some Stream Padding after it */
+static uint8_t *xz_test_input(struct kunit *test, const uint8_t *in,
+			      size_t size)
+{
+	uint8_t *buf = kunit_kzalloc(test, size + 8, GFP_KERNEL);
+
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	memcpy(buf, in, size);
+	return buf;
+}
+
+static void xz_test_scan(struct kunit *test, struct xz_dec *s,
+			 const uint8_t *in, struct xz_block *blocks,
+			 size_t *nr)
+{
+	struct xz_buf b = { .in = in, .in_size = sizeof(xz_test_multi) + 8 };
+
+	*nr = XZ_TEST_MULTI_BLOCKS;
+	KUNIT_ASSERT_EQ(test, xz_dec_scan(s, &b, blocks, nr), XZ_STREAM_END);
+	KUNIT_ASSERT_EQ(test, *nr, XZ_TEST_MULTI_BLOCKS);
+
+	/* The Stream Padding is left to the caller. */
+	KUNIT_EXPECT_EQ(test, b.in_pos, sizeof(xz_test_multi));
+}
+
+static void xz_test_blocks(struct kunit *test)
+{
+	struct xz_block blocks[XZ_TEST_MULTI_BLOCKS];
+	size_t out_size = 0, out_pos[XZ_TEST_MULTI_BLOCKS];
+	struct xz_dec *s = xz_test_dec(test);
+	uint8_t *in, *out;
+	char *expected;
+	size_t nr;
+	int i;
+
+	in = xz_test_input(test, xz_test_multi, sizeof(xz_test_multi));
+	xz_test_scan(test, s, in, blocks, &nr);
+
+	for (i = 0; i < XZ_TEST_MULTI_BLOCKS; i++) {
+		out_pos[i] = out_size;
+		out_size += blocks[i].out_size;
+	}
+	KUNIT_ASSERT_EQ(test, out_size, XZ_TEST_MULTI_LINES * XZ_TEST_LINE_LEN);
+
+	out = kunit_kzalloc(test, out_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, out);
+
+	/* Blocks are independent, so decode them back to front. */
+	for (i = XZ_TEST_MULTI_BLOCKS - 1; i >= 0; i--) {
+		struct xz_buf b = {
+			.in = in + blocks[i].in_pos,
+			.in_size = blocks[i].in_size,
+			.out = out + out_pos[i],
+			.out_size = blocks[i].out_size,
+		};
+
+		KUNIT_ASSERT_EQ(test, xz_dec_block_run(s, &blocks[i], &b),
+				XZ_STREAM_END);
+		KUNIT_EXPECT_EQ(test, b.in_pos, blocks[i].in_size);
+		KUNIT_EXPECT_EQ(test, b.out_pos, blocks[i].out_size);
+	}
+
+	expected = xz_test_expected(test, XZ_TEST_MULTI_LINES);
+	KUNIT_EXPECT_MEMEQ(test, out, expected, out_size);
+
+	xz_dec_end(s);
+}
+
+static void xz_test_scan_limits(struct kunit *test)
+{
+	struct xz_buf b = { .in = xz_test_multi, .in_size = sizeof(xz_test_multi) };
+	struct xz_block blocks[XZ_TEST_MULTI_BLOCKS - 1];
+	struct xz_dec *s = xz_test_dec(test);
+	size_t nr;
+
+	/* Counting only */
+	nr = 0;
+	KUNIT_EXPECT_EQ(test, xz_dec_scan(s, &b, NULL, &nr), XZ_STREAM_END);
+	KUNIT_EXPECT_EQ(test, nr, XZ_TEST_MULTI_BLOCKS);
+
+	/* Too small a table reports the number of Blocks needed */
+	b.in_pos = 0;
+	nr = ARRAY_SIZE(blocks);
+	KUNIT_EXPECT_EQ(test, xz_dec_scan(s, &b, blocks, &nr), XZ_MEM_ERROR);
+	KUNIT_EXPECT_EQ(test, nr, XZ_TEST_MULTI_BLOCKS);
+	KUNIT_EXPECT_EQ(test, b.in_pos, 0);
+
+	/* Truncated Stream */
+	b.in_size = sizeof(xz_test_multi) - 1;
+	KUNIT_EXPECT_EQ(test, xz_dec_scan(s, &b, NULL, &nr), XZ_DATA_ERROR);
+
+	/* Without sizes in the Block Header, only xz_dec_run() can decode it. */
+	b.in = xz_test_single;
+	b.in_size = sizeof(xz_test_single);
+	KUNIT_EXPECT_EQ(test, xz_dec_scan(s, &b, NULL, &nr), XZ_OPTIONS_ERROR);
+
+	xz_dec_end(s);
+}
+
+static void xz_test_corrupt(struct kunit *test)
+{
+	struct xz_block blocks[XZ_TEST_MULTI_BLOCKS];
+	struct xz_dec *s = xz_test_dec(test);
+	struct xz_buf b = {};
+	uint8_t *in, *out;
+	size_t nr;
+
+	in = xz_test_input(test, xz_test_multi, sizeof(xz_test_multi));
+	xz_test_scan(test, s, in, blocks, &nr);
+
+	out = kunit_kzalloc(test, blocks[1].out_size, GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, out);
+
+	/* Compressed Data is only validated when the Block is decoded. */
+	in[blocks[1].in_pos + blocks[1].in_size / 2] ^= 0x01;
+	xz_test_scan(test, s, in, blocks, &nr);
+
+	b.in = in + blocks[1].in_pos;
+	b.in_size = blocks[1].in_size;
+	b.out = out;
+	b.out_size = blocks[1].out_size;
+	KUNIT_EXPECT_EQ(test, xz_dec_block_run(s, &blocks[1], &b), XZ_DATA_ERROR);
+	KUNIT_EXPECT_EQ(test, b.in_pos, 0);
+	KUNIT_EXPECT_EQ(test, b.out_pos, 0);
+	in[blocks[1].in_pos + blocks[1].in_size / 2] ^= 0x01;
+
+	/* A Block must not run into the next one. */
+	b.in_size = blocks[1].in_size + blocks[2].in_size;
+	KUNIT_EXPECT_EQ(test, xz_dec_block_run(s, &blocks[1], &b), XZ_DATA_ERROR);
+
+	/* The Index has to match the Block Headers. */
+	in[sizeof(xz_test_multi) - 12 - 8] ^= 0x01;
+	b.in = in;
+	b.in_pos = 0;
+	b.in_size = sizeof(xz_test_multi);
+	nr = XZ_TEST_MULTI_BLOCKS;
+	KUNIT_EXPECT_EQ(test, xz_dec_scan(s, &b, blocks, &nr), XZ_DATA_ERROR);
+
+	xz_dec_end(s);
+}
+
+static struct kunit_case xz_dec_test_cases[] = {
+	KUNIT_CASE(xz_test_blocks),
+	KUNIT_CASE(xz_test_scan_limits),
+	KUNIT_CASE(xz_test_corrupt),
+	{}
+};
+
+static struct kunit_suite xz_dec_test_suite = {
+	.name = "xz_dec",
+	.test_cases = xz_dec_test_cases,
+};
+kunit_test_suite(xz_dec_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests for block-level XZ decoding");
+MODULE_LICENSE("GPL");
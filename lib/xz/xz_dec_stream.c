@@ -133,6 +133,20 @@ struct xz_dec {
 	struct xz_dec_bcj *bcj;
 	bool bcj_active;
 #endif
+
+#ifdef XZ_DEC_MT
+	/* True when xz_dec_block_run() is decoding a lone Block */
+	bool single_block;
+
+	/*
+	 * Block table filled by xz_dec_scan(), or NULL when decoding.
+	 * Only the first scan.max Blocks are stored.
+	 */
+	struct {
+		struct xz_block *blocks;
+		size_t max;
+	} scan;
+#endif
 };
 
 #ifdef XZ_DEC_ANY_CHECK
@@ -202,6 +216,25 @@ static enum xz_ret dec_vli(struct xz_dec *s, const uint8_t *in,
 	return XZ_OK;
 }
 
+/* Add a finished Block to the hash used to validate the Index field. */
+static void block_hash_update(struct xz_dec *s)
+{
+	s->block.hash.unpadded += s->block_header.size + s->block.compressed;
+
+#ifdef XZ_DEC_ANY_CHECK
+	s->block.hash.unpadded += check_sizes[s->check_type];
+#else
+	if (s->check_type == XZ_CHECK_CRC32)
+		s->block.hash.unpadded += 4;
+#endif
+
+	s->block.hash.uncompressed += s->block.uncompressed;
+	s->block.hash.crc32 = xz_crc32((const uint8_t *)&s->block.hash,
+			sizeof(s->block.hash), s->block.hash.crc32);
+
+	++s->block.count;
+}
+
 /*
  * Decode the Compressed Data field from a Block. Update and validate
  * the observed compressed and uncompressed sizes of the Block so that
@@ -255,26 +288,62 @@ static enum xz_ret dec_block(struct xz_dec *s, struct xz_buf *b)
 					!= s->block.uncompressed)
 			return XZ_DATA_ERROR;
 
-		s->block.hash.unpadded += s->block_header.size
-				+ s->block.compressed;
+		block_hash_update(s);
+	}
+
+	return ret;
+}
+
+#ifdef XZ_DEC_MT
+/*
+ * Skip over the Compressed Data, Block Padding, and Check fields of a Block
+ * without decoding them and record where the Block is. This needs both
+ * sizes in the Block Header, which is what multithreaded encoders store.
+ * The skipped fields are validated later by xz_dec_block_run().
+ */
+static enum xz_ret scan_block(struct xz_dec *s, struct xz_buf *b)
+{
+	size_t avail = b->in_size - b->in_pos;
+	struct xz_block *block;
+	vli_type size;
+
+	if (s->block_header.compressed == VLI_UNKNOWN
+			|| s->block_header.uncompressed == VLI_UNKNOWN)
+		return XZ_OPTIONS_ERROR;
+
+	if (s->block_header.compressed > avail)
+		return XZ_DATA_ERROR;
 
+	size = (s->block_header.compressed + 3) & ~(vli_type)3;
 #ifdef XZ_DEC_ANY_CHECK
-		s->block.hash.unpadded += check_sizes[s->check_type];
+	size += check_sizes[s->check_type];
 #else
-		if (s->check_type == XZ_CHECK_CRC32)
-			s->block.hash.unpadded += 4;
+	if (s->check_type == XZ_CHECK_CRC32)
+		size += 4;
 #endif
 
-		s->block.hash.uncompressed += s->block.uncompressed;
-		s->block.hash.crc32 = xz_crc32(
-				(const uint8_t *)&s->block.hash,
-				sizeof(s->block.hash), s->block.hash.crc32);
+	if (size > avail)
+		return XZ_DATA_ERROR;
+
+	if (s->block_header.uncompressed > (size_t)-1)
+		return XZ_MEM_ERROR;
 
-		++s->block.count;
+	if (s->block.count < s->scan.max) {
+		block = &s->scan.blocks[s->block.count];
+		block->in_pos = b->in_pos - s->block_header.size;
+		block->in_size = s->block_header.size + size;
+		block->out_size = s->block_header.uncompressed;
+		block->check = s->check_type;
 	}
 
-	return ret;
+	b->in_pos += size;
+	s->block.compressed = s->block_header.compressed;
+	s->block.uncompressed = s->block_header.uncompressed;
+	block_hash_update(s);
+
+	return XZ_STREAM_END;
 }
+#endif
 
 /* Update the Index size and the CRC32 value. */
 static void index_update(struct xz_dec *s, const struct xz_buf *b)
@@ -591,6 +660,10 @@ static enum xz_ret dec_main(struct xz_dec *s, struct xz_buf *b)
 
 			/* See if this is the beginning of the Index field. */
 			if (b->in[b->in_pos] == 0) {
+#ifdef XZ_DEC_MT
+				if (s->single_block)
+					return XZ_DATA_ERROR;
+#endif
 				s->in_start = b->in_pos++;
 				s->sequence = SEQ_INDEX;
 				break;
@@ -622,6 +695,16 @@ static enum xz_ret dec_main(struct xz_dec *s, struct xz_buf *b)
 			fallthrough;
 
 		case SEQ_BLOCK_UNCOMPRESS:
+#ifdef XZ_DEC_MT
+			if (s->scan.blocks != NULL) {
+				ret = scan_block(s, b);
+				if (ret != XZ_STREAM_END)
+					return ret;
+
+				s->sequence = SEQ_BLOCK_START;
+				break;
+			}
+#endif
 			ret = dec_block(s, b);
 			if (ret != XZ_STREAM_END)
 				return ret;
@@ -664,6 +747,11 @@ static enum xz_ret dec_main(struct xz_dec *s, struct xz_buf *b)
 			}
 #endif
 
+#ifdef XZ_DEC_MT
+			if (s->single_block)
+				return XZ_STREAM_END;
+#endif
+
 			s->sequence = SEQ_BLOCK_START;
 			break;
 
@@ -782,6 +870,72 @@ enum xz_ret xz_dec_run(struct xz_dec *s, struct xz_buf *b)
 	return ret;
 }
 
+#ifdef XZ_DEC_MT
+enum xz_ret xz_dec_scan(struct xz_dec *s, struct xz_buf *b,
+			struct xz_block *blocks, size_t *nr_blocks)
+{
+	size_t in_start = b->in_pos;
+	struct xz_block dummy;
+	enum xz_ret ret;
+
+	if (!DEC_IS_SINGLE(s->mode))
+		return XZ_OPTIONS_ERROR;
+
+	xz_dec_reset(s);
+	s->scan.blocks = blocks != NULL ? blocks : &dummy;
+	s->scan.max = blocks != NULL ? *nr_blocks : 0;
+
+	ret = dec_main(s, b);
+	if (ret == XZ_OK)
+		ret = XZ_DATA_ERROR;
+
+	if (ret == XZ_STREAM_END) {
+		if (blocks != NULL && s->block.count > *nr_blocks)
+			ret = XZ_MEM_ERROR;
+
+		*nr_blocks = s->block.count;
+	}
+
+	if (ret != XZ_STREAM_END)
+		b->in_pos = in_start;
+
+	s->scan.blocks = NULL;
+	return ret;
+}
+
+enum xz_ret xz_dec_block_run(struct xz_dec *s, const struct xz_block *block,
+			     struct xz_buf *b)
+{
+	size_t in_start = b->in_pos;
+	size_t out_start = b->out_pos;
+	enum xz_ret ret;
+
+	if (!DEC_IS_SINGLE(s->mode) || block->check > XZ_CHECK_CRC32)
+		return XZ_OPTIONS_ERROR;
+
+	xz_dec_reset(s);
+	s->check_type = block->check;
+	s->single_block = true;
+	s->sequence = SEQ_BLOCK_START;
+
+	ret = dec_main(s, b);
+	if (ret == XZ_OK)
+		ret = b->in_pos == b->in_size ? XZ_DATA_ERROR : XZ_BUF_ERROR;
+
+	/* The Block has to fill the input exactly. */
+	if (ret == XZ_STREAM_END && (b->in_pos != b->in_size
+			|| b->out_pos - out_start != block->out_size))
+		ret = XZ_DATA_ERROR;
+
+	if (ret != XZ_STREAM_END) {
+		b->in_pos = in_start;
+		b->out_pos = out_start;
+	}
+
+	return ret;
+}
+#endif
+
 struct xz_dec *xz_dec_init(enum xz_mode mode, uint32_t dict_max)
 {
 	struct xz_dec *s = kmalloc(sizeof(*s), GFP_KERNEL);
@@ -822,6 +976,10 @@ void xz_dec_reset(struct xz_dec *s)
 	memzero(&s->index, sizeof(s->index));
 	s->temp.pos = 0;
 	s->temp.size = STREAM_HEADER_SIZE;
+#ifdef XZ_DEC_MT
+	s->single_block = false;
+	s->scan.blocks = NULL;
+#endif
 }
 
 void xz_dec_end(struct xz_dec *s)
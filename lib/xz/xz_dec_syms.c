@@ -14,6 +14,11 @@ EXPORT_SYMBOL(xz_dec_reset);
 EXPORT_SYMBOL(xz_dec_run);
 EXPORT_SYMBOL(xz_dec_end);
 
+#ifdef CONFIG_XZ_DEC_MT
+EXPORT_SYMBOL(xz_dec_scan);
+EXPORT_SYMBOL(xz_dec_block_run);
+#endif
+
 #ifdef CONFIG_XZ_DEC_MICROLZMA
 EXPORT_SYMBOL(xz_dec_microlzma_alloc);
 EXPORT_SYMBOL(xz_dec_microlzma_reset);
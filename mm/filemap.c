@@ -2533,7 +2533,7 @@ static int filemap_readahead(struct kiocb *iocb, struct file *file,
 }
 
 static int filemap_get_pages(struct kiocb *iocb, size_t count,
-		struct folio_batch *fbatch, bool need_uptodate)
+		struct folio_batch *fbatch, bool need_uptodate, bool *ra_miss)
 {
 	struct file *filp = iocb->ki_filp;
 	struct address_space *mapping = filp->f_mapping;
@@ -2556,6 +2556,7 @@ static int filemap_get_pages(struct kiocb *iocb, size_t count,
 			return -EAGAIN;
 		if (iocb->ki_flags & IOCB_NOWAIT)
 			flags = memalloc_noio_save();
+		*ra_miss = true;
 		page_cache_sync_readahead(mapping, ra, filp, index,
 				last_index - index);
 		if (iocb->ki_flags & IOCB_NOWAIT)
@@ -2578,6 +2579,7 @@ static int filemap_get_pages(struct kiocb *iocb, size_t count,
 			goto err;
 	}
 	if (!folio_test_uptodate(folio)) {
+		*ra_miss = true;
 		if ((iocb->ki_flags & IOCB_WAITQ) &&
 		    folio_batch_count(fbatch) > 1)
 			iocb->ki_flags |= IOCB_NOWAIT;
@@ -2628,7 +2630,8 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 	struct inode *inode = mapping->host;
 	struct folio_batch fbatch;
 	int i, error = 0;
-	bool writably_mapped;
+	bool writably_mapped, ra_miss = false;
+	bool nocache = iter->nocache, streaming;
 	loff_t isize, end_offset;
 	loff_t last_pos = ra->prev_pos;
 
@@ -2639,6 +2642,7 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 
 	iov_iter_truncate(iter, inode->i_sb->s_maxbytes - iocb->ki_pos);
 	folio_batch_init(&fbatch);
+	streaming = iov_iter_nocache_size(already_read + iov_iter_count(iter));
 
 	do {
 		cond_resched();
@@ -2654,10 +2658,19 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 		if (unlikely(iocb->ki_pos >= i_size_read(inode)))
 			break;
 
-		error = filemap_get_pages(iocb, iter->count, &fbatch, false);
+		error = filemap_get_pages(iocb, iter->count, &fbatch, false,
+					  &ra_miss);
 		if (error < 0)
 			break;
 
+		/*
+		 * A large read that had to go to disk is most likely streamed
+		 * and not looked at again soon, keep the rest of it out of the
+		 * CPU cache. Only when vm.iov_iter_nocache_threshold is set.
+		 */
+		if (ra_miss && streaming)
+			iov_iter_set_nocache(iter, true);
+
 		/*
 		 * i_size must be checked after we know the pages are Uptodate.
 		 *
@@ -2722,6 +2735,7 @@ ssize_t filemap_read(struct kiocb *iocb, struct iov_iter *iter,
 		folio_batch_init(&fbatch);
 	} while (iov_iter_count(iter) && iocb->ki_pos < isize && !error);
 
+	iov_iter_set_nocache(iter, nocache);
 	file_accessed(filp);
 	ra->prev_pos = last_pos;
 	return already_read ? already_read : error;
@@ -2907,7 +2921,7 @@ ssize_t filemap_splice_read(struct file *in, loff_t *ppos,
 	struct kiocb iocb;
 	size_t total_spliced = 0, used, npages;
 	loff_t isize, end_offset;
-	bool writably_mapped;
+	bool writably_mapped, ra_miss;
 	int i, error = 0;
 
 	if (unlikely(*ppos >= in->f_mapping->host->i_sb->s_maxbytes))
@@ -2930,7 +2944,7 @@ ssize_t filemap_splice_read(struct file *in, loff_t *ppos,
 			break;
 
 		iocb.ki_pos = *ppos;
-		error = filemap_get_pages(&iocb, len, &fbatch, true);
+		error = filemap_get_pages(&iocb, len, &fbatch, true, &ra_miss);
 		if (error < 0)
 			break;
 
@@ -4139,7 +4153,8 @@ ssize_t __generic_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 	struct file *file = iocb->ki_filp;
 	struct address_space *mapping = file->f_mapping;
 	struct inode *inode = mapping->host;
-	ssize_t ret;
+	ssize_t ret, written;
+	bool nocache;
 
 	ret = file_remove_privs(file);
 	if (ret)
@@ -4160,8 +4175,12 @@ ssize_t __generic_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 		 */
 		if (ret < 0 || !iov_iter_count(from) || IS_DAX(inode))
 			return ret;
-		return direct_write_fallback(iocb, from, ret,
-				generic_perform_write(iocb, from));
+		/* The caller asked for uncached I/O, don't fill the CPU cache */
+		nocache = from->nocache;
+		iov_iter_set_nocache(from, true);
+		written = generic_perform_write(iocb, from);
+		iov_iter_set_nocache(from, nocache);
+		return direct_write_fallback(iocb, from, ret, written);
 	}
 
 	return generic_perform_write(iocb, from);
@@ -4678,6 +4678,13 @@ static int shmem_fill_super(struct super_block *sb, struct fs_context *fc)
 	raw_spin_lock_init(&sbinfo->stat_lock);
 	if (percpu_counter_init(&sbinfo->used_blocks, 0, GFP_KERNEL))
 		goto failed;
+	/*
+	 * Every page allocation of a size limited tmpfs checks used_blocks
+	 * against max_blocks; close to the limit, the LLC partial sums spare
+	 * most of those checks the walk over all CPUs.
+	 */
+	if (percpu_counter_enable_llc(&sbinfo->used_blocks, GFP_KERNEL))
+		goto failed;
 	spin_lock_init(&sbinfo->shrinklist_lock);
 	INIT_LIST_HEAD(&sbinfo->shrinklist);
 
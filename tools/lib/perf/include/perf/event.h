@@ -381,6 +381,13 @@ struct perf_record_aux_output_hw_id {
 	__u64			hw_id;
 };
 
+struct perf_record_callchain_stack {
+	struct perf_event_header header;
+	__u64			 id;
+	__u64			 nr;
+	__u64			 ips[];
+};
+
 struct perf_record_thread_map_entry {
 	__u64			 pid;
 	char			 comm[16];
@@ -509,6 +516,7 @@ union perf_event {
 	struct perf_record_aux			aux;
 	struct perf_record_itrace_start		itrace_start;
 	struct perf_record_aux_output_hw_id	aux_output_hw_id;
+	struct perf_record_callchain_stack	callchain_stack;
 	struct perf_record_switch		context_switch;
 	struct perf_record_thread_map		thread_map;
 	struct perf_record_cpu_map		cpu_map;
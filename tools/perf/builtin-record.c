@@ -3382,6 +3382,10 @@ static struct option __record_options[] = {
 		    "collect data with this RT SCHED_FIFO priority"),
 	OPT_BOOLEAN(0, "no-buffering", &record.opts.no_buffering,
 		    "collect data without buffering"),
+	OPT_BOOLEAN(0, "wakeup-adaptive", &record.opts.wakeup_adaptive,
+		    "let the kernel adapt the wakeup watermark to the reader"),
+	OPT_BOOLEAN(0, "callchain-dedup", &record.opts.callchain_dedup,
+		    "record each distinct callchain once and refer to it by id"),
 	OPT_BOOLEAN('R', "raw-samples", &record.opts.raw_samples,
 		    "collect raw sample records from all opened counters"),
 	OPT_BOOLEAN('a', "all-cpus", &record.opts.target.system_wide,
@@ -58,6 +58,7 @@ static const char *perf_event__names[] = {
 	[PERF_RECORD_CGROUP]			= "CGROUP",
 	[PERF_RECORD_TEXT_POKE]			= "TEXT_POKE",
 	[PERF_RECORD_AUX_OUTPUT_HW_ID]		= "AUX_OUTPUT_HW_ID",
+	[PERF_RECORD_CALLCHAIN_STACK]		= "CALLCHAIN_STACK",
 	[PERF_RECORD_HEADER_ATTR]		= "ATTR",
 	[PERF_RECORD_HEADER_EVENT_TYPE]		= "EVENT_TYPE",
 	[PERF_RECORD_HEADER_TRACING_DATA]	= "TRACING_DATA",
@@ -468,6 +469,12 @@ size_t perf_event__fprintf_aux_output_hw_id(union perf_event *event, FILE *fp)
 		       event->aux_output_hw_id.hw_id);
 }
 
+size_t perf_event__fprintf_callchain_stack(union perf_event *event, FILE *fp)
+{
+	return fprintf(fp, " id: %"PRI_lu64" nr: %"PRI_lu64"\n",
+		       event->callchain_stack.id, event->callchain_stack.nr);
+}
+
 size_t perf_event__fprintf_switch(union perf_event *event, FILE *fp)
 {
 	bool out = event->header.misc & PERF_RECORD_MISC_SWITCH_OUT;
@@ -600,6 +607,9 @@ size_t perf_event__fprintf(union perf_event *event, struct machine *machine, FIL
 	case PERF_RECORD_AUX_OUTPUT_HW_ID:
 		ret += perf_event__fprintf_aux_output_hw_id(event, fp);
 		break;
+	case PERF_RECORD_CALLCHAIN_STACK:
+		ret += perf_event__fprintf_callchain_stack(event, fp);
+		break;
 	default:
 		ret += fprintf(fp, "\n");
 	}
@@ -34,11 +34,13 @@
 #include "util/stat.h"
 #include "util/util.h"
 #include "util/env.h"
+#include "util/hashmap.h"
 #include "util/intel-tpebs.h"
 #include <signal.h>
 #include <unistd.h>
 #include <sched.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "parse-events.h"
 #include <subcmd/parse-options.h>
@@ -170,14 +172,84 @@ static void evlist__purge(struct evlist *evlist)
 	evlist->core.nr_entries = 0;
 }
 
+static void evlist__free_callchain_stacks(struct evlist *evlist)
+{
+	struct hashmap_entry *cur;
+	size_t bkt;
+
+	if (evlist->callchain_stacks == NULL)
+		return;
+
+	hashmap__for_each_entry(evlist->callchain_stacks, cur, bkt)
+		free(cur->pvalue);
+	hashmap__free(evlist->callchain_stacks);
+	evlist->callchain_stacks = NULL;
+}
+
 void evlist__exit(struct evlist *evlist)
 {
+	evlist__free_callchain_stacks(evlist);
 	event_enable_timer__exit(&evlist->eet);
 	zfree(&evlist->mmap);
 	zfree(&evlist->overwrite_mmap);
 	perf_evlist__exit(&evlist->core);
 }
 
+static size_t callchain_stack__hash(long key, void *ctx __maybe_unused)
+{
+	return key;
+}
+
+static bool callchain_stack__equal(long key1, long key2, void *ctx __maybe_unused)
+{
+	return key1 == key2;
+}
+
+/* Remember the callchain of a PERF_RECORD_CALLCHAIN_STACK record. */
+int evlist__add_callchain_stack(struct evlist *evlist, union perf_event *event)
+{
+	struct perf_record_callchain_stack *rec = &event->callchain_stack;
+	struct ip_callchain *chain;
+	size_t size;
+
+	if (sizeof(*rec) + rec->nr * sizeof(u64) > event->header.size)
+		return -EINVAL;
+
+	if (evlist->callchain_stacks == NULL) {
+		evlist->callchain_stacks = hashmap__new(callchain_stack__hash,
+							callchain_stack__equal, NULL);
+		if (IS_ERR(evlist->callchain_stacks)) {
+			evlist->callchain_stacks = NULL;
+			return -ENOMEM;
+		}
+	}
+
+	size = sizeof(*chain) + rec->nr * sizeof(u64);
+	chain = malloc(size);
+	if (chain == NULL)
+		return -ENOMEM;
+
+	chain->nr = rec->nr;
+	memcpy(chain->ips, rec->ips, rec->nr * sizeof(u64));
+
+	/* Ids are unique, a duplicate can only come from a replayed file. */
+	if (hashmap__add(evlist->callchain_stacks, rec->id, chain))
+		free(chain);
+
+	return 0;
+}
+
+struct ip_callchain *evlist__find_callchain_stack(struct evlist *evlist, u64 id)
+{
+	struct ip_callchain *chain;
+
+	if (evlist->callchain_stacks == NULL ||
+	    !hashmap__find(evlist->callchain_stacks, id, &chain))
+		return NULL;
+
+	return chain;
+}
+
 void evlist__delete(struct evlist *evlist)
 {
 	if (evlist == NULL)
@@ -51,6 +51,8 @@ enum bkw_mmap_state {
 };
 
 struct event_enable_timer;
+struct hashmap;
+struct ip_callchain;
 
 struct evlist {
 	struct perf_evlist core;
@@ -84,6 +86,8 @@ struct evlist {
 		int	pos;	/* index at evlist core object to check signals */
 	} ctl_fd;
 	struct event_enable_timer *eet;
+	/* PERF_RECORD_CALLCHAIN_STACK callchains by stack id */
+	struct hashmap *callchain_stacks;
 };
 
 struct evsel_str_handler {
@@ -97,6 +101,9 @@ struct evlist *evlist__new_dummy(void);
 void evlist__init(struct evlist *evlist, struct perf_cpu_map *cpus,
 		  struct perf_thread_map *threads);
 void evlist__exit(struct evlist *evlist);
+
+int evlist__add_callchain_stack(struct evlist *evlist, union perf_event *event);
+struct ip_callchain *evlist__find_callchain_stack(struct evlist *evlist, u64 id);
 void evlist__delete(struct evlist *evlist);
 
 void evlist__add(struct evlist *evlist, struct evsel *entry);
@@ -868,6 +868,10 @@ static void __evsel__config_callchain(struct evsel *evsel, struct record_opts *o
 
 	attr->sample_max_stack = param->max_stack;
 
+	/* Stack records could be overwritten before their samples. */
+	if (opts->callchain_dedup && !opts->overwrite)
+		attr->callchain_dedup = 1;
+
 	if (opts->kernel_callchains)
 		attr->exclude_callchain_user = 1;
 	if (opts->user_callchains)
@@ -930,6 +934,7 @@ static void evsel__reset_callgraph(struct evsel *evsel, struct callchain_param *
 	struct perf_event_attr *attr = &evsel->core.attr;
 
 	evsel__reset_sample_bit(evsel, CALLCHAIN);
+	attr->callchain_dedup = 0;
 	if (param->record_mode == CALLCHAIN_LBR) {
 		evsel__reset_sample_bit(evsel, BRANCH_STACK);
 		attr->branch_sample_type &= ~(PERF_SAMPLE_BRANCH_USER |
@@ -1259,6 +1264,8 @@ void evsel__config(struct evsel *evsel, struct record_opts *opts,
 	if (opts->no_buffering) {
 		attr->watermark = 0;
 		attr->wakeup_events = 1;
+	} else if (opts->wakeup_adaptive) {
+		attr->wakeup_adaptive = 1;
 	}
 	if (opts->branch_stack && !evsel->no_aux_samples) {
 		evsel__set_sample_bit(evsel, BRANCH_STACK);
@@ -2089,6 +2096,10 @@ static int __evsel__prepare_open(struct evsel *evsel, struct perf_cpu_map *cpus,
 
 static void evsel__disable_missing_features(struct evsel *evsel)
 {
+	if (perf_missing_features.callchain_dedup)
+		evsel->core.attr.callchain_dedup = 0;
+	if (perf_missing_features.wakeup_adaptive)
+		evsel->core.attr.wakeup_adaptive = 0;
 	if (perf_missing_features.branch_counters)
 		evsel->core.attr.branch_sample_type &= ~PERF_SAMPLE_BRANCH_COUNTERS;
 	if (perf_missing_features.read_lost)
@@ -2144,7 +2155,15 @@ bool evsel__detect_missing_features(struct evsel *evsel)
 	 * Must probe features in the order they were added to the
 	 * perf_event_attr interface.
 	 */
-	if (!perf_missing_features.branch_counters &&
+	if (!perf_missing_features.callchain_dedup && evsel->core.attr.callchain_dedup) {
+		perf_missing_features.callchain_dedup = true;
+		pr_debug2("switching off callchain deduplication\n");
+		return true;
+	} else if (!perf_missing_features.wakeup_adaptive && evsel->core.attr.wakeup_adaptive) {
+		perf_missing_features.wakeup_adaptive = true;
+		pr_debug2("switching off adaptive wakeups\n");
+		return true;
+	} else if (!perf_missing_features.branch_counters &&
 	    (evsel->core.attr.branch_sample_type & PERF_SAMPLE_BRANCH_COUNTERS)) {
 		perf_missing_features.branch_counters = true;
 		pr_debug2("switching off branch counters support\n");
@@ -221,6 +221,8 @@ struct perf_missing_features {
 	bool weight_struct;
 	bool read_lost;
 	bool branch_counters;
+	bool wakeup_adaptive;
+	bool callchain_dedup;
 };
 
 extern struct perf_missing_features perf_missing_features;
@@ -15,6 +15,8 @@ struct record_opts {
 	struct target target;
 	bool	      inherit_stat;
 	bool	      no_buffering;
+	bool	      wakeup_adaptive;
+	bool	      callchain_dedup;
 	bool	      no_inherit;
 	bool	      no_inherit_set;
 	bool	      no_samples;
@@ -714,6 +714,7 @@ static perf_event__swap_op perf_event__swap_ops[] = {
 	[PERF_RECORD_CGROUP]		  = perf_event__cgroup_swap,
 	[PERF_RECORD_TEXT_POKE]		  = perf_event__text_poke_swap,
 	[PERF_RECORD_AUX_OUTPUT_HW_ID]	  = perf_event__all64_swap,
+	[PERF_RECORD_CALLCHAIN_STACK]	  = perf_event__all64_swap,
 	[PERF_RECORD_HEADER_ATTR]	  = perf_event__hdr_attr_swap,
 	[PERF_RECORD_HEADER_EVENT_TYPE]	  = perf_event__event_type_swap,
 	[PERF_RECORD_HEADER_TRACING_DATA] = perf_event__tracing_data_swap,
@@ -1270,6 +1271,17 @@ static int machines__deliver_event(struct machines *machines,
 			return 0;
 		}
 		dump_sample(evsel, event, sample, perf_env__arch(machine->env));
+		if (sample->callchain && sample->callchain->nr == 2 &&
+		    sample->callchain->ips[0] == PERF_CONTEXT_STACK_ID) {
+			struct ip_callchain *chain;
+
+			chain = evlist__find_callchain_stack(evlist, sample->callchain->ips[1]);
+			if (chain == NULL) {
+				++evlist->stats.nr_unknown_stacks;
+				return 0;
+			}
+			sample->callchain = chain;
+		}
 		return evlist__deliver_sample(evlist, tool, event, sample, evsel, machine);
 	case PERF_RECORD_MMAP:
 		return tool->mmap(tool, event, sample, machine);
@@ -1327,6 +1339,8 @@ static int machines__deliver_event(struct machines *machines,
 		return tool->text_poke(tool, event, sample, machine);
 	case PERF_RECORD_AUX_OUTPUT_HW_ID:
 		return tool->aux_output_hw_id(tool, event, sample, machine);
+	case PERF_RECORD_CALLCHAIN_STACK:
+		return evlist__add_callchain_stack(evlist, event);
 	default:
 		++evlist->stats.nr_unknown_events;
 		return -1;
@@ -1723,6 +1737,11 @@ static void perf_session__warn_about_errors(const struct perf_session *session)
 			    stats->nr_unknown_id);
 	}
 
+	if (stats->nr_unknown_stacks != 0) {
+		ui__warning("%u samples refer to a callchain stack id that was not recorded\n",
+			    stats->nr_unknown_stacks);
+	}
+
 	if (stats->nr_invalid_chains != 0) {
 		ui__warning("Found invalid callchains!\n\n"
 			    "%u out of %u events were discarded for this reason.\n\n"
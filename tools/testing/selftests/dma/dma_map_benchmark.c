@@ -21,10 +21,35 @@ static char *directions[] = {
 	"FROM_DEVICE",
 };
 
+static int run_benchmark(int fd, struct map_benchmark *map, int threads)
+{
+	map->threads = threads;
+	if (ioctl(fd, DMA_MAP_BENCHMARK, map)) {
+		perror("ioctl");
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * struct map_benchmark has no room for a loop count without changing the
+ * ioctl, so estimate the rate from the latencies: each thread maps, waits
+ * dma_trans_ns and unmaps, back to back.
+ */
+static unsigned long long map_rate(struct map_benchmark *map, int threads)
+{
+	double ns = (map->avg_map_100ns + map->avg_unmap_100ns) * 100.0 +
+		    map->dma_trans_ns;
+
+	return ns > 0 ? threads * 1e9 / ns : 0;
+}
+
 int main(int argc, char **argv)
 {
 	struct map_benchmark map;
-	int fd, opt;
+	int fd, opt, t;
+	/* scan thread counts 1, 2, 4, ... up to -t instead of a single run */
+	int scan = 0;
 	/* default single thread, run 20 seconds on NUMA_NO_NODE */
 	int threads = 1, seconds = 20, node = -1;
 	/* default dma mask 32bit, bidirectional DMA */
@@ -32,9 +57,7 @@ int main(int argc, char **argv)
 	/* default granule 1 PAGESIZE */
 	int granule = 1;
 
-	int cmd = DMA_MAP_BENCHMARK;
-
-	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:")) != -1) {
+	while ((opt = getopt(argc, argv, "t:s:n:b:d:x:g:S")) != -1) {
 		switch (opt) {
 		case 't':
 			threads = atoi(optarg);
@@ -57,6 +80,9 @@ int main(int argc, char **argv)
 		case 'g':
 			granule = atoi(optarg);
 			break;
+		case 'S':
+			scan = 1;
+			break;
 		default:
 			return -1;
 		}
@@ -112,17 +138,33 @@ int main(int argc, char **argv)
 	map.dma_trans_ns = xdelay;
 	map.granule = granule;
 
-	if (ioctl(fd, cmd, &map)) {
-		perror("ioctl");
-		exit(1);
+	if (scan) {
+		printf("dma mapping scan: seconds:%d node:%d dir:%s granule: %d\n",
+				seconds, node, directions[dir], granule);
+		printf("%8s %16s %12s %12s\n", "threads", "~map+unmap/s",
+				"map(us)", "unmap(us)");
+		for (t = 1; t <= threads; t *= 2) {
+			if (run_benchmark(fd, &map, t))
+				exit(1);
+			printf("%8d %16llu %12.1f %12.1f\n", t,
+					map_rate(&map, t),
+					map.avg_map_100ns/10.0,
+					map.avg_unmap_100ns/10.0);
+		}
+		return 0;
 	}
 
+	if (run_benchmark(fd, &map, threads))
+		exit(1);
+
 	printf("dma mapping benchmark: threads:%d seconds:%d node:%d dir:%s granule: %d\n",
 			threads, seconds, node, dir[directions], granule);
 	printf("average map latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_map_100ns/10.0, map.map_stddev/10.0);
 	printf("average unmap latency(us):%.1f standard deviation:%.1f\n",
 			map.avg_unmap_100ns/10.0, map.unmap_stddev/10.0);
+	printf("estimated map+unmap rate(per second):%llu\n",
+			map_rate(&map, threads));
 
 	return 0;
 }
@@ -0,0 +1,174 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Test PR_FUTEX_HASH and the private futex hash it controls: the slot count
+ * is validated and reported back, a waiter queued before a resize is still
+ * woken after it, and FUTEX_WAKE still fails on a futex with PI waiters,
+ * which stay in the global hash.
+ */
+
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/prctl.h>
+#include "logging.h"
+#include "futextest.h"
+
+#define TEST_NAME "futex-priv-hash"
+#define WAKE_WAIT_US 10000
+
+#ifndef PR_FUTEX_HASH
+#define PR_FUTEX_HASH			74
+# define PR_FUTEX_HASH_SET_SLOTS	1
+# define PR_FUTEX_HASH_GET_SLOTS	2
+#endif
+
+static futex_t futex_word;
+static futex_t pi_word;
+
+void usage(char *prog)
+{
+	printf("Usage: %s\n", prog);
+	printf("  -c	Use color\n");
+	printf("  -h	Display this help message\n");
+	printf("  -v L	Verbosity level: %d=QUIET %d=CRITICAL %d=INFO\n",
+	       VQUIET, VCRITICAL, VINFO);
+}
+
+static int futex_hash_slots_set(unsigned int slots)
+{
+	return prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_SET_SLOTS, slots, 0, 0);
+}
+
+static int futex_hash_slots_get(void)
+{
+	return prctl(PR_FUTEX_HASH, PR_FUTEX_HASH_GET_SLOTS, 0, 0, 0);
+}
+
+static void *waiterfn(void *arg)
+{
+	struct timespec to = { .tv_sec = 5 };
+
+	if (futex_wait(&futex_word, 0, &to, FUTEX_PRIVATE_FLAG))
+		printf("waiter failed errno %d\n", errno);
+
+	return NULL;
+}
+
+static void *pi_waiterfn(void *arg)
+{
+	struct timespec to = { .tv_sec = 5 };
+
+	if (futex_lock_pi(&pi_word, &to, 0, FUTEX_PRIVATE_FLAG))
+		printf("pi waiter failed errno %d\n", errno);
+	else
+		futex_unlock_pi(&pi_word, FUTEX_PRIVATE_FLAG);
+
+	return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+	int res, ret = RET_PASS, c;
+	pthread_t waiter;
+
+	while ((c = getopt(argc, argv, "chv:")) != -1) {
+		switch (c) {
+		case 'c':
+			log_color(1);
+			break;
+		case 'h':
+			usage(basename(argv[0]));
+			exit(0);
+		case 'v':
+			log_verbosity(atoi(optarg));
+			break;
+		default:
+			usage(basename(argv[0]));
+			exit(1);
+		}
+	}
+
+	ksft_print_header();
+	ksft_set_plan(5);
+	ksft_print_msg("%s: Test PR_FUTEX_HASH\n", basename(argv[0]));
+
+	res = futex_hash_slots_get();
+	if (res < 0) {
+		if (errno == EINVAL)
+			ksft_exit_skip("PR_FUTEX_HASH not supported\n");
+		ksft_exit_fail_msg("PR_FUTEX_HASH_GET_SLOTS failed: %s\n",
+				   strerror(errno));
+	}
+
+	/* Slot counts must be a power of two */
+	res = futex_hash_slots_set(3);
+	if (res != -1 || errno != EINVAL) {
+		ksft_test_result_fail("set 3 slots returned: %d %s\n",
+				      res, strerror(errno));
+		ret = RET_FAIL;
+	} else {
+		ksft_test_result_pass("set 3 slots fails with EINVAL\n");
+	}
+
+	/* Still single threaded, so a private hash can be created */
+	res = futex_hash_slots_set(16);
+	if (res || futex_hash_slots_get() != 16) {
+		ksft_test_result_fail("set 16 slots returned: %d, get %d\n",
+				      res, futex_hash_slots_get());
+		ret = RET_FAIL;
+	} else {
+		ksft_test_result_pass("set 16 slots succeeds\n");
+	}
+
+	/* Resize with a waiter queued, which has to move with it */
+	info("Calling private futex_wait on futex: %p\n", &futex_word);
+	if (pthread_create(&waiter, NULL, waiterfn, NULL))
+		error("pthread_create failed\n", errno);
+
+	usleep(WAKE_WAIT_US);
+
+	res = futex_hash_slots_set(4);
+	if (res)
+		error("set 4 slots failed\n", errno);
+
+	info("Calling private futex_wake on futex: %p\n", &futex_word);
+	res = futex_wake(&futex_word, 1, FUTEX_PRIVATE_FLAG);
+	if (res != 1) {
+		ksft_test_result_fail("futex_wake after resize returned: %d %s\n",
+				      res, strerror(errno));
+		ret = RET_FAIL;
+	} else {
+		ksft_test_result_pass("futex_wake after resize succeeds\n");
+	}
+	pthread_join(waiter, NULL);
+
+	/* PI waiters are queued in the global hash; FUTEX_WAKE must see them */
+	pi_word = syscall(SYS_gettid);
+	if (pthread_create(&waiter, NULL, pi_waiterfn, NULL))
+		error("pthread_create failed\n", errno);
+
+	usleep(WAKE_WAIT_US);
+
+	res = futex_wake(&pi_word, 1, FUTEX_PRIVATE_FLAG);
+	if (res != -1 || errno != EINVAL) {
+		ksft_test_result_fail("futex_wake on PI waiter returned: %d %s\n",
+				      res, strerror(errno));
+		ret = RET_FAIL;
+	} else {
+		ksft_test_result_pass("futex_wake on PI waiter fails with EINVAL\n");
+	}
+	futex_unlock_pi(&pi_word, FUTEX_PRIVATE_FLAG);
+	pthread_join(waiter, NULL);
+
+	/* 0 slots moves the process back to the global hash */
+	res = futex_hash_slots_set(0);
+	if (res || futex_hash_slots_get() != 0) {
+		ksft_test_result_fail("set 0 slots returned: %d, get %d\n",
+				      res, futex_hash_slots_get());
+		ret = RET_FAIL;
+	} else {
+		ksft_test_result_pass("set 0 slots succeeds\n");
+	}
+
+	ksft_print_cnts();
+	return ret;
+}
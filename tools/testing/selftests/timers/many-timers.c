@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Benchmark hrtimer start/cancel cost and expiry latency with a large
+ * number of armed timers, the way a server with many idle connections
+ * uses timerfd and epoll for connection timeouts.
+ *
+ * All timerfds are armed 2..30 seconds out on CLOCK_MONOTONIC, re-armed
+ * (a connection saw traffic) and finally disarmed. In between a small
+ * set of them is armed to expire within the next second and the
+ * expiry latency is measured while the far-out timers stay armed.
+ *
+ * Usage: many-timers [-n nr_timers]
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include "../kselftest.h"
+
+#define NSEC_PER_SEC		1000000000LL
+#define DEFAULT_TIMERS		20000
+#define NR_EXPIRING		1000
+#define UNREASONABLE_LATENCY	40000000LL	/* 40ms in nanoseconds */
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
+
+static int arm(int fd, long long expires)
+{
+	struct itimerspec its = {
+		.it_value.tv_sec = expires / NSEC_PER_SEC,
+		.it_value.tv_nsec = expires % NSEC_PER_SEC,
+	};
+
+	return timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/* Arm all timers 2..30s out and report the average cost per operation */
+static int arm_far(int *fds, int nr, const char *what)
+{
+	long long start, base = now_ns() + 2 * NSEC_PER_SEC;
+	int i;
+
+	start = now_ns();
+	for (i = 0; i < nr; i++) {
+		/* random() is only 31 bits, too few for 28s worth of ns */
+		long long r = ((long long)random() << 31) | random();
+
+		if (arm(fds[i], base + r % (28 * NSEC_PER_SEC))) {
+			ksft_print_msg("timerfd_settime: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+	ksft_print_msg("%-8s %d timers: %lld ns/op\n", what, nr, (now_ns() - start) / nr);
+	return 0;
+}
+
+static int cancel_all(int *fds, int nr)
+{
+	long long start = now_ns();
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		if (arm(fds[i], 0)) {
+			ksft_print_msg("timerfd_settime: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+	ksft_print_msg("%-8s %d timers: %lld ns/op\n", "cancel", nr, (now_ns() - start) / nr);
+	return 0;
+}
+
+/*
+ * Re-arm the first NR_EXPIRING timers to expire within the next second
+ * and measure how late they are delivered through epoll.
+ */
+static int expiry_latency(int *fds, long long *targets, int nr, int epfd)
+{
+	long long base = now_ns() + NSEC_PER_SEC / 10;
+	long long sum = 0, max = 0;
+	struct epoll_event ev[64];
+	int i, done = 0;
+
+	for (i = 0; i < nr; i++) {
+		targets[i] = base + (long long)random() % (NSEC_PER_SEC - NSEC_PER_SEC / 10);
+		if (arm(fds[i], targets[i]))
+			return -1;
+	}
+
+	while (done < nr) {
+		int n = epoll_wait(epfd, ev, 64, 5000);
+		long long now = now_ns();
+
+		if (n <= 0) {
+			ksft_print_msg("epoll_wait: %s\n", n ? strerror(errno) : "timed out");
+			return -1;
+		}
+
+		for (i = 0; i < n; i++) {
+			int idx = ev[i].data.u32;
+			unsigned long long ticks;
+			long long lat;
+
+			if (read(fds[idx], &ticks, sizeof(ticks)) != sizeof(ticks))
+				continue;
+			if (idx >= nr) {
+				ksft_print_msg("far-out timer %d expired early\n", idx);
+				return -1;
+			}
+			lat = now - targets[idx];
+			if (lat < 0) {
+				ksft_print_msg("timer %d expired %lld ns early\n", idx, -lat);
+				return -1;
+			}
+			sum += lat;
+			if (lat > max)
+				max = lat;
+			done++;
+		}
+	}
+
+	ksft_print_msg("expiry   %d timers: avg latency %lld ns, max %lld ns\n",
+		       nr, sum / nr, max);
+	return sum / nr > UNREASONABLE_LATENCY ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int nr = DEFAULT_TIMERS, nr_expiring, epfd, opt, i, ret;
+	struct rlimit rlim;
+	long long *targets;
+	int *fds;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			nr = atoi(optarg);
+			break;
+		default:
+			printf("Usage: %s [-n nr_timers]\n", argv[0]);
+			return KSFT_FAIL;
+		}
+	}
+
+	ksft_print_header();
+	ksft_set_plan(4);
+
+	if (nr < 1)
+		ksft_exit_fail_msg("invalid number of timers\n");
+
+	/* Leave some room for stdio and the epoll descriptor */
+	if (!getrlimit(RLIMIT_NOFILE, &rlim) && rlim.rlim_cur < (rlim_t)nr + 16) {
+		rlim.rlim_cur = rlim.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rlim);
+		getrlimit(RLIMIT_NOFILE, &rlim);
+		if (rlim.rlim_cur < (rlim_t)nr + 16)
+			ksft_exit_skip("RLIMIT_NOFILE too low for %d timers\n", nr);
+	}
+
+	fds = calloc(nr, sizeof(*fds));
+	targets = calloc(nr, sizeof(*targets));
+	if (!fds || !targets)
+		ksft_exit_fail_msg("out of memory\n");
+
+	epfd = epoll_create1(0);
+	if (epfd < 0)
+		ksft_exit_fail_msg("epoll_create1: %s\n", strerror(errno));
+
+	for (i = 0; i < nr; i++) {
+		struct epoll_event ev = { .events = EPOLLIN, .data.u32 = i };
+
+		fds[i] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+		if (fds[i] < 0)
+			ksft_exit_fail_msg("timerfd_create: %s\n", strerror(errno));
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[i], &ev))
+			ksft_exit_fail_msg("epoll_ctl: %s\n", strerror(errno));
+	}
+
+	srandom(getpid());
+	nr_expiring = nr < NR_EXPIRING ? nr : NR_EXPIRING;
+
+	ret = arm_far(fds, nr, "start");
+	ksft_test_result(!ret, "start\n");
+
+	ret = arm_far(fds, nr, "restart");
+	ksft_test_result(!ret, "restart\n");
+
+	ret = expiry_latency(fds, targets, nr_expiring, epfd);
+	ksft_test_result(!ret, "expiry latency\n");
+
+	ret = cancel_all(fds, nr);
+	ksft_test_result(!ret, "cancel\n");
+
+	for (i = 0; i < nr; i++)
+		close(fds[i]);
+	close(epfd);
+	free(targets);
+	free(fds);
+
+	ksft_finished();
+}